@@ -2,16 +2,22 @@
 
 #include "Arduino.h"
 #include "LedCube.h"
+#include "LedCubeRaster.h"
+#include "LedCubeTimeline.h"
+#include "LedCubeCoroutine.h"
+#include "LedCubeTransition.h"
+#include "LedCubeProfiler.h"
+#include "LedCubeSnapshot.h"
 
 LedCubeRefresher::LedCubeRefresher(LedCube * led_cube)
 	: _led_cube(led_cube)
 {
-	start(1000 / _led_cube->getRefreshFrequency());
+	start(_led_cube->getRefreshInterval());
 }
 
 unsigned long LedCubeRefresher::run() {
 	_led_cube->update();
-	return 0;
+	return _led_cube->getRefreshInterval();
 }
 
 
@@ -19,50 +25,60 @@ unsigned long LedCubeRefresher::run() {
 
 // TODO: led_cube_map nahradit pomocí "new" při konstruktoru a "delete" při destruktoru - https://forum.arduino.cc/index.php?topic=351930.0
 LedCube::LedCube(int ** led_cube_map, int * layer, int * column, int num_layers, int num_columns, int size, int freq)
-	: _led_cube_map(led_cube_map), _layer(layer), _column(column), _num_layers(num_layers), _num_columns(num_columns), _size(size), _freq(freq), _led_cube_refresher(this), _current_sequence(nullptr)
+	: _size(size), _led_cube_map(led_cube_map), _layer(layer), _column(column), _num_layers(num_layers), _num_columns(num_columns), _column_lut(nullptr), _block_lut(nullptr), _layer_lut(nullptr), _z_offset(nullptr), _scan_order(nullptr), _freq(freq), _refreshes(0), _refresh_start(0), _refresh_end(0), _refresh_period(0), _refresh_jitter(0), _min_refresh_period(0xFFFFFFFFUL), _max_refresh_period(0), _scan_overhead(0), _max_gap(0), _is_auto_refresh(false), _min_freq(freq), _max_freq(freq), _min_time_for_layer(0), _window_gap(0), _window_refreshes(0), _refresh_shift(0), _scan_start(0), _refresh_task(nullptr), _led_cube_refresher(this), _current_sequence(nullptr), _timeline(nullptr), _render_target(nullptr), _is_split_target(false), _profiler(nullptr), _sequence_type(profiler::OTHER), _writes(0), _wrapped(0), _late_policy(CATCH_UP), _is_paced(false), _sequence_start(0), _frame_deadline(0), _nominal_deadline(0), _drift(0), _dropped_frames(0), _deferred_frames(0), _budget_policy(COUNT_ONLY), _set_budget(0), _budget(0), _budget_start(0), _budget_overruns(0), _split_frames(0), _split_time(0), _split_writes(0), _is_over_budget(false), _detail(255)
 {
-	_is_splitted = _size != _num_layers; // když neodpovídá počet vrstev výšce kostky, pak je kostka rozdělena
-// 	_is_splitted = _size * _size != _num_columns; // druhá (výpočetně složitější) možnost
-
-	if (_is_splitted) {
-		_num_splits = _size / (_num_columns / _size);
+	// když neodpovídá počet vrstev výšce kostky, pak je kostka rozdělena (po y, každá část má své vrstvy)
+	if (_size != _num_layers && _num_layers > _size) {
+		_topology.y_groups = _num_layers / _size;
 	}
 	
-	_time_for_layer = 1000 / _freq / _num_layers;
+	// fixed refresh: the layers are lit for half of the period, the main loop has the other half
+	_time_for_layer = 1000000UL / _freq / 2 / _num_layers;
 	
 	initCube();
 }
 
+LedCube::~LedCube()
+{
+	delete[] _column_lut;
+	delete[] _block_lut;
+	delete[] _layer_lut;
+	delete[] _z_offset;
+	delete[] _scan_order;
+}
+
 void LedCube::_modulo(int &x, int &y, int &z)
 {
-	x = x % _size;
-	y = y % _size;
-	z = z % _size;
+	// negative ones too (x % _size alone would index before the tables)
+	x = (x % _size + _size) % _size;
+	y = (y % _size + _size) % _size;
+	z = (z % _size + _size) % _size;
 }
 
 void LedCube::_turnDirect(int x, int y, int z, int state)
 {
 	// state = HIGH / LOW
+	int layer;
+	int column;
 	
-	//x < _size, y < _size, z < _size;
-	_modulo(x, y, z);
-	
-	/* Note:
-	 * ----
-	 * if led_cube is splitted
-	 *   x and y is column mod _num_columns
-	 *   z are two layers
-	 * else
-	 *   x and y is column
-	 *   z is layer
-	 */
+	_mapPosition(x, y, z, layer, column);
 	
-	if (_is_splitted) {
-		digitalWrite(_layer[(z + y / _num_splits * _size) % _num_layers], state);
-	} else {
-		digitalWrite(_layer[z % _num_layers], state);
+	digitalWrite(_layer[layer], state);
+	digitalWrite(_column[column], state);
+}
+
+void LedCube::_mapPosition(int x, int y, int z, int &layer, int &column)
+{
+	// x < _size, y < _size, z < _size (others wrap around)
+	if ((unsigned int)x >= (unsigned int)_size || (unsigned int)y >= (unsigned int)_size || (unsigned int)z >= (unsigned int)_size) {
+		_wrapped += 1;
+		_modulo(x, y, z);
 	}
-	digitalWrite(_column[(x + y * _size) % _num_columns], state);
+	
+	const int xy = x + y * _size;
+	
+	layer = _layer_lut[_block_lut[xy] * _size + z];
+	column = _column_lut[_z_offset[z] + xy];
 }
 
 void LedCube::_turnThroughMap(int x, int y, int z, int state)
@@ -71,18 +87,18 @@ void LedCube::_turnThroughMap(int x, int y, int z, int state)
 	int layer;
 	int column;
 	
-	if (_is_splitted) {
-		layer = (z + y / _num_splits * _size) % _num_layers;
-	} else {
-		layer = z % _num_layers;
-	}
-	column = (x + y * _size) % _num_columns;
+	_mapPosition(x, y, z, layer, column);
 	
 	_led_cube_map[layer][column] = state;
 }
 
 void LedCube::_turn(int x, int y, int z, int state)
 {
+	_writes += 1;
+	if (_render_target != nullptr) {
+		_render_target->setState(x, y, z, state);
+		return;
+	}
 	_turnThroughMap(x, y, z, state);
 }
 
@@ -100,9 +116,125 @@ void LedCube::initCube()
 		digitalWrite(_column[i], LOW);
 	}
 	
+	_compileTopology();
 	_initMap();
 }
 
+bool LedCube::_fits(const LedCubeTopology &topology)
+{
+	if (topology.x_groups == 0 || topology.y_groups == 0 || topology.z_groups == 0
+		|| _size % topology.x_groups != 0 || _size % topology.y_groups != 0 || _size % topology.z_groups != 0) {
+		return false;
+	}
+	
+	const int layers = topology.x_groups * topology.y_groups * (_size / topology.z_groups);
+	const int columns = (_size / topology.x_groups) * (_size / topology.y_groups) * topology.z_groups;
+	
+	return layers == _num_layers && columns == _num_columns && columns <= 256 && layers <= 256;
+}
+
+bool LedCube::setTopology(const LedCubeTopology &topology)
+{
+	if (!_fits(topology)) {
+		return false;
+	}
+	
+	_topology = topology;
+	initCube();
+	return true;
+}
+
+void LedCube::_compileTopology()
+{
+	// a topology which does not fit (only the default one for unusual wirings) wraps around like the former formula
+	const bool fits = _fits(_topology);
+	const LedCubeTopology &t = _topology;
+	const int x_groups = (t.x_groups > 0 && _size % t.x_groups == 0) ? t.x_groups : 1;
+	const int y_groups = (t.y_groups > 0 && _size % t.y_groups == 0) ? t.y_groups : 1;
+	const int z_groups = (t.z_groups > 0 && _size % t.z_groups == 0) ? t.z_groups : 1;
+	const int width = _size / x_groups; // of a block
+	const int depth = _size / y_groups;
+	const int height = _size / z_groups; // of a part
+	const int blocks = x_groups * y_groups;
+	const int area = _size * _size;
+	
+	delete[] _column_lut;
+	delete[] _block_lut;
+	delete[] _layer_lut;
+	delete[] _z_offset;
+	delete[] _scan_order;
+	_column_lut = new uint8_t[z_groups * area];
+	_block_lut = new uint8_t[area];
+	_layer_lut = new uint8_t[blocks * _size];
+	_z_offset = new uint16_t[_size];
+	_scan_order = new uint8_t[_num_layers];
+	
+	for (int y = 0; y < _size; ++y) {
+		for (int x = 0; x < _size; ++x) {
+			const int xy = x + y * _size;
+			const int row = y % depth;
+			int position = x % width;
+			
+			if (t.serpentine && row % 2 == 1) {
+				position = width - 1 - position;
+			}
+			_block_lut[xy] = (y / depth) * x_groups + x / width;
+			for (int part = 0; part < z_groups; ++part) {
+				int column = (position + row * width + part * width * depth) % _num_columns;
+				if (t.column_order != nullptr) {
+					column = t.column_order[column];
+				}
+				_column_lut[part * area + xy] = column;
+			}
+		}
+	}
+	
+	for (int z = 0; z < _size; ++z) {
+		_z_offset[z] = (z / height) * area;
+		for (int block = 0; block < blocks; ++block) {
+			_layer_lut[block * _size + z] = _layerLine(block, z % height, blocks, height);
+		}
+	}
+	
+	if (!fits || !t.interleave_scan) {
+		for (int slot = 0; slot < _num_layers; ++slot) {
+			_scan_order[slot] = slot;
+		}
+		return;
+	}
+	
+	/* Heights in the bit reversed order (0 4 2 6 1 5 3 7, heights over the part are skipped),
+	 * every height in all blocks, so the consecutive layers are far apart.
+	 */
+	int bits = 0;
+	while ((1 << bits) < height) {
+		bits += 1;
+	}
+	int slot = 0;
+	for (int i = 0; i < (1 << bits); ++i) {
+		int level = 0;
+		for (int b = 0; b < bits; ++b) {
+			if (i & (1 << b)) {
+				level |= 1 << (bits - 1 - b);
+			}
+		}
+		if (level >= height) {
+			continue;
+		}
+		for (int block = 0; block < blocks; ++block) {
+			_scan_order[slot++] = _layerLine(block, level, blocks, height);
+		}
+	}
+}
+
+uint8_t LedCube::_layerLine(int block, int level, int blocks, int height)
+{
+	int layer = _topology.interleave_blocks ? level * blocks + block : level + block * height;
+	
+	layer %= _num_layers;
+	return (_topology.layer_order != nullptr) ? _topology.layer_order[layer] : layer;
+}
+
 void LedCube::_initMap()
 {
 	turnEverythingOff();
@@ -110,35 +242,242 @@ void LedCube::_initMap()
 
 void LedCube::update()
 {
+	unsigned long start = micros();
+	// the main loop ran since the last refresh (the first refresh has no gap)
+	const unsigned long gap = (_refreshes > 0) ? start - _refresh_end : 0;
+	
+	if (_refreshes > 0) {
+		// an early refresh waits for its time, so the period does not depend on how long the main loop took
+		const long early = (long)(_refresh_start + 1000000UL / _freq + _refresh_shift - start);
+		_refresh_shift = 0;
+		if (early > 0) {
+			_waitMicros(early);
+			start = micros();
+		}
+	}
+	_scan_start = start;
 	// TODO: optimalizace každý obraz sekvence příkazů
-	for (int layer = 0; layer < _num_layers; ++layer) {
+	for (int slot = 0; slot < _num_layers; ++slot) {
+		const int layer = _scan_order[slot];
 		// nejprve musíme nastavit sloupce a poté je nechat rozsvítit v dané vrstvě (kdybychom to udělali naopak, tak by chvilku svítily dle předchozího nastavení)
 		for (int column = 0; column < _num_columns; ++column) {
 			digitalWrite(_column[column], _led_cube_map[layer][column]);
 		}
 		digitalWrite(_layer[layer], HIGH);
-		delay(_time_for_layer);
+		_waitMicros(_time_for_layer);
 		digitalWrite(_layer[layer], LOW);
 	}
+	_measureRefresh(start, gap, micros());
+}
+
+void LedCube::_waitMicros(unsigned long us)
+{
+	// the task runs at the start of the wait and then every millisecond
+	while (_refresh_task != nullptr) {
+		const unsigned long start = micros();
+		_refresh_task->duringRefresh();
+		const unsigned long spent = micros() - start;
+		
+		if (spent + 1000 >= us) {
+			us = (spent < us) ? us - spent : 0;
+			break;
+		}
+		delay(1);
+		us -= spent + 1000;
+	}
+	// delayMicroseconds() is exact only up to 16383 us
+	if (us >= 1000) {
+		delay(us / 1000);
+	}
+	delayMicroseconds(us % 1000);
+}
+
+void LedCube::_measureRefresh(unsigned long start, unsigned long gap, unsigned long end)
+{
+	// averages are kept in 1/16 us: average += sample - average / 16
+	const unsigned long on = _time_for_layer * _num_layers;
+	const unsigned long overhead = (end - start > on) ? (end - start - on) / _num_layers : 0;
+	
+	if (_refreshes == 0) {
+		_scan_overhead = overhead * 16;
+	} else {
+		const unsigned long period = start - _refresh_start;
+		
+		if (_refreshes == 1) {
+			_refresh_period = period * 16;
+		}
+		const unsigned long average = _refresh_period / 16;
+		const unsigned long difference = (period > average) ? period - average : average - period;
+		_refresh_period += period - average;
+		_refresh_jitter += difference - _refresh_jitter / 16;
+		_scan_overhead += overhead - _scan_overhead / 16;
+		if (period < _min_refresh_period) {
+			_min_refresh_period = period;
+		}
+		if (period > _max_refresh_period) {
+			_max_refresh_period = period;
+		}
+		if (gap > _window_gap) {
+			_window_gap = gap;
+		}
+	}
+	_refreshes += 1;
+	_refresh_start = start;
+	_refresh_end = end;
+	
+	if (++_window_refreshes >= _tuning_window) {
+		_tuneRefresh();
+	}
+}
+
+void LedCube::_tuneRefresh()
+{
+	// a longer gap counts at once, a shorter one only slowly (a load with rare long frames does not make the period swing)
+	_max_gap -= _max_gap / 32;
+	if (_window_gap > _max_gap) {
+		_max_gap = _window_gap;
+	}
+	_window_gap = 0;
+	_window_refreshes = 0;
+	if (!_is_auto_refresh) {
+		return;
+	}
+	
+	// the period holds the longest gap, the switching and the shortest on-time of every layer, with 1/8 in reserve
+	const unsigned long switching = _scan_overhead / 16 * _num_layers;
+	unsigned long needed = _max_gap + switching + _min_time_for_layer * _num_layers;
+	needed += needed / 8;
+	unsigned long freq = 1000000UL / needed;
+	
+	if (freq > (unsigned long)(_freq + _freq / 8 + 1)) {
+		freq = _freq + _freq / 8 + 1;
+	}
+	if (freq > (unsigned long)_max_freq) {
+		freq = _max_freq;
+	}
+	if (freq < (unsigned long)_min_freq) {
+		freq = _min_freq;
+	}
+	_freq = freq;
+	_fitTimeForLayer();
+}
+
+void LedCube::_fitTimeForLayer()
+{
+	// the layers get the rest of the period after the longest gap and the switching
+	const unsigned long period = 1000000UL / _freq;
+	const unsigned long switching = _scan_overhead / 16 * _num_layers;
+	
+	if (_max_gap + switching + _min_time_for_layer * _num_layers >= period) {
+		_time_for_layer = _min_time_for_layer;
+	} else {
+		_time_for_layer = (period - _max_gap - switching) / _num_layers;
+	}
+}
+
+int LedCube::getRefreshFrequency()
+{
+	if (_refreshes < 2) {
+		return _freq;
+	}
+	return (16000000UL + _refresh_period / 2) / _refresh_period;
+}
+
+unsigned long LedCube::getRefreshInterval()
+{
+	// automatic refresh: the on-time of the layers makes the period
+	if (_is_auto_refresh || _refreshes == 0) {
+		return 1;
+	}
+	// fixed refresh: the rest of the period after the scan (whole milliseconds down, update() waits for the rest)
+	const unsigned long period = 1000000UL / _freq;
+	const unsigned long scan = _refresh_end - _refresh_start;
+	
+	return (scan + 1000 < period) ? (period - scan) / 1000 : 1;
+}
+
+LedCubeRefreshStats LedCube::getRefreshStats()
+{
+	LedCubeRefreshStats stats;
+	
+	stats.refreshes = _refreshes;
+	stats.period = _refresh_period / 16;
+	stats.jitter = _refresh_jitter / 16;
+	stats.min_period = (_refreshes < 2) ? 0 : _min_refresh_period;
+	stats.max_period = _max_refresh_period;
+	stats.time_for_layer = _time_for_layer;
+	stats.scan_overhead = _scan_overhead / 16;
+	stats.max_gap = (_max_gap > _window_gap) ? _max_gap : _window_gap;
+	return stats;
+}
+
+void LedCube::resetRefreshStats()
+{
+	_refreshes = 0;
+	_refresh_period = 0;
+	_refresh_jitter = 0;
+	_min_refresh_period = 0xFFFFFFFFUL;
+	_max_refresh_period = 0;
+	_max_gap = 0;
+	_window_gap = 0;
+	_window_refreshes = 0;
+}
+
+void LedCube::lockRefresh(int freq, long shift)
+{
+	// the on-time of the layers still follows the own load
+	if (!_is_auto_refresh) {
+		setAutoRefresh(true, freq, freq, 100);
+	} else if (_freq != freq || _min_freq != freq || _max_freq != freq) {
+		_min_freq = freq;
+		_max_freq = freq;
+		_freq = freq;
+		_fitTimeForLayer();
+	}
+	_refresh_shift += shift;
+}
+
+void LedCube::setAutoRefresh(bool enable, int min_freq, int max_freq, unsigned long min_time_for_layer)
+{
+	_is_auto_refresh = enable;
+	_min_freq = min_freq;
+	_max_freq = max_freq;
+	_min_time_for_layer = min_time_for_layer;
+	if (enable) {
+		// from the requested rate within the limits, the first window moves it
+		if (_freq > _max_freq) {
+			_freq = _max_freq;
+		}
+		if (_freq < _min_freq) {
+			_freq = _min_freq;
+		}
+		_window_gap = 0;
+		_window_refreshes = 0;
+		_time_for_layer = 1000000UL / _freq / _num_layers;
+	} else {
+		_time_for_layer = 1000000UL / _freq / 2 / _num_layers;
+	}
 }
 
 void LedCube::updateNextLayer() // BUG: Bliká to
 {
+	// _last_layer is the slot of the scan order
 	if (_last_layer >= 0) {
-		digitalWrite(_layer[_last_layer], LOW);
+		digitalWrite(_layer[_scan_order[_last_layer]], LOW);
 	}
 	
 	_last_layer += 1;
 	if (_last_layer >= _num_layers || _last_layer < 0) {
 		_last_layer = 0;
 	}
+	const int layer = _scan_order[_last_layer];
 	
 	// nejprve musíme nastavit sloupce a poté je nechat rozsvítit v dané vrstvě (kdybychom to udělali naopak, tak by chvilku svítily dle předchozího nastavení)
 	for (int column = 0; column < _num_columns; ++column) {
-		digitalWrite(_column[column], _led_cube_map[_last_layer][column]);
+		digitalWrite(_column[column], _led_cube_map[layer][column]);
 	}
 	
-	digitalWrite(_layer[_last_layer], HIGH);
+	digitalWrite(_layer[layer], HIGH);
 }
 
 void LedCube::turnOn(int x, int y, int z)
@@ -160,7 +499,53 @@ void LedCube::switchTo(int x, int y, int z)
 	turnOn(x, y, z);
 }
 
-void LedCube::test(int speed=1000)
+int LedCube::getState(int x, int y, int z)
+{
+	int layer;
+	int column;
+	
+	if (_render_target != nullptr) {
+		return _render_target->getState(x, y, z);
+	}
+	
+	_mapPosition(x, y, z, layer, column);
+	
+	return _led_cube_map[layer][column];
+}
+
+void LedCube::setRow(int y, int z, uint16_t row)
+{
+	_writes += _size;
+	if (_render_target != nullptr) {
+		_render_target->setRow(y, z, row);
+		return;
+	}
+	
+	_setMapRow(y, z, row);
+}
+
+void LedCube::_setMapRow(int y, int z, uint16_t row)
+{
+	int layer;
+	int column;
+	
+	for (int x = 0; x < _size; ++x) {
+		_mapPosition(x, y, z, layer, column);
+		_led_cube_map[layer][column] = (row & (1U << x)) ? HIGH : LOW;
+	}
+}
+
+void LedCube::showFrame(LedCubeFrame &frame)
+{
+	_writes += (unsigned long)_size * _size * _size;
+	for (int z = 0; z < _size; ++z) {
+		for (int y = 0; y < _size; ++y) {
+			_setMapRow(y, z, frame.getRow(y, z));
+		}
+	}
+}
+
+void LedCube::test(int speed)
 {
 	for (int z = 0; z < _size; ++z) {
 		for (int y = 0; y < _size; ++y) {
@@ -175,6 +560,11 @@ void LedCube::test(int speed=1000)
 
 void LedCube::turnEverythingOff()
 {
+	_writes += (unsigned long)_size * _size * _size;
+	if (_render_target != nullptr) {
+		_render_target->fill(LOW);
+		return;
+	}
 	for (int layer = 0; layer < _num_layers; ++layer) {
 		for (int column = 0; column < _num_columns; ++column) {
 			_led_cube_map[layer][column] = LOW;
@@ -184,6 +574,11 @@ void LedCube::turnEverythingOff()
 
 void LedCube::turnEverythingOn()
 {
+	_writes += (unsigned long)_size * _size * _size;
+	if (_render_target != nullptr) {
+		_render_target->fill(HIGH);
+		return;
+	}
 	for (int layer = 0; layer < _num_layers; ++layer) {
 		for (int column = 0; column < _num_columns; ++column) {
 			_led_cube_map[layer][column] = HIGH;
@@ -191,26 +586,160 @@ void LedCube::turnEverythingOn()
 	}
 }
 
-void LedCube::setSequence(LedCubeSequence * new_sequence)
+void LedCube::setSequence(LedCubeSequence * new_sequence, uint8_t type)
 {
 	stopCurrentSequence();
 	_current_sequence = new_sequence;
+	_sequence_type = type;
+	_is_paced = false;
+	_drift = 0;
+	_dropped_frames = 0;
+	_deferred_frames = 0;
+	_budget_overruns = 0;
+	_split_frames = 0;
+	_split_time = 0;
+	_split_writes = 0;
+	_is_over_budget = false;
+	_detail = 255;
 }
 
 unsigned long LedCube::nextFrameOfSequence()
 {
 	unsigned long wait = 0;
+	unsigned long now = millis();
 	
-	if (isSequenceRunning()) {
-		wait = (*_current_sequence)();
-		if (wait == 0) {
-			stopCurrentSequence();
-		}
+	if (!isSequenceRunning()) {
+		return 0;
+	}
+	
+	_budget = _deriveFrameBudget();
+	_budget_start = micros();
+	
+	if (!_is_paced) {
+		// the first frame defines the start of the sequence
+		_sequence_start = now;
+		_frame_deadline = now;
+		_nominal_deadline = now;
+		_is_paced = true;
+	}
+	
+	_drift = (long)(now - _nominal_deadline);
+	if (_late_policy == STRETCH && (long)(now - _frame_deadline) > 0) {
+		_frame_deadline = now;
+	}
+	
+	if (_budget_policy == DEFER_FRAME && _is_over_budget) {
+		// the refresh gets this pass, the frame comes in the next one against the same deadline
+		_is_over_budget = false;
+		_deferred_frames += 1;
+		return 1;
 	} else {
-		wait = 0;
+		for (int dropped = 0; ; ++dropped) {
+			if (_profiler != nullptr) {
+				// a frame in pieces (SPLIT_WORK) is recorded once, with the time and the writes of all of them
+				const LedCubeProfiler::Mark mark = _profiler->mark(_split_time, _split_writes);
+				
+				wait = (*_current_sequence)();
+				if (wait == CONTINUE_FRAME) {
+					_split_time = micros() - mark.start;
+					_split_writes = _writes - mark.writes;
+				} else {
+					_profiler->record(_sequence_type, mark, wait);
+					_split_time = 0;
+					_split_writes = 0;
+				}
+			} else {
+				wait = (*_current_sequence)();
+			}
+			if (wait == CONTINUE_FRAME) {
+				// the rest of the frame after the refresh, as soon as possible
+				_split_frames += 1;
+				_endOfBudget();
+				return 1;
+			}
+			if (wait == 0) {
+				stopCurrentSequence();
+				return 0;
+			}
+			_frame_deadline += wait;
+			_nominal_deadline += wait;
+			
+			now = millis();
+			if (_late_policy == DROP && (long)(now - _frame_deadline) >= 0 && dropped < _max_dropped_in_row) {
+				_dropped_frames += 1;
+			} else {
+				break;
+			}
+		}
+		_endOfBudget();
 	}
 	
-	return wait;
+	if ((long)(_frame_deadline - now) <= 0) {
+		// already late, as soon as possible (0 would stop the sequence)
+		return 1;
+	}
+	return _frame_deadline - now;
+}
+
+void LedCube::setBudgetPolicy(BudgetPolicy policy, unsigned long budget)
+{
+	_budget_policy = policy;
+	_set_budget = budget;
+	_is_over_budget = false;
+	_detail = 255;
+}
+
+unsigned long LedCube::_deriveFrameBudget()
+{
+	if (_set_budget > 0) {
+		return _set_budget;
+	}
+	if (!_is_auto_refresh) {
+		// the half of the period the layers leave, without the switching
+		const unsigned long gap = 1000000UL / _freq - _time_for_layer * _num_layers;
+		const unsigned long switching = _scan_overhead / 16 * _num_layers;
+		
+		return (gap > switching) ? gap - switching : 0;
+	}
+	
+	// the gap for which _tuneRefresh() chooses the rate (with its 1/8 in reserve)
+	const unsigned long scan = _scan_overhead / 16 * _num_layers + _min_time_for_layer * _num_layers;
+	unsigned long usable = 1000000UL / _max_freq * 8 / 9;
+	
+	if (usable <= scan) {
+		usable = 1000000UL / _min_freq * 8 / 9;
+	}
+	return (usable > scan) ? usable - scan : 0;
+}
+
+void LedCube::_endOfBudget()
+{
+	// an overrun lowers the detail by 1/4, a call within half of the budget raises it by 8
+	const unsigned long time = micros() - _budget_start;
+	
+	_is_over_budget = time > _budget;
+	if (_is_over_budget) {
+		_budget_overruns += 1;
+		if (_budget_policy == LOWER_DETAIL) {
+			_detail = (_detail - _detail / 4 > 16) ? _detail - _detail / 4 : 16;
+		}
+	} else if (_budget_policy == LOWER_DETAIL && time < _budget / 2) {
+		_detail = (_detail < 255 - 8) ? _detail + 8 : 255;
+	}
+}
+
+void LedCube::shiftSequence(long ms)
+{
+	_sequence_start += ms;
+	_frame_deadline += ms;
+	_nominal_deadline += ms;
+}
+
+unsigned long LedCube::getFrameLateness()
+{
+	long lateness = (long)(millis() - _frame_deadline);
+	
+	return (_is_paced && lateness > 0) ? lateness : 0;
 }
 
 void LedCube::stopCurrentSequence()
@@ -221,6 +750,39 @@ void LedCube::stopCurrentSequence()
 	}
 }
 
+unsigned long LedCubeSequence::_waitTicks(unsigned long ticks)
+{
+	LedCubeTimeline * timeline = _led_cube->getTimeline();
+	
+	if (timeline == nullptr) {
+		return ticks;
+	}
+	
+	if (!_tick_started) {
+		_tick = timeline->getTick();
+		_tick_started = true;
+	}
+	_tick += ticks;
+	
+	// the cube counts the wait from the deadline of this frame, not from now
+	return timeline->untilTick(_tick) + _led_cube->getFrameLateness();
+}
+
+unsigned long LedCubeSequence::_waitBeats(unsigned int beats)
+{
+	LedCubeTimeline * timeline = _led_cube->getTimeline();
+	
+	return _waitTicks((unsigned long)beats * ((timeline != nullptr) ? timeline->getTicksPerBeat() : 1));
+}
+
+bool LedCubeSequence::_archiveState(LedCubeArchive &archive)
+{
+	archive.field(_state);
+	archive.field(_tick);
+	archive.field(_tick_started);
+	return archive.isOk();
+}
+
 namespace sequences {
 	unsigned long FlickerOn::operator()()
 	{
@@ -266,167 +828,110 @@ namespace sequences {
 		} while (_state == 0);
 	}
 
+	void TurnOnAndOffAllByLayerUpAndDown::_turnLayer(int z, int state)
+	{
+		for (int x = 0; x < _led_cube->getSize(); ++x) {
+			for (int y = 0; y < _led_cube->getSize(); ++y) {
+				if (state == HIGH) {
+					_led_cube->turnOn(x, y, z);
+				} else {
+					_led_cube->turnOff(x, y, z);
+				}
+			}
+		}
+	}
+
 	unsigned long TurnOnAndOffAllByLayerUpAndDown::operator()()
 	{
-		int x = 0;
-		int y = 0;
-		int z = 0;
+		const int size = _led_cube->getSize();
 		
-		while (true) {
-			switch(_state) {
-				// TODO: Místo čísel použít enum (viz https://en.cppreference.com/w/cpp/language/enum )
-				case 0:
-					_led_cube->turnEverythingOn();
-					_state += 1;
-					return _wait;
-				case 1:
-					_layer = _led_cube->getSize()-1;
-					_state += 1;
-				case 2:
-					// Turn off by layer from the top to the bottom
-					z = _layer;
-					for (x = 0; x < _led_cube->getSize(); ++x) {
-						for (y = 0; y < _led_cube->getSize(); ++y) {
-							_led_cube->turnOff(x, y, z);
-						}
-					}
-					_layer -= 1;
-					if (_layer < 0) {
-						_layer = 0;
-						_state += 1;
-					}
-					return _wait;
-				case 3:
-					// Turn on by layer from the bottom to the top
-					z = _layer;
-					for (x = 0; x < _led_cube->getSize(); ++x) {
-						for (y = 0; y < _led_cube->getSize(); ++y) {
-							_led_cube->turnOn(x, y, z);
-						}
-					}
-					_layer += 1;
-					if (_layer >= _led_cube->getSize()) {
-						_layer = 0;
-						_state += 1;
-					}
-					return _wait;
-				case 4:
-					// Turn off by layer from the bottom to the top
-					z = _layer;
-					for (x = 0; x < _led_cube->getSize(); ++x) {
-						for (y = 0; y < _led_cube->getSize(); ++y) {
-							_led_cube->turnOff(x, y, z);
-						}
-					}
-					_layer += 1;
-					if (_layer >= _led_cube->getSize()) {
-						_layer = _led_cube->getSize()-1;
-						_state += 1;
-					}
-					return _wait;
-				case 5:
-					// Turn on by layer from the top to the bottom
-					z = _layer;
-					for (x = 0; x < _led_cube->getSize(); ++x) {
-						for (y = 0; y < _led_cube->getSize(); ++y) {
-							_led_cube->turnOn(x, y, z);
-						}
-					}
-					_layer -= 1;
-					if (_layer < 0) {
-						_layer = 0;
-						_state += 1;
-					}
-					return _wait;
-				case 6:
-					if (_cycles_cnt < _max_cycles) {
-						_cycles_cnt += 1;
-						_state = 1;
-					} else {
-						_state += 1;
-					}
-					break;
-				default:
-					return 0;
+		SEQUENCE_BEGIN();
+		
+		_led_cube->turnEverythingOn();
+		SEQUENCE_YIELD(_wait);
+		
+		for (;;) {
+			// Turn off by layer from the top to the bottom
+			for (_layer = size-1; _layer >= 0; --_layer) {
+				_turnLayer(_layer, LOW);
+				SEQUENCE_YIELD(_wait);
+			}
+			// Turn on by layer from the bottom to the top
+			for (_layer = 0; _layer < size; ++_layer) {
+				_turnLayer(_layer, HIGH);
+				SEQUENCE_YIELD(_wait);
+			}
+			// Turn off by layer from the bottom to the top
+			for (_layer = 0; _layer < size; ++_layer) {
+				_turnLayer(_layer, LOW);
+				SEQUENCE_YIELD(_wait);
+			}
+			// Turn on by layer from the top to the bottom
+			for (_layer = size-1; _layer >= 0; --_layer) {
+				_turnLayer(_layer, HIGH);
+				SEQUENCE_YIELD(_wait);
+			}
+			
+			if (_cycles_cnt >= _max_cycles) {
+				break;
+			}
+			_cycles_cnt += 1;
+		}
+		
+		SEQUENCE_END();
+	}
+
+	void TurnOnAndOffAllByLayerSideways::_turnLayer(int y, int state)
+	{
+		for (int i = 0; i < _led_cube->getSize(); ++i) {
+			for (int j = 0; j < _led_cube->getSize(); ++j) {
+				if (state == HIGH) {
+					_led_cube->turnOn(i, y, j);
+				} else {
+					_led_cube->turnOff(i, y, j);
+				}
 			}
 		}
 	}
 
 	unsigned long TurnOnAndOffAllByLayerSideways::operator()()
 	{
-		while (true) {
-			switch(_state) {
-				case 0:
-					_led_cube->turnEverythingOff();
-					_state += 1;
-					return _wait;
-				case 1:
-					_layer = 0;
-					_state += 1;
-				case 2:
-					// Turn on by layer from the front to the back
-					for (int i = 0; i < _led_cube->getSize(); ++i) {
-						for (int j = 0; j < _led_cube->getSize(); ++j) {
-							_led_cube->turnOn(i, _layer, j);
-						}
-					}
-					_layer += 1;
-					if (_layer >= _led_cube->getSize()) {
-						_layer = 0;
-						_state += 1;
-					}
-					return _wait;
-				case 3:
-					// Turn off by layer from the front to the back
-					for (int i = 0; i < _led_cube->getSize(); ++i) {
-						for (int j = 0; j < _led_cube->getSize(); ++j) {
-							_led_cube->turnOff(i, _layer, j);
-						}
-					}
-					_layer += 1;
-					if (_layer >= _led_cube->getSize()) {
-						_layer = _led_cube->getSize()-1;
-						_state += 1;
-					}
-					return _wait;
-				case 4:
-					// Turn on by layer from the back to the front
-					for (int i = 0; i < _led_cube->getSize(); ++i) {
-						for (int j = 0; j < _led_cube->getSize(); ++j) {
-							_led_cube->turnOn(i, _layer, j);
-						}
-					}
-					_layer -= 1;
-					if (_layer < 0) {
-						_layer = _led_cube->getSize()-1;
-						_state += 1;
-					}
-					return _wait;
-				case 5:
-					// Turn off by layer from the back to the front
-					for (int i = 0; i < _led_cube->getSize(); ++i) {
-						for (int j = 0; j < _led_cube->getSize(); ++j) {
-							_led_cube->turnOff(i, _layer, j);
-						}
-					}
-					_layer -= 1;
-					if (_layer < 0) {
-						_layer = 0;
-						_state += 1;
-					}
-					return _wait;
-				case 6:
-					if (_cycles_cnt < _max_cycles) {
-						_cycles_cnt += 1;
-						_state = 1;
-					} else {
-						_state += 1;
-					}
-					break;
-				default:
-					return 0;
+		const int size = _led_cube->getSize();
+		
+		SEQUENCE_BEGIN();
+		
+		_led_cube->turnEverythingOff();
+		SEQUENCE_YIELD(_wait);
+		
+		for (;;) {
+			// Turn on by layer from the front to the back
+			for (_layer = 0; _layer < size; ++_layer) {
+				_turnLayer(_layer, HIGH);
+				SEQUENCE_YIELD(_wait);
+			}
+			// Turn off by layer from the front to the back
+			for (_layer = 0; _layer < size; ++_layer) {
+				_turnLayer(_layer, LOW);
+				SEQUENCE_YIELD(_wait);
+			}
+			// Turn on by layer from the back to the front
+			for (_layer = size-1; _layer >= 0; --_layer) {
+				_turnLayer(_layer, HIGH);
+				SEQUENCE_YIELD(_wait);
+			}
+			// Turn off by layer from the back to the front
+			for (_layer = size-1; _layer >= 0; --_layer) {
+				_turnLayer(_layer, LOW);
+				SEQUENCE_YIELD(_wait);
 			}
+			
+			if (_cycles_cnt >= _max_cycles) {
+				break;
+			}
+			_cycles_cnt += 1;
 		}
+		
+		SEQUENCE_END();
 	}
 
 	unsigned long LayerStompUpAndDown::operator()()
@@ -694,17 +1199,35 @@ namespace sequences {
 					_led_cube->turnEverythingOff();
 					_state += 1;
 				case 1:
-					for (int i = 0; i < _max_drops; ++i) {
-						if (_drops[i].enable == false && random(6) < 2) {
-							_drops[i].enable = true;
-							_drops[i].redraw = true;
-							_drops[i].x = random(_led_cube->getSize());
-							_drops[i].y = random(_led_cube->getSize());
-							_drops[i].layer = _led_cube->getSize()-1;
-							_drops[i].sublayer = 0;
-							_drops[i].slowness = random(_led_cube->getSize()*2);
+					{
+						// a lowered detail of the cube lets fewer drops fall
+						const int max_enabled = (_max_drops * _led_cube->getDetail() + 255) / 256;
+						int enabled = 0;
+						
+						for (int i = 0; i < _max_drops; ++i) {
+							if (_drops[i].enable) {
+								enabled += 1;
+							}
+						}
+						while (_drop_index < _max_drops) {
+							const int i = _drop_index++;
+							
+							if (_drops[i].enable == false && enabled < max_enabled && random(6) < 2) {
+								_drops[i].enable = true;
+								_drops[i].redraw = true;
+								_drops[i].x = random(_led_cube->getSize());
+								_drops[i].y = random(_led_cube->getSize());
+								_drops[i].layer = _led_cube->getSize()-1;
+								_drops[i].sublayer = 0;
+								_drops[i].slowness = random(_led_cube->getSize()*2);
+								enabled += 1;
+							}
+							if (_drop_index < _max_drops && _isOverBudget()) {
+								return _continueFrame();
+							}
 						}
 					}
+					_drop_index = 0;
 					_state += 1;
 				case 2:
 					for (int i = 0; i < _max_drops; ++i) {
@@ -716,7 +1239,9 @@ namespace sequences {
 					_state += 1;
 					return _wait;
 				case 3:
-					for (int i = 0; i < _max_drops; ++i) {
+					while (_drop_index < _max_drops) {
+						const int i = _drop_index++;
+						
 						if (_drops[i].enable) {
 // 							if (random(100) > 0) { // BUG: Při 8 kapkách už to bliká. Není to generátorem pseudonáhodných čísel? Zdá se, že ano.
 							if (true) {
@@ -739,7 +1264,11 @@ namespace sequences {
 								}
 							}
 						}
+						if (_drop_index < _max_drops && _isOverBudget()) {
+							return _continueFrame();
+						}
 					}
+					_drop_index = 0;
 					_state += 1;
 					break;
 				case 4:
@@ -767,74 +1296,57 @@ namespace sequences {
 		}
 	}
 
-	void DiagonalRectangle::_topLeftOn()
+	void DiagonalRectangle::_rectangleOn(int y, int z)
 	{
-		for (int i = 0; i < _led_cube->getSize(); ++i) {
-			for (int j = 0; j < _led_cube->getSize()/2; ++j) {
-				_led_cube->turnOn(i, j, 2);
-				_led_cube->turnOn(i, j, 3);
+		// a rectangle of half of the cube in y and z at one of three positions along both (0 => start, 1 => middle, 2 => end),
+		// on 4x4x4 two LEDs thick at 0, 1 or 2
+		const int size = _led_cube->getSize();
+		const int half = (size > 1) ? size/2 : 1;
+		const int y0 = y * (size - half) / 2;
+		const int z0 = z * (size - half) / 2;
+		
+		for (int i = 0; i < size; ++i) {
+			for (int j = 0; j < half; ++j) {
+				for (int k = 0; k < half; ++k) {
+					_led_cube->turnOn(i, y0 + j, z0 + k);
+				}
 			}
 		}
 	}
 
+	void DiagonalRectangle::_topLeftOn()
+	{
+		_rectangleOn(0, 2);
+	}
+	
 	void DiagonalRectangle::_topMiddleOn()
 	{
-		for (int i = 0; i < _led_cube->getSize(); ++i) {
-			for (int j = 0; j < _led_cube->getSize()/2; ++j) {
-				_led_cube->turnOn(i, j+1, 2);
-				_led_cube->turnOn(i, j+1, 3);
-			}
-		}
+		_rectangleOn(1, 2);
 	}
 
 	void DiagonalRectangle::_topRightOn()
 	{
-		for (int i = 0; i < _led_cube->getSize(); ++i) {
-			for (int j = 0; j < _led_cube->getSize()/2; ++j) {
-				_led_cube->turnOn(i, j+2, 2);
-				_led_cube->turnOn(i, j+2, 3);
-			}
-		}
+		_rectangleOn(2, 2);
 	}
 
 	void DiagonalRectangle::_middleMiddleOn()
 	{
-		for (int i = 0; i < _led_cube->getSize(); ++i) {
-			for (int j = 0; j < _led_cube->getSize()/2; ++j) {
-				_led_cube->turnOn(i, j+1, 1);
-				_led_cube->turnOn(i, j+1, 2);
-			}
-		}
+		_rectangleOn(1, 1);
 	}
 
 	void DiagonalRectangle::_bottomLeftOn()
 	{
-		for (int i = 0; i < _led_cube->getSize(); ++i) {
-			for (int j = 0; j < _led_cube->getSize()/2; ++j) {
-				_led_cube->turnOn(i, j, 0);
-				_led_cube->turnOn(i, j, 1);
-			}
-		}
+		_rectangleOn(0, 0);
 	}
 
 	void DiagonalRectangle::_bottomMiddleOn()
 	{
-		for (int i = 0; i < _led_cube->getSize(); ++i) {
-			for (int j = 0; j < _led_cube->getSize()/2; ++j) {
-				_led_cube->turnOn(i, j+1, 0);
-				_led_cube->turnOn(i, j+1, 1);
-			}
-		}
+		_rectangleOn(1, 0);
 	}
 
 	void DiagonalRectangle::_bottomRightOn()
 	{
-		for (int i = 0; i < _led_cube->getSize(); ++i) {
-			for (int j = 0; j < _led_cube->getSize()/2; ++j) {
-				_led_cube->turnOn(i, j+2, 0);
-				_led_cube->turnOn(i, j+2, 1);
-			}
-		}
+		_rectangleOn(2, 0);
 	}
 
 	unsigned long DiagonalRectangle::operator()()
@@ -904,18 +1416,16 @@ namespace sequences {
 
 	void Propeller::_diagonalLeftToRightOn()
 	{
-		for (int i = 0; i < _led_cube->getSize(); ++i) {
-			_led_cube->turnOn(i, i, _layer);
-		}
+		int high = _led_cube->getSize()-1;
+		
+		raster::line(_led_cube, 0, 0, _layer, high, high, _layer);
 	}
 
 	void Propeller::_diagonalRightToLeftOn()
 	{
 		int high = _led_cube->getSize()-1;
 		
-		for (int i = 0; i < _led_cube->getSize(); ++i) {
-			_led_cube->turnOn(high - i, i, _layer);
-		}
+		raster::line(_led_cube, high, 0, _layer, 0, high, _layer);
 	}
 
 	void Propeller::_sLeftToRightOn()
@@ -1235,112 +1745,393 @@ namespace sequences {
 		}
 	}
 
-	unsigned long Demo::operator()()
+	unsigned long BeatSync::operator()()
 	{
-		unsigned long wait = 0;
-		const unsigned long wait_between_sequences = 50;
+		LedCubeTimeline * timeline = _led_cube->getTimeline();
+		unsigned long wait = (*_sequence)();
 		
-		while (true) {
-			if (_isSequenceRunning()) {
-				wait = _nextFrameOfSequence();
-				if (wait > 0) {
-					return wait;
-				}
-			} else {
-				_state += 1;
-				switch(_state) {
-					case 1:
-						_setSequence(new TurnEverythingOff(_led_cube));
-						return wait_between_sequences;
-					case 2:
-						_setSequence(new FlickerOn(_led_cube));
-						return wait_between_sequences;
-					case 3:
-						_setSequence(new TurnEverythingOn(_led_cube));
-						return wait_between_sequences;
-					case 4:
-						_setSequence(new TurnOnAndOffAllByLayerUpAndDown(_led_cube));
-						return 250;
-					case 5:
-						_setSequence(new LayerStompUpAndDown(_led_cube));
-						return wait_between_sequences;
-					case 6:
-						_setSequence(new SpiralInAndOut(_led_cube));
-						return wait_between_sequences;
-					case 7:
-						_setSequence(new TurnOnAndOffAllByLayerSideways(_led_cube));
-						return wait_between_sequences;
-					case 8:
-						_setSequence(new AroundEdgeDown(_led_cube));
-						return 250;
-					case 9:
-						_setSequence(new TurnEverythingOff(_led_cube));
-						return wait_between_sequences;
-					case 10:
-						_setSequence(new RandomFlicker(_led_cube));
-						return wait_between_sequences;
-					case 11:
-						_setSequence(new RandomRain(_led_cube));
-						return wait_between_sequences;
-					case 12:
-						_setSequence(new MatrixRain(_led_cube));
-						return wait_between_sequences;
-					case 13:
-						_setSequence(new DiagonalRectangle(_led_cube));
-						return wait_between_sequences;
-					case 14:
-						_setSequence(new GoThroughAllLedsOneAtATime(_led_cube));
-						return wait_between_sequences;
-					case 15:
-						_setSequence(new Propeller(_led_cube));
-						return wait_between_sequences;
-					case 16:
-						_setSequence(new SpiralInAndOut(_led_cube));
-						return wait_between_sequences;
-					case 17:
-						_setSequence(new FlickerOff(_led_cube));
-						return wait_between_sequences;
-					case 18:
-						_setSequence(new TurnEverythingOff(_led_cube));
-						return wait_between_sequences;
-					case 19:
-						return 2000;
-					default:
-						return 0;
-				}
-			}
+		if (wait == 0 || wait == LedCube::CONTINUE_FRAME || timeline == nullptr) {
+			return wait;
 		}
 		
-		return 0;
+		if (!_tick_started) {
+			_tick = timeline->getTick();
+			_tick_started = true;
+			_ticks_per_minute = (unsigned long)timeline->getTempo() * timeline->getTicksPerBeat();
+		}
+		// [ms] of the starting tempo => ticks and 1/60000 of a tick, summed exactly
+		const uint64_t position = (uint64_t)wait * _ticks_per_minute + _fraction;
+		_tick += position / 60000;
+		_fraction = position % 60000;
+		
+		// the time between the two ticks, so a change of the tempo keeps the position
+		const uint64_t from = timeline->tickToMicros(_tick);
+		const uint64_t at = from + (timeline->tickToMicros(_tick + 1) - from) * _fraction / 60000;
+		const uint64_t now = timeline->getTime();
+		// the cube counts the wait from the deadline of this frame, not from now
+		const unsigned long lateness = _led_cube->getFrameLateness();
+		
+		if (at <= now + 1000) {
+			return 1 + lateness;
+		}
+		return (at - now + 500) / 1000 + lateness;
 	}
 
-	void Demo::_setSequence(LedCubeSequence * new_sequence)
+	Playlist::~Playlist()
 	{
-		_stopCurrentSequence();
-		_current_sequence = new_sequence;
+		delete _current_sequence;
+		delete _next_sequence;
 	}
 
-	unsigned long Demo::_nextFrameOfSequence()
+	bool Playlist::_prepareNext()
 	{
-		unsigned long wait = 0;
+		// reads the next entry and constructs its sequence, false at the end of the list
+		playlist::Entry entry;
 		
-		if (_isSequenceRunning()) {
-			wait = (*_current_sequence)();
-			if (wait == 0) {
-				_stopCurrentSequence();
-			}
-		} else {
-			wait = 0;
+		if (_is_list_end) {
+			return false;
 		}
 		
-		return wait;
+		if (_in_progmem) {
+			memcpy_P(&entry, &_entries[_index], sizeof(entry));
+		} else {
+			entry = _entries[_index];
+		}
+		if (entry.sequence >= playlist::END) {
+			_is_list_end = true;
+			return false;
+		}
+		_index += 1;
+
+		_next_sequence = playlist::create(_led_cube, entry);
+		_next_type = entry.sequence;
+		if (_next_sequence != nullptr && _transition != transition::CUT) {
+			_next_sequence = new Transition(_led_cube, nullptr, _next_sequence, _transition_duration, _transition, _transition_step);
+		}
+		_next_gap = entry.gap;
+		_is_next_ready = true;
+		return true;
 	}
 
-	void Demo::_stopCurrentSequence()
+	void Playlist::_prepareAhead()
 	{
-		if (_isSequenceRunning()) {
+		// called when the rest of the wait of the frame is idle
+		if (!_prepare_ahead || _is_next_ready || _is_list_end) {
+			return;
+		}
+
+		const unsigned long start = micros();
+		_prepareNext();
+		const unsigned long time = micros() - start;
+		if (time > _max_prepare_time) {
+			_max_prepare_time = time;
+		}
+	}
+	
+	unsigned long Playlist::operator()()
+	{
+		unsigned long wait = 0;
+		
+		while (true) {
+			switch(_state) {
+				case 0:
+					_switch_start = micros();
+					_switch_time = 0;
+					_state = 2;
+					break;
+				case 1:
+					// frame of the current sequence
+					if (_led_cube->getProfiler() != nullptr) {
+						LedCubeProfiler * profiler = _led_cube->getProfiler();
+						const LedCubeProfiler::Mark mark = profiler->mark(_split_time, _split_writes);
+						
+						wait = (*_current_sequence)();
+						if (wait == LedCube::CONTINUE_FRAME) {
+							_split_time = micros() - mark.start;
+							_split_writes = _led_cube->getWrites() - mark.writes;
+						} else {
+							profiler->record(_current_type, mark, wait);
+							_split_time = 0;
+							_split_writes = 0;
+						}
+					} else {
+						wait = (*_current_sequence)();
+					}
+					if (wait == LedCube::CONTINUE_FRAME) {
+						// the rest of the frame comes in the next call, no time is idle
+						return wait;
+					}
+					if (wait > 0) {
+						_prepareAhead();
+						return wait;
+					}
+					_last_drift = getCurrentDrift();
+					if (_last_drift > _max_drift) {
+						_max_drift = _last_drift;
+						_max_drift_type = _current_type;
+					}
+					delete _current_sequence;
+					_current_sequence = nullptr;
+					_switch_start = micros();
+					_switch_time = 0;
+					_state += 1;
+				case 2:
+					// switch to the next entry
+					if (!_is_next_ready) {
+						if (!_prepareNext()) {
+							_state = -1;
+							return 0;
+						}
+						if (_index > 1) {
+							_unprepared_switches += 1;
+						}
+					}
+					_current_sequence = _next_sequence;
+					_current_type = _next_type;
+					_next_sequence = nullptr;
+					_is_next_ready = false;
+					_state += 1;
+					if (_next_gap > 0) {
+						// the previous frame stays for the gap, which is idle as well
+						const unsigned long gap = _next_gap;
+						_switch_time += micros() - _switch_start;
+						_is_after_gap = true;
+						_prepareAhead();
+						return gap;
+					}
+				case 3:
+					if (_current_sequence == nullptr) {
+						// the entry was only a pause
+						_is_after_gap = false;
+						_state = 2;
+						break;
+					}
+					if (_is_after_gap) {
+						_switch_start = micros();
+						_is_after_gap = false;
+					}
+					_switch_time += micros() - _switch_start;
+					_last_switch_time = _switch_time;
+					if (_switch_time > _max_switch_time) {
+						_max_switch_time = _switch_time;
+					}
+					_switches += 1;
+					_drift_start = _led_cube->getSequenceDrift();
+					_state = 1;
+					break;
+				default:
+					return 0;
+			}
+		}
+	}
+	
+	// archive() of the sequences: what changes while they play, the parameters come from the constructor
+	bool FlickerOn::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_wait);
+		return archive.isOk();
+	}
+	
+	bool TurnOnAndOffAllByLayerUpAndDown::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_layer);
+		archive.field(_cycles_cnt);
+		return archive.isOk();
+	}
+	
+	bool TurnOnAndOffAllByLayerSideways::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_layer);
+		archive.field(_cycles_cnt);
+		return archive.isOk();
+	}
+	
+	bool LayerStompUpAndDown::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_layer);
+		archive.field(_whole_repeats_cnt);
+		archive.field(_inner_repeats_cnt);
+		return archive.isOk();
+	}
+	
+	bool AroundEdgeDown::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_wait);
+		archive.field(_layer);
+		archive.field(_trace_step);
+		return archive.isOk();
+	}
+	
+	bool RandomFlicker::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_whole_repeats_cnt);
+		archive.fieldByte(_last_x);
+		archive.fieldByte(_last_y);
+		archive.fieldByte(_last_z);
+		return archive.isOk();
+	}
+	
+	bool RandomRain::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_whole_repeats_cnt);
+		archive.fieldByte(_last_x);
+		archive.fieldByte(_last_y);
+		archive.fieldByte(_layer);
+		return archive.isOk();
+	}
+	
+	bool MatrixRain::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_whole_repeats_cnt);
+		archive.fieldByte(_drop_index);
+		// coordinates and counters of the drops are below 2*size
+		for (int i = 0; i < _max_drops; ++i) {
+			archive.fieldByte(_drops[i].enable);
+			archive.fieldByte(_drops[i].x);
+			archive.fieldByte(_drops[i].y);
+			archive.fieldByte(_drops[i].layer);
+			archive.fieldByte(_drops[i].sublayer);
+			archive.fieldByte(_drops[i].slowness);
+			archive.fieldByte(_drops[i].redraw);
+		}
+		return archive.isOk();
+	}
+	
+	bool DiagonalRectangle::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_whole_repeats_cnt);
+		return archive.isOk();
+	}
+	
+	bool Propeller::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_inner_repeats_cnt);
+		archive.fieldByte(_layer);
+		return archive.isOk();
+	}
+	
+	bool SpiralInAndOut::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_whole_repeats_cnt);
+		archive.field(_column);
+		return archive.isOk();
+	}
+	
+	bool GoThroughAllLedsOneAtATime::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_whole_repeats_cnt);
+		archive.field(_step);
+		return archive.isOk();
+	}
+	
+	bool BeatSync::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_ticks_per_minute);
+		archive.field(_fraction);
+		return archive.isOk() && _sequence->archive(archive);
+	}
+	
+	bool Playlist::archive(LedCubeArchive &archive)
+	{
+		// entry of the current sequence, the one after it may be constructed already
+		int current = _index - (_is_next_ready ? 2 : 1);
+		
+		_archiveState(archive);
+		archive.field(current);
+		archive.field(_is_after_gap);
+		if (!archive.isOk()) {
+			return false;
+		}
+		
+		if (archive.isLoading()) {
+			// the sequences of the entries are constructed anew
 			delete _current_sequence;
+			delete _next_sequence;
 			_current_sequence = nullptr;
+			_next_sequence = nullptr;
+			_is_next_ready = false;
+			_is_list_end = false;
+			_index = (current > 0) ? current : 0;
+			if (_state == 1 || _state == 3) {
+				_prepareNext();
+				_current_sequence = _next_sequence;
+				_current_type = _next_type;
+				_next_sequence = nullptr;
+				_is_next_ready = false;
+			}
+		}
+		
+		if (_current_sequence == nullptr) {
+			return true;
+		}
+		return _current_sequence->archive(archive);
+	}
+}
+
+namespace playlist {
+	const Entry demo[] PROGMEM = {
+		{TURN_EVERYTHING_OFF, 0, 0, 50},
+		{FLICKER_ON, 0, 0, 50},
+		{TURN_EVERYTHING_ON, 0, 0, 50},
+		{UP_AND_DOWN, 0, 0, 250},
+		{LAYER_STOMP, 0, 0, 50},
+		{SPIRAL_IN_AND_OUT, 0, 0, 50},
+		{SIDEWAYS, 0, 0, 50},
+		{AROUND_EDGE_DOWN, 0, 0, 250},
+		{TURN_EVERYTHING_OFF, 0, 0, 50},
+		{RANDOM_FLICKER, 0, 0, 50},
+		{RANDOM_RAIN, 0, 0, 50},
+		{MATRIX_RAIN, 0, 0, 50},
+		{DIAGONAL_RECTANGLE, 0, 0, 50},
+		{GO_THROUGH_ALL_LEDS, 0, 0, 50},
+		{PROPELLER, 0, 0, 50},
+		{SPIRAL_IN_AND_OUT, 0, 0, 50},
+		{FLICKER_OFF, 0, 0, 50},
+		{TURN_EVERYTHING_OFF, 0, 0, 50},
+		{PAUSE, 0, 0, 2000},
+		{END, 0, 0, 0}
+	};
+	
+	// 0 => default value of the parameter
+	static unsigned int _param(unsigned int value, unsigned int default_value)
+	{
+		return (value != 0) ? value : default_value;
+	}
+	
+	LedCubeSequence * create(LedCube * led_cube, const Entry & entry)
+	{
+		using namespace sequences;
+		
+		switch (entry.sequence) {
+			case TURN_EVERYTHING_OFF: return new TurnEverythingOff(led_cube);
+			case TURN_EVERYTHING_ON: return new TurnEverythingOn(led_cube);
+			case FLICKER_ON: return new FlickerOn(led_cube, _param(entry.wait, 150), _param(entry.repeats, 5));
+			case FLICKER_OFF: return new FlickerOff(led_cube, _param(entry.wait, 150), _param(entry.repeats, 5));
+			case UP_AND_DOWN: return new TurnOnAndOffAllByLayerUpAndDown(led_cube, _param(entry.wait, 75), _param(entry.repeats, 5));
+			case SIDEWAYS: return new TurnOnAndOffAllByLayerSideways(led_cube, _param(entry.wait, 75), _param(entry.repeats, 5));
+			case LAYER_STOMP: return new LayerStompUpAndDown(led_cube, _param(entry.wait, 75), _param(entry.repeats, 5));
+			case AROUND_EDGE_DOWN: return new AroundEdgeDown(led_cube, _param(entry.wait, 200), _param(entry.repeats, 50));
+			case RANDOM_FLICKER: return new RandomFlicker(led_cube, _param(entry.wait, 20), _param(entry.repeats, 750/2));
+			case RANDOM_RAIN: return new RandomRain(led_cube, _param(entry.wait, 100), _param(entry.repeats, 60/2));
+			case MATRIX_RAIN: return new MatrixRain(led_cube, _param(entry.wait, 100), _param(entry.repeats, 500));
+			case DIAGONAL_RECTANGLE: return new DiagonalRectangle(led_cube, _param(entry.wait, 350), _param(entry.repeats, 5));
+			case PROPELLER: return new Propeller(led_cube, _param(entry.wait, 90), _param(entry.repeats, 6));
+			case SPIRAL_IN_AND_OUT: return new SpiralInAndOut(led_cube, _param(entry.wait, 60), _param(entry.repeats, 6));
+			case GO_THROUGH_ALL_LEDS: return new GoThroughAllLedsOneAtATime(led_cube, _param(entry.wait, 20), _param(entry.repeats, 5));
+			default: return nullptr;
 		}
 	}
 }
@@ -1350,13 +2141,7 @@ void center(LedCube * _led_cube) {
 	int low = _led_cube->getSize()/2 - 1;
 	int high = _led_cube->getSize()-1 - low;
 	
-	for (int z = low; z <= high; ++z) {
-		for (int y = low; y <= high; ++y) {
-			for (int x = low; x <= high; ++x) {
-				_led_cube->turnOn(x, y, z);
-			}
-		}
-	}
+	raster::cuboid(_led_cube, low, low, low, high, high, high);
 }
 
 void corners(LedCube * _led_cube) {
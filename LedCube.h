@@ -8,6 +8,73 @@
 class LedCube;
 class LedCubeRefresher;
 class LedCubeSequence;
+class LedCubeTimeline;
+class LedCubeFrame;
+class LedCubeProfiler;
+class LedCubeArchive;
+
+
+/* How the LEDs are wired to the layer and column lines (compiled into lookup tables by LedCube::initCube()):
+ * - the footprint of the cube is split into x_groups * y_groups blocks, every block has its own layer lines
+ *   (the 4x4x4 cube on 8 layers and 8 columns of the examples is y_groups = 2)
+ * - the height is split into z_groups parts, which share the layer lines and have their own columns
+ * - layer lines are numbered block by block (z + block * height of a part) or interleaved (z * blocks + block)
+ * - columns of a block are numbered by rows (x + y * width of a block), serpentine reverses the odd rows
+ * - layer_order / column_order map these numbers to the indexes of the pins (nullptr => the same)
+ * - interleave_scan refreshes the layer lines in an order in which consecutive ones are far apart, meant to keep the
+ *   refresh from looking like a band moving through the cube (not measured: every LED is lit for the same time in both
+ *   orders, the effect on the perceived flicker is untested)
+ * Every block has size / x_groups * size / y_groups * z_groups columns and x_groups * y_groups * size / z_groups layers.
+ */
+struct LedCubeTopology
+{
+	uint8_t x_groups;
+	uint8_t y_groups;
+	uint8_t z_groups;
+	bool interleave_blocks;
+	bool serpentine;
+	bool interleave_scan;
+	const uint8_t * layer_order;
+	const uint8_t * column_order;
+	
+	LedCubeTopology(uint8_t x_groups=1, uint8_t y_groups=1, uint8_t z_groups=1, bool interleave_blocks=false, bool serpentine=false,
+		bool interleave_scan=true, const uint8_t * layer_order=nullptr, const uint8_t * column_order=nullptr)
+		: x_groups(x_groups), y_groups(y_groups), z_groups(z_groups), interleave_blocks(interleave_blocks), serpentine(serpentine),
+		interleave_scan(interleave_scan), layer_order(layer_order), column_order(column_order)
+	{}
+};
+
+// measured by LedCube::update(), see LedCube::getRefreshStats()
+struct LedCubeRefreshStats
+{
+	unsigned long refreshes;
+	unsigned long period; // [us] average time between the starts of two refreshes
+	unsigned long jitter; // [us] average difference of a period from the average
+	unsigned long min_period; // [us]
+	unsigned long max_period; // [us]
+	unsigned long time_for_layer; // [us] on-time of a layer in the last refresh
+	unsigned long scan_overhead; // [us] average time of switching one layer (writing its columns)
+	unsigned long max_gap; // [us] longest time between the end of a refresh and the start of the next one (the work of the main loop)
+};
+
+
+// short work done while the layers are lit (LedCube::update() waits), see LedCube::setRefreshTask()
+class LedCubeRefreshTask
+{
+public:
+	virtual ~LedCubeRefreshTask() {}
+	
+	// about every millisecond of the on-time of a layer
+	virtual void duringRefresh() = 0;
+};
+
+
+// types of sequences told apart by LedCubeProfiler: the built-in sequences are playlist::SequenceId (0-14), then these
+namespace profiler {
+	const uint8_t PLAYLIST = 16; // sequences::Playlist itself (its frames include the frames of its sequences), playlist::END
+	const uint8_t OTHER = 17; // sequences set without a type
+	const uint8_t USER = 18; // the first type free for own sequences
+}
 
 
 class LedCubeRefresher : public VariableTimedAction
@@ -24,6 +91,25 @@ public:
 
 class LedCube
 {
+public:
+	// what to do when a frame of the sequence comes late
+	enum LatePolicy {
+		CATCH_UP, // show the next frames sooner until the sequence is back on its deadlines
+		DROP, // compute the frames which are already late without showing them
+		STRETCH // shift the rest of the sequence by the lateness
+	};
+	
+	// what to do when a pass of the main loop (the frame of the sequence) takes longer than its budget (getFrameBudget())
+	enum BudgetPolicy {
+		COUNT_ONLY, // the overruns are only counted
+		SPLIT_WORK, // sequences stop at the end of the budget and go on in the next pass, after the refresh (LedCubeSequence::_isOverBudget())
+		DEFER_FRAME, // the pass after an overrun computes nothing (the refresh runs), the frame comes in the next pass;
+		             // the deadlines stay, so it is late by a pass and the LatePolicy applies (DROP skips it)
+		LOWER_DETAIL // sequences do less work per frame (getDetail() goes down after an overrun and back up in light frames)
+	};
+	
+	// wait of a sequence whose frame goes on in the next call (SPLIT_WORK), the deadlines stay
+	static const unsigned long CONTINUE_FRAME = 0xFFFFFFFFUL;
 private:
 	int _size;
 	int ** _led_cube_map;
@@ -31,12 +117,71 @@ private:
 	int * _column;
 	int _num_layers;
 	int _num_columns;
-	bool _is_splitted;
-	int _num_splits;
+	LedCubeTopology _topology;
+	// lookup tables compiled from the topology: layer = _layer_lut[_block_lut[x + y*size]*size + z],
+	// column = _column_lut[_z_offset[z] + x + y*size], refresh order of the layers = _scan_order
+	uint8_t * _column_lut;
+	uint8_t * _block_lut;
+	uint8_t * _layer_lut;
+	uint16_t * _z_offset;
+	uint8_t * _scan_order;
 	int _freq;
-	int _time_for_layer; // [ms]
+	unsigned long _time_for_layer; // [us]
+	
+	// refresh statistics (LedCubeRefreshStats), averages move by 1/16 of the difference
+	unsigned long _refreshes;
+	unsigned long _refresh_start; // [us] of the last refresh
+	unsigned long _refresh_end; // [us]
+	unsigned long _refresh_period; // [us]
+	unsigned long _refresh_jitter; // [us]
+	unsigned long _min_refresh_period; // [us]
+	unsigned long _max_refresh_period; // [us]
+	unsigned long _scan_overhead; // [us] per layer
+	unsigned long _max_gap; // [us] in the last window of the tuning
+	
+	// automatic refresh rate (setAutoRefresh())
+	bool _is_auto_refresh;
+	int _min_freq;
+	int _max_freq;
+	unsigned long _min_time_for_layer; // [us]
+	unsigned long _window_gap; // [us] longest gap in the current window
+	uint8_t _window_refreshes;
+	static const uint8_t _tuning_window = 32; // refreshes
+	long _refresh_shift; // [us] of the next refresh (lockRefresh())
+	unsigned long _scan_start; // [us] of the running (or the last) scan
+	LedCubeRefreshTask * _refresh_task;
 	LedCubeRefresher _led_cube_refresher;
 	LedCubeSequence * _current_sequence;
+	LedCubeTimeline * _timeline;
+	LedCubeFrame * _render_target;
+	bool _is_split_target; // the target is shown only when its frame is whole
+	LedCubeProfiler * _profiler;
+	uint8_t _sequence_type; // for the profiler
+	unsigned long _writes; // LEDs written
+	unsigned long _wrapped; // coordinates outside the cube
+	
+	// frames are scheduled against absolute deadlines, so lateness does not add up
+	LatePolicy _late_policy;
+	bool _is_paced;
+	unsigned long _sequence_start; // [ms] first frame of the sequence
+	unsigned long _frame_deadline; // [ms] when the current frame was due
+	unsigned long _nominal_deadline; // [ms] start of the sequence + sum of all waits
+	long _drift; // [ms]
+	unsigned long _dropped_frames;
+	unsigned long _deferred_frames;
+	static const int _max_dropped_in_row = 8;
+	
+	// budget of a call of nextFrameOfSequence(), the refresh runs between two calls
+	BudgetPolicy _budget_policy;
+	unsigned long _set_budget; // [us] 0 => derived from the refresh
+	unsigned long _budget; // [us] of the running (or the last) call
+	unsigned long _budget_start; // [us]
+	unsigned long _budget_overruns;
+	unsigned long _split_frames;
+	unsigned long _split_time; // [us] of the pieces of the frame so far, for the profiler
+	unsigned long _split_writes; // of the pieces of the frame so far
+	bool _is_over_budget; // the last call took longer than its budget
+	uint8_t _detail;
 	
 	int _last_x = 0, _last_y = 0, _last_z = 0, _last_layer = -1;
 	
@@ -44,17 +189,49 @@ private:
 	
 	void _turnDirect(int x, int y, int z, int state);
 	
+	void _mapPosition(int x, int y, int z, int &layer, int &column);
+	
 	void _turnThroughMap(int x, int y, int z, int state);
 	
 	void _turn(int x, int y, int z, int state);
 	
 	void _initMap();
 	
+	bool _fits(const LedCubeTopology &topology);
+	
+	void _compileTopology();
+	
+	uint8_t _layerLine(int block, int level, int blocks, int height);
+	
+	void _waitMicros(unsigned long us);
+	
+	void _measureRefresh(unsigned long start, unsigned long gap, unsigned long end);
+	
+	void _tuneRefresh();
+	
+	void _fitTimeForLayer();
+	
+	void _setMapRow(int y, int z, uint16_t row);
+	
+	unsigned long _deriveFrameBudget();
+	
+	void _endOfBudget();
+	
 public:
 	LedCube(int ** led_cube_map, int * layer, int * column, int num_layers, int num_columns, int size, int freq);
 	
+	~LedCube();
+	
 	void initCube();
 	
+	// false (and the previous topology stays) when it does not fit the numbers of layers and columns
+	bool setTopology(const LedCubeTopology &topology);
+	
+	const LedCubeTopology & getTopology() { return _topology; }
+	
+	// layer line refreshed as the slot-th one
+	int getScanLayer(int slot) { return _scan_order[slot]; }
+	
 	void update();
 	
 	void updateNextLayer();
@@ -65,8 +242,18 @@ public:
 	
 	void switchTo(int x, int y, int z);
 	
+	// state of the LED in the map (HIGH / LOW)
+	int getState(int x, int y, int z);
+	
+	// sets LEDs x = 0..size-1 of the row at once, bit x = LED x
+	void setRow(int y, int z, uint16_t row);
+	
+	// copies the frame into the map, never into the render target (for showing frames computed ahead, see LedCubePipeline.h)
+	void showFrame(LedCubeFrame &frame);
+	
 	// TODO: void move(axis={x,y,z}, distance=<int>, zero/rotate=<bool>)
 	// TODO: void rotate(axis={x,y,z}, angle=+/-{45,90,135,180}, center=<coord>)
+	//       (models drawn as vectors rotate by any angle: LedCubeWireframe in LedCubeVector.h)
 	// TODO: void scale(axis={x,y,z}, value=<int>)
 	// TODO: void mirror(axis={x,y,z}, clone=<bool>)
 	
@@ -76,7 +263,8 @@ public:
 	
 	void turnEverythingOn();
 	
-	void setSequence(LedCubeSequence * new_sequence);
+	// type => which record of the profiler gets the frames of the sequence (see namespace profiler)
+	void setSequence(LedCubeSequence * new_sequence, uint8_t type=profiler::OTHER);
 	
 	unsigned long nextFrameOfSequence();
 	
@@ -84,11 +272,143 @@ public:
 	
 	bool isSequenceRunning() { return _current_sequence != nullptr; }
 	
-	int getRefreshFrequency() { return _freq; }
+	LedCubeSequence * getSequence() { return _current_sequence; }
+	
+	uint8_t getSequenceType() { return _sequence_type; }
+	
+	void setLatePolicy(LatePolicy policy) { _late_policy = policy; }
+	
+	// how late was the last frame of the current (or last) sequence against the sum of its waits [ms]
+	long getSequenceDrift() { return _drift; }
+	
+	// frames computed late without being shown (DROP)
+	unsigned long getDroppedFrames() { return _dropped_frames; }
+	
+	// passes without a frame after an overrun of the budget (DEFER_FRAME)
+	unsigned long getDeferredFrames() { return _deferred_frames; }
+	
+	// the current sequence has shown its first frame
+	bool isSequenceStarted() { return _is_paced; }
+	
+	// [ms] since the first frame of the current sequence
+	unsigned long getSequenceTime() { return _is_paced ? millis() - _sequence_start : 0; }
+	
+	// moves the deadlines of the current sequence by [ms] (positive => later), e.g. to follow the sequence of another cube
+	void shiftSequence(long ms);
+	
+	// how late is the frame being computed [ms] (sequences computing their own absolute waits add this)
+	unsigned long getFrameLateness();
+	
+	/* Budget of a call of nextFrameOfSequence() [us], the refresh waits for its end:
+	 * - fixed refresh: the half of the period which the layers leave, without the switching
+	 * - automatic refresh: the gap which keeps the rate at max_freq with the shortest on-time of the layers (a longer one
+	 *   makes the tuning lower the rate), at min_freq when max_freq leaves none
+	 * budget > 0 is used instead (0 => derived again). Overruns are counted with every policy, the statistics restart with the sequence.
+	 */
+	void setBudgetPolicy(BudgetPolicy policy, unsigned long budget=0);
+	
+	BudgetPolicy getBudgetPolicy() { return _budget_policy; }
+	
+	// [us] of the running (or the last) frame
+	unsigned long getFrameBudget() { return _budget; }
+	
+	// the budget from now, for a frame computed outside nextFrameOfSequence() (LedCubePipeline::produce())
+	void startFrameBudget()
+	{
+		_budget = _deriveFrameBudget();
+		_budget_start = micros();
+	}
+	
+	// [us] left of the budget of the running frame (0 => over)
+	unsigned long getRemainingBudget()
+	{
+		const unsigned long time = micros() - _budget_start;
+		
+		return (time < _budget) ? _budget - time : 0;
+	}
+	
+	// calls of nextFrameOfSequence() longer than the budget
+	unsigned long getBudgetOverruns() { return _budget_overruns; }
 	
-	int getTimeForLayer() { return _time_for_layer; }
+	// calls which ended with CONTINUE_FRAME (SPLIT_WORK)
+	unsigned long getSplitFrames() { return _split_frames; }
+	
+	// how much work the sequences should do (255 => all of it, at least 16), lowered only by LOWER_DETAIL
+	uint8_t getDetail() { return _detail; }
+	
+	// achieved refresh rate [Hz] (the requested one until the cube has been refreshed twice)
+	int getRefreshFrequency();
+	
+	// requested refresh rate [Hz] (chosen by the tuning when the refresh is automatic)
+	int getTargetRefreshFrequency() { return _freq; }
+	
+	// on-time of a layer [ms], whole milliseconds (see getTimeForLayerMicros())
+	int getTimeForLayer() { return _time_for_layer / 1000; }
+	
+	// on-time of a layer [us]
+	unsigned long getTimeForLayerMicros() { return _time_for_layer; }
+	
+	// [ms] between the end of a refresh and the start of the next one (LedCubeRefresher)
+	unsigned long getRefreshInterval();
+	
+	LedCubeRefreshStats getRefreshStats();
+	
+	void resetRefreshStats();
+	
+	/* The refresh rate follows the measured time of switching the layers and the longest gap between two refreshes
+	 * (the main loop): every window of refreshes the highest rate at which a layer still gets min_time_for_layer
+	 * is chosen (lower at once, higher by at most 1/8 per window) and the on-time of the layers fills the rest of the period.
+	 * The refresher runs 1 ms after a refresh and a refresh which comes early waits for its time,
+	 * so the period stays the same while the main loop takes no longer than the longest gap. Disabling keeps the last chosen rate.
+	 * The fixed refresh (the rate given to the constructor) lights the layers for half of the period and starts a refresh
+	 * every period as well, a main loop longer than the other half lowers the rate.
+	 */
+	void setAutoRefresh(bool enable, int min_freq=30, int max_freq=200, unsigned long min_time_for_layer=100);
+	
+	bool isAutoRefresh() { return _is_auto_refresh; }
+	
+	// [us] since the start of the running (or the last) scan
+	unsigned long getRefreshPhase() { return micros() - _scan_start; }
+	
+	/* Refreshes at the rate of another cube (automatic refresh with the rate fixed) and moves the next refresh
+	 * by shift [us] (positive => later), so the scans of several cubes run together (see LedCubeSync.h).
+	 * A refresh can only come earlier while it waits for its time, so the rate has to leave room for the own main loop.
+	 */
+	void lockRefresh(int freq, long shift);
+	
+	// the task runs while the layers are lit (nullptr => none), e.g. reading a serial line without waiting for the refresh
+	void setRefreshTask(LedCubeRefreshTask * task) { _refresh_task = task; }
+	
+	LedCubeRefreshTask * getRefreshTask() { return _refresh_task; }
 	
 	int getSize() { return _size; }
+	
+	// shared clock for sequences waiting in beats or ticks (nullptr => none)
+	void setTimeline(LedCubeTimeline * timeline) { _timeline = timeline; }
+	
+	LedCubeTimeline * getTimeline() { return _timeline; }
+	
+	/* turnOn/turnOff/getState/... work with the frame instead of the map (nullptr => the map), see LedCubeTransition.h
+	 * is_split => the frame is used only when the sequence has finished it, so it may be split (SPLIT_WORK, LedCubePipeline)
+	 */
+	void setRenderTarget(LedCubeFrame * frame, bool is_split=false) { _render_target = frame; _is_split_target = is_split; }
+	
+	LedCubeFrame * getRenderTarget() { return _render_target; }
+	
+	bool isSplitTarget() { return _render_target == nullptr || _is_split_target; }
+	
+	// measures every frame of the sequences (nullptr => none), see LedCubeProfiler.h
+	void setProfiler(LedCubeProfiler * profiler) { _profiler = profiler; }
+	
+	LedCubeProfiler * getProfiler() { return _profiler; }
+	
+	// LEDs written into the map or the render target (turnOn() 1, setRow() size, turnEverythingOff() all), it wraps around
+	unsigned long getWrites() { return _writes; }
+	
+	/* Coordinates outside the cube given to turnOn()/turnOff()/getState()/... (they wrap around), since the construction.
+	 * Not 0 is usually a sequence written for another size of the cube (see extras/host/batch_render.cpp).
+	 */
+	unsigned long getWrappedCoordinates() { return _wrapped; }
 
 };
 
@@ -98,14 +418,103 @@ class LedCubeSequence
 protected:
 	LedCube * _led_cube;
 	int _state;
+	unsigned long _tick; // position of the sequence on the timeline of the cube
+	bool _tick_started;
+	
+	/* Waits for given number of ticks of the timeline of the cube and returns the wait in [ms].
+	 * The position of the sequence on the timeline is absolute, so waits do not drift.
+	 * Without a timeline one tick is 1 ms.
+	 */
+	unsigned long _waitTicks(unsigned long ticks);
+	
+	unsigned long _waitBeats(unsigned int beats);
+	
+	/* SPLIT_WORK: the frame has used up the budget of the cube (or what is left is shorter than the next piece of work
+	 * takes [us]), the sequence keeps its place and returns _continueFrame(), the next call goes on from there (what is
+	 * drawn so far is shown meanwhile). Never true while drawing into a render target which takes whole frames
+	 * (transitions, composites), a pipeline shows a frame only when it is finished.
+	 */
+	bool _isOverBudget(unsigned long next_work=0)
+	{
+		if (_led_cube->getBudgetPolicy() != LedCube::SPLIT_WORK || !_led_cube->isSplitTarget()) {
+			return false;
+		}
+		const unsigned long remaining = _led_cube->getRemainingBudget();
+		
+		return remaining == 0 || remaining < next_work;
+	}
+	
+	unsigned long _continueFrame() { return LedCube::CONTINUE_FRAME; }
+	
+	// _state and the position on the timeline, for archive() of the sequences
+	bool _archiveState(LedCubeArchive &archive);
 public:
 	LedCubeSequence(LedCube * led_cube)
-		: _led_cube(led_cube), _state(0)
+		: _led_cube(led_cube), _state(0), _tick(0), _tick_started(false)
 	{}
 	
+	virtual ~LedCubeSequence() {}
+	
 	virtual unsigned long operator()() = 0;
+	
+	/* Writes the state of the sequence into the archive, or reads it back into a sequence constructed with the same
+	 * parameters (LedCubeArchive::isLoading()), see LedCubeSnapshot. False when the sequence cannot be saved (now).
+	 */
+	virtual bool archive(LedCubeArchive &) { return false; }
 };
 
+// how sequences::Playlist switches to the next sequence (see sequences::Transition in LedCubeTransition.h)
+namespace transition {
+	enum Mode {
+		CUT, // the next sequence starts over the last frame of the previous one
+		DISSOLVE, // LEDs switch to the next sequence one by one in a random order
+		CROSSFADE // LEDs show the next sequence for a growing part of the frames
+	};
+}
+
+/* Compact tables of sequences for sequences::Playlist (in PROGMEM)
+ *   const playlist::Entry my_list[] PROGMEM = {
+ *       {playlist::FLICKER_ON, 0, 0, 50},
+ *       {playlist::RANDOM_RAIN, 80, 20, 250}, // wait 80 ms, 20 repeats, 250 ms before it starts
+ *       {playlist::END, 0, 0, 0}
+ *   };
+ */
+namespace playlist {
+	enum SequenceId {
+		TURN_EVERYTHING_OFF,
+		TURN_EVERYTHING_ON,
+		FLICKER_ON,
+		FLICKER_OFF,
+		UP_AND_DOWN, // TurnOnAndOffAllByLayerUpAndDown
+		SIDEWAYS, // TurnOnAndOffAllByLayerSideways
+		LAYER_STOMP,
+		AROUND_EDGE_DOWN,
+		RANDOM_FLICKER,
+		RANDOM_RAIN,
+		MATRIX_RAIN,
+		DIAGONAL_RECTANGLE,
+		PROPELLER,
+		SPIRAL_IN_AND_OUT,
+		GO_THROUGH_ALL_LEDS,
+		PAUSE, // no sequence, only the gap
+		END
+	};
+	
+	struct Entry
+	{
+		uint8_t sequence; // SequenceId
+		uint16_t wait; // first parameter of the sequence (wait or max_wait) [ms], 0 => default
+		uint16_t repeats; // second parameter (repeats, cycles or step), 0 => default
+		uint16_t gap; // pause before the sequence starts, the previous frame stays [ms]
+	};
+	
+	// sequences::Demo
+	extern const Entry demo[];
+	
+	// constructs the sequence of the entry (nullptr for PAUSE and END)
+	LedCubeSequence * create(LedCube * led_cube, const Entry & entry);
+}
+
 namespace sequences {
 	class TurnEverythingOff : public LedCubeSequence
 	{
@@ -115,6 +524,8 @@ namespace sequences {
 		{}
 		
 		unsigned long operator()() { _led_cube->turnEverythingOff(); return 0; }
+		
+		bool archive(LedCubeArchive &archive) { return _archiveState(archive); }
 	};
 
 	class TurnEverythingOn : public LedCubeSequence
@@ -125,6 +536,8 @@ namespace sequences {
 		{}
 		
 		unsigned long operator()() { _led_cube->turnEverythingOn(); return 0; }
+		
+		bool archive(LedCubeArchive &archive) { return _archiveState(archive); }
 	};
 
 	class FlickerOn : public LedCubeSequence
@@ -141,6 +554,8 @@ namespace sequences {
 		}
 		
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
 	};
 
 	class FlickerOff : public FlickerOn
@@ -162,12 +577,16 @@ namespace sequences {
 		int _layer;
 		const int _max_cycles;
 		int _cycles_cnt;
+		
+		void _turnLayer(int z, int state);
 	public:
 		TurnOnAndOffAllByLayerUpAndDown(LedCube * led_cube, unsigned long wait=75, int max_cycles=5)
 			: LedCubeSequence(led_cube), _wait(wait), _layer(0), _max_cycles(max_cycles), _cycles_cnt(0)
 		{}
 		
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
 	};
 
 	class TurnOnAndOffAllByLayerSideways : public LedCubeSequence
@@ -177,12 +596,16 @@ namespace sequences {
 		int _layer;
 		const int _max_cycles;
 		int _cycles_cnt;
+		
+		void _turnLayer(int y, int state);
 	public:
 		TurnOnAndOffAllByLayerSideways(LedCube * led_cube, unsigned long wait=75, int max_cycles=5)
 			: LedCubeSequence(led_cube), _wait(wait), _layer(0), _max_cycles(max_cycles), _cycles_cnt(1)
 		{}
 		
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
 	};
 
 	class LayerStompUpAndDown : public LedCubeSequence
@@ -200,6 +623,8 @@ namespace sequences {
 		{}
 		
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
 	};
 
 	class AroundEdgeDown : public LedCubeSequence
@@ -211,24 +636,34 @@ namespace sequences {
 		int _layer;
 		
 		int _trace_step;
-		static const int _trace_capacity = 32;
+		const int _trace_capacity; // edge of a layer, 4 * (size-1)
 		int _trace_len;
 		struct Coord {
 			int x;
 			int y;
 		};
-		Coord _trace[_trace_capacity];
+		Coord * _trace;
 		
 		void _createTrace();
 	public:
 		AroundEdgeDown(LedCube * led_cube, unsigned long max_wait=200, unsigned long step=50)
-			: LedCubeSequence(led_cube), _max_wait(max_wait), _time_step(step), _layer(0)
+			: LedCubeSequence(led_cube), _max_wait(max_wait), _time_step(step), _layer(0),
+			_trace_capacity((led_cube->getSize() > 1) ? 4 * (led_cube->getSize() - 1) : 1)
 		{
 			_wait = _max_wait;
+			_trace = new Coord[_trace_capacity];
 			_createTrace();
 		}
 		
+		AroundEdgeDown(const AroundEdgeDown &) = delete;
+		
+		AroundEdgeDown & operator=(const AroundEdgeDown &) = delete;
+		
+		~AroundEdgeDown() { delete[] _trace; }
+		
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
 	};
 
 	class RandomFlicker : public LedCubeSequence
@@ -244,6 +679,8 @@ namespace sequences {
 		{}
 		
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
 	};
 
 	class RandomRain : public LedCubeSequence
@@ -259,8 +696,11 @@ namespace sequences {
 		{}
 		
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
 	};
 
+	// splits its frames with SPLIT_WORK, fewer drops fall with a lowered detail (LOWER_DETAIL)
 	class MatrixRain : public LedCubeSequence
 	{
 	protected:
@@ -268,6 +708,7 @@ namespace sequences {
 		const int _max_whole_repeats;
 		int _whole_repeats_cnt;
 		static const int _max_drops = 16;
+		int _drop_index; // where the split frame goes on (SPLIT_WORK)
 		struct drop {
 			bool enable;
 			int x;
@@ -279,7 +720,7 @@ namespace sequences {
 		} _drops[_max_drops];
 	public:
 		MatrixRain(LedCube * led_cube, unsigned long wait=100, int max_whole_repeats=500)
-			: LedCubeSequence(led_cube), _wait(wait), _max_whole_repeats(max_whole_repeats), _whole_repeats_cnt(1)
+			: LedCubeSequence(led_cube), _wait(wait), _max_whole_repeats(max_whole_repeats), _whole_repeats_cnt(1), _drop_index(0)
 		{
 			for (int i = 0; i < _max_drops; ++i) {
 				_drops[i].enable = false;
@@ -288,10 +729,13 @@ namespace sequences {
 				_drops[i].layer = 0;
 				_drops[i].sublayer = 0;
 				_drops[i].slowness = 0;
+				_drops[i].redraw = false;
 			}
 		}
 		
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
 	};
 
 	class DiagonalRectangle : public LedCubeSequence
@@ -301,6 +745,7 @@ namespace sequences {
 		const int _max_whole_repeats;
 		int _whole_repeats_cnt;
 		
+		void _rectangleOn(int y, int z);
 		void _topLeftOn();
 		void _topMiddleOn();
 		void _topRightOn();
@@ -314,6 +759,8 @@ namespace sequences {
 		{}
 		
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
 	};
 
 	class Propeller : public LedCubeSequence
@@ -338,6 +785,8 @@ namespace sequences {
 		}
 		
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
 	};
 
 	class SpiralInAndOut : public LedCubeSequence
@@ -347,13 +796,13 @@ namespace sequences {
 		const int _max_whole_repeats;
 		int _whole_repeats_cnt;
 		int _column;
-		static const int _max_columns = 16;
+		const int _max_columns; // size * size
 		struct Column {
 			int x;
 			int y;
 		};
-		Column _spiral_in_clockwise[_max_columns];
-		Column _spiral_in_counter_clockwise[_max_columns];
+		Column * _spiral_in_clockwise;
+		Column * _spiral_in_counter_clockwise;
 		
 		void _createMapForSpiralInClockwise();
 		void _createMapForSpiralInCounterClockwise();
@@ -361,13 +810,28 @@ namespace sequences {
 		void _turnOffColumn(Column column);
 	public:
 		SpiralInAndOut(LedCube * led_cube, unsigned long wait=60, int max_whole_repeats=6)
-			: LedCubeSequence(led_cube), _wait(wait), _max_whole_repeats(max_whole_repeats), _whole_repeats_cnt(1), _column(0)
+			: LedCubeSequence(led_cube), _wait(wait), _max_whole_repeats(max_whole_repeats), _whole_repeats_cnt(1), _column(0),
+			_max_columns(led_cube->getSize() * led_cube->getSize())
 		{
+			_spiral_in_clockwise = new Column[_max_columns];
+			_spiral_in_counter_clockwise = new Column[_max_columns];
 			_createMapForSpiralInClockwise();
 			_createMapForSpiralInCounterClockwise();
 		}
 		
+		SpiralInAndOut(const SpiralInAndOut &) = delete;
+		
+		SpiralInAndOut & operator=(const SpiralInAndOut &) = delete;
+		
+		~SpiralInAndOut()
+		{
+			delete[] _spiral_in_clockwise;
+			delete[] _spiral_in_counter_clockwise;
+		}
+		
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
 	};
 
 	class GoThroughAllLedsOneAtATime : public LedCubeSequence
@@ -381,42 +845,155 @@ namespace sequences {
 			int y;
 			int z;
 		};
-		static const int _trace_len = 64;
-		Coord _trace[_trace_len];
+		const int _trace_len; // size^3
+		Coord * _trace;
 		int _step;
 		
 		void _createTrace();
 	public:
 		GoThroughAllLedsOneAtATime(LedCube * led_cube, unsigned long wait=20, int max_whole_repeats=5)
-			: LedCubeSequence(led_cube), _wait(wait), _max_whole_repeats(max_whole_repeats), _whole_repeats_cnt(1)
+			: LedCubeSequence(led_cube), _wait(wait), _max_whole_repeats(max_whole_repeats), _whole_repeats_cnt(1),
+			_trace_len(led_cube->getSize() * led_cube->getSize() * led_cube->getSize())
 		{
+			_trace = new Coord[_trace_len];
 			_createTrace();
 		}
 		
+		GoThroughAllLedsOneAtATime(const GoThroughAllLedsOneAtATime &) = delete;
+		
+		GoThroughAllLedsOneAtATime & operator=(const GoThroughAllLedsOneAtATime &) = delete;
+		
+		~GoThroughAllLedsOneAtATime() { delete[] _trace; }
+		
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
 	};
 
 
 
 
-	class Demo : public LedCubeSequence
+	/* Plays the sequence on the timeline of the cube (i.e. in sync with music): from the tick it starts on, its waits are
+	 * summed as ticks and fractions of a tick of the tempo it started with (scaled, not rounded), every frame is due at its
+	 * exact position on the timeline. Waits shorter than a tick stay as they are, nothing drifts and a change of the tempo
+	 * slows down or speeds up the sequence with the music (see extras/host/beat_check.cpp).
+	 */
+	class BeatSync : public LedCubeSequence
 	{
 	protected:
-		LedCubeSequence * _current_sequence;
+		LedCubeSequence * _sequence;
+		unsigned long _ticks_per_minute; // of the tempo the sequence started with
+		uint16_t _fraction; // of the tick after _tick [1/60000]
+	public:
+		BeatSync(LedCube * led_cube, LedCubeSequence * sequence)
+			: LedCubeSequence(led_cube), _sequence(sequence), _ticks_per_minute(0), _fraction(0)
+		{}
 		
-		void _setSequence(LedCubeSequence * new_sequence);
+		~BeatSync() { delete _sequence; }
+		
+		unsigned long operator()();
 		
-		unsigned long _nextFrameOfSequence();
+		bool archive(LedCubeArchive &archive);
+	};
+
+	// plays a table of sequences (see namespace playlist), the next sequence is constructed during the frames of the current one
+	// (with LedCube::setProfiler() the frames of every sequence are recorded under its playlist::SequenceId)
+	// Note: the built-in sequences are cheap to construct, so preparing ahead makes their switches no faster
+	// (extras/host/playlist_bench.cpp), it pays off for sequences with a costly constructor
+	class Playlist : public LedCubeSequence
+	{
+	protected:
+		const playlist::Entry * const _entries;
+		const bool _in_progmem;
+		const bool _prepare_ahead;
+		int _index; // of the next entry
+		LedCubeSequence * _current_sequence;
+		LedCubeSequence * _next_sequence;
+		uint8_t _current_type; // playlist::SequenceId for the profiler
+		uint8_t _next_type;
+		unsigned long _next_gap; // [ms]
+		bool _is_next_ready;
+		bool _is_list_end;
+		bool _is_after_gap;
+		transition::Mode _transition;
+		unsigned long _transition_duration; // [ms]
+		unsigned long _transition_step; // [ms]
 		
-		void _stopCurrentSequence();
+		unsigned long _switch_start; // [us]
+		unsigned long _switch_time; // [us]
+		unsigned long _last_switch_time; // [us]
+		unsigned long _max_switch_time; // [us]
+		unsigned long _max_prepare_time; // [us]
+		unsigned long _switches;
+		unsigned long _unprepared_switches;
+		unsigned long _split_time; // [us] of the pieces of the frame so far, for the profiler
+		unsigned long _split_writes; // of the pieces of the frame so far
+		long _drift_start; // [ms] LedCube::getSequenceDrift() at the first frame of the current sequence
+		long _last_drift; // [ms]
+		long _max_drift; // [ms]
+		uint8_t _max_drift_type;
 		
-		bool _isSequenceRunning() { return _current_sequence != nullptr; }
+		bool _prepareNext();
+		
+		void _prepareAhead();
 	public:
-		Demo(LedCube * led_cube)
-			: LedCubeSequence(led_cube), _current_sequence(nullptr)
+		Playlist(LedCube * led_cube, const playlist::Entry * entries, bool in_progmem=true, bool prepare_ahead=true)
+			: LedCubeSequence(led_cube), _entries(entries), _in_progmem(in_progmem), _prepare_ahead(prepare_ahead), _index(0),
+			_current_sequence(nullptr), _next_sequence(nullptr), _current_type(0), _next_type(0), _next_gap(0), _is_next_ready(false), _is_list_end(false), _is_after_gap(false),
+			_transition(transition::CUT), _transition_duration(0), _transition_step(0),
+			_switch_start(0), _switch_time(0), _last_switch_time(0), _max_switch_time(0), _max_prepare_time(0), _switches(0), _unprepared_switches(0),
+			_split_time(0), _split_writes(0), _drift_start(0), _last_drift(0), _max_drift(0), _max_drift_type(0)
 		{}
 		
+		~Playlist();
+
 		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
+		
+		// the next sequences start with a transition from the frame shown at the switch (after the gap)
+		void setTransition(transition::Mode mode, unsigned long duration=500, unsigned long step=20)
+		{
+			_transition = mode;
+			_transition_duration = duration;
+			_transition_step = step;
+		}
+		
+		/* Switch gap: time spent between the last frame of a sequence and the first frame of the next one,
+		 * without the gap of the entry (the pause is intended) [us]
+		 */
+		unsigned long getLastSwitchTime() { return _last_switch_time; }
+		
+		unsigned long getMaxSwitchTime() { return _max_switch_time; }
+		
+		// longest construction of a sequence done ahead, during the wait of a frame [us]
+		unsigned long getMaxPrepareTime() { return _max_prepare_time; }
+
+		unsigned long getSwitches() { return _switches; }
+
+		// switches which had to construct the sequence on their own (no frame with a wait and no gap before)
+		unsigned long getUnpreparedSwitches() { return _unprepared_switches; }
+		
+		/* Drift of the sequences of the playlist: how much of LedCube::getSequenceDrift() (the playlist against the sum of its
+		 * waits) came up during the frames of one of them (the switch to it included) [ms]
+		 */
+		long getCurrentDrift() { return _led_cube->getSequenceDrift() - _drift_start; }
+		
+		// of the last sequence which ended
+		long getLastDrift() { return _last_drift; }
+		
+		// the largest one a sequence ended with and its playlist::SequenceId
+		long getMaxDrift() { return _max_drift; }
+		
+		uint8_t getMaxDriftType() { return _max_drift_type; }
+	};
+	
+	class Demo : public Playlist
+	{
+	public:
+		Demo(LedCube * led_cube, bool prepare_ahead=true)
+			: Playlist(led_cube, playlist::demo, true, prepare_ahead)
+		{}
 	};
 }
 
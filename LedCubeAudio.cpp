@@ -0,0 +1,159 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeAudio.h"
+
+void LedCubeAnalogSource::begin()
+{
+	// selects the pin (and the reference) and starts the first conversion
+	analogRead(_pin);
+#ifdef __AVR__
+	ADCSRA |= _BV(ADSC);
+#endif
+}
+
+void LedCubeAnalogSource::sample()
+{
+#ifdef __AVR__
+	// the conversion started by the previous call is done, the next one runs until the next call
+	const int value = ADC;
+	ADCSRA |= _BV(ADSC);
+#else
+	const int value = analogRead(_pin);
+#endif
+	
+	if ((uint8_t)(_tail - _load(_head)) >= _capacity) {
+		_overruns += 1;
+		return;
+	}
+	_samples[_tail % _capacity] = value - 512;
+	_store(_tail, _tail + 1);
+}
+
+int LedCubeAnalogSource::read()
+{
+	if (available() == 0) {
+		return 0;
+	}
+	const int value = _samples[_head % _capacity];
+	
+	_store(_head, _head + 1);
+	return value;
+}
+
+unsigned long LedCubeAnalogSource::getOverruns()
+{
+	// written by sample() in the interrupt
+	noInterrupts();
+	const unsigned long overruns = _overruns;
+	interrupts();
+	return overruns;
+}
+
+namespace sequences {
+	void AudioVisualizer::_drawColumns()
+	{
+		int size = _led_cube->getSize();
+		
+		for (int x = 0; x < size; ++x) {
+			for (int z = 0; z < size; ++z) {
+				for (int y = 0; y < size; ++y) {
+					if (z < _levels[x]) {
+						_led_cube->turnOn(x, y, z);
+					} else {
+						_led_cube->turnOff(x, y, z);
+					}
+				}
+			}
+		}
+	}
+	
+	void AudioVisualizer::_drawLayers()
+	{
+		int size = _led_cube->getSize();
+		
+		for (int z = 0; z < size; ++z) {
+			// level 1 => the middle (1x1 or 2x2), max level => the whole layer
+			int low = (size - 2*_levels[z] + 1) / 2;
+			int high = size-1 - low;
+			if (_levels[z] == 0) {
+				low = size;
+			}
+			for (int y = 0; y < size; ++y) {
+				for (int x = 0; x < size; ++x) {
+					if (x >= low && x <= high && y >= low && y <= high) {
+						_led_cube->turnOn(x, y, z);
+					} else {
+						_led_cube->turnOff(x, y, z);
+					}
+				}
+			}
+		}
+	}
+	
+	unsigned long AudioVisualizer::operator()()
+	{
+		int size = _led_cube->getSize();
+		int num_bands = (size < LedCubeSpectrum::max_bands) ? size : LedCubeSpectrum::max_bands;
+		int max_level = (_mode == COLUMNS) ? size : (size + 1) / 2;
+		
+		while (true) {
+			switch(_state) {
+				case 0:
+					_led_cube->turnEverythingOff();
+					_state += 1;
+				case 1:
+					if (_max_frames == 0 || _frames_cnt < _max_frames) {
+						unsigned int available = _source->available();
+						
+						if (available < (unsigned int)LedCubeSpectrum::block_len) {
+							// until the rest of the block is sampled
+							const unsigned long missing = LedCubeSpectrum::block_len - available;
+							const unsigned int rate = _source->getSampleRate();
+							
+							return (missing * 1000 + rate - 1) / rate;
+						}
+						_frames_cnt += 1;
+						
+						// the newest block (the main loop was late)
+						for (; available > (unsigned int)LedCubeSpectrum::block_len; --available) {
+							_source->read();
+						}
+						for (int i = 0; i < LedCubeSpectrum::block_len; ++i) {
+							_samples[i] = _source->read();
+						}
+						
+						unsigned long start = micros();
+						_spectrum.compute(_samples);
+						for (int band = 0; band < num_bands; ++band) {
+							int level = LedCubeSpectrum::toLevel(_spectrum.getBand(band, num_bands), max_level);
+							if (level >= _levels[band]) {
+								_levels[band] = level;
+							} else {
+								_levels[band] -= 1;
+							}
+						}
+						if (_mode == COLUMNS) {
+							_drawColumns();
+						} else {
+							_drawLayers();
+						}
+						_last_compute_time = micros() - start;
+						
+						return _wait;
+					} else {
+						_state += 1;
+					}
+					break;
+				case 2:
+					_led_cube->turnEverythingOff();
+					_state += 1;
+					return _wait;
+				default:
+					return 0;
+			}
+		}
+	}
+}
+
+// EOF
@@ -0,0 +1,115 @@
+#ifndef _LED_CUBE_AUDIO_H
+#define _LED_CUBE_AUDIO_H
+
+#include "LedCube.h"
+#include "LedCubeSpectrum.h"
+
+// source of audio samples with a fixed sample rate
+class LedCubeSampleSource
+{
+public:
+	virtual unsigned int getSampleRate() = 0; // [Hz]
+	
+	// samples which read() returns without waiting
+	virtual unsigned int available() = 0;
+	
+	// the oldest sample not read yet, a signed 10 bit sample (like analogRead() - 512)
+	virtual int read() = 0;
+};
+
+/* Analog input sampled into a ring by sample(), called at the sample rate from a timer interrupt (see
+ * examples/AudioVisualizer), so the main loop never waits for the samples:
+ * - AVR: sample() takes the result of the conversion started by its previous call and starts the next one (a few us
+ *   instead of the 112 us of analogRead(), sample rates up to about 8 kHz), begin() selects the pin,
+ *   no other analogRead() may run while sampling
+ * - elsewhere: sample() calls analogRead()
+ * The ring holds two blocks (LedCubeSpectrum::block_len), when it is full new samples are dropped and counted.
+ */
+class LedCubeAnalogSource : public LedCubeSampleSource
+{
+protected:
+	static const uint8_t _capacity = 2 * LedCubeSpectrum::block_len; // power of two
+	const uint8_t _pin;
+	const unsigned int _sample_rate; // [Hz]
+	int16_t _samples[_capacity];
+	uint8_t _head; // next to read (main loop)
+	uint8_t _tail; // next to write (interrupt)
+	volatile unsigned long _overruns;
+	
+	uint8_t _load(const uint8_t &index) { return __atomic_load_n(&index, __ATOMIC_ACQUIRE); }
+	
+	void _store(uint8_t &index, uint8_t value) { __atomic_store_n(&index, value, __ATOMIC_RELEASE); }
+public:
+	LedCubeAnalogSource(uint8_t pin, unsigned int sample_rate=4000)
+		: _pin(pin), _sample_rate(sample_rate), _head(0), _tail(0), _overruns(0)
+	{}
+	
+	// before the interrupt starts calling sample()
+	void begin();
+	
+	// from the timer interrupt, at the sample rate
+	void sample();
+	
+	unsigned int getSampleRate() { return _sample_rate; }
+	
+	unsigned int available() { return (uint8_t)(_load(_tail) - _head); }
+	
+	int read();
+	
+	// samples dropped because the ring was full
+	unsigned long getOverruns();
+};
+
+namespace sequences {
+	/* Audio visualizer, every frame:
+	 * - takes the newest block of samples (LedCubeSpectrum::block_len samples, 8 ms at 4 kHz) sampled meanwhile by
+	 *   the source, older ones are skipped; a block which is not complete yet is waited for by the wait of the frame
+	 * - computes the spectrum and maps the bands to the cube
+	 *   - COLUMNS: band per x (bass on the left), the height of the wall is the level
+	 *   - LAYERS: band per layer (bass at the bottom), the level is the size of the square in the middle of the layer
+	 * - levels fall by one step per frame (peak hold)
+	 * Latency from the sound to the LEDs (the block + compute + the next scan), measured by extras/host/audio_bench on 4x4x4
+	 * at 4 kHz: 16 ms on average (at most 17 ms) at the fixed 60 Hz refresh, 7 ms (at most 18 ms) with the automatic one.
+	 */
+	class AudioVisualizer : public LedCubeSequence
+	{
+	public:
+		enum Mode {
+			COLUMNS,
+			LAYERS
+		};
+	protected:
+		LedCubeSampleSource * _source;
+		const Mode _mode;
+		const unsigned long _wait; // [ms]
+		const int _max_frames; // 0 => forever
+		int _frames_cnt;
+		LedCubeSpectrum _spectrum;
+		int16_t _samples[LedCubeSpectrum::block_len];
+		uint8_t _levels[LedCubeSpectrum::max_bands];
+		unsigned long _last_compute_time; // [us]
+		
+		void _drawColumns();
+		void _drawLayers();
+	public:
+		AudioVisualizer(LedCube * led_cube, LedCubeSampleSource * source, Mode mode=COLUMNS, unsigned long wait=1, int max_frames=0)
+			: LedCubeSequence(led_cube), _source(source), _mode(mode), _wait(wait), _max_frames(max_frames), _frames_cnt(0), _last_compute_time(0)
+		{
+			for (int i = 0; i < LedCubeSpectrum::max_bands; ++i) {
+				_levels[i] = 0;
+			}
+		}
+		
+		unsigned long operator()();
+		
+		// time of the spectrum and drawing of the last frame (without sampling) [us]
+		unsigned long getLastComputeTime() { return _last_compute_time; }
+		
+		// duration of sampling of one block [us]
+		unsigned long getBlockTime() { return 1000000UL * LedCubeSpectrum::block_len / _source->getSampleRate(); }
+		
+		int getLevel(int band) { return _levels[band]; }
+	};
+}
+
+#endif // _LED_CUBE_AUDIO_H
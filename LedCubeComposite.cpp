@@ -0,0 +1,187 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeComposite.h"
+#include "LedCubeSnapshot.h"
+
+namespace sequences {
+	Composite::~Composite()
+	{
+		for (int i = 0; i < _num_layers; ++i) {
+			delete _layers[i].sequence;
+			delete _layers[i].frame;
+		}
+	}
+	
+	bool Composite::addLayer(LedCubeSequence * sequence, composite::Operator op)
+	{
+		if (_num_layers >= _max_layers) {
+			return false;
+		}
+		
+		Layer &layer = _layers[_num_layers];
+		layer.sequence = sequence;
+		layer.frame = new LedCubeFrame(_led_cube->getSize());
+		layer.op = op;
+		layer.due = _time;
+		_num_layers += 1;
+		return true;
+	}
+	
+	bool Composite::_advance(Layer &layer)
+	{
+		// draws the frames of the layer which are due, true when the layer changed
+		LedCubeFrame * target = _led_cube->getRenderTarget();
+		bool changed = false;
+		
+		for (int i = 0; layer.sequence != nullptr && (long)(_time - layer.due) >= 0 && i < _max_catch_up; ++i) {
+			_led_cube->setRenderTarget(layer.frame);
+			const unsigned long wait = (*layer.sequence)();
+			_led_cube->setRenderTarget(target);
+			changed = true;
+			if (wait == 0) {
+				delete layer.sequence;
+				layer.sequence = nullptr;
+			} else {
+				layer.due += wait;
+			}
+		}
+		return changed;
+	}
+	
+	bool Composite::_composite()
+	{
+		// true when the result differs from the last one
+		uint8_t * const result = _result.getBits();
+		const int bytes = _result.getBytes();
+		bool changed = false;
+		
+		for (int i = 0; i < bytes; ++i) {
+			// the base is taken as it is, its operator has nothing under it to combine with
+			uint8_t bits = _layers[0].frame->getBits()[i];
+			
+			for (int l = 1; l < _num_layers; ++l) {
+				if (_layers[l].sequence == nullptr) {
+					continue;
+				}
+				const uint8_t layer = _layers[l].frame->getBits()[i];
+				switch(_layers[l].op) {
+					case composite::OR: bits |= layer; break;
+					case composite::AND: bits &= layer; break;
+					case composite::XOR: bits ^= layer; break;
+					case composite::MASK: bits &= ~layer; break;
+				}
+			}
+			if (bits != result[i]) {
+				result[i] = bits;
+				changed = true;
+			}
+		}
+		return changed;
+	}
+	
+	void Composite::_show()
+	{
+		const int size = _led_cube->getSize();
+		
+		for (int z = 0; z < size; ++z) {
+			for (int y = 0; y < size; ++y) {
+				_led_cube->setRow(y, z, _result.getRow(y, z));
+			}
+		}
+	}
+	
+	unsigned long Composite::operator()()
+	{
+		switch(_state) {
+			case 0:
+				if (_num_layers == 0) {
+					return 0;
+				}
+				// the map is written as a whole the first time
+				_show();
+				_state += 1;
+			case 1:
+			{
+				bool changed = false;
+				for (int l = 0; l < _num_layers; ++l) {
+					if (_advance(_layers[l])) {
+						changed = true;
+					}
+				}
+				_last_composite_time = 0;
+				if (changed) {
+					const unsigned long start = micros();
+					changed = _composite();
+					if (changed) {
+						_show();
+					}
+					_last_composite_time = micros() - start;
+					if (_last_composite_time > _max_composite_time) {
+						_max_composite_time = _last_composite_time;
+					}
+					_composites += 1;
+				}
+				if (!changed) {
+					_skipped += 1;
+				}
+				if (_layers[0].sequence == nullptr) {
+					// the base ended, what it drew last stays
+					_state = -1;
+					return 0;
+				}
+				
+				// until the nearest frame of a layer
+				unsigned long next = _layers[0].due;
+				for (int l = 1; l < _num_layers; ++l) {
+					if (_layers[l].sequence != nullptr && (long)(_layers[l].due - next) < 0) {
+						next = _layers[l].due;
+					}
+				}
+				if ((long)(next - _time) <= 0) {
+					// a layer is catching up
+					next = _time + 1;
+				}
+				const unsigned long wait = next - _time;
+				_time = next;
+				return wait;
+			}
+			default:
+				return 0;
+		}
+	}
+	
+	bool Composite::archive(LedCubeArchive &archive)
+	{
+		int num_layers = _num_layers;
+		
+		_archiveState(archive);
+		archive.field(_time);
+		archive.field(num_layers);
+		if (!archive.isOk() || num_layers != _num_layers) {
+			return false;
+		}
+		archive.bytes(_result.getBits(), _result.getBytes());
+		for (int l = 0; l < _num_layers; ++l) {
+			Layer &layer = _layers[l];
+			bool has_sequence = layer.sequence != nullptr;
+			
+			archive.field(has_sequence);
+			archive.field(layer.due);
+			archive.bytes(layer.frame->getBits(), layer.frame->getBytes());
+			if (!archive.isOk()) {
+				return false;
+			}
+			if (archive.isLoading() && !has_sequence) {
+				delete layer.sequence;
+				layer.sequence = nullptr;
+			}
+			if (has_sequence && (layer.sequence == nullptr || !layer.sequence->archive(archive))) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+// EOF
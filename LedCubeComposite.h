@@ -0,0 +1,78 @@
+#ifndef _LED_CUBE_COMPOSITE_H
+#define _LED_CUBE_COMPOSITE_H
+
+#include "LedCube.h"
+#include "LedCubeTransition.h"
+
+// how a layer of sequences::Composite is combined with the layers under it
+namespace composite {
+	enum Operator {
+		OR, // LEDs of the layer are added
+		AND, // only LEDs lit in the layer stay
+		XOR, // LEDs of the layer invert the ones under it
+		MASK // LEDs of the layer are cut out
+	};
+}
+
+namespace sequences {
+	/* Plays several sequences at once (e.g. an animation and a status LED on top of it), each into its own layer
+	 * (LedCubeFrame) by its own waits. The layers are combined from the first one up, a byte (8 LEDs) at a time,
+	 * and only in frames in which some layer drew a new frame; the map is rewritten only when the result changed.
+	 * The first layer is the base: it is taken as it is (its operator is not used, AND or MASK would have nothing under them
+	 * and blank the cube) and the composite ends with it. Other layers which end are left out from then on.
+	 */
+	class Composite : public LedCubeSequence
+	{
+	protected:
+		static const int _max_layers = 4;
+		struct Layer {
+			LedCubeSequence * sequence; // nullptr => ended
+			LedCubeFrame * frame;
+			composite::Operator op;
+			unsigned long due; // [ms] next frame
+		} _layers[_max_layers];
+		int _num_layers;
+		LedCubeFrame _result;
+		unsigned long _time; // [ms] since the start
+		static const int _max_catch_up = 4;
+		
+		unsigned long _last_composite_time; // [us]
+		unsigned long _max_composite_time; // [us]
+		unsigned long _composites;
+		unsigned long _skipped;
+		
+		bool _advance(Layer &layer);
+		
+		bool _composite();
+		
+		void _show();
+	public:
+		Composite(LedCube * led_cube)
+			: LedCubeSequence(led_cube), _num_layers(0), _result(led_cube->getSize()), _time(0),
+			_last_composite_time(0), _max_composite_time(0), _composites(0), _skipped(0)
+		{}
+		
+		~Composite();
+		
+		// adds the layer on top of the others (the sequence is owned), false when there are already _max_layers;
+		// the operator of the first layer is not used
+		bool addLayer(LedCubeSequence * sequence, composite::Operator op=composite::OR);
+		
+		unsigned long operator()();
+		
+		// the layers (constructed with the same parameters and added in the same order) with their frames
+		bool archive(LedCubeArchive &archive);
+		
+		// time of compositing in the last frame (0 => no layer changed) [us]
+		unsigned long getLastCompositeTime() { return _last_composite_time; }
+		
+		unsigned long getMaxCompositeTime() { return _max_composite_time; }
+		
+		unsigned long getComposites() { return _composites; }
+		
+		// frames in which the map was not rewritten (no layer drew a frame or the result stayed the same)
+		unsigned long getSkippedWrites() { return _skipped; }
+	};
+}
+
+#endif // _LED_CUBE_COMPOSITE_H
@@ -0,0 +1,94 @@
+#ifndef _LED_CUBE_COROUTINE_H
+#define _LED_CUBE_COROUTINE_H
+
+#include "LedCube.h"
+
+/* Stackless coroutines (protothreads) for LedCubeSequence::operator()
+ *
+ *   unsigned long MySequence::operator()()
+ *   {
+ *       SEQUENCE_BEGIN();
+ *       for (_layer = 0; _layer < _led_cube->getSize(); ++_layer) {
+ *           ...
+ *           SEQUENCE_YIELD(_wait);
+ *       }
+ *       SEQUENCE_END();
+ *   }
+ *
+ * - the position in the function is kept in _state (ordinal of the last yield in the function: 1, 2, ...), 0 => start;
+ *   it does not depend on the lines, so a snapshot (LedCubeSnapshot.h) fits every build with the same yields
+ * - local variables do not survive SEQUENCE_YIELD, use members instead
+ * - SEQUENCE_YIELD cannot be used inside of a switch statement
+ * - after SEQUENCE_END the sequence returns 0 (ends)
+ */
+#define SEQUENCE_BEGIN() enum { _sequence_first = __COUNTER__ }; switch (_state) { case 0:
+
+// the argument is expanded once, so both uses get the same __COUNTER__
+#define SEQUENCE_YIELD(wait) _SEQUENCE_YIELD_TO(wait, __COUNTER__ - _sequence_first)
+
+#define _SEQUENCE_YIELD_TO(wait, point) \
+	do { \
+		_state = (point); \
+		return (wait); \
+		case (point):; \
+	} while (0)
+
+#define SEQUENCE_END() } _state = -1; return 0
+
+
+#if defined(__cpp_impl_coroutine) && !defined(ARDUINO)
+// C++20 coroutines (host builds only): sequences written as a plain function with "co_yield wait;"
+#include <coroutine>
+#include <exception>
+
+class LedCubeTask
+{
+public:
+	struct promise_type
+	{
+		unsigned long wait = 0;
+		
+		LedCubeTask get_return_object() { return LedCubeTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		std::suspend_always yield_value(unsigned long new_wait) noexcept { wait = new_wait; return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() { std::terminate(); }
+	};
+private:
+	std::coroutine_handle<promise_type> _handle;
+	
+	explicit LedCubeTask(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+public:
+	LedCubeTask(LedCubeTask && other) noexcept : _handle(other._handle) { other._handle = nullptr; }
+	LedCubeTask(const LedCubeTask &) = delete;
+	LedCubeTask & operator=(const LedCubeTask &) = delete;
+	~LedCubeTask() { if (_handle) _handle.destroy(); }
+	
+	// runs to the next co_yield, 0 => finished
+	unsigned long next()
+	{
+		if (!_handle || _handle.done()) {
+			return 0;
+		}
+		_handle.resume();
+		return _handle.done() ? 0 : _handle.promise().wait;
+	}
+};
+
+namespace sequences {
+	class Coroutine : public LedCubeSequence
+	{
+	protected:
+		LedCubeTask _task;
+	public:
+		Coroutine(LedCube * led_cube, LedCubeTask && task)
+			: LedCubeSequence(led_cube), _task(static_cast<LedCubeTask &&>(task))
+		{}
+		
+		unsigned long operator()() { return _task.next(); }
+	};
+}
+#endif
+
+#endif // _LED_CUBE_COROUTINE_H
@@ -0,0 +1,262 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeField.h"
+#include "LedCubeVector.h"
+#include "LedCubeSnapshot.h"
+
+LedCubeField::LedCubeField(LedCube * led_cube, int16_t low, int16_t high)
+	: _led_cube(led_cube), _size(led_cube->getSize()), _low(low), _high(high), _last_draw_time(0), _max_draw_time(0)
+{
+	_values = new int16_t[_size];
+}
+
+LedCubeField::~LedCubeField()
+{
+	delete[] _values;
+}
+
+void LedCubeField::row(int y, int z, int16_t * values)
+{
+	for (int x = 0; x < _size; ++x) {
+		values[x] = value(x, y, z);
+	}
+}
+
+void LedCubeField::draw(uint8_t t)
+{
+	const unsigned long start = micros();
+	// low <= value <= high by one unsigned comparison
+	const uint16_t range = _high - _low;
+	
+	begin(t);
+	for (int z = 0; z < _size; ++z) {
+		for (int y = 0; y < _size; ++y) {
+			uint16_t bits = 0;
+			uint16_t mask = 1;
+			
+			row(y, z, _values);
+			for (int x = 0; x < _size; ++x, mask <<= 1) {
+				if ((uint16_t)(_values[x] - _low) <= range) {
+					bits |= mask;
+				}
+			}
+			_led_cube->setRow(y, z, bits);
+		}
+	}
+	_last_draw_time = micros() - start;
+	if (_last_draw_time > _max_draw_time) {
+		_max_draw_time = _last_draw_time;
+	}
+}
+
+namespace fields {
+	void Plane::begin(uint8_t t)
+	{
+		// unit normal in Q14, its components are the steps of the distance per LED (Q8.8)
+		const uint8_t turn = t * _speed_turn;
+		const uint8_t tilt = t * _speed_tilt;
+		const long cos_tilt = vector3d::cos(tilt);
+		
+		_dx = (((cos_tilt * vector3d::cos(turn)) >> 14) + 32) >> 6;
+		_dy = (((cos_tilt * vector3d::sin(turn)) >> 14) + 32) >> 6;
+		_dz = (vector3d::sin(tilt) + 32) >> 6;
+		// through the center of the cube
+		_offset = -((long)(_dx + _dy + _dz) * (_size - 1)) / 2;
+	}
+	
+	int16_t Plane::value(int x, int y, int z)
+	{
+		return _offset + _dx * x + _dy * y + _dz * z;
+	}
+	
+	void Plane::row(int y, int z, int16_t * values)
+	{
+		int16_t distance = _offset + _dy * y + _dz * z;
+		
+		for (int x = 0; x < _size; ++x) {
+			values[x] = distance;
+			distance += _dx;
+		}
+	}
+	
+	Surface::Surface(LedCube * led_cube)
+		: LedCubeField(led_cube, -128, 127)
+	{
+		_heights = new int16_t[_size * _size];
+		memset(_heights, 0, _size * _size * sizeof(int16_t));
+	}
+	
+	Surface::~Surface()
+	{
+		delete[] _heights;
+	}
+	
+	int16_t Surface::value(int x, int y, int z)
+	{
+		return (z << 8) - _heights[x + y * _size];
+	}
+	
+	void Surface::row(int y, int z, int16_t * values)
+	{
+		const int16_t * heights = _heights + y * _size;
+		const int16_t height = z << 8;
+		
+		for (int x = 0; x < _size; ++x) {
+			values[x] = height - heights[x];
+		}
+	}
+	
+	Wave::Wave(LedCube * led_cube, uint8_t kx, uint8_t ky, int16_t amplitude)
+		: Surface(led_cube), _kx(kx), _ky(ky), _amplitude(amplitude)
+	{
+		if (_kx == 0) {
+			_kx = 256 / _size;
+		}
+		if (_ky == 0) {
+			_ky = 128 / _size;
+		}
+		if (_amplitude == 0) {
+			_amplitude = (_size - 1) * 64;
+		}
+	}
+	
+	void Wave::begin(uint8_t t)
+	{
+		// the phase moves by kx along the row
+		const int16_t middle = (_size - 1) * 128;
+		int16_t * heights = _heights;
+		
+		for (int y = 0; y < _size; ++y) {
+			uint8_t phase = _ky * y + t;
+			
+			for (int x = 0; x < _size; ++x, phase += _kx) {
+				*heights++ = middle + (((long)_amplitude * vector3d::sin(phase)) >> 14);
+			}
+		}
+	}
+	
+	Ripple::Ripple(LedCube * led_cube, uint8_t k, int16_t amplitude)
+		: Surface(led_cube), _amplitude(amplitude)
+	{
+		if (k == 0) {
+			k = 512 / _size;
+		}
+		if (_amplitude == 0) {
+			_amplitude = (_size - 1) * 64;
+		}
+		_phases = new uint8_t[_size * _size];
+		// distances from the axis of the cube, once
+		const float center = (_size - 1) / 2.0;
+		
+		for (int y = 0; y < _size; ++y) {
+			for (int x = 0; x < _size; ++x) {
+				const float distance = sqrt((x - center) * (x - center) + (y - center) * (y - center));
+				
+				_phases[x + y * _size] = (uint8_t)(long)(k * distance + 0.5);
+			}
+		}
+	}
+	
+	Ripple::~Ripple()
+	{
+		delete[] _phases;
+	}
+	
+	void Ripple::begin(uint8_t t)
+	{
+		const int16_t middle = (_size - 1) * 128;
+		
+		for (int i = 0; i < _size * _size; ++i) {
+			_heights[i] = middle + (((long)_amplitude * vector3d::sin(_phases[i] - t)) >> 14);
+		}
+	}
+	
+	Plasma::Plasma(LedCube * led_cube, uint8_t k)
+		: LedCubeField(led_cube, -40, 40), _k(k)
+	{
+		if (_k == 0) {
+			_k = 256 / _size;
+		}
+		_terms = new int16_t[6 * _size - 2];
+	}
+	
+	Plasma::~Plasma()
+	{
+		delete[] _terms;
+	}
+	
+	void Plasma::begin(uint8_t t)
+	{
+		// every term -64..64 (Q14 >> 8)
+		int16_t * terms_x = _terms;
+		int16_t * terms_y = _terms + _size;
+		int16_t * terms_z = _terms + 2 * _size;
+		int16_t * terms_d = _terms + 3 * _size;
+		
+		for (int i = 0; i < _size; ++i) {
+			terms_x[i] = vector3d::sin(_k * i + t) >> 8;
+			terms_y[i] = vector3d::sin(_k * i - 2 * t + 64) >> 8;
+			terms_z[i] = vector3d::sin(_k * i + 3 * t + 128) >> 8;
+		}
+		for (int i = 0; i < 3 * _size - 2; ++i) {
+			terms_d[i] = vector3d::sin(((_k * i) >> 1) - t) >> 8;
+		}
+	}
+	
+	int16_t Plasma::value(int x, int y, int z)
+	{
+		return _terms[x] + _terms[_size + y] + _terms[2 * _size + z] + _terms[3 * _size + x + y + z];
+	}
+	
+	void Plasma::row(int y, int z, int16_t * values)
+	{
+		const int16_t base = _terms[_size + y] + _terms[2 * _size + z];
+		const int16_t * terms_x = _terms;
+		const int16_t * terms_d = _terms + 3 * _size + y + z;
+		
+		for (int x = 0; x < _size; ++x) {
+			values[x] = base + terms_x[x] + terms_d[x];
+		}
+	}
+}
+
+namespace sequences {
+	unsigned long Shader::operator()()
+	{
+		while (true) {
+			switch(_state) {
+				case 0:
+					_led_cube->turnEverythingOff();
+					_field->resetDrawTime();
+					_state += 1;
+				case 1:
+					if (_frames_cnt < _max_frames) {
+						_frames_cnt += 1;
+						_field->draw(_t);
+						_t += _speed;
+						return _wait;
+					} else {
+						_state += 1;
+					}
+					break;
+				case 2:
+					_led_cube->turnEverythingOff();
+					_state += 1;
+					return _wait;
+				default:
+					return 0;
+			}
+		}
+	}
+	
+	bool Shader::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_frames_cnt);
+		archive.field(_t);
+		return archive.isOk();
+	}
+}
+
+// EOF
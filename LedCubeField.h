@@ -0,0 +1,181 @@
+#ifndef _LED_CUBE_FIELD_H
+#define _LED_CUBE_FIELD_H
+
+#include "LedCube.h"
+
+/* Procedural field ("shader"): an integer function f(x, y, z, t) of every LED, the LEDs whose value is within
+ * the band <low, high> are lit. A frame is drawn in three steps:
+ * - begin(t) once per frame: small tables of the terms that depend on one or two coordinates (sin from PROGMEM, see LedCubeVector.h)
+ * - row(y, z) for every row: the values of the whole row, incrementally or from the tables (a few additions per LED)
+ * - the row is compared with the band and written by setRow()
+ * A new field needs only value() (called for every LED, the slow but simple way), row() makes it fast.
+ * The geometric fields below give distances in Q8.8 LEDs (256 => 1 LED), so the band <-128, 127> is a surface one LED thick.
+ */
+class LedCubeField
+{
+protected:
+	LedCube * _led_cube;
+	const int _size;
+	int16_t _low, _high;
+	int16_t * _values; // [size] of the row
+	unsigned long _last_draw_time; // [us]
+	unsigned long _max_draw_time; // [us]
+	
+	LedCubeField(LedCube * led_cube, int16_t low, int16_t high);
+public:
+	LedCubeField(const LedCubeField &) = delete;
+	
+	LedCubeField & operator=(const LedCubeField &) = delete;
+	
+	virtual ~LedCubeField();
+	
+	// prepares the frame t (tables of the terms shared by many LEDs)
+	virtual void begin(uint8_t t) { (void)t; }
+	
+	// value of one LED in the frame given to begin()
+	virtual int16_t value(int x, int y, int z) = 0;
+	
+	// values of the row x = 0..size-1 in the frame given to begin(), by default value() for every LED
+	virtual void row(int y, int z, int16_t * values);
+	
+	// evaluates the frame t into the cube (or its render target)
+	void draw(uint8_t t);
+	
+	void setBand(int16_t low, int16_t high) { _low = low; _high = high; }
+	
+	unsigned long getLastDrawTime() { return _last_draw_time; }
+	
+	unsigned long getMaxDrawTime() { return _max_draw_time; }
+	
+	void resetDrawTime() { _max_draw_time = 0; }
+};
+
+namespace fields {
+	// any function of the LED and the frame, evaluated for every LED (for writing new fields, see LedCubeField)
+	class Function : public LedCubeField
+	{
+	protected:
+		int16_t (*_function)(int x, int y, int z, uint8_t t);
+		uint8_t _t;
+	public:
+		Function(LedCube * led_cube, int16_t (*function)(int x, int y, int z, uint8_t t), int16_t low, int16_t high)
+			: LedCubeField(led_cube, low, high), _function(function), _t(0)
+		{}
+		
+		void begin(uint8_t t) { _t = t; }
+		
+		int16_t value(int x, int y, int z) { return _function(x, y, z, _t); }
+	};
+	
+	// distance from a plane through the center of the cube whose normal turns around z by speed_turn and tilts by speed_tilt
+	// (1/256 of a turn per frame): 1 addition per LED
+	class Plane : public LedCubeField
+	{
+	protected:
+		const uint8_t _speed_turn, _speed_tilt;
+		int16_t _dx, _dy, _dz; // [1/256 LED] per LED
+		int16_t _offset; // [1/256 LED] at the LED 0, 0, 0
+	public:
+		Plane(LedCube * led_cube, uint8_t speed_turn=2, uint8_t speed_tilt=3)
+			: LedCubeField(led_cube, -128, 127), _speed_turn(speed_turn), _speed_tilt(speed_tilt)
+		{}
+		
+		void begin(uint8_t t);
+		
+		int16_t value(int x, int y, int z);
+		
+		void row(int y, int z, int16_t * values);
+	};
+	
+	// height of a surface above the LED row of the column x, y, the heights are computed once per frame (2 B per column):
+	// 1 subtraction per LED
+	class Surface : public LedCubeField
+	{
+	protected:
+		int16_t * _heights; // [size * size] [1/256 LED]
+		
+		Surface(LedCube * led_cube);
+	public:
+		~Surface();
+		
+		int16_t value(int x, int y, int z);
+		
+		void row(int y, int z, int16_t * values);
+	};
+	
+	// plane wave: height = middle + amplitude * sin(kx * x + ky * y + t), k in 1/256 of a turn per LED
+	// (defaults: one wave across x, a half across y, amplitude a quarter of the cube)
+	class Wave : public Surface
+	{
+	protected:
+		uint8_t _kx, _ky;
+		int16_t _amplitude; // [1/256 LED]
+	public:
+		Wave(LedCube * led_cube, uint8_t kx=0, uint8_t ky=0, int16_t amplitude=0);
+		
+		void begin(uint8_t t);
+	};
+	
+	// circular waves from the center: height = middle + amplitude * sin(k * distance - t),
+	// the phases k * distance of the columns are computed once (1 B per column)
+	class Ripple : public Surface
+	{
+	protected:
+		uint8_t * _phases; // [size * size]
+		int16_t _amplitude; // [1/256 LED]
+	public:
+		Ripple(LedCube * led_cube, uint8_t k=0, int16_t amplitude=0);
+		
+		~Ripple();
+		
+		void begin(uint8_t t);
+	};
+	
+	// sum of four waves along x, y, z and the diagonal x + y + z with their own speeds (values -256..256),
+	// the terms are tables of size (the diagonal 3 * size) computed per frame: 2 additions per LED
+	// (the default band <-40, 40> shows the level surface between the blobs)
+	class Plasma : public LedCubeField
+	{
+	protected:
+		uint8_t _k;
+		int16_t * _terms; // x [size], y [size], z [size], x + y + z [3 * size - 2]
+	public:
+		Plasma(LedCube * led_cube, uint8_t k=0);
+		
+		~Plasma();
+		
+		void begin(uint8_t t);
+		
+		int16_t value(int x, int y, int z);
+		
+		void row(int y, int z, int16_t * values);
+	};
+}
+
+namespace sequences {
+	// draws the field (owned) for max_frames frames, t moves by speed every frame
+	class Shader : public LedCubeSequence
+	{
+	protected:
+		LedCubeField * _field;
+		const unsigned long _wait; // [ms]
+		const int _max_frames;
+		int _frames_cnt;
+		const uint8_t _speed;
+		uint8_t _t;
+	public:
+		Shader(LedCube * led_cube, LedCubeField * field, unsigned long wait=40, int max_frames=400, uint8_t speed=1)
+			: LedCubeSequence(led_cube), _field(field), _wait(wait), _max_frames(max_frames), _frames_cnt(0), _speed(speed), _t(0)
+		{}
+		
+		~Shader() { delete _field; }
+		
+		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
+		
+		LedCubeField & getField() { return *_field; }
+	};
+}
+
+#endif // _LED_CUBE_FIELD_H
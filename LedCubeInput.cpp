@@ -0,0 +1,180 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeInput.h"
+
+bool LedCubeEventQueue::push(const LedCubeInputEvent &event)
+{
+	const uint8_t tail = _tail;
+	
+	if ((uint8_t)(tail - _load(_head)) >= _depth) {
+		return false;
+	}
+	_events[tail % _depth] = event;
+	_store(_tail, tail + 1);
+	return true;
+}
+
+bool LedCubeEventQueue::pop(LedCubeInputEvent &event)
+{
+	const uint8_t head = _head;
+	
+	if (head == _load(_tail)) {
+		return false;
+	}
+	event = _events[head % _depth];
+	_store(_head, head + 1);
+	return true;
+}
+
+LedCubeInput::LedCubeInput(LedCube * led_cube, const uint8_t * button_pins, uint8_t num_buttons, const uint8_t * axis_pins, uint8_t num_axes,
+	unsigned long debounce, unsigned long axis_interval, int threshold, uint8_t depth)
+	: _led_cube(led_cube), _queue(depth), _button_pins(button_pins), _num_buttons((num_buttons < _max_buttons) ? num_buttons : _max_buttons),
+	_axis_pins(axis_pins), _num_axes(num_axes), _debounce(debounce), _axis_interval(axis_interval), _threshold(threshold),
+	_next_task(led_cube->getRefreshTask()), _pressed(0), _last_axes(0),
+	_is_pending(false), _pending_time(0), _read_time(0),
+	_events(0), _overflows(0), _bounces(0), _latencies(0), _last_latency(0), _max_latency(0), _average_latency(0)
+{
+	_last_edge = new unsigned long[_num_buttons];
+	_axis_value = new int[_num_axes];
+	for (uint8_t i = 0; i < _num_buttons; ++i) {
+		pinMode(_button_pins[i], INPUT_PULLUP);
+		_last_edge[i] = 0;
+	}
+	for (uint8_t i = 0; i < _num_axes; ++i) {
+		_axis_value[i] = analogRead(_axis_pins[i]);
+	}
+	_led_cube->setRefreshTask(this);
+	start(1);
+}
+
+LedCubeInput::~LedCubeInput()
+{
+	if (_led_cube->getRefreshTask() == this) {
+		_led_cube->setRefreshTask(_next_task);
+	}
+	delete[] _last_edge;
+	delete[] _axis_value;
+}
+
+void LedCubeInput::_push(uint8_t type, uint8_t source, int value, unsigned long time)
+{
+	LedCubeInputEvent event;
+	
+	event.type = type;
+	event.source = source;
+	event.value = value;
+	event.time = time;
+	if (_queue.push(event)) {
+		_events += 1;
+	} else {
+		_overflows += 1;
+	}
+}
+
+void LedCubeInput::_captureButtons(unsigned long now)
+{
+	for (uint8_t i = 0; i < _num_buttons; ++i) {
+		const bool is_down = digitalRead(_button_pins[i]) == LOW;
+		const uint16_t bit = 1U << i;
+		
+		if (is_down == ((_pressed & bit) != 0)) {
+			continue;
+		}
+		// the first edge at once, then nothing for the debounce time
+		if (now - _last_edge[i] < _debounce) {
+			_bounces += 1;
+			continue;
+		}
+		_last_edge[i] = now;
+		_pressed ^= bit;
+		_push(is_down ? input::PRESS : input::RELEASE, i, 0, now);
+	}
+}
+
+void LedCubeInput::capture()
+{
+	_captureButtons(micros());
+}
+
+void LedCubeInput::poll()
+{
+	unsigned long now = micros();
+	
+	noInterrupts();
+	_captureButtons(now);
+	interrupts();
+	
+	if (_num_axes > 0 && now - _last_axes >= _axis_interval) {
+		_last_axes = now;
+		for (uint8_t i = 0; i < _num_axes; ++i) {
+			const int value = analogRead(_axis_pins[i]);
+			
+			if (value - _axis_value[i] > _threshold || _axis_value[i] - value > _threshold) {
+				_axis_value[i] = value;
+				noInterrupts();
+				_push(input::MOVE, i, value, now);
+				interrupts();
+			}
+		}
+		now = micros();
+	}
+	
+	if (_is_pending) {
+		// the frame with the event is shown by the first scan which started after it was read
+		const unsigned long scan_start = now - _led_cube->getRefreshPhase();
+		
+		if ((long)(scan_start - _read_time) >= 0) {
+			const unsigned long latency = scan_start - _pending_time;
+			
+			_is_pending = false;
+			if (_latencies == 0) {
+				_average_latency = latency * 16;
+			}
+			_average_latency += latency - _average_latency / 16;
+			_latencies += 1;
+			_last_latency = latency;
+			if (latency > _max_latency) {
+				_max_latency = latency;
+			}
+		}
+	}
+}
+
+void LedCubeInput::duringRefresh()
+{
+	poll();
+	if (_next_task != nullptr) {
+		_next_task->duringRefresh();
+	}
+}
+
+bool LedCubeInput::read(LedCubeInputEvent &event)
+{
+	if (!_queue.pop(event)) {
+		return false;
+	}
+	if (!_is_pending) {
+		_is_pending = true;
+		_pending_time = event.time;
+		_read_time = micros();
+	}
+	return true;
+}
+
+void LedCubeInput::resetLatency()
+{
+	_is_pending = false;
+	_latencies = 0;
+	_last_latency = 0;
+	_max_latency = 0;
+	_average_latency = 0;
+}
+
+unsigned long LedCubeInput::run()
+{
+	poll();
+	return 0;
+}
+
+// EOF
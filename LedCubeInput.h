@@ -0,0 +1,159 @@
+#ifndef _LED_CUBE_INPUT_H
+#define _LED_CUBE_INPUT_H
+
+#include "LedCube.h"
+
+namespace input {
+	enum EventType {
+		PRESS, // a button went down
+		RELEASE, // a button went up
+		MOVE // an analog axis moved by more than the threshold
+	};
+}
+
+struct LedCubeInputEvent
+{
+	uint8_t type; // input::EventType
+	uint8_t source; // index of the button or of the axis
+	int16_t value; // MOVE: position of the axis (0-1023)
+	unsigned long time; // [us] when it was captured
+};
+
+/* Ring of input events for one producer (capture() in a pin change interrupt, or poll() with interrupts disabled)
+ * and one consumer (the sequence in the main loop) without locks, the same way as LedCubeFrameQueue.
+ * The depth is a power of two up to 128, a full queue drops the new event.
+ */
+class LedCubeEventQueue
+{
+protected:
+	const uint8_t _depth;
+	LedCubeInputEvent * _events;
+	uint8_t _head; // next event to consume
+	uint8_t _tail; // next slot to produce
+	
+	uint8_t _load(const uint8_t &index) { return __atomic_load_n(&index, __ATOMIC_ACQUIRE); }
+	
+	void _store(uint8_t &index, uint8_t value) { __atomic_store_n(&index, value, __ATOMIC_RELEASE); }
+public:
+	LedCubeEventQueue(uint8_t depth)
+		: _depth(depth), _head(0), _tail(0)
+	{
+		_events = new LedCubeInputEvent[depth];
+	}
+	
+	LedCubeEventQueue(const LedCubeEventQueue &) = delete;
+	
+	LedCubeEventQueue & operator=(const LedCubeEventQueue &) = delete;
+	
+	~LedCubeEventQueue() { delete[] _events; }
+	
+	uint8_t getDepth() { return _depth; }
+	
+	uint8_t getCount() { return _load(_tail) - _load(_head); }
+	
+	// producer: false when the queue is full
+	bool push(const LedCubeInputEvent &event);
+	
+	// consumer: false when the queue is empty
+	bool pop(LedCubeInputEvent &event);
+};
+
+/* Buttons (to GND, with the internal pull-up) and analog axes (a joystick) for interactive sequences:
+ * - buttons are captured by capture(), from a pin change interrupt (attachInterrupt(), PCINT) or from poll(),
+ *   the first edge counts at once and the following ones are ignored for the debounce time (bounces),
+ *   a state which settled differently meanwhile is caught by the next poll()
+ * - axes are read by poll() every axis_interval, a change by more than the threshold is a MOVE event
+ * - poll() runs from the main loop (every millisecond) and while the layers are lit (the input is the refresh task
+ *   of the cube, a task set before is still called), so it is not delayed by the refresh
+ * A sequence reads the events in every frame (read()) and returns a short wait (a few milliseconds) to react soon.
+ * Latency (input to photon): from the capture of the first event read in a frame to the start of the first scan
+ * which shows the frame.
+ */
+class LedCubeInput : public VariableTimedAction, public LedCubeRefreshTask
+{
+protected:
+	static const uint8_t _max_buttons = 16;
+	
+	LedCube * _led_cube;
+	LedCubeEventQueue _queue;
+	const uint8_t * _button_pins;
+	const uint8_t _num_buttons;
+	const uint8_t * _axis_pins;
+	const uint8_t _num_axes;
+	const unsigned long _debounce; // [us]
+	const unsigned long _axis_interval; // [us]
+	const int _threshold;
+	LedCubeRefreshTask * _next_task;
+	volatile uint16_t _pressed; // bit i => button i is down
+	unsigned long * _last_edge; // [us] of every button
+	int * _axis_value; // last reported
+	unsigned long _last_axes; // [us]
+	
+	// latency
+	bool _is_pending; // an event was read, its frame is not shown yet
+	unsigned long _pending_time; // [us] capture of the event
+	unsigned long _read_time; // [us] when it was read
+	
+	// statistics (the counters of the capture may change in an interrupt)
+	volatile unsigned long _events;
+	volatile unsigned long _overflows;
+	volatile unsigned long _bounces;
+	unsigned long _latencies;
+	unsigned long _last_latency; // [us]
+	unsigned long _max_latency; // [us]
+	unsigned long _average_latency; // [1/16 us] average += sample - average / 16
+	
+	void _push(uint8_t type, uint8_t source, int value, unsigned long time);
+	
+	void _captureButtons(unsigned long now);
+	
+	unsigned long run();
+public:
+	// pins are kept (not copied), debounce [us], axes are read every axis_interval [us], depth of the queue (a power of two)
+	LedCubeInput(LedCube * led_cube, const uint8_t * button_pins, uint8_t num_buttons, const uint8_t * axis_pins=nullptr, uint8_t num_axes=0,
+		unsigned long debounce=5000, unsigned long axis_interval=5000, int threshold=8, uint8_t depth=16);
+	
+	LedCubeInput(const LedCubeInput &) = delete;
+	
+	LedCubeInput & operator=(const LedCubeInput &) = delete;
+	
+	~LedCubeInput();
+	
+	// reads the buttons now, from a pin change interrupt (or with interrupts disabled)
+	void capture();
+	
+	// main loop: buttons, axes and the latency of the last read event
+	void poll();
+	
+	void duringRefresh();
+	
+	// consumer: the oldest event, false when there is none
+	bool read(LedCubeInputEvent &event);
+	
+	bool isPressed(uint8_t button) { return (_pressed >> button) & 1; }
+	
+	int getAxis(uint8_t axis) { return _axis_value[axis]; }
+	
+	uint8_t getQueued() { return _queue.getCount(); }
+	
+	unsigned long getEvents() { return _events; }
+	
+	// events lost with a full queue
+	unsigned long getOverflows() { return _overflows; }
+	
+	// edges ignored within the debounce time
+	unsigned long getBounces() { return _bounces; }
+	
+	// input to photon [us]: number of measured events, the last, the (moving) average and the longest one
+	unsigned long getLatencies() { return _latencies; }
+	
+	unsigned long getLastLatency() { return _last_latency; }
+	
+	unsigned long getAverageLatency() { return _average_latency / 16; }
+	
+	unsigned long getMaxLatency() { return _max_latency; }
+	
+	void resetLatency();
+};
+
+#endif // _LED_CUBE_INPUT_H
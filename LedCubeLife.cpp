@@ -0,0 +1,322 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeLife.h"
+#include "LedCubeSnapshot.h"
+
+namespace life3d {
+	//                                      birth, survival
+	const LedCubeLifeRule bays_4555 =      {1UL << 5, (1UL << 4) | (1UL << 5)};
+	const LedCubeLifeRule bays_5766 =      {1UL << 6, (1UL << 5) | (1UL << 6) | (1UL << 7)};
+	const LedCubeLifeRule amoeba =         {(1UL << 5) | (1UL << 6) | (1UL << 7), 0x1F0UL};
+	const LedCubeLifeRule crystal =        {1UL << 1, 0x7FFFFFFUL};
+}
+
+// adds the sliced number a (bits slices) to the sliced sum (5 slices), bit by bit with the carry
+static void addSliced(uint16_t * sum, const uint16_t * a, uint8_t bits)
+{
+	uint16_t carry = 0;
+	
+	for (uint8_t i = 0; i < 5; ++i) {
+		const uint16_t s = sum[i];
+		
+		if (i < bits) {
+			const uint16_t half = s ^ a[i];
+			
+			sum[i] = half ^ carry;
+			carry = (s & a[i]) | (carry & half);
+		} else {
+			if (carry == 0) {
+				return;
+			}
+			sum[i] = s ^ carry;
+			carry = s & carry;
+		}
+	}
+}
+
+LedCubeLife::LedCubeLife(int size, const LedCubeLifeRule &rule, bool wrap)
+	: _size((size <= 16) ? size : 16), _wrap(wrap), _mask(0xFFFFU >> (16 - _size)), _rule(rule), _generation(0), _period(0)
+{
+	_cells = new uint16_t[_size * _size];
+	_previous = new uint16_t[_size * _size];
+	_row_sums = new uint16_t[3 * 2 * _size];
+	_layer_sums = new uint16_t[4 * _size];
+	clear();
+}
+
+LedCubeLife::~LedCubeLife()
+{
+	delete[] _cells;
+	delete[] _previous;
+	delete[] _row_sums;
+	delete[] _layer_sums;
+}
+
+void LedCubeLife::clear()
+{
+	memset(_cells, 0, _size * _size * sizeof(uint16_t));
+	memset(_previous, 0, _size * _size * sizeof(uint16_t));
+	_generation = 0;
+	_period = 0;
+	_hashes[0] = _hash();
+}
+
+void LedCubeLife::randomize(uint8_t density)
+{
+	clear();
+	for (int i = 0; i < _size * _size; ++i) {
+		uint16_t row = 0;
+		
+		for (int x = 0; x < _size; ++x) {
+			if (random(256) < density) {
+				row |= 1U << x;
+			}
+		}
+		_cells[i] = row;
+	}
+	_hashes[0] = _hash();
+}
+
+void LedCubeLife::setCell(int x, int y, int z, bool is_alive)
+{
+	uint16_t &row = _cells[y + z * _size];
+	
+	row = is_alive ? (row | (1U << x)) : (row & ~(1U << x));
+	_hashes[_generation % _history] = _hash();
+	_period = 0;
+}
+
+void LedCubeLife::_sumRows(int z)
+{
+	// every cell with its left and right neighbour: a full adder of three shifted rows (0-3)
+	uint16_t * sums = _rowSums(z);
+	const bool is_outside = z < 0 || z >= _size;
+	
+	if (is_outside && !_wrap) {
+		memset(sums, 0, 2 * _size * sizeof(uint16_t));
+		return;
+	}
+	const uint16_t * rows = _cells + ((z + _size) % _size) * _size;
+	
+	for (int y = 0; y < _size; ++y) {
+		const uint16_t row = rows[y];
+		uint16_t left = (row << 1) & _mask; // bit x = cell x-1
+		uint16_t right = row >> 1; // bit x = cell x+1
+		
+		if (_wrap) {
+			left |= row >> (_size - 1);
+			right |= (row << (_size - 1)) & _mask;
+		}
+		const uint16_t half = left ^ row;
+		
+		sums[y] = half ^ right;
+		sums[_size + y] = (left & row) | (right & half);
+	}
+}
+
+uint16_t LedCubeLife::_match(const uint16_t * count, uint32_t values)
+{
+	// cells whose count is one of the values: the slices compared bit by bit
+	uint16_t matched = 0;
+	
+	for (uint8_t value = 0; values != 0 && value < 28; ++value, values >>= 1) {
+		if (!(values & 1)) {
+			continue;
+		}
+		uint16_t equal = _mask;
+		
+		for (uint8_t i = 0; i < 5; ++i) {
+			equal &= ((value >> i) & 1) ? count[i] : ~count[i];
+		}
+		matched |= equal;
+	}
+	return matched;
+}
+
+void LedCubeLife::step()
+{
+	// the count includes the cell: a dead cell with n neighbours has n, a live one n+1
+	const uint32_t birth = _rule.birth;
+	const uint32_t survival = _rule.survival << 1;
+	uint16_t * next = _previous;
+	
+	_sumRows(-1);
+	_sumRows(0);
+	for (int z = 0; z < _size; ++z) {
+		_sumRows(z + 1);
+		
+		// sums of the rows at y in the layers z-1, z, z+1 (0-9)
+		const uint16_t * below = _rowSums(z - 1);
+		const uint16_t * here = _rowSums(z);
+		const uint16_t * above = _rowSums(z + 1);
+		
+		for (int y = 0; y < _size; ++y) {
+			uint16_t sum[5] = {below[y], below[_size + y], 0, 0, 0};
+			const uint16_t a[2] = {here[y], here[_size + y]};
+			const uint16_t b[2] = {above[y], above[_size + y]};
+			
+			addSliced(sum, a, 2);
+			addSliced(sum, b, 2);
+			for (uint8_t i = 0; i < 4; ++i) {
+				_layer_sums[i * _size + y] = sum[i];
+			}
+		}
+		
+		// and of those at y-1, y, y+1 (0-27)
+		for (int y = 0; y < _size; ++y) {
+			uint16_t count[5] = {0, 0, 0, 0, 0};
+			
+			for (int dy = -1; dy <= 1; ++dy) {
+				const int ny = y + dy;
+				
+				if ((ny < 0 || ny >= _size) && !_wrap) {
+					continue;
+				}
+				const int wy = (ny + _size) % _size;
+				const uint16_t slices[4] = {_layer_sums[wy], _layer_sums[_size + wy], _layer_sums[2 * _size + wy], _layer_sums[3 * _size + wy]};
+				
+				addSliced(count, slices, 4);
+			}
+			const uint16_t cells = _cells[y + z * _size];
+			
+			next[y + z * _size] = (~cells & _match(count, birth)) | (cells & _match(count, survival));
+		}
+	}
+	_previous = _cells;
+	_cells = next;
+	_generation += 1;
+	_hashes[_generation % _history] = _hash();
+	_findCycle();
+}
+
+uint32_t LedCubeLife::_hash()
+{
+	// FNV-1a over the rows
+	uint32_t hash = 2166136261UL;
+	
+	for (int i = 0; i < _size * _size; ++i) {
+		hash = (hash ^ _cells[i]) * 16777619UL;
+	}
+	return hash;
+}
+
+void LedCubeLife::_findCycle()
+{
+	const uint32_t hash = _hashes[_generation % _history];
+	
+	_period = 0;
+	for (uint8_t period = 1; period < _history && period <= _generation; ++period) {
+		if (_hashes[(_generation - period) % _history] == hash) {
+			_period = period;
+			return;
+		}
+	}
+}
+
+int LedCubeLife::getPopulation()
+{
+	int population = 0;
+	
+	for (int i = 0; i < _size * _size; ++i) {
+		for (uint16_t row = _cells[i]; row != 0; row &= row - 1) {
+			population += 1;
+		}
+	}
+	return population;
+}
+
+bool LedCubeLife::archive(LedCubeArchive &archive)
+{
+	archive.bytes(_cells, _size * _size * sizeof(uint16_t));
+	archive.bytes(_previous, _size * _size * sizeof(uint16_t));
+	archive.field(_hashes);
+	archive.field(_generation);
+	archive.field(_period);
+	return archive.isOk();
+}
+
+namespace sequences {
+	void Life3D::_draw(bool is_all)
+	{
+		const int size = _life.getSize();
+		
+		for (int z = 0; z < size; ++z) {
+			for (int y = 0; y < size; ++y) {
+				const uint16_t row = _life.getRow(y, z);
+				const uint16_t changed = is_all ? 0xFFFFU : row ^ _life.getPreviousRow(y, z);
+				
+				if (changed == 0) {
+					continue;
+				}
+				if (size <= 8) {
+					_led_cube->setRow(y, z, row);
+					continue;
+				}
+				for (int x = 0; x < size; ++x) {
+					if (changed & (1U << x)) {
+						if (row & (1U << x)) {
+							_led_cube->turnOn(x, y, z);
+						} else {
+							_led_cube->turnOff(x, y, z);
+						}
+					}
+				}
+			}
+		}
+	}
+	
+	unsigned long Life3D::operator()()
+	{
+		while (true) {
+			switch(_state) {
+				case 0:
+					_life.randomize(_density);
+					_draw(true);
+					_hold_cnt = 0;
+					_state += 1;
+					return _wait;
+				case 1:
+					if (_generations_cnt >= _max_generations) {
+						_state = 3;
+						break;
+					}
+					{
+						const unsigned long start = micros();
+						
+						_life.step();
+						_last_step_time = micros() - start;
+					}
+					_generations_cnt += 1;
+					_draw(false);
+					if (_life.getPeriod() > 0) {
+						_state += 1;
+					}
+					return _wait;
+				case 2:
+					// the cycle (or the empty cube) stays for a while, then a new start
+					if (_hold_cnt < _hold && _life.getPopulation() > 0) {
+						_hold_cnt += 1;
+						_state = 1;
+						break;
+					}
+					_restarts += 1;
+					_state = 0;
+					break;
+				default:
+					return 0;
+			}
+		}
+	}
+	
+	bool Life3D::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_generations_cnt);
+		archive.field(_hold_cnt);
+		archive.field(_restarts);
+		return _life.archive(archive);
+	}
+}
+
+// EOF
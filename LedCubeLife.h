@@ -0,0 +1,143 @@
+#ifndef _LED_CUBE_LIFE_H
+#define _LED_CUBE_LIFE_H
+
+#include "LedCube.h"
+
+// rule of the 3D game of life, bit n => n live neighbours (0-26) of the 26 around the cell
+struct LedCubeLifeRule
+{
+	uint32_t birth; // a dead cell comes alive
+	uint32_t survival; // a live cell stays alive
+};
+
+namespace life3d {
+	extern const LedCubeLifeRule bays_4555; // B5/S45 (Bays), gliders
+	extern const LedCubeLifeRule bays_5766; // B6/S567, stable shapes
+	extern const LedCubeLifeRule amoeba; // B5-7/S4-8, slowly growing blobs
+	extern const LedCubeLifeRule crystal; // B1/S0-26 without B0, grows from few cells
+}
+
+/* Generations of a 3D game of life up to 16x16x16, bit-packed: one word per row (bit x = cell x, index y + z*size).
+ * Neighbours are counted for whole rows at once with bit-sliced adders (bit x of the slices i = bit i of the count of cell x):
+ * - every row is summed with its left and right neighbours (0-3, 2 slices)
+ * - the sums of the rows at y of the layers z-1, z, z+1 are added (0-9, 4 slices)
+ * - the sums at y-1, y, y+1 of that are added (0-27, 5 slices, the cell itself included)
+ * - the rule is applied to the slices (a few operations per value allowed by the rule)
+ * A generation costs about 50 word operations per row (size*size rows), not 26 reads per cell.
+ * Cells beyond the edges are dead, or the cube wraps around (a torus).
+ * Every generation is hashed, a hash seen within the last _history generations is a cycle (still life, oscillator,
+ * an empty cube) of that period.
+ * Memory: 2 generations + sums of 3 layers + 4 slices of a layer, 4x4x4: 144 B, 8x8x8: 416 B, 16x16x16: 1344 B.
+ */
+class LedCubeLife
+{
+protected:
+	static const uint8_t _history = 8; // generations
+	
+	const int _size;
+	const bool _wrap;
+	const uint16_t _mask; // bits of a row
+	LedCubeLifeRule _rule;
+	uint16_t * _cells; // current generation
+	uint16_t * _previous; // previous generation (also the buffer of the next one)
+	uint16_t * _row_sums; // [3][2][size] sums of rows in a ring of layers
+	uint16_t * _layer_sums; // [4][size] sums of 3 layers
+	uint32_t _hashes[_history];
+	unsigned long _generation;
+	uint8_t _period; // 0 => no cycle found
+	
+	uint16_t * _rowSums(int z) { return _row_sums + ((z + 3) % 3) * 2 * _size; }
+	
+	void _sumRows(int z);
+	
+	uint16_t _match(const uint16_t * count, uint32_t values);
+	
+	uint32_t _hash();
+	
+	void _findCycle();
+public:
+	LedCubeLife(int size, const LedCubeLifeRule &rule, bool wrap=false);
+	
+	LedCubeLife(const LedCubeLife &) = delete;
+	
+	LedCubeLife & operator=(const LedCubeLife &) = delete;
+	
+	~LedCubeLife();
+	
+	int getSize() { return _size; }
+	
+	void setRule(const LedCubeLifeRule &rule) { _rule = rule; }
+	
+	const LedCubeLifeRule & getRule() { return _rule; }
+	
+	// all dead, a new history
+	void clear();
+	
+	// live cells with probability density/256 (random()), a new history
+	void randomize(uint8_t density);
+	
+	bool getCell(int x, int y, int z) { return (_cells[y + z * _size] >> x) & 1; }
+	
+	void setCell(int x, int y, int z, bool is_alive);
+	
+	// cells of the row, bit x = cell x
+	uint16_t getRow(int y, int z) { return _cells[y + z * _size]; }
+	
+	uint16_t getPreviousRow(int y, int z) { return _previous[y + z * _size]; }
+	
+	// computes the next generation
+	void step();
+	
+	unsigned long getGeneration() { return _generation; }
+	
+	int getPopulation();
+	
+	uint32_t getHash() { return _hashes[_generation % _history]; }
+	
+	// period of the cycle the generations are in (1 => still or empty), 0 => none within the history
+	uint8_t getPeriod() { return _period; }
+	
+	// both generations and the history (see LedCubeSnapshot.h)
+	bool archive(LedCubeArchive &archive);
+};
+
+namespace sequences {
+	/* 3D game of life from random cells (density/256), a new random start when the generations cycle
+	 * (the cycle is shown for hold generations) and the sequence ends after max_generations.
+	 * Only rows which changed are drawn (setRow() up to 8x8x8, only the LEDs which changed for 16x16x16,
+	 * which is faster there).
+	 */
+	class Life3D : public LedCubeSequence
+	{
+	protected:
+		LedCubeLife _life;
+		const unsigned long _wait; // [ms]
+		const unsigned long _max_generations;
+		const uint8_t _density;
+		const uint8_t _hold;
+		unsigned long _generations_cnt;
+		uint8_t _hold_cnt;
+		unsigned long _restarts;
+		unsigned long _last_step_time; // [us]
+		
+		void _draw(bool is_all);
+	public:
+		Life3D(LedCube * led_cube, const LedCubeLifeRule &rule=life3d::bays_4555, unsigned long wait=200, unsigned long max_generations=300, uint8_t density=64, uint8_t hold=12, bool wrap=true)
+			: LedCubeSequence(led_cube), _life(led_cube->getSize(), rule, wrap), _wait(wait), _max_generations(max_generations),
+			_density(density), _hold(hold), _generations_cnt(0), _hold_cnt(0), _restarts(0), _last_step_time(0)
+		{}
+		
+		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
+		
+		LedCubeLife & getLife() { return _life; }
+		
+		unsigned long getRestarts() { return _restarts; }
+		
+		// time of computing the last generation [us]
+		unsigned long getLastStepTime() { return _last_step_time; }
+	};
+}
+
+#endif // _LED_CUBE_LIFE_H
@@ -0,0 +1,199 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeParticles.h"
+
+namespace particles {
+	//                                           x, y, z, vx, vy, vz, spread_xy, spread_z, gravity, min_life, max_life, rate, burst, burst_period
+	const LedCubeParticleEmitter rain =         {LedCubeParticleEmitter::random_pos, LedCubeParticleEmitter::random_pos, LedCubeParticleEmitter::max_pos, 0, 0, -8, 0, 3, -1, 40, 40, 24, 0, 0};
+	const LedCubeParticleEmitter snow =         {LedCubeParticleEmitter::random_pos, LedCubeParticleEmitter::random_pos, LedCubeParticleEmitter::max_pos, 0, 0, -3, 2, 1, 0, 60, 120, 8, 0, 0};
+	const LedCubeParticleEmitter fireworks =    {LedCubeParticleEmitter::random_pos, LedCubeParticleEmitter::random_pos, LedCubeParticleEmitter::center_pos, 0, 0, 4, 10, 10, -1, 10, 16, 0, 24, 12};
+	const LedCubeParticleEmitter fountain =     {LedCubeParticleEmitter::center_pos, LedCubeParticleEmitter::center_pos, 0, 0, 0, 14, 4, 3, -1, 40, 40, 20, 0, 0};
+}
+
+LedCubeParticles::LedCubeParticles(LedCube * led_cube, const LedCubeParticleEmitter * emitter, int capacity, int16_t * x, int16_t * y, int16_t * z, int8_t * vx, int8_t * vy, int8_t * vz, uint8_t * life, uint16_t * drawn)
+	: _led_cube(led_cube), _emitter(emitter), _capacity(capacity), _x(x), _y(y), _z(z), _vx(vx), _vy(vy), _vz(vz), _life(life), _drawn(drawn), _alive(0), _free_hint(0), _rate_acc(0), _burst_cnt(0), _last_step_time(0)
+{
+	// own generator, random() is too slow to be called for every particle
+	_rng = random(1, 0xFFFF);
+}
+
+uint16_t LedCubeParticles::_random()
+{
+	// xorshift16
+	_rng ^= _rng << 7;
+	_rng ^= _rng >> 9;
+	_rng ^= _rng << 8;
+	return _rng;
+}
+
+int LedCubeParticles::_randomSpread(uint8_t spread)
+{
+	if (spread == 0) {
+		return 0;
+	}
+	return (int)(_random() % (2 * spread + 1)) - spread;
+}
+
+int LedCubeParticles::_origin(int8_t origin)
+{
+	int size = _led_cube->getSize();
+	
+	switch (origin) {
+		case LedCubeParticleEmitter::random_pos:
+			return _random() % size;
+		case LedCubeParticleEmitter::center_pos:
+			return size / 2;
+		case LedCubeParticleEmitter::max_pos:
+			return size - 1;
+		default:
+			return origin;
+	}
+}
+
+void LedCubeParticles::_spawn(int x, int y, int z)
+{
+	if (_alive >= _capacity) {
+		return;
+	}
+	
+	int i = _free_hint;
+	while (_life[i] != 0) {
+		i += 1;
+		if (i >= _capacity) {
+			i = 0;
+		}
+	}
+	_free_hint = (i + 1 < _capacity) ? i + 1 : 0;
+	
+	// middle of the LED
+	_x[i] = (x << 8) + 128;
+	_y[i] = (y << 8) + 128;
+	_z[i] = (z << 8) + 128;
+	_vx[i] = _emitter->vx + _randomSpread(_emitter->spread_xy);
+	_vy[i] = _emitter->vy + _randomSpread(_emitter->spread_xy);
+	_vz[i] = _emitter->vz + _randomSpread(_emitter->spread_z);
+	_life[i] = _emitter->min_life;
+	if (_emitter->max_life > _emitter->min_life) {
+		_life[i] += _random() % (_emitter->max_life - _emitter->min_life + 1);
+	}
+	if (_life[i] == 0) {
+		_life[i] = 1;
+	}
+	_drawn[i] = _none;
+	_alive += 1;
+}
+
+uint16_t LedCubeParticles::_voxelOf(int i)
+{
+	const int16_t limit = _led_cube->getSize() << 8;
+	
+	if (_x[i] < 0 || _y[i] < 0 || _z[i] < 0 || _x[i] >= limit || _y[i] >= limit || _z[i] >= limit) {
+		return _none;
+	}
+	return (_x[i] >> 8) | ((_y[i] >> 8) << 4) | ((_z[i] >> 8) << 8);
+}
+
+void LedCubeParticles::emit(int count)
+{
+	for (int i = 0; i < count; ++i) {
+		_spawn(_origin(_emitter->x), _origin(_emitter->y), _origin(_emitter->z));
+	}
+}
+
+void LedCubeParticles::step(bool emit_new)
+{
+	unsigned long start = micros();
+	
+	if (emit_new) {
+		int rate_acc = _rate_acc + _emitter->rate;
+		emit(rate_acc >> 4);
+		_rate_acc = rate_acc & 0x0F;
+		
+		if (_emitter->burst > 0 && ++_burst_cnt >= _emitter->burst_period) {
+			int x = _origin(_emitter->x);
+			int y = _origin(_emitter->y);
+			int z = _origin(_emitter->z);
+			
+			_burst_cnt = 0;
+			for (int i = 0; i < _emitter->burst; ++i) {
+				_spawn(x, y, z);
+			}
+		}
+	}
+	
+	// move particles and erase LEDs they left (all erases first, so a particle does not erase a newly drawn one)
+	bool erased = false;
+	for (int i = 0; i < _capacity; ++i) {
+		if (_life[i] == 0) {
+			continue;
+		}
+		
+		int vz = _vz[i] + _emitter->gravity;
+		_vz[i] = (vz < -128) ? -128 : ((vz > 127) ? 127 : vz);
+		_x[i] += _vx[i] * 8;
+		_y[i] += _vy[i] * 8;
+		_z[i] += _vz[i] * 8;
+		_life[i] -= 1;
+		
+		uint16_t voxel = (_life[i] > 0) ? _voxelOf(i) : _none;
+		if (voxel == _none) {
+			_life[i] = 0;
+			_alive -= 1;
+		}
+		if (voxel != _drawn[i] && _drawn[i] != _none) {
+			_led_cube->turnOff(_drawn[i] & 0x0F, (_drawn[i] >> 4) & 0x0F, _drawn[i] >> 8);
+			_drawn[i] = _none;
+			erased = true;
+		}
+	}
+	
+	// draw LEDs the particles moved to; after an erase also the LEDs of the particles which stayed, another particle
+	// may have left the same LED
+	for (int i = 0; i < _capacity; ++i) {
+		if (_life[i] == 0) {
+			continue;
+		}
+		if (_drawn[i] == _none) {
+			_drawn[i] = _voxelOf(i);
+		} else if (!erased || _led_cube->getState(_drawn[i] & 0x0F, (_drawn[i] >> 4) & 0x0F, _drawn[i] >> 8) != LOW) {
+			continue;
+		}
+		_led_cube->turnOn(_drawn[i] & 0x0F, (_drawn[i] >> 4) & 0x0F, _drawn[i] >> 8);
+	}
+	
+	_last_step_time = micros() - start;
+}
+
+void LedCubeParticles::clear()
+{
+	for (int i = 0; i < _capacity; ++i) {
+		if (_life[i] != 0 && _drawn[i] != _none) {
+			_led_cube->turnOff(_drawn[i] & 0x0F, (_drawn[i] >> 4) & 0x0F, _drawn[i] >> 8);
+		}
+		_life[i] = 0;
+		_drawn[i] = _none;
+	}
+	_alive = 0;
+	_free_hint = 0;
+}
+
+bool LedCubeParticles::archive(LedCubeArchive &archive)
+{
+	archive.bytes(_x, _capacity * sizeof(int16_t));
+	archive.bytes(_y, _capacity * sizeof(int16_t));
+	archive.bytes(_z, _capacity * sizeof(int16_t));
+	archive.bytes(_vx, _capacity);
+	archive.bytes(_vy, _capacity);
+	archive.bytes(_vz, _capacity);
+	archive.bytes(_life, _capacity);
+	archive.bytes(_drawn, _capacity * sizeof(uint16_t));
+	archive.field(_alive);
+	archive.field(_free_hint);
+	archive.field(_rate_acc);
+	archive.field(_burst_cnt);
+	archive.field(_rng);
+	return archive.isOk();
+}
+
+// EOF
@@ -0,0 +1,163 @@
+#ifndef _LED_CUBE_PARTICLES_H
+#define _LED_CUBE_PARTICLES_H
+
+#include "LedCube.h"
+#include "LedCubeSnapshot.h"
+
+/* Configuration of the particle source.
+ * - positions of particles are fixed point numbers with 8 fractional bits [1/256 LED]
+ * - velocities and gravity are in [1/32 LED per frame]
+ */
+struct LedCubeParticleEmitter
+{
+	// special values for the origin
+	static const int8_t random_pos = -1; // random LED on the axis (for every particle)
+	static const int8_t center_pos = -2; // middle of the axis
+	static const int8_t max_pos = -3; // last LED on the axis (top for z)
+	
+	int8_t x, y, z; // origin [LED]
+	int8_t vx, vy, vz; // initial velocity [1/32 LED per frame]
+	uint8_t spread_xy; // random +- added to vx and vy
+	uint8_t spread_z; // random +- added to vz
+	int8_t gravity; // added to vz every frame
+	uint8_t min_life, max_life; // [frames]
+	uint8_t rate; // particles emitted per frame [1/16]
+	uint8_t burst; // particles emitted at once from one random origin (0 => no bursts)
+	uint8_t burst_period; // [frames]
+};
+
+namespace particles {
+	extern const LedCubeParticleEmitter rain;
+	extern const LedCubeParticleEmitter snow;
+	extern const LedCubeParticleEmitter fireworks;
+	extern const LedCubeParticleEmitter fountain;
+}
+
+/* Particle engine with a fixed pool kept as a structure of arrays (see LedCubeParticlePool).
+ * Only LEDs whose particle moved to another LED are erased and redrawn. An LED shared by several particles stays lit
+ * while one of them is on it: after the erases, the LEDs of the particles which stayed are checked (getState()) and lit again.
+ */
+class LedCubeParticles
+{
+protected:
+	static const uint16_t _none = 0xFFFF;
+	
+	LedCube * _led_cube;
+	const LedCubeParticleEmitter * _emitter;
+	const int _capacity;
+	int16_t * _x;
+	int16_t * _y;
+	int16_t * _z;
+	int8_t * _vx;
+	int8_t * _vy;
+	int8_t * _vz;
+	uint8_t * _life; // [frames], 0 => free slot
+	uint16_t * _drawn; // x | y << 4 | z << 8 of the lit LED or _none
+	int _alive;
+	int _free_hint;
+	uint8_t _rate_acc;
+	uint8_t _burst_cnt;
+	uint16_t _rng;
+	unsigned long _last_step_time; // [us]
+	
+	uint16_t _random();
+	int _randomSpread(uint8_t spread);
+	int _origin(int8_t origin);
+	void _spawn(int x, int y, int z);
+	uint16_t _voxelOf(int i);
+	
+	LedCubeParticles(LedCube * led_cube, const LedCubeParticleEmitter * emitter, int capacity, int16_t * x, int16_t * y, int16_t * z, int8_t * vx, int8_t * vy, int8_t * vz, uint8_t * life, uint16_t * drawn);
+public:
+	// next frame: emit new particles (if emit_new == true), move all of them and redraw the changed LEDs
+	void step(bool emit_new=true);
+	
+	void emit(int count);
+	
+	void clear();
+	
+	void setEmitter(const LedCubeParticleEmitter * emitter) { _emitter = emitter; }
+	
+	int getAlive() { return _alive; }
+	
+	int getCapacity() { return _capacity; }
+	
+	unsigned long getLastStepTime() { return _last_step_time; }
+	
+	// the particles and the generator (see LedCubeSnapshot.h)
+	bool archive(LedCubeArchive &archive);
+};
+
+template <int capacity>
+class LedCubeParticlePool : public LedCubeParticles
+{
+protected:
+	int16_t _x_pool[capacity], _y_pool[capacity], _z_pool[capacity];
+	int8_t _vx_pool[capacity], _vy_pool[capacity], _vz_pool[capacity];
+	uint8_t _life_pool[capacity];
+	uint16_t _drawn_pool[capacity];
+public:
+	LedCubeParticlePool(LedCube * led_cube, const LedCubeParticleEmitter * emitter)
+		: LedCubeParticles(led_cube, emitter, capacity, _x_pool, _y_pool, _z_pool, _vx_pool, _vy_pool, _vz_pool, _life_pool, _drawn_pool)
+	{
+		for (int i = 0; i < capacity; ++i) {
+			_life_pool[i] = 0;
+		}
+		clear();
+	}
+};
+
+namespace sequences {
+	// emits particles for max_frames frames and then waits until all of them die
+	template <int capacity=16>
+	class ParticleShow : public LedCubeSequence
+	{
+	protected:
+		const unsigned long _wait; // [ms]
+		const int _max_frames;
+		int _frames_cnt;
+		LedCubeParticlePool<capacity> _particles;
+	public:
+		ParticleShow(LedCube * led_cube, const LedCubeParticleEmitter & emitter, unsigned long wait=50, int max_frames=400)
+			: LedCubeSequence(led_cube), _wait(wait), _max_frames(max_frames), _frames_cnt(0), _particles(led_cube, &emitter)
+		{}
+		
+		unsigned long operator()()
+		{
+			while (true) {
+				switch(_state) {
+					case 0:
+						_led_cube->turnEverythingOff();
+						_state += 1;
+					case 1:
+						if (_frames_cnt < _max_frames) {
+							_frames_cnt += 1;
+							_particles.step(true);
+							return _wait;
+						} else {
+							_state += 1;
+						}
+						break;
+					case 2:
+						if (_particles.getAlive() > 0) {
+							_particles.step(false);
+							return _wait;
+						} else {
+							_state += 1;
+						}
+						break;
+					default:
+						return 0;
+				}
+			}
+		}
+		
+		bool archive(LedCubeArchive &archive)
+		{
+			_archiveState(archive);
+			archive.field(_frames_cnt);
+			return _particles.archive(archive);
+		}
+	};
+}
+
+#endif // _LED_CUBE_PARTICLES_H
@@ -0,0 +1,169 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubePipeline.h"
+
+LedCubeFrameQueue::LedCubeFrameQueue(int size, uint8_t depth)
+	: _depth(depth), _head(0), _tail(0)
+{
+	_frames = new LedCubeFrame * [_depth];
+	for (int i = 0; i < _depth; ++i) {
+		_frames[i] = new LedCubeFrame(size);
+	}
+	_due = new unsigned long[_depth];
+	_end = new unsigned long[_depth];
+}
+
+LedCubeFrameQueue::~LedCubeFrameQueue()
+{
+	for (int i = 0; i < _depth; ++i) {
+		delete _frames[i];
+	}
+	delete[] _frames;
+	delete[] _due;
+	delete[] _end;
+}
+
+LedCubeFrame * LedCubeFrameQueue::back()
+{
+	if ((uint8_t)(_tail - _load(_head)) >= _depth) {
+		return nullptr;
+	}
+	return _frames[_tail % _depth];
+}
+
+void LedCubeFrameQueue::push(unsigned long due, unsigned long end)
+{
+	_due[_tail % _depth] = due;
+	_end[_tail % _depth] = end;
+	_store(_tail, _tail + 1);
+}
+
+LedCubeFrame * LedCubeFrameQueue::front()
+{
+	if (_load(_tail) == _head) {
+		return nullptr;
+	}
+	return _frames[_head % _depth];
+}
+
+void LedCubeFrameQueue::pop()
+{
+	_store(_head, _head + 1);
+}
+
+
+
+
+unsigned long LedCubePipeline::_read(volatile unsigned long &value)
+{
+	// 32 bit values written by present() in an interrupt are read in one piece
+	noInterrupts();
+	const unsigned long copy = value;
+	interrupts();
+	return copy;
+}
+
+void LedCubePipeline::setSequence(LedCubeSequence * sequence)
+{
+	delete _sequence;
+	_sequence = sequence;
+	// the sequence continues from what is shown
+	_work.capture(_led_cube);
+	_is_started = false;
+	_is_producing = _sequence != nullptr;
+	_produced = 0;
+	_split_frames = 0;
+	_lead = 0;
+	_min_lead = 0xFFFFFFFFUL;
+	_presented = 0;
+	_underruns = 0;
+	_dropped = 0;
+	_max_late = 0;
+	_is_underrun = false;
+}
+
+bool LedCubePipeline::produce()
+{
+	if (_sequence == nullptr) {
+		return false;
+	}
+	LedCubeFrame * frame = _queue.back();
+	if (frame == nullptr) {
+		return false;
+	}
+	
+	if (!_is_started) {
+		_due = millis() + _start_delay;
+		_is_started = true;
+	}
+	
+	// the frame is queued only when it is finished, so the sequence may split it
+	LedCubeFrame * target = _led_cube->getRenderTarget();
+	_led_cube->setRenderTarget(&_work, true);
+	_led_cube->startFrameBudget();
+	const unsigned long wait = (*_sequence)();
+	_led_cube->setRenderTarget(target);
+	if (wait == LedCube::CONTINUE_FRAME) {
+		// the rest of the frame in the next call
+		_split_frames += 1;
+		return true;
+	}
+	memcpy(frame->getBits(), _work.getBits(), _work.getBytes());
+	
+	const unsigned long now = millis();
+	_lead = ((long)(_due - now) > 0) ? _due - now : 0;
+	if (_lead < _min_lead) {
+		_min_lead = _lead;
+	}
+	_produced += 1;
+	
+	// what the sequence drew in its last call stays shown (as with LedCube::nextFrameOfSequence)
+	_queue.push(_due, _due + wait);
+	_due += wait;
+	if (wait == 0) {
+		delete _sequence;
+		_sequence = nullptr;
+		__atomic_store_n(&_is_producing, false, __ATOMIC_RELEASE);
+	}
+	return true;
+}
+
+void LedCubePipeline::present()
+{
+	const unsigned long now = millis();
+	LedCubeFrame * frame = _queue.front();
+	
+	if (frame == nullptr) {
+		if (_isProducing() && _presented > 0 && !_is_underrun && (long)(now - _shown_end) >= 0) {
+			// the shown frame is over and the next one is not computed yet
+			_underruns += 1;
+			_is_underrun = true;
+		}
+		return;
+	}
+	if ((long)(now - _queue.frontDue()) < 0) {
+		return;
+	}
+	
+	while (true) {
+		const unsigned long due = _queue.frontDue();
+		_led_cube->showFrame(*frame);
+		_shown_end = _queue.frontEnd();
+		if (now - due > _max_late) {
+			_max_late = now - due;
+		}
+		_queue.pop();
+		
+		frame = _queue.front();
+		if (frame == nullptr || (long)(now - _queue.frontDue()) < 0) {
+			break;
+		}
+		// the next frame is due as well
+		_dropped += 1;
+	}
+	_presented += 1;
+	_is_underrun = false;
+}
+
+// EOF
@@ -0,0 +1,144 @@
+#ifndef _LED_CUBE_PIPELINE_H
+#define _LED_CUBE_PIPELINE_H
+
+#include "LedCube.h"
+#include "LedCubeTransition.h"
+
+/* Ring of frames (LedCubeFrame) with the time when each is due, for one producer and one consumer
+ * (the main loop and an interrupt, or two threads on a host) without locks:
+ * the producer only moves _tail, the consumer only moves _head, both are single bytes stored with release
+ * and loaded with acquire order, so a slot is never read before it is written (and vice versa).
+ * The depth is a power of two up to 128 (the counters run freely over 256).
+ */
+class LedCubeFrameQueue
+{
+protected:
+	const uint8_t _depth;
+	LedCubeFrame ** _frames;
+	unsigned long * _due; // [ms]
+	unsigned long * _end; // [ms] due + wait
+	uint8_t _head; // next slot to consume
+	uint8_t _tail; // next slot to produce
+	
+	uint8_t _load(const uint8_t &index) { return __atomic_load_n(&index, __ATOMIC_ACQUIRE); }
+	
+	void _store(uint8_t &index, uint8_t value) { __atomic_store_n(&index, value, __ATOMIC_RELEASE); }
+public:
+	LedCubeFrameQueue(int size, uint8_t depth);
+	
+	LedCubeFrameQueue(const LedCubeFrameQueue &) = delete;
+	
+	LedCubeFrameQueue & operator=(const LedCubeFrameQueue &) = delete;
+	
+	~LedCubeFrameQueue();
+	
+	uint8_t getDepth() { return _depth; }
+	
+	// frames waiting (from either side)
+	uint8_t getCount() { return _load(_tail) - _load(_head); }
+	
+	// producer: frame to draw into, nullptr when the queue is full
+	LedCubeFrame * back();
+	
+	// producer: publishes the frame from back()
+	void push(unsigned long due, unsigned long end);
+	
+	// consumer: the oldest frame, nullptr when the queue is empty
+	LedCubeFrame * front();
+	
+	unsigned long frontDue() { return _due[_head % _depth]; }
+	
+	unsigned long frontEnd() { return _end[_head % _depth]; }
+	
+	// consumer: releases the frame from front()
+	void pop();
+};
+
+/* Plays a sequence through a queue of frames computed ahead, so a heavy frame does not delay its showing:
+ * - produce() (main loop, whenever there is time) draws the next frames of the sequence into the queue
+ * - present() (refresh side: LedCubeRefresher, a timer interrupt, ...) shows every frame when it is due
+ * In one main loop, the refresh and present() run only between two calls of produce(): with the budget policy
+ * SPLIT_WORK of the cube, a sequence which splits its frames (LedCubeSequence::_isOverBudget()) computes a heavy frame
+ * in pieces of the frame budget, while the frames queued before it are shown on time and the refresh goes on.
+ * Frames are due at absolute times (start + sum of the waits). When a frame is not ready when the previous
+ * one ends, it is an underrun; the frame is shown as soon as it is ready. Frames which are overdue together
+ * with a newer one are dropped, so the display catches up at once.
+ * Memory: depth + 1 frames (4x4x4: 8 B each, 8x8x8: 64 B each).
+ */
+class LedCubePipeline
+{
+protected:
+	LedCube * _led_cube;
+	LedCubeFrameQueue _queue;
+	LedCubeFrame _work; // the sequence draws incrementally, so it keeps its own frame
+	LedCubeSequence * _sequence; // owned, nullptr => all frames are in the queue
+	unsigned long _start_delay; // [ms]
+	unsigned long _due; // [ms] of the next frame to produce
+	bool _is_started;
+	bool _is_producing; // read by both sides, see _isProducing()
+	
+	// producer side
+	unsigned long _produced;
+	unsigned long _split_frames;
+	unsigned long _lead; // [ms] how long before its due the last frame was ready
+	unsigned long _min_lead; // [ms]
+	
+	// consumer side (updated by present(), possibly in an interrupt)
+	volatile unsigned long _presented;
+	volatile unsigned long _underruns;
+	volatile unsigned long _dropped;
+	volatile unsigned long _max_late; // [ms]
+	volatile unsigned long _shown_end; // [ms] end of the shown frame
+	volatile bool _is_underrun;
+	
+	unsigned long _read(volatile unsigned long &value);
+	
+	bool _isProducing() { return __atomic_load_n(&_is_producing, __ATOMIC_ACQUIRE); }
+public:
+	// start_delay: the first frame is due this long after the first produce() (time to fill the queue)
+	LedCubePipeline(LedCube * led_cube, uint8_t depth=4, unsigned long start_delay=0)
+		: _led_cube(led_cube), _queue(led_cube->getSize(), depth), _work(led_cube->getSize()), _sequence(nullptr),
+		_start_delay(start_delay), _due(0), _is_started(false), _is_producing(false),
+		_produced(0), _split_frames(0), _lead(0), _min_lead(0xFFFFFFFFUL),
+		_presented(0), _underruns(0), _dropped(0), _max_late(0), _shown_end(0), _is_underrun(false)
+	{}
+	
+	~LedCubePipeline() { delete _sequence; }
+	
+	// the sequence is owned, call it before produce() and present() run (or after isRunning() is false)
+	void setSequence(LedCubeSequence * sequence);
+	
+	// computes the next frame (or its next piece) if the queue has room, false when there was nothing to do
+	bool produce();
+	
+	// shows the frame which is due, call it at least once per millisecond
+	void present();
+	
+	// until the last frame of the sequence has been shown
+	bool isRunning() { return _isProducing() || _queue.getCount() > 0; }
+	
+	uint8_t getDepth() { return _queue.getDepth(); }
+	
+	uint8_t getQueued() { return _queue.getCount(); }
+	
+	unsigned long getProduced() { return _produced; }
+	
+	// calls of produce() which ended in the middle of a frame (SPLIT_WORK)
+	unsigned long getSplitFrames() { return _split_frames; }
+	
+	// [ms] how long before they were due the last frame / the least ready frame was computed
+	unsigned long getLead() { return _lead; }
+	
+	unsigned long getMinLead() { return _min_lead; }
+	
+	unsigned long getPresented() { return _read(_presented); }
+	
+	unsigned long getUnderruns() { return _read(_underruns); }
+	
+	unsigned long getDropped() { return _read(_dropped); }
+	
+	// [ms] the latest frame against its due time
+	unsigned long getMaxLate() { return _read(_max_late); }
+};
+
+#endif // _LED_CUBE_PIPELINE_H
@@ -0,0 +1,142 @@
+// Create by: Jan Doležal, 2020
+
+#include <stdio.h>
+#include "Arduino.h"
+#include "LedCubeProfiler.h"
+
+static_assert(profiler::PLAYLIST == playlist::END, "types of the profiler follow playlist::SequenceId");
+
+// names of the types up to profiler::OTHER (playlist::SequenceId, PAUSE never has frames)
+static const char _names[profiler::USER][12] PROGMEM = {
+	"off", "on", "flicker_on", "flicker_off", "up_down", "sideways", "stomp", "edge_down",
+	"rnd_flicker", "rnd_rain", "matrix_rain", "diagonal", "propeller", "spiral", "all_leds",
+	"pause", "playlist", "other"
+};
+
+LedCubeProfiler::LedCubeProfiler(LedCube * led_cube, uint8_t num_types)
+	: _led_cube(led_cube), _num_types(num_types), _is_text(true), _dump_type(num_types), _line_length(0), _line_pos(0)
+{
+	_profiles = new LedCubeProfile[_num_types];
+	reset();
+}
+
+LedCubeProfiler::~LedCubeProfiler()
+{
+	delete[] _profiles;
+}
+
+unsigned long LedCubeProfiler::getMeanTime(uint8_t type)
+{
+	const LedCubeProfile &profile = _profiles[type];
+	
+	return (profile.frames > 0) ? profile.time / profile.frames : 0;
+}
+
+void LedCubeProfiler::reset()
+{
+	for (uint8_t type = 0; type < _num_types; ++type) {
+		LedCubeProfile &profile = _profiles[type];
+		
+		profile.frames = 0;
+		profile.time = 0;
+		profile.min_time = 0xFFFF;
+		profile.max_time = 0;
+		profile.writes = 0;
+		profile.misses = 0;
+	}
+}
+
+void LedCubeProfiler::startDump(bool as_text)
+{
+	_is_text = as_text;
+	_dump_type = 0;
+	_line_pos = 0;
+	if (_is_text) {
+		strcpy(_line, "type frames min mean max writes misses\n");
+		_line_length = strlen(_line);
+	} else {
+		memcpy(_line, "LCP\x01", 4);
+		_line_length = 4;
+	}
+}
+
+// little endian
+static uint8_t putBytes(char * line, unsigned long value, uint8_t bytes)
+{
+	for (uint8_t i = 0; i < bytes; ++i, value >>= 8) {
+		line[i] = value & 0xFF;
+	}
+	return bytes;
+}
+
+bool LedCubeProfiler::_formatNext()
+{
+	// the next type with frames into the line, false after the last one (the binary end mark is a line as well)
+	while (_dump_type < _num_types && _profiles[_dump_type].frames == 0) {
+		_dump_type += 1;
+	}
+	_line_pos = 0;
+	if (_dump_type >= _num_types) {
+		if (_dump_type == _num_types && !_is_text) {
+			_line[0] = (char)0xFF;
+			_line_length = 1;
+			_dump_type += 1;
+			return true;
+		}
+		_line_length = 0;
+		return false;
+	}
+	
+	const uint8_t type = _dump_type++;
+	const LedCubeProfile profile = _profiles[type];
+	
+	if (_is_text) {
+		char name[12];
+		
+		if (type < profiler::USER) {
+			memcpy_P(name, _names[type], sizeof(name));
+		} else {
+			snprintf(name, sizeof(name), "#%u", type);
+		}
+		const int length = snprintf(_line, _line_size, "%s %lu %u %lu %u %lu %u\n", name, profile.frames,
+			(profile.min_time <= profile.max_time) ? profile.min_time : 0, profile.time / profile.frames, profile.max_time,
+			profile.writes / profile.frames, profile.misses);
+		
+		_line_length = (length < _line_size) ? length : _line_size - 1;
+	} else {
+		uint8_t length = 0;
+		
+		length += putBytes(_line + length, type, 1);
+		length += putBytes(_line + length, profile.frames, 4);
+		length += putBytes(_line + length, profile.time, 4);
+		length += putBytes(_line + length, profile.min_time, 2);
+		length += putBytes(_line + length, profile.max_time, 2);
+		length += putBytes(_line + length, profile.writes, 4);
+		length += putBytes(_line + length, profile.misses, 2);
+		_line_length = length;
+	}
+	return true;
+}
+
+bool LedCubeProfiler::dump(Stream &out, uint8_t max_bytes)
+{
+	while (max_bytes > 0) {
+		if (_line_pos >= _line_length && !_formatNext()) {
+			return true;
+		}
+		const uint8_t rest = _line_length - _line_pos;
+		const uint8_t length = (rest < max_bytes) ? rest : max_bytes;
+		const size_t written = out.write((const uint8_t *)_line + _line_pos, length);
+		
+		_line_pos += written;
+		max_bytes -= written;
+		if (written < length) {
+			// the stream is full
+			return false;
+		}
+	}
+	// the next call finds out whether there is more
+	return false;
+}
+
+// EOF
@@ -0,0 +1,120 @@
+#ifndef _LED_CUBE_PROFILER_H
+#define _LED_CUBE_PROFILER_H
+
+#include "LedCube.h"
+
+// frames of one type of sequences, see LedCubeProfiler
+struct LedCubeProfile
+{
+	unsigned long frames;
+	unsigned long time; // [us] of all frames (wraps around after 71 minutes of computing)
+	uint16_t min_time; // [us] (at most 65535)
+	uint16_t max_time; // [us] (at most 65535)
+	unsigned long writes; // LEDs written (LedCube::getWrites())
+	uint16_t misses; // frames ready only when the next one was already due (dropped ones too), at most 65535
+};
+
+/* Opt-in profiler of the frames of sequences (LedCube::setProfiler()), per type of sequence (namespace profiler):
+ * frames, min/mean/max time of computing a frame, LEDs written and deadline misses.
+ * - LedCube::nextFrameOfSequence() records under the type given to LedCube::setSequence()
+ * - sequences::Playlist (sequences::Demo) records the frames of its sequences under their playlist::SequenceId
+ * A frame costs two more calls of micros(). Memory: 18 B per type (18 types by default => 324 B) and 64 B for the dump.
+ * dump() writes the results in small pieces, so a serial line never waits for its buffer and the refresh goes on.
+ */
+class LedCubeProfiler
+{
+public:
+	// state at the start of a frame
+	struct Mark
+	{
+		unsigned long start; // [us]
+		unsigned long writes;
+	};
+protected:
+	static const uint8_t _line_size = 64;
+	
+	LedCube * _led_cube;
+	const uint8_t _num_types;
+	LedCubeProfile * _profiles;
+	
+	// dump in progress: the formatted line of the type before _dump_type
+	bool _is_text;
+	uint8_t _dump_type;
+	uint8_t _line_length;
+	uint8_t _line_pos;
+	char _line[_line_size];
+	
+	bool _formatNext();
+public:
+	LedCubeProfiler(LedCube * led_cube, uint8_t num_types=profiler::USER);
+	
+	LedCubeProfiler(const LedCubeProfiler &) = delete;
+	
+	LedCubeProfiler & operator=(const LedCubeProfiler &) = delete;
+	
+	~LedCubeProfiler();
+	
+	Mark mark()
+	{
+		Mark mark = {micros(), _led_cube->getWrites()};
+		
+		return mark;
+	}
+	
+	// the next piece of a frame computed in pieces (LedCube::CONTINUE_FRAME), after the time [us] and the writes of the others
+	Mark mark(unsigned long time, unsigned long writes)
+	{
+		Mark mark = {micros() - time, _led_cube->getWrites() - writes};
+		
+		return mark;
+	}
+	
+	// the frame computed since the mark, it returned wait [ms] (0 => the end of the sequence, never a miss)
+	void record(uint8_t type, const Mark &mark, unsigned long wait)
+	{
+		if (type >= _num_types) {
+			return;
+		}
+		const unsigned long time = micros() - mark.start;
+		const uint16_t short_time = (time < 0xFFFF) ? time : 0xFFFF;
+		LedCubeProfile &profile = _profiles[type];
+		
+		profile.frames += 1;
+		profile.time += time;
+		if (short_time < profile.min_time) {
+			profile.min_time = short_time;
+		}
+		if (short_time > profile.max_time) {
+			profile.max_time = short_time;
+		}
+		profile.writes += _led_cube->getWrites() - mark.writes;
+		// the frame is late by its whole wait => the next one is due already
+		if (wait > 0 && _led_cube->getFrameLateness() >= wait && profile.misses < 0xFFFF) {
+			profile.misses += 1;
+		}
+	}
+	
+	uint8_t getNumTypes() { return _num_types; }
+	
+	// type < getNumTypes()
+	const LedCubeProfile & getProfile(uint8_t type) { return _profiles[type]; }
+	
+	// [us], 0 without frames
+	unsigned long getMeanTime(uint8_t type);
+	
+	void reset();
+	
+	/* Starts a dump of the types with frames:
+	 * - text: a header and a line per type "name frames min mean max writes_per_frame misses" (times in us),
+	 *   the built-in types by name, the others as #type
+	 * - binary: "LCP" and version 1, then 19 B per type (type, frames, time, min_time, max_time, writes, misses,
+	 *   little endian, sizes as in LedCubeProfile) and 0xFF at the end
+	 * Every line (record) is taken when it is started, frames recorded meanwhile go to the next dump.
+	 */
+	void startDump(bool as_text=true);
+	
+	// writes at most max_bytes of the dump (less when the stream is full), true when the dump is done
+	bool dump(Stream &out, uint8_t max_bytes=16);
+};
+
+#endif // _LED_CUBE_PROFILER_H
@@ -0,0 +1,236 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeRaster.h"
+
+namespace raster {
+	static int _floorDiv(int num, int den)
+	{
+		// den > 0
+		int q = num / den;
+		if (num % den < 0) {
+			q -= 1;
+		}
+		return q;
+	}
+	
+	// plot x in <cx-to, cx-from> and <cx+from, cx+to>
+	static void _span(LedCube * led_cube, int cx, int y, int z, int from, int to, int state)
+	{
+		for (int x = from; x <= to; ++x) {
+			point(led_cube, cx + x, y, z, state);
+			if (x != 0) {
+				point(led_cube, cx - x, y, z, state);
+			}
+		}
+	}
+	
+	static void _ball(LedCube * led_cube, int cx, int cy, int cz, int r, bool hollow, int state)
+	{
+		if (r < 0) {
+			return;
+		}
+		
+		// (r + 1/2)^2 rounded down, so only integers are needed
+		const int outer = r*r + r;
+		const int inner = (hollow && r > 0) ? (r-1)*(r-1) + (r-1) : -1;
+		
+		for (int dz = 0; dz <= r; ++dz) {
+			int xo = r;
+			int xi = r;
+			for (int dy = 0; dy <= r; ++dy) {
+				const int rest_outer = outer - dz*dz - dy*dy;
+				if (rest_outer < 0) {
+					break;
+				}
+				// the extent of the row only shrinks with growing dy (midpoint walk)
+				while (xo*xo > rest_outer) {
+					xo -= 1;
+				}
+				
+				int from = 0;
+				const int rest_inner = inner - dz*dz - dy*dy;
+				if (rest_inner >= 0) {
+					while (xi*xi > rest_inner) {
+						xi -= 1;
+					}
+					from = xi + 1;
+				}
+				
+				_span(led_cube, cx, cy + dy, cz + dz, from, xo, state);
+				if (dy != 0) {
+					_span(led_cube, cx, cy - dy, cz + dz, from, xo, state);
+				}
+				if (dz != 0) {
+					_span(led_cube, cx, cy + dy, cz - dz, from, xo, state);
+					if (dy != 0) {
+						_span(led_cube, cx, cy - dy, cz - dz, from, xo, state);
+					}
+				}
+			}
+		}
+	}
+	
+	void point(LedCube * led_cube, int x, int y, int z, int state)
+	{
+		const int size = led_cube->getSize();
+		
+		if (x < 0 || y < 0 || z < 0 || x >= size || y >= size || z >= size) {
+			return;
+		}
+		
+		if (state == LOW) {
+			led_cube->turnOff(x, y, z);
+		} else {
+			led_cube->turnOn(x, y, z);
+		}
+	}
+	
+	void line(LedCube * led_cube, int x0, int y0, int z0, int x1, int y1, int z1, int state)
+	{
+		const int dx = abs(x1 - x0);
+		const int dy = abs(y1 - y0);
+		const int dz = abs(z1 - z0);
+		const int sx = (x0 < x1) ? 1 : -1;
+		const int sy = (y0 < y1) ? 1 : -1;
+		const int sz = (z0 < z1) ? 1 : -1;
+		
+		// the longest axis drives the line, the other two accumulate an error
+		int steps = dx;
+		if (dy > steps) steps = dy;
+		if (dz > steps) steps = dz;
+		
+		int ex = steps / 2;
+		int ey = steps / 2;
+		int ez = steps / 2;
+		
+		for (int i = 0; i <= steps; ++i) {
+			point(led_cube, x0, y0, z0, state);
+			
+			ex -= dx;
+			if (ex < 0) {
+				ex += steps;
+				x0 += sx;
+			}
+			ey -= dy;
+			if (ey < 0) {
+				ey += steps;
+				y0 += sy;
+			}
+			ez -= dz;
+			if (ez < 0) {
+				ez += steps;
+				z0 += sz;
+			}
+		}
+	}
+	
+	void box(LedCube * led_cube, int x0, int y0, int z0, int x1, int y1, int z1, int state)
+	{
+		// edges along x
+		line(led_cube, x0, y0, z0, x1, y0, z0, state);
+		line(led_cube, x0, y1, z0, x1, y1, z0, state);
+		line(led_cube, x0, y0, z1, x1, y0, z1, state);
+		line(led_cube, x0, y1, z1, x1, y1, z1, state);
+		// edges along y
+		line(led_cube, x0, y0, z0, x0, y1, z0, state);
+		line(led_cube, x1, y0, z0, x1, y1, z0, state);
+		line(led_cube, x0, y0, z1, x0, y1, z1, state);
+		line(led_cube, x1, y0, z1, x1, y1, z1, state);
+		// edges along z
+		line(led_cube, x0, y0, z0, x0, y0, z1, state);
+		line(led_cube, x1, y0, z0, x1, y0, z1, state);
+		line(led_cube, x0, y1, z0, x0, y1, z1, state);
+		line(led_cube, x1, y1, z0, x1, y1, z1, state);
+	}
+	
+	void cuboid(LedCube * led_cube, int x0, int y0, int z0, int x1, int y1, int z1, int state)
+	{
+		const int size = led_cube->getSize();
+		
+		if (x0 > x1) { int t = x0; x0 = x1; x1 = t; }
+		if (y0 > y1) { int t = y0; y0 = y1; y1 = t; }
+		if (z0 > z1) { int t = z0; z0 = z1; z1 = t; }
+		
+		// clip once instead of per LED
+		if (x0 < 0) x0 = 0;
+		if (y0 < 0) y0 = 0;
+		if (z0 < 0) z0 = 0;
+		if (x1 >= size) x1 = size-1;
+		if (y1 >= size) y1 = size-1;
+		if (z1 >= size) z1 = size-1;
+		
+		for (int z = z0; z <= z1; ++z) {
+			for (int y = y0; y <= y1; ++y) {
+				for (int x = x0; x <= x1; ++x) {
+					point(led_cube, x, y, z, state);
+				}
+			}
+		}
+	}
+	
+	void sphere(LedCube * led_cube, int cx, int cy, int cz, int r, int state)
+	{
+		_ball(led_cube, cx, cy, cz, r, false, state);
+	}
+	
+	void shell(LedCube * led_cube, int cx, int cy, int cz, int r, int state)
+	{
+		_ball(led_cube, cx, cy, cz, r, true, state);
+	}
+	
+	void plane(LedCube * led_cube, int a, int b, int c, int d, int state)
+	{
+		const int size = led_cube->getSize();
+		
+		if (a == 0 && b == 0 && c == 0) {
+			return;
+		}
+		
+		/* The axis with the largest coefficient is computed from the other two (i and j),
+		 * so the plane has exactly one LED in each column along that axis (no gaps).
+		 */
+		int axis; // 0 => x, 1 => y, 2 => z
+		int ci, cj, ck;
+		if (abs(c) >= abs(a) && abs(c) >= abs(b)) {
+			axis = 2; ci = a; cj = b; ck = c;
+		} else if (abs(b) >= abs(a)) {
+			axis = 1; ci = a; cj = c; ck = b;
+		} else {
+			axis = 0; ci = b; cj = c; ck = a;
+		}
+		if (ck < 0) {
+			ci = -ci;
+			cj = -cj;
+			ck = -ck;
+			d = -d;
+		}
+		
+		// k = round((d - ci*i - cj*j) / ck), walked incrementally along i
+		const int step_q = _floorDiv(-ci, ck);
+		const int step_r = -ci - step_q*ck;
+		
+		for (int j = 0; j < size; ++j) {
+			const int num = d - cj*j + ck/2;
+			int k = _floorDiv(num, ck);
+			int rest = num - k*ck;
+			
+			for (int i = 0; i < size; ++i) {
+				switch (axis) {
+					case 0: point(led_cube, k, i, j, state); break;
+					case 1: point(led_cube, i, k, j, state); break;
+					default: point(led_cube, i, j, k, state);
+				}
+				
+				k += step_q;
+				rest += step_r;
+				if (rest >= ck) {
+					rest -= ck;
+					k += 1;
+				}
+			}
+		}
+	}
+}
+
+// EOF
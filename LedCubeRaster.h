@@ -0,0 +1,34 @@
+#ifndef _LED_CUBE_RASTER_H
+#define _LED_CUBE_RASTER_H
+
+#include "LedCube.h"
+
+/* Rasterization primitives drawing into the LED cube map.
+ * - integer arithmetic only (no floating point on AVR)
+ * - every primitive costs time proportional to the LEDs it touches
+ * - coordinates outside of the cube are clipped (not wrapped around like turnOn)
+ * - state = HIGH / LOW
+ */
+namespace raster {
+	void point(LedCube * led_cube, int x, int y, int z, int state=HIGH);
+	
+	// 3D Bresenham line including both end points
+	void line(LedCube * led_cube, int x0, int y0, int z0, int x1, int y1, int z1, int state=HIGH);
+	
+	// wireframe of the axis aligned box (12 edges)
+	void box(LedCube * led_cube, int x0, int y0, int z0, int x1, int y1, int z1, int state=HIGH);
+	
+	// filled axis aligned box
+	void cuboid(LedCube * led_cube, int x0, int y0, int z0, int x1, int y1, int z1, int state=HIGH);
+	
+	// filled sphere (midpoint rule: x^2 + y^2 + z^2 <= r^2 + r)
+	void sphere(LedCube * led_cube, int cx, int cy, int cz, int r, int state=HIGH);
+	
+	// hollow sphere, one LED thick
+	void shell(LedCube * led_cube, int cx, int cy, int cz, int r, int state=HIGH);
+	
+	// plane a*x + b*y + c*z = d (rounded), one LED thick and without gaps
+	void plane(LedCube * led_cube, int a, int b, int c, int d, int state=HIGH);
+}
+
+#endif // _LED_CUBE_RASTER_H
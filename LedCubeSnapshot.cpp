@@ -0,0 +1,238 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeSnapshot.h"
+
+#if defined(__AVR__) || defined(HOST_ARDUINO)
+	#include <avr/eeprom.h>
+	#define LED_CUBE_SNAPSHOT_HAS_EEPROM
+#endif
+
+static const uint8_t version = 2; // 2: ordinal resume points of SEQUENCE_YIELD (LedCubeCoroutine.h) instead of lines
+
+LedCubeSnapshot::LedCubeSnapshot(LedCube * led_cube, uint16_t capacity)
+	: _led_cube(led_cube), _capacity(capacity), _length(0)
+{
+	_data = new uint8_t[_capacity];
+}
+
+LedCubeSnapshot::~LedCubeSnapshot()
+{
+	delete[] _data;
+}
+
+bool LedCubeSnapshot::save()
+{
+	LedCubeSequence * sequence = _led_cube->getSequence();
+	const int size = _led_cube->getSize();
+	const uint16_t frame_bytes = _frameBytes();
+	
+	_length = 0;
+	if (sequence == nullptr || _capacity < _header_size + frame_bytes) {
+		return false;
+	}
+	
+	_data[0] = 'L';
+	_data[1] = 'C';
+	_data[2] = 'S';
+	_data[3] = version;
+	_data[4] = sizeof(int);
+	_data[5] = size;
+	_data[6] = _led_cube->getSequenceType();
+	_data[7] = 0;
+	
+	// LEDs: bit index = x + y*size + z*size*size (as LedCubeFrame)
+	uint8_t * bits = _data + _header_size;
+	memset(bits, 0, frame_bytes);
+	for (int z = 0; z < size; ++z) {
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				const int index = x + (y + z * size) * size;
+				
+				if (_led_cube->getState(x, y, z) != LOW) {
+					bits[index >> 3] |= 1 << (index & 7);
+				}
+			}
+		}
+	}
+	
+	LedCubeArchive archive(bits + frame_bytes, _capacity - _header_size - frame_bytes, false);
+	if (!sequence->archive(archive)) {
+		return false;
+	}
+	_length = _header_size + frame_bytes + archive.getLength();
+	
+	// a save which failed leaves random() as it was, from here on the random numbers are the ones a restored sequence gets
+	const unsigned long seed = random(1, 0x7FFFFFFFL);
+	for (int i = 0; i < 4; ++i) {
+		_data[8 + i] = seed >> (8 * i);
+	}
+	randomSeed(seed);
+	return true;
+}
+
+bool LedCubeSnapshot::restore(LedCubeSequence * sequence, uint8_t type)
+{
+	const int size = _led_cube->getSize();
+	const uint16_t frame_bytes = _frameBytes();
+	
+	if (_length < _header_size + frame_bytes || _data[0] != 'L' || _data[1] != 'C' || _data[2] != 'S' || _data[3] != version
+		|| _data[4] != sizeof(int) || _data[5] != size || _data[6] != type) {
+		delete sequence;
+		return false;
+	}
+	
+	const uint8_t * bits = _data + _header_size;
+	const uint16_t state_length = _length - _header_size - frame_bytes;
+	LedCubeArchive archive(_data + _header_size + frame_bytes, state_length, true);
+	if (!sequence->archive(archive) || archive.getLength() != state_length) {
+		delete sequence;
+		return false;
+	}
+	
+	_led_cube->setSequence(sequence, type);
+	for (int z = 0; z < size; ++z) {
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				const int index = x + (y + z * size) * size;
+				
+				if ((bits[index >> 3] >> (index & 7)) & 1) {
+					_led_cube->turnOn(x, y, z);
+				} else {
+					_led_cube->turnOff(x, y, z);
+				}
+			}
+		}
+	}
+	
+	unsigned long seed = 0;
+	for (int i = 0; i < 4; ++i) {
+		seed |= (unsigned long)_data[8 + i] << (8 * i);
+	}
+	randomSeed(seed);
+	return true;
+}
+
+bool LedCubeSnapshot::setData(const uint8_t * data, uint16_t length)
+{
+	if (length > _capacity) {
+		_length = 0;
+		return false;
+	}
+	memcpy(_data, data, length);
+	_length = length;
+	return true;
+}
+
+#ifdef LED_CUBE_SNAPSHOT_HAS_EEPROM
+static uint8_t * _eepromAddress(uint16_t address) { return (uint8_t *)(uintptr_t)address; }
+
+// Fletcher-16 of the counter, the length and the data of the slot
+static uint16_t _eepromChecksum(uint16_t counter, uint16_t length, uint16_t data_address, const uint8_t * data)
+{
+	uint16_t sum1 = 0;
+	uint16_t sum2 = 0;
+	const uint8_t head[4] = {(uint8_t)counter, (uint8_t)(counter >> 8), (uint8_t)length, (uint8_t)(length >> 8)};
+	
+	for (uint16_t i = 0; i < 4 + length; ++i) {
+		uint8_t value;
+		
+		if (i < 4) {
+			value = head[i];
+		} else if (data != nullptr) {
+			value = data[i - 4];
+		} else {
+			value = eeprom_read_byte(_eepromAddress(data_address + i - 4));
+		}
+		sum1 = (sum1 + value) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	return sum2 << 8 | sum1;
+}
+#endif
+
+int LedCubeSnapshot::_newestEepromSlot(uint16_t address, uint8_t slots, uint16_t &counter)
+{
+	int newest = -1;
+
+#ifdef LED_CUBE_SNAPSHOT_HAS_EEPROM
+	for (uint8_t slot = 0; slot < slots; ++slot) {
+		const uint16_t slot_address = address + slot * (_slot_header_size + _capacity);
+		const uint16_t slot_counter = eeprom_read_word((const uint16_t *)_eepromAddress(slot_address));
+		const uint16_t length = eeprom_read_word((const uint16_t *)_eepromAddress(slot_address + 2));
+		const uint16_t checksum = eeprom_read_word((const uint16_t *)_eepromAddress(slot_address + 4));
+		
+		if (length == 0 || length > _capacity
+			|| _eepromChecksum(slot_counter, length, slot_address + _slot_header_size, nullptr) != checksum) {
+			continue;
+		}
+		// the counter wraps around
+		if (newest < 0 || (int16_t)(slot_counter - counter) > 0) {
+			newest = slot;
+			counter = slot_counter;
+		}
+	}
+#else
+	(void)address;
+	(void)slots;
+	(void)counter;
+#endif
+	return newest;
+}
+
+bool LedCubeSnapshot::saveToEeprom(uint16_t address, uint8_t slots)
+{
+#ifdef LED_CUBE_SNAPSHOT_HAS_EEPROM
+	uint16_t counter = 0;
+	
+	if (_length == 0 || slots == 0) {
+		return false;
+	}
+	
+	// the slot after the newest one (the newest one stays valid until this one is whole)
+	const int newest = _newestEepromSlot(address, slots, counter);
+	const uint8_t slot = (newest < 0) ? 0 : (newest + 1) % slots;
+	const uint16_t slot_address = address + slot * (_slot_header_size + _capacity);
+	
+	counter += 1;
+	for (uint16_t i = 0; i < _length; ++i) {
+		eeprom_update_byte(_eepromAddress(slot_address + _slot_header_size + i), _data[i]);
+	}
+	eeprom_update_word((uint16_t *)_eepromAddress(slot_address + 2), _length);
+	eeprom_update_word((uint16_t *)_eepromAddress(slot_address + 4), _eepromChecksum(counter, _length, 0, _data));
+	// last, a slot cut off before it fails its checksum
+	eeprom_update_word((uint16_t *)_eepromAddress(slot_address), counter);
+	return true;
+#else
+	(void)address;
+	(void)slots;
+	return false;
+#endif
+}
+
+bool LedCubeSnapshot::loadFromEeprom(uint16_t address, uint8_t slots)
+{
+#ifdef LED_CUBE_SNAPSHOT_HAS_EEPROM
+	uint16_t counter = 0;
+	const int newest = _newestEepromSlot(address, slots, counter);
+	
+	_length = 0;
+	if (newest < 0) {
+		return false;
+	}
+	
+	const uint16_t slot_address = address + newest * (_slot_header_size + _capacity);
+	const uint16_t length = eeprom_read_word((const uint16_t *)_eepromAddress(slot_address + 2));
+	for (uint16_t i = 0; i < length; ++i) {
+		_data[i] = eeprom_read_byte(_eepromAddress(slot_address + _slot_header_size + i));
+	}
+	_length = length;
+	return true;
+#else
+	(void)address;
+	(void)slots;
+	return false;
+#endif
+}
+
+// EOF
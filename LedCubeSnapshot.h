@@ -0,0 +1,124 @@
+#ifndef _LED_CUBE_SNAPSHOT_H
+#define _LED_CUBE_SNAPSHOT_H
+
+#include "LedCube.h"
+
+// state of a sequence as bytes (LedCubeSequence::archive()): the same function of the sequence writes it and reads it back
+class LedCubeArchive
+{
+protected:
+	uint8_t * _data;
+	const uint16_t _capacity;
+	uint16_t _length; // written or read so far
+	const bool _is_loading;
+	bool _is_ok;
+public:
+	// is_loading => reads capacity bytes written before
+	LedCubeArchive(uint8_t * data, uint16_t capacity, bool is_loading)
+		: _data(data), _capacity(capacity), _length(0), _is_loading(is_loading), _is_ok(true)
+	{}
+	
+	bool isLoading() { return _is_loading; }
+	
+	// false after a field which did not fit (every field after it is skipped)
+	bool isOk() { return _is_ok; }
+	
+	uint16_t getLength() { return _length; }
+	
+	void bytes(void * data, uint16_t size)
+	{
+		if (!_is_ok || _length + size > _capacity) {
+			_is_ok = false;
+			return;
+		}
+		if (_is_loading) {
+			memcpy(data, _data + _length, size);
+		} else {
+			memcpy(_data + _length, data, size);
+		}
+		_length += size;
+	}
+	
+	template <typename T>
+	void field(T &value) { bytes(&value, sizeof(value)); }
+	
+	// values 0..255 in one byte
+	template <typename T>
+	void fieldByte(T &value)
+	{
+		uint8_t small = value;
+		
+		bytes(&small, 1);
+		if (_is_loading) {
+			value = small;
+		}
+	}
+};
+
+/* Snapshot of the running sequence of the cube and of what the cube shows, as one compact blob (RAM, EEPROM, a file):
+ * - save() between two frames: a header, the LEDs (1 bit each) and the state of the sequence (LedCubeSequence::archive()),
+ *   false when the sequence cannot be saved now (e.g. during the blend of a transition) or does not fit
+ * - restore() into a sequence constructed with the same parameters: it goes on after the saved frame (its next frame comes
+ *   at once) and the cube shows the saved LEDs again
+ * Note: every successful save() seeds random() anew (with a seed kept in the blob), so that the restored sequence draws
+ * the same numbers as the saved one did after the save. The show with periodic saves therefore differs from the show
+ * without them (still random, but not the same numbers), and other users of random() get the new sequence of numbers too.
+ * A blob fits the builds with the same layout of the state of the sequences: positions in SEQUENCE_YIELD coroutines are
+ * ordinals, not lines, and a state of another size is refused by restore(), but a changed meaning of a field is not found.
+ * Supported: the sequences of LedCube.h (sequences::Playlist and sequences::Demo included, transitions after
+ * the handover), ScrollText, ParticleShow, Program, Composite (layers added in the same order), Life3D, Spin and Shader.
+ * Not supported (save() returns false): sequences::Stream (the position in the storage is not kept), sequences::Coroutine
+ * (C++20 coroutines) and sequences without archive().
+ * sequences::Demo on 4x4x4 needs at most 168 B (182 B with transitions), see extras/host/snapshot_check.cpp for the others.
+ */
+class LedCubeSnapshot
+{
+protected:
+	static const uint8_t _header_size = 12; // "LCS", version, sizeof(int), size, type, reserved, seed
+	static const uint8_t _slot_header_size = 6; // counter, length, checksum
+	
+	LedCube * _led_cube;
+	const uint16_t _capacity;
+	uint8_t * _data;
+	uint16_t _length; // 0 => none
+	
+	uint16_t _frameBytes() { return ((uint16_t)_led_cube->getSize() * _led_cube->getSize() * _led_cube->getSize() + 7) / 8; }
+	
+	int _newestEepromSlot(uint16_t address, uint8_t slots, uint16_t &counter);
+public:
+	LedCubeSnapshot(LedCube * led_cube, uint16_t capacity=256);
+	
+	LedCubeSnapshot(const LedCubeSnapshot &) = delete;
+	
+	LedCubeSnapshot & operator=(const LedCubeSnapshot &) = delete;
+	
+	~LedCubeSnapshot();
+	
+	// the running sequence and the LEDs (call it between two frames)
+	bool save();
+	
+	/* The saved state into the sequence (constructed with the parameters of the saved one, type as given to LedCube::setSequence()),
+	 * which becomes the sequence of the cube. False (and the sequence is deleted) when the blob does not fit it.
+	 */
+	bool restore(LedCubeSequence * sequence, uint8_t type=profiler::OTHER);
+	
+	const uint8_t * getData() { return _data; }
+	
+	// [B] 0 => nothing saved
+	uint16_t getLength() { return _length; }
+	
+	// a blob saved before (e.g. read from a file), checked by restore()
+	bool setData(const uint8_t * data, uint16_t length);
+	
+	/* EEPROM (AVR and host builds): slots of 6 + capacity bytes from the address, written in turns (wear and brown-outs:
+	 * a slot written only in part fails its checksum and the previous one is loaded). Only changed bytes are written.
+	 */
+	bool saveToEeprom(uint16_t address, uint8_t slots=2);
+	
+	// the newest slot with a valid checksum
+	bool loadFromEeprom(uint16_t address, uint8_t slots=2);
+	
+	uint16_t getEepromSize(uint8_t slots=2) { return slots * (_slot_header_size + _capacity); }
+};
+
+#endif // _LED_CUBE_SNAPSHOT_H
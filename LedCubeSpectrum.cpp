@@ -0,0 +1,128 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeSpectrum.h"
+
+// sin(2*pi*k/32) in Q15, k = <0, 23> (cos(x) = sin(x + 8))
+static const int16_t _sin_table[24] PROGMEM = {
+	0, 6393, 12539, 18204, 23170, 27245, 30273, 32137, 32767, 32137, 30273, 27245,
+	23170, 18204, 12539, 6393, 0, -6393, -12539, -18204, -23170, -27245, -30273, -32137
+};
+
+// first half of the Hann window in Q15 (the window is symmetric)
+static const int16_t _hann_table[16] PROGMEM = {
+	0, 335, 1328, 2937, 5096, 7717, 10693, 13903, 17213, 20490, 23599, 26412, 28815, 30708, 32016, 32683
+};
+
+void LedCubeSpectrum::_window()
+{
+	for (int i = 0; i < block_len / 2; ++i) {
+		int16_t w = pgm_read_word(&_hann_table[i]);
+		_re[i] = ((long)_re[i] * w) >> 15;
+		_re[block_len-1 - i] = ((long)_re[block_len-1 - i] * w) >> 15;
+	}
+}
+
+void LedCubeSpectrum::_fft()
+{
+	// bit reversal permutation
+	for (int i = 1, j = 0; i < block_len; ++i) {
+		int bit = block_len >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j) {
+			int16_t t = _re[i]; _re[i] = _re[j]; _re[j] = t;
+			t = _im[i]; _im[i] = _im[j]; _im[j] = t;
+		}
+	}
+	
+	for (int len = 2; len <= block_len; len <<= 1) {
+		int half = len >> 1;
+		int step = block_len / len;
+		for (int i = 0; i < block_len; i += len) {
+			for (int j = 0; j < half; ++j) {
+				int k = j * step;
+				int16_t wr = pgm_read_word(&_sin_table[k + 8]);
+				int16_t wi = -(int16_t)pgm_read_word(&_sin_table[k]);
+				int a = i + j;
+				int b = a + half;
+				
+				int16_t tr = ((long)wr * _re[b] - (long)wi * _im[b]) >> 15;
+				int16_t ti = ((long)wr * _im[b] + (long)wi * _re[b]) >> 15;
+				
+				_re[b] = (_re[a] - tr) >> 1;
+				_im[b] = (_im[a] - ti) >> 1;
+				_re[a] = (_re[a] + tr) >> 1;
+				_im[a] = (_im[a] + ti) >> 1;
+			}
+		}
+	}
+}
+
+void LedCubeSpectrum::compute(const int16_t * samples)
+{
+	for (int i = 0; i < block_len; ++i) {
+		// 10 bit samples => Q15 with headroom
+		_re[i] = samples[i] << 5;
+		_im[i] = 0;
+	}
+	
+	_window();
+	_fft();
+	
+	for (int i = 0; i < num_bins; ++i) {
+		uint16_t re = abs(_re[i]);
+		uint16_t im = abs(_im[i]);
+		// |z| ~ max + min/2
+		_magnitude[i] = (re > im) ? re + (im >> 1) : im + (re >> 1);
+	}
+}
+
+uint16_t LedCubeSpectrum::getBand(int band, int num_bands)
+{
+	const int usable = num_bins - 1; // without DC
+	int lo = 1;
+	int hi = 1;
+	
+	// band widths grow quadratically, every band gets at least one bin
+	for (int b = 0; b <= band; ++b) {
+		lo = hi;
+		hi = 1 + (long)usable * (b+1) * (b+1) / ((long)num_bands * num_bands);
+		if (hi <= lo) {
+			hi = lo + 1;
+		}
+	}
+	if (lo >= num_bins) {
+		lo = num_bins - 1;
+	}
+	if (hi > num_bins) {
+		hi = num_bins;
+	}
+	
+	uint16_t value = 0;
+	for (int i = lo; i < hi; ++i) {
+		if (_magnitude[i] > value) {
+			value = _magnitude[i];
+		}
+	}
+	return value;
+}
+
+int LedCubeSpectrum::toLevel(uint16_t magnitude, int max_level, int noise_bits)
+{
+	int bits = 0;
+	while (magnitude) {
+		bits += 1;
+		magnitude >>= 1;
+	}
+	if (bits <= noise_bits) {
+		return 0;
+	}
+	
+	int level = (long)(bits - noise_bits) * max_level / (15 - noise_bits);
+	return (level > max_level) ? max_level : level;
+}
+
+// EOF
@@ -0,0 +1,37 @@
+#ifndef _LED_CUBE_SPECTRUM_H
+#define _LED_CUBE_SPECTRUM_H
+
+#include "Arduino.h"
+
+/* Fixed point (Q15) spectrum analyzer of one block of samples.
+ * - radix-2 FFT of block_len samples with the Hann window, every stage scaled by 1/2 (no overflow)
+ * - magnitudes are approximated without sqrt (alpha max plus beta min)
+ * - bins are grouped into bands with roughly logarithmic widths
+ */
+class LedCubeSpectrum
+{
+public:
+	static const int block_len = 32;
+	static const int num_bins = block_len / 2; // bin 0 is DC
+	static const int max_bands = 16;
+protected:
+	int16_t _re[block_len];
+	int16_t _im[block_len];
+	uint16_t _magnitude[num_bins];
+	
+	void _window();
+	void _fft();
+public:
+	// samples are signed 10 bit values (analogRead() - 512)
+	void compute(const int16_t * samples);
+	
+	uint16_t getMagnitude(int bin) { return _magnitude[bin]; }
+	
+	// maximal magnitude of the bins belonging to the band (num_bands <= max_bands)
+	uint16_t getBand(int band, int num_bands);
+	
+	// magnitude mapped to <0, max_level> on a logarithmic scale, magnitudes below 2^noise_bits are silence
+	static int toLevel(uint16_t magnitude, int max_level, int noise_bits=4);
+};
+
+#endif // _LED_CUBE_SPECTRUM_H
@@ -0,0 +1,56 @@
+#ifndef _LED_CUBE_STORAGE_I2C_H
+#define _LED_CUBE_STORAGE_I2C_H
+
+#include <Wire.h>
+
+#include "LedCubeStream.h"
+
+// Animation in an I2C EEPROM with 16 bit addressing (24LC32 .. 24LC512), Wire.begin() has to be called before
+class LedCubeStorageI2C : public LedCubeStorage
+{
+private:
+	const uint8_t _address;
+	const uint32_t _capacity; // [B]
+public:
+	LedCubeStorageI2C(uint8_t address=0x50, uint32_t capacity=32768)
+		: _address(address), _capacity(capacity)
+	{}
+	
+	int read(uint32_t offset, uint8_t * buffer, int length)
+	{
+		if (offset >= _capacity) {
+			return 0;
+		}
+		if ((uint32_t)length > _capacity - offset) {
+			length = _capacity - offset;
+		}
+		
+		// one request can not be longer than the buffer of Wire
+#ifdef BUFFER_LENGTH
+		const int max_request = BUFFER_LENGTH;
+#else
+		const int max_request = 32;
+#endif
+		int done = 0;
+		while (done < length) {
+			const int count = (length - done < max_request) ? length - done : max_request;
+			const uint16_t address = offset + done;
+			
+			Wire.beginTransmission(_address);
+			Wire.write((uint8_t)(address >> 8));
+			Wire.write((uint8_t)(address & 0xFF));
+			if (Wire.endTransmission(false) != 0) {
+				return -1;
+			}
+			if (Wire.requestFrom(_address, (uint8_t)count) != count) {
+				return -1;
+			}
+			for (int i = 0; i < count; ++i) {
+				buffer[done++] = Wire.read();
+			}
+		}
+		return done;
+	}
+};
+
+#endif // _LED_CUBE_STORAGE_I2C_H
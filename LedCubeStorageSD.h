@@ -0,0 +1,31 @@
+#ifndef _LED_CUBE_STORAGE_SD_H
+#define _LED_CUBE_STORAGE_SD_H
+
+#include <SD.h>
+
+#include "LedCubeStream.h"
+
+// Animation in a file on the SD card (the file has to stay open while it is played)
+class LedCubeStorageSD : public LedCubeStorage
+{
+private:
+	File _file;
+public:
+	LedCubeStorageSD(File file)
+		: _file(file)
+	{}
+	
+	int read(uint32_t offset, uint8_t * buffer, int length)
+	{
+		if (!_file) {
+			return -1;
+		}
+		// the player reads sequentially, so seeking happens only at the start
+		if (_file.position() != offset && !_file.seek(offset)) {
+			return -1;
+		}
+		return _file.read(buffer, length);
+	}
+};
+
+#endif // _LED_CUBE_STORAGE_SD_H
@@ -0,0 +1,48 @@
+#ifndef _LED_CUBE_STORAGE_SPI_H
+#define _LED_CUBE_STORAGE_SPI_H
+
+#include <SPI.h>
+
+#include "LedCubeStream.h"
+
+// Animation in an SPI EEPROM / flash with the READ (0x03) command (25LC256, 25LC1024, W25Qxx, ...), SPI.begin() has to be called before
+class LedCubeStorageSPI : public LedCubeStorage
+{
+private:
+	const uint8_t _cs_pin;
+	const uint32_t _capacity; // [B]
+	const uint8_t _address_bytes; // 2 up to 64 KiB, 3 above
+public:
+	LedCubeStorageSPI(uint8_t cs_pin, uint32_t capacity=32768, uint8_t address_bytes=2)
+		: _cs_pin(cs_pin), _capacity(capacity), _address_bytes(address_bytes)
+	{
+		pinMode(_cs_pin, OUTPUT);
+		digitalWrite(_cs_pin, HIGH);
+	}
+	
+	int read(uint32_t offset, uint8_t * buffer, int length)
+	{
+		if (offset >= _capacity) {
+			return 0;
+		}
+		if ((uint32_t)length > _capacity - offset) {
+			length = _capacity - offset;
+		}
+		
+		// the chip streams any number of bytes after one command
+		SPI.beginTransaction(SPISettings(4000000, MSBFIRST, SPI_MODE0));
+		digitalWrite(_cs_pin, LOW);
+		SPI.transfer(0x03);
+		for (int i = _address_bytes - 1; i >= 0; --i) {
+			SPI.transfer((uint8_t)(offset >> (8 * i)));
+		}
+		for (int i = 0; i < length; ++i) {
+			buffer[i] = SPI.transfer(0);
+		}
+		digitalWrite(_cs_pin, HIGH);
+		SPI.endTransaction();
+		return length;
+	}
+};
+
+#endif // _LED_CUBE_STORAGE_SPI_H
@@ -0,0 +1,182 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeStream.h"
+
+LedCubeStreamPlayer::LedCubeStreamPlayer(LedCube * led_cube, LedCubeStorage * storage, uint32_t start, uint8_t * front, uint8_t * back, int block_size, int chunk_size)
+	: LedCubeSequence(led_cube), _storage(storage), _start(start), _blocks{front, back}, _block_size(block_size), _chunk_size(chunk_size),
+	_front(0), _position(0), _filled{0, 0}, _back_ready(false), _offset(start), _end_of_data(false),
+	_chunk_time(0), _underruns(0), _max_stall(0), _frame_stall(0), _frames(0), _error(false), _wait_left(0), _frame_end(0)
+{}
+
+void LedCubeStreamPlayer::_readChunk()
+{
+	const int back = 1 - _front;
+	int length = _block_size - _filled[back];
+	if (length > _chunk_size) {
+		length = _chunk_size;
+	}
+	
+	const unsigned long start = micros();
+	int read = _storage->read(_offset, _blocks[back] + _filled[back], length);
+	const unsigned long time = micros() - start;
+	// average of the last reads (a rare slow read must not stop the prefetch for good)
+	if (_chunk_time == 0) {
+		_chunk_time = time;
+	} else {
+		_chunk_time = _chunk_time - _chunk_time / 8 + time / 8;
+	}
+	
+	if (read < 0) {
+		_error = true;
+		read = 0;
+	}
+	if (read < length) {
+		_end_of_data = true;
+	}
+	_filled[back] += read;
+	_offset += read;
+	_back_ready = _end_of_data || _filled[back] == _block_size;
+}
+
+bool LedCubeStreamPlayer::_swapBlocks()
+{
+	if (!_back_ready) {
+		// underrun: the frame has to wait for the rest of the block
+		const unsigned long start = micros();
+		while (!_back_ready) {
+			_readChunk();
+		}
+		const unsigned long stall = micros() - start;
+		if (stall > _max_stall) {
+			_max_stall = stall;
+		}
+		_frame_stall += stall;
+		_underruns += 1;
+	}
+	
+	const int back = 1 - _front;
+	if (_filled[back] == 0) {
+		return false;
+	}
+	
+	_front = back;
+	_position = 0;
+	_filled[1 - _front] = 0;
+	_back_ready = _end_of_data;
+	return true;
+}
+
+bool LedCubeStreamPlayer::_nextByte(uint8_t &value)
+{
+	if (_position == _filled[_front] && !_swapBlocks()) {
+		return false;
+	}
+	value = _blocks[_front][_position];
+	_position += 1;
+	return true;
+}
+
+void LedCubeStreamPlayer::_prefetch(unsigned long budget)
+{
+	// a chunk is read only if it is expected to fit into the budget
+	const unsigned long start = micros();
+	
+	while (!_back_ready && micros() - start + _chunk_time <= budget) {
+		_readChunk();
+	}
+}
+
+unsigned long LedCubeStreamPlayer::_stop(bool error)
+{
+	_error = _error || error;
+	_state = -1;
+	return 0;
+}
+
+unsigned long LedCubeStreamPlayer::operator()()
+{
+	const int size = _led_cube->getSize();
+	uint8_t low, high;
+	unsigned long wait;
+	
+	switch(_state) {
+		case 0: {
+			uint8_t header[stream::header_bytes];
+			if (_storage->read(_start, header, stream::header_bytes) != stream::header_bytes) {
+				return _stop(true);
+			}
+			if (header[0] != 'L' || header[1] != 'C' || header[2] != stream::version || header[3] != size) {
+				return _stop(true);
+			}
+			_offset = _start + stream::header_bytes;
+			
+			// both blocks are filled before the first frame (not counted as underruns)
+			while (!_back_ready) {
+				_readChunk();
+			}
+			_swapBlocks();
+			while (!_back_ready) {
+				_readChunk();
+			}
+			_state += 1;
+		}
+		case 1:
+			_frame_stall = 0;
+			if (!_nextByte(low) || !_nextByte(high)) {
+				return _stop(_error);
+			}
+			wait = low | (uint16_t)high << 8;
+			if (wait == 0) {
+				return _stop(_error);
+			}
+			
+			for (int z = 0, bit = 8; z < size; ++z) {
+				for (int y = 0; y < size; ++y) {
+					for (int x = 0; x < size; ++x, ++bit) {
+						if (bit == 8) {
+							if (!_nextByte(low)) {
+								return _stop(true);
+							}
+							bit = 0;
+						}
+						if (low & (1 << bit)) {
+							_led_cube->turnOn(x, y, z);
+						} else {
+							_led_cube->turnOff(x, y, z);
+						}
+					}
+				}
+			}
+			_frames += 1;
+			_wait_left = wait;
+			_frame_end = millis() + wait;
+			_state += 1;
+		case 2: {
+			// a slice of the frame budget, the refresh runs before the next one; a chunk longer than the budget is read
+			// alone; at most half of the time until the next frame
+			const long left = (long)(_frame_end - millis());
+			unsigned long slice = _led_cube->getFrameBudget();
+			if (slice < _chunk_time) {
+				slice = _chunk_time;
+			}
+			if (left <= 0) {
+				slice = 0;
+			} else if (slice > (unsigned long)left * 500) {
+				slice = left * 500;
+			}
+			_prefetch(slice);
+			// the next piece only while a chunk still fits into half of the time left
+			if (!_back_ready && _wait_left > 1 && (long)(_frame_end - millis()) * 500 > (long)_chunk_time) {
+				_wait_left -= 1;
+				return 1;
+			}
+			_state = 1;
+			return _wait_left;
+		}
+		default:
+			return 0;
+	}
+}
+
+// EOF
@@ -0,0 +1,105 @@
+#ifndef _LED_CUBE_STREAM_H
+#define _LED_CUBE_STREAM_H
+
+#include "LedCube.h"
+
+/* Format of the recorded animations (extras/host/stream_bench.cpp records them from sequences):
+ * - header: 'L' 'C' version size
+ * - frames: wait [ms] (16 bit little endian) followed by the LEDs, one bit each (LSB first),
+ *   bit index = x + y*size + z*size*size
+ * - the animation ends with wait 0 (or with the end of the data)
+ */
+namespace stream {
+	const uint8_t version = 1;
+	const int header_bytes = 4;
+	
+	inline int ledBytes(int size) { return (size*size*size + 7) / 8; }
+	
+	inline int frameBytes(int size) { return 2 + ledBytes(size); }
+}
+
+// Source of the recorded animation (SD card file, I2C/SPI EEPROM, ...), see LedCubeStorageSD.h and LedCubeStorageI2C.h
+class LedCubeStorage
+{
+public:
+	virtual ~LedCubeStorage() {}
+	
+	// reads up to length bytes from the offset into the buffer, returns the number of bytes read (less at the end, < 0 on error)
+	virtual int read(uint32_t offset, uint8_t * buffer, int length) = 0;
+};
+
+/* Plays an animation from the storage through two blocks of memory (see sequences::Stream):
+ * frames are taken from the front block while the back block is prefetched in chunks during the wait of every frame,
+ * in slices of the frame budget of the cube (LedCube::getFrameBudget()): the sequence returns a part of the wait after
+ * a slice and goes on with the next slice in the next call, so the refresh runs between them. A chunk slower than the
+ * budget is read alone in its slice; a slice is at most half of the time left until the next frame and the prefetch
+ * stops when no chunk fits into it any more (a chunk is read only when its average read time fits into the slice).
+ * When a frame needs data which are not prefetched yet (underrun), the rest of the back block is read at once.
+ */
+class LedCubeStreamPlayer : public LedCubeSequence
+{
+protected:
+	LedCubeStorage * _storage;
+	const uint32_t _start; // offset of the header in the storage
+	uint8_t * const _blocks[2];
+	const int _block_size;
+	const int _chunk_size;
+	int _front; // index of the block frames are taken from
+	int _position; // in the front block
+	int _filled[2]; // valid bytes in the blocks
+	bool _back_ready; // back block is full or contains the end of the data
+	uint32_t _offset; // of the next byte to prefetch
+	bool _end_of_data;
+	unsigned long _chunk_time; // [us] average read of one chunk
+	unsigned long _underruns;
+	unsigned long _max_stall; // [us]
+	unsigned long _frame_stall; // [us]
+	unsigned long _frames;
+	bool _error;
+	unsigned long _wait_left; // [ms] of the wait of the shown frame not returned yet
+	unsigned long _frame_end; // [ms] when the next frame is due
+	
+	void _readChunk();
+	bool _swapBlocks();
+	bool _nextByte(uint8_t &value);
+	void _prefetch(unsigned long budget);
+	unsigned long _stop(bool error);
+	
+	LedCubeStreamPlayer(LedCube * led_cube, LedCubeStorage * storage, uint32_t start, uint8_t * front, uint8_t * back, int block_size, int chunk_size);
+public:
+	unsigned long operator()();
+	
+	// how many times a frame had to wait for the storage
+	unsigned long getUnderruns() { return _underruns; }
+	
+	// longest wait for the storage during an underrun [us]
+	unsigned long getMaxStall() { return _max_stall; }
+	
+	// how long the last frame waited for the storage before it was drawn [us]
+	unsigned long getFrameStall() { return _frame_stall; }
+	
+	unsigned long getFrames() { return _frames; }
+	
+	// wrong header, other size of the cube or a read error
+	bool hasError() { return _error; }
+};
+
+namespace sequences {
+	/* Player of an animation recorded in the storage from the offset start (the storage is not owned).
+	 * A block should hold a few frames (4x4x4: 10 B per frame, 8x8x8: 66 B per frame),
+	 * a chunk is the amount read at once (small chunks keep the reads short, e.g. 32 B is the I2C buffer of Wire).
+	 */
+	template <int block_size=64, int chunk_size=16>
+	class Stream : public LedCubeStreamPlayer
+	{
+	protected:
+		uint8_t _front_block[block_size];
+		uint8_t _back_block[block_size];
+	public:
+		Stream(LedCube * led_cube, LedCubeStorage * storage, uint32_t start=0)
+			: LedCubeStreamPlayer(led_cube, storage, start, _front_block, _back_block, block_size, chunk_size)
+		{}
+	};
+}
+
+#endif // _LED_CUBE_STREAM_H
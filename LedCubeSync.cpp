@@ -0,0 +1,182 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeSync.h"
+
+uint8_t LedCubeSync::_crc(const uint8_t * data, uint8_t length)
+{
+	// CRC-8, polynomial x^8 + x^2 + x + 1
+	uint8_t crc = 0;
+	
+	for (uint8_t i = 0; i < length; ++i) {
+		crc ^= data[i];
+		for (uint8_t bit = 0; bit < 8; ++bit) {
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+void LedCubeSync::_put(uint8_t * data, unsigned long value, uint8_t bytes)
+{
+	for (uint8_t i = 0; i < bytes; ++i) {
+		data[i] = value >> (8 * i);
+	}
+}
+
+unsigned long LedCubeSync::_get(const uint8_t * data, uint8_t bytes)
+{
+	unsigned long value = 0;
+	
+	for (uint8_t i = 0; i < bytes; ++i) {
+		value |= (unsigned long)data[i] << (8 * i);
+	}
+	return value;
+}
+
+long LedCubeSync::_correction(long error, long max_step)
+{
+	// a half per packet smooths the jitter of reading, a large difference (a new sequence) is a step
+	if (error > max_step || error < -max_step) {
+		return error;
+	}
+	return error / 2;
+}
+
+void LedCubeSync::startSequence(uint8_t id)
+{
+	_generation += 1;
+	_has_generation = true;
+	_sequence_id = id;
+	_seed = random(0x7FFFFFFFL);
+	randomSeed(_seed);
+	_send();
+}
+
+void LedCubeSync::_send()
+{
+	uint8_t packet[_packet_size];
+	uint8_t flags = 0;
+	unsigned long sequence_time = 0, timeline_time = 0;
+	LedCubeTimeline * timeline = _led_cube->getTimeline();
+	
+	if (_led_cube->isSequenceStarted()) {
+		flags |= _has_sequence;
+		sequence_time = _led_cube->getSequenceTime();
+	}
+	if (timeline != nullptr) {
+		flags |= _has_timeline;
+		timeline_time = timeline->getTime();
+	}
+	if (_led_cube->isAutoRefresh()) {
+		flags |= _has_auto_refresh;
+	}
+	packet[0] = _start_byte;
+	packet[1] = _generation;
+	packet[2] = _sequence_id;
+	packet[3] = flags;
+	_put(packet + 4, _seed, 4);
+	_put(packet + 8, sequence_time, 4);
+	_put(packet + 12, timeline_time, 4);
+	_put(packet + 16, _led_cube->getRefreshPhase(), 2);
+	_put(packet + 18, _led_cube->getTargetRefreshFrequency(), 2);
+	packet[20] = _crc(packet + 1, _packet_size - 2);
+	
+	_port->write(packet, _packet_size);
+	_last_send = millis();
+	_sent += 1;
+}
+
+void LedCubeSync::poll()
+{
+	const unsigned long now = micros();
+	const bool is_timely = now - _last_poll <= _max_poll_gap;
+	
+	_last_poll = now;
+	if (_role != SLAVE) {
+		return;
+	}
+	while (_port->available() > 0) {
+		const uint8_t value = _port->read();
+		
+		if (_length == 0 && value != _start_byte) {
+			continue;
+		}
+		_packet[_length++] = value;
+		if (_length < _packet_size) {
+			continue;
+		}
+		_length = 0;
+		if (_crc(_packet + 1, _packet_size - 2) != _packet[_packet_size - 1]) {
+			_corrupted += 1;
+			continue;
+		}
+		// the last byte came at most since the previous poll
+		_follow(now, is_timely && _port->available() == 0);
+	}
+}
+
+void LedCubeSync::_follow(unsigned long received, bool is_timely)
+{
+	const uint8_t flags = _packet[3];
+	
+	if (!_has_generation || _packet[1] != _generation) {
+		// a new sequence of the master (or the first packet of this slave)
+		_generation = _packet[1];
+		_has_generation = true;
+		_sequence_id = _packet[2];
+		_seed = _get(_packet + 4, 4);
+		randomSeed(_seed);
+		if (_on_sequence != nullptr) {
+			_on_sequence(_sequence_id);
+		}
+	}
+	if (!is_timely) {
+		_rejected += 1;
+		return;
+	}
+	_accepted += 1;
+	
+	// times of the master when the packet was received
+	const unsigned long late = _link_delay + (micros() - received);
+	
+	if ((flags & _has_sequence) && _led_cube->isSequenceStarted()) {
+		const unsigned long master = _get(_packet + 8, 4) + (late + 500) / 1000;
+		_sequence_error = (long)(_led_cube->getSequenceTime() - master);
+		_led_cube->shiftSequence(_correction(_sequence_error, _max_step));
+	}
+	
+	LedCubeTimeline * timeline = _led_cube->getTimeline();
+	if ((flags & _has_timeline) && timeline != nullptr) {
+		const unsigned long master = _get(_packet + 12, 4) + late;
+		_timeline_error = (long)((unsigned long)timeline->getTime() - master);
+		timeline->adjustTime(-_correction(_timeline_error, _max_step * 1000));
+	}
+	
+	const int freq = _get(_packet + 18, 2);
+	if ((flags & _has_auto_refresh) && freq > 0) {
+		// the phases differ by less than a half of the period
+		const long period = 1000000L / freq;
+		const unsigned long master = _get(_packet + 16, 2) + late;
+		long error = (long)(_led_cube->getRefreshPhase() - master) % period;
+		
+		if (error > period / 2) {
+			error -= period;
+		} else if (error <= -period / 2) {
+			error += period;
+		}
+		_refresh_error = error;
+		_led_cube->lockRefresh(freq, error / 2);
+	}
+}
+
+unsigned long LedCubeSync::run()
+{
+	poll();
+	if (_role == MASTER && millis() - _last_send >= _period) {
+		_send();
+	}
+	return 0;
+}
+
+// EOF
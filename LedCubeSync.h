@@ -0,0 +1,126 @@
+#ifndef _LED_CUBE_SYNC_H
+#define _LED_CUBE_SYNC_H
+
+#include "LedCube.h"
+#include "LedCubeTimeline.h"
+
+/* Keeps the cubes of a wall (one controller each) in step over a shared serial line:
+ * the master broadcasts a packet every interval and the slaves follow it
+ * - sequence: the master announces every sequence (an id of the application and a seed of random()),
+ *   the slaves seed random() the same way and start the sequence of the id (setOnSequence())
+ * - sequence time: the slaves move the deadlines of their sequence (LedCube::shiftSequence()) to the time of the master
+ * - timeline: the same for the timeline of the cube (LedCubeTimeline::adjustTime()), when both have one
+ * - refresh: when the master refreshes automatically, the slaves refresh at its rate with the scans at the same time
+ *   (LedCube::lockRefresh())
+ * A difference up to max_step is corrected by a half per packet, a larger one at once.
+ * Packets are read when the main loop polls (every 1 ms) and while the layers are lit (the slave is the refresh task of its cube),
+ * a packet read more than _max_poll_gap after the previous poll may have waited in the buffer
+ * (a long frame of a sequence), so its times are not used.
+ * Packet (21 B): 0xC5, generation, id, flags, seed (4 B), sequence time [ms] (4 B), timeline [us] (4 B),
+ * refresh phase [us] (2 B), refresh rate [Hz] (2 B), CRC-8; numbers are little endian.
+ */
+class LedCubeSync : public VariableTimedAction, public LedCubeRefreshTask
+{
+public:
+	enum Role {
+		MASTER,
+		SLAVE
+	};
+protected:
+	static const uint8_t _start_byte = 0xC5;
+	static const uint8_t _packet_size = 21;
+	static const uint8_t _has_sequence = 0x01;
+	static const uint8_t _has_timeline = 0x02;
+	static const uint8_t _has_auto_refresh = 0x04;
+	static const unsigned long _max_poll_gap = 3000; // [us]
+	
+	LedCube * _led_cube;
+	Stream * _port;
+	const Role _role;
+	const unsigned long _link_delay; // [us] from the first byte sent to the last one received
+	const unsigned long _period; // [ms] between two packets of the master
+	const long _max_step; // [ms]
+	uint8_t _packet[_packet_size];
+	uint8_t _length; // received bytes of the packet
+	unsigned long _last_poll; // [us]
+	unsigned long _last_send; // [ms]
+	
+	// sequence
+	uint8_t _generation;
+	bool _has_generation;
+	uint8_t _sequence_id;
+	unsigned long _seed;
+	void (*_on_sequence)(uint8_t id);
+	
+	// statistics
+	unsigned long _sent;
+	unsigned long _accepted;
+	unsigned long _rejected;
+	unsigned long _corrupted;
+	long _sequence_error; // [ms]
+	long _timeline_error; // [us]
+	long _refresh_error; // [us]
+	
+	static uint8_t _crc(const uint8_t * data, uint8_t length);
+	
+	static void _put(uint8_t * data, unsigned long value, uint8_t bytes);
+	
+	static unsigned long _get(const uint8_t * data, uint8_t bytes);
+	
+	long _correction(long error, long max_step);
+	
+	void _send();
+	
+	void _follow(unsigned long received, bool is_timely);
+	
+	unsigned long run();
+public:
+	// baud: speed of the line for the time a packet travels (0 => none, e.g. ptys); interval [ms] between packets of the master
+	LedCubeSync(LedCube * led_cube, Stream * port, Role role, unsigned long baud=115200, unsigned long interval=100, long max_step=50)
+		: _led_cube(led_cube), _port(port), _role(role), _link_delay((baud > 0) ? _packet_size * 10 * 1000000UL / baud : 0),
+		_period(interval), _max_step(max_step), _length(0), _last_poll(0), _last_send(0),
+		_generation(0), _has_generation(false), _sequence_id(0), _seed(0), _on_sequence(nullptr),
+		_sent(0), _accepted(0), _rejected(0), _corrupted(0), _sequence_error(0), _timeline_error(0), _refresh_error(0)
+	{
+		if (_role == SLAVE) {
+			_led_cube->setRefreshTask(this);
+		}
+		start(1);
+	}
+	
+	// reads the line (slave), called by run() and while the layers are lit
+	void poll();
+	
+	void duringRefresh() { poll(); }
+	
+	Role getRole() { return _role; }
+	
+	/* Master: announces a new sequence and seeds random() for it, then set the sequence of the id to the cube:
+	 *   sync.startSequence(playlist::RANDOM_RAIN);
+	 *   led_cube.setSequence(new sequences::RandomRain(&led_cube));
+	 */
+	void startSequence(uint8_t id);
+	
+	// slave: called with the id of a sequence announced by the master (random() is seeded already)
+	void setOnSequence(void (*on_sequence)(uint8_t id)) { _on_sequence = on_sequence; }
+	
+	uint8_t getSequenceId() { return _sequence_id; }
+	
+	unsigned long getSent() { return _sent; }
+	
+	// packets whose times were used / not used (read late) / with a wrong CRC
+	unsigned long getAccepted() { return _accepted; }
+	
+	unsigned long getRejected() { return _rejected; }
+	
+	unsigned long getCorrupted() { return _corrupted; }
+	
+	// differences from the master found by the last accepted packet (positive => the slave is ahead)
+	long getSequenceError() { return _sequence_error; }
+	
+	long getTimelineError() { return _timeline_error; }
+	
+	long getRefreshError() { return _refresh_error; }
+};
+
+#endif // _LED_CUBE_SYNC_H
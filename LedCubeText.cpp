@@ -0,0 +1,241 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeText.h"
+#include "LedCubeSnapshot.h"
+
+namespace text {
+	// ASCII ' ' to '_' (lowercase letters are shown as uppercase), glyph_width columns per character
+	static const uint8_t _font[] PROGMEM = {
+		0x00, 0x00, 0x00, // ' '
+		0x00, 0x17, 0x00, // '!'
+		0x03, 0x00, 0x03, // '"'
+		0x1F, 0x0A, 0x1F, // '#'
+		0x12, 0x1F, 0x09, // '$'
+		0x19, 0x04, 0x13, // '%'
+		0x0A, 0x15, 0x1A, // '&'
+		0x00, 0x03, 0x00, // '''
+		0x00, 0x0E, 0x11, // '('
+		0x11, 0x0E, 0x00, // ')'
+		0x0A, 0x04, 0x0A, // '*'
+		0x04, 0x0E, 0x04, // '+'
+		0x10, 0x08, 0x00, // ','
+		0x04, 0x04, 0x04, // '-'
+		0x00, 0x10, 0x00, // '.'
+		0x18, 0x04, 0x03, // '/'
+		0x1F, 0x11, 0x1F, // '0'
+		0x12, 0x1F, 0x10, // '1'
+		0x1D, 0x15, 0x17, // '2'
+		0x11, 0x15, 0x1F, // '3'
+		0x07, 0x04, 0x1F, // '4'
+		0x17, 0x15, 0x1D, // '5'
+		0x1F, 0x15, 0x1D, // '6'
+		0x01, 0x1D, 0x03, // '7'
+		0x1F, 0x15, 0x1F, // '8'
+		0x17, 0x15, 0x1F, // '9'
+		0x00, 0x0A, 0x00, // ':'
+		0x10, 0x0A, 0x00, // ';'
+		0x04, 0x0A, 0x11, // '<'
+		0x0A, 0x0A, 0x0A, // '='
+		0x11, 0x0A, 0x04, // '>'
+		0x01, 0x15, 0x07, // '?'
+		0x1F, 0x15, 0x17, // '@'
+		0x1E, 0x05, 0x1E, // 'A'
+		0x1F, 0x15, 0x0A, // 'B'
+		0x0E, 0x11, 0x11, // 'C'
+		0x1F, 0x11, 0x0E, // 'D'
+		0x1F, 0x15, 0x11, // 'E'
+		0x1F, 0x05, 0x01, // 'F'
+		0x0E, 0x11, 0x1D, // 'G'
+		0x1F, 0x04, 0x1F, // 'H'
+		0x11, 0x1F, 0x11, // 'I'
+		0x08, 0x10, 0x0F, // 'J'
+		0x1F, 0x04, 0x1B, // 'K'
+		0x1F, 0x10, 0x10, // 'L'
+		0x1F, 0x06, 0x1F, // 'M'
+		0x1F, 0x01, 0x1E, // 'N'
+		0x0E, 0x11, 0x0E, // 'O'
+		0x1F, 0x05, 0x02, // 'P'
+		0x0E, 0x19, 0x16, // 'Q'
+		0x1F, 0x05, 0x1A, // 'R'
+		0x12, 0x15, 0x09, // 'S'
+		0x01, 0x1F, 0x01, // 'T'
+		0x0F, 0x10, 0x1F, // 'U'
+		0x07, 0x18, 0x07, // 'V'
+		0x1F, 0x0C, 0x1F, // 'W'
+		0x1B, 0x04, 0x1B, // 'X'
+		0x03, 0x1C, 0x03, // 'Y'
+		0x19, 0x15, 0x13, // 'Z'
+		0x1F, 0x11, 0x00, // '['
+		0x03, 0x04, 0x18, // 'backslash'
+		0x00, 0x11, 0x1F, // ']'
+		0x02, 0x01, 0x02, // '^'
+		0x10, 0x10, 0x10, // '_'
+	};
+	
+	uint8_t glyphColumn(char c, int column)
+	{
+		if (column < 0 || column >= glyph_width) {
+			return 0;
+		}
+		if (c >= 'a' && c <= 'z') {
+			c -= 'a' - 'A';
+		}
+		if (c < ' ' || c > '_') {
+			c = '?';
+		}
+		
+		return pgm_read_byte(&_font[(c - ' ') * glyph_width + column]);
+	}
+}
+
+namespace sequences {
+	void ScrollText::_measureText()
+	{
+		int size = _led_cube->getSize();
+		int perimeter = (size > 1) ? 4 * (size-1) : 1;
+		
+		_text_len = 0;
+		while (_charAt(_text_len) != '\0') {
+			_text_len += 1;
+		}
+		
+		if (_mode == AROUND) {
+			// the last column has to leave the whole perimeter
+			_num_steps = _text_len * text::glyph_pitch + perimeter;
+		} else {
+			_num_steps = _text_len * size;
+		}
+	}
+	
+	char ScrollText::_charAt(int i)
+	{
+		if (_text_in_progmem) {
+			return pgm_read_byte(_text + i);
+		} else {
+			return _text[i];
+		}
+	}
+	
+	uint8_t ScrollText::_column(int text_column)
+	{
+		if (text_column < 0 || text_column >= _text_len * text::glyph_pitch) {
+			return 0;
+		}
+		
+		return text::glyphColumn(_charAt(text_column / text::glyph_pitch), text_column % text::glyph_pitch);
+	}
+	
+	void ScrollText::_drawColumn(int x, int y, uint8_t column)
+	{
+		int size = _led_cube->getSize();
+		uint16_t lines = 0; // bit 0 = top layer (size <= 16)
+		
+		for (int row = 0; row < text::glyph_height; ++row) {
+			if (column & (1U << row)) {
+				if (size >= text::glyph_height) {
+					lines |= 1U << row;
+				} else {
+					lines |= 1U << ((row * size + size/2) / text::glyph_height);
+				}
+			}
+		}
+		
+		for (int line = 0; line < size; ++line) {
+			if (lines & (1U << line)) {
+				_led_cube->turnOn(x, y, size-1 - line);
+			} else {
+				_led_cube->turnOff(x, y, size-1 - line);
+			}
+		}
+	}
+	
+	void ScrollText::_drawAround()
+	{
+		int high = _led_cube->getSize()-1;
+		int perimeter = (high > 0) ? 4 * high : 1;
+		
+		/* Position 0 is the front right corner, the text moves to the left along the front face
+		 * and continues around the left, back and right face.
+		 */
+		for (int p = 0; p < perimeter; ++p) {
+			uint8_t column = _column(_step - p);
+			int side = (high > 0) ? p / high : 0;
+			int k = (high > 0) ? p % high : 0;
+			
+			switch (side) {
+				case 0: _drawColumn(high - k, 0, column); break;
+				case 1: _drawColumn(0, k, column); break;
+				case 2: _drawColumn(k, high, column); break;
+				default: _drawColumn(high, high - k, column);
+			}
+		}
+	}
+	
+	void ScrollText::_drawThrough()
+	{
+		int size = _led_cube->getSize();
+		int depth = _step % size;
+		char c = _charAt(_step / size);
+		int offset = (size - text::glyph_width) / 2;
+		
+		// erase the character at its previous depth
+		for (int x = 0; x < size; ++x) {
+			_drawColumn(x, (depth > 0) ? depth-1 : size-1, 0);
+		}
+		
+		for (int x = 0; x < size; ++x) {
+			_drawColumn(x, depth, text::glyphColumn(c, x - offset));
+		}
+	}
+	
+	unsigned long ScrollText::operator()()
+	{
+		while (true) {
+			switch(_state) {
+				case 0:
+					_led_cube->turnEverythingOff();
+					_step = 0;
+					_state += 1;
+				case 1:
+					if (_step < _num_steps) {
+						if (_mode == AROUND) {
+							_drawAround();
+						} else {
+							_drawThrough();
+						}
+						_step += 1;
+						return _wait;
+					} else {
+						_state += 1;
+					}
+					break;
+				case 2:
+					if (_whole_repeats_cnt < _max_whole_repeats) {
+						_whole_repeats_cnt += 1;
+						_step = 0;
+						_state = 1;
+					} else {
+						_state += 1;
+					}
+					break;
+				case 3:
+					_led_cube->turnEverythingOff();
+					_state += 1;
+					return _wait;
+				default:
+					return 0;
+			}
+		}
+	}
+	
+	bool ScrollText::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_whole_repeats_cnt);
+		archive.field(_step);
+		return archive.isOk();
+	}
+}
+
+// EOF
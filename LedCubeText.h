@@ -0,0 +1,60 @@
+#ifndef _LED_CUBE_TEXT_H
+#define _LED_CUBE_TEXT_H
+
+#include "LedCube.h"
+
+namespace text {
+	// glyphs of the font are 3 columns wide and 5 rows high, one empty column between glyphs
+	static const int glyph_width = 3;
+	static const int glyph_height = 5;
+	static const int glyph_pitch = glyph_width + 1;
+	
+	// column of the glyph read from PROGMEM (bit 0 = top row), the spacing column is empty
+	uint8_t glyphColumn(char c, int column);
+}
+
+namespace sequences {
+	/* Scrolls the text on the cube.
+	 * - AROUND: the text runs around the four vertical sides (front face first, read from the front)
+	 * - THROUGH: one character after another flies from the front face to the back
+	 * Glyphs are read from PROGMEM lazily for each frame, so RAM usage does not depend on the length of the text.
+	 * On cubes lower than the font the rows of glyphs are squeezed together.
+	 */
+	class ScrollText : public LedCubeSequence
+	{
+	public:
+		enum Mode {
+			AROUND,
+			THROUGH
+		};
+	protected:
+		const char * _text;
+		const bool _text_in_progmem;
+		const Mode _mode;
+		const unsigned long _wait; // [ms]
+		const int _max_whole_repeats;
+		int _whole_repeats_cnt;
+		int _text_len;
+		int _step;
+		int _num_steps;
+		
+		void _measureText();
+		char _charAt(int i);
+		uint8_t _column(int text_column);
+		void _drawColumn(int x, int y, uint8_t column);
+		void _drawAround();
+		void _drawThrough();
+	public:
+		ScrollText(LedCube * led_cube, const char * text, Mode mode=AROUND, unsigned long wait=120, int max_whole_repeats=1, bool text_in_progmem=false)
+			: LedCubeSequence(led_cube), _text(text), _text_in_progmem(text_in_progmem), _mode(mode), _wait(wait), _max_whole_repeats(max_whole_repeats), _whole_repeats_cnt(1), _step(0)
+		{
+			_measureText();
+		}
+		
+		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
+	};
+}
+
+#endif // _LED_CUBE_TEXT_H
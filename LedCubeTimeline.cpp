@@ -0,0 +1,67 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeTimeline.h"
+
+uint64_t LedCubeTimeline::_elapsedMicros()
+{
+	unsigned long now = micros();
+	
+	_elapsed += now - _last_micros; // overflow of micros() is handled by unsigned arithmetic
+	_last_micros = now;
+	
+	return _elapsed;
+}
+
+void LedCubeTimeline::start()
+{
+	_last_micros = micros();
+	_elapsed = 0;
+	_tempo_origin_time = 0;
+	_tempo_origin_tick = 0;
+}
+
+void LedCubeTimeline::setTempo(unsigned int bpm)
+{
+	unsigned long tick = getTick();
+	
+	_tempo_origin_time = tickToMicros(tick);
+	_tempo_origin_tick = tick;
+	_bpm = bpm;
+}
+
+unsigned long LedCubeTimeline::getTick()
+{
+	uint64_t since_origin = _elapsedMicros() - _tempo_origin_time;
+	
+	return _tempo_origin_tick + since_origin * ((unsigned long)_bpm * _ticks_per_beat) / 60000000ULL;
+}
+
+uint64_t LedCubeTimeline::tickToMicros(unsigned long tick)
+{
+	const unsigned long ticks_per_minute = (unsigned long)_bpm * _ticks_per_beat;
+	
+	if (tick < _tempo_origin_tick) {
+		tick = _tempo_origin_tick;
+	}
+	// absolute (not accumulated) => rounding does not add up
+	return _tempo_origin_time + ((uint64_t)(tick - _tempo_origin_tick) * 60000000ULL + ticks_per_minute / 2) / ticks_per_minute;
+}
+
+unsigned long LedCubeTimeline::untilTick(unsigned long tick)
+{
+	uint64_t now = _elapsedMicros();
+	uint64_t at = tickToMicros(tick);
+	
+	if (at <= now + 1000) {
+		return 1;
+	}
+	return (at - now + 500) / 1000;
+}
+
+long LedCubeTimeline::getLateness(unsigned long tick)
+{
+	return (long)(_elapsedMicros() - tickToMicros(tick));
+}
+
+// EOF
@@ -0,0 +1,55 @@
+#ifndef _LED_CUBE_TIMELINE_H
+#define _LED_CUBE_TIMELINE_H
+
+#include "Arduino.h"
+
+/* Shared musical clock.
+ * Time of every tick is computed from the start of the timeline (never by summing waits), so everything scheduled
+ * against the same timeline stays in sync without drift; only the jitter of the scheduler remains.
+ * (micros() is extended to 64 bits, so it has to be read at least once every ~70 minutes, which every frame does)
+ */
+class LedCubeTimeline
+{
+protected:
+	unsigned int _bpm; // beats per minute
+	unsigned int _ticks_per_beat;
+	unsigned long _last_micros; // [us]
+	uint64_t _elapsed; // [us] since the start
+	uint64_t _tempo_origin_time; // [us] since the start, time of _tempo_origin_tick
+	unsigned long _tempo_origin_tick; // first tick with the current tempo
+	
+	uint64_t _elapsedMicros();
+public:
+	LedCubeTimeline(unsigned int bpm=120, unsigned int ticks_per_beat=24)
+		: _bpm(bpm), _ticks_per_beat(ticks_per_beat), _last_micros(0), _elapsed(0), _tempo_origin_time(0), _tempo_origin_tick(0)
+	{}
+	
+	// tick 0 is now
+	void start();
+	
+	// changes the tempo from the current tick on
+	void setTempo(unsigned int bpm);
+	
+	unsigned int getTempo() { return _bpm; }
+	
+	unsigned int getTicksPerBeat() { return _ticks_per_beat; }
+	
+	unsigned long getTick();
+	
+	// time of the tick since the start [us]
+	uint64_t tickToMicros(unsigned long tick);
+	
+	// wait for the scheduler [ms] until the tick, at least 1 ms (0 stops sequences / keeps the interval of VariableTimedAction)
+	unsigned long untilTick(unsigned long tick);
+	
+	// how late is now against the time of the tick [us] (negative => early)
+	long getLateness(unsigned long tick);
+	
+	// [us] since the start
+	uint64_t getTime() { return _elapsedMicros(); }
+	
+	// moves the timeline by [us] (positive => later ticks come sooner), e.g. to follow the timeline of another cube
+	void adjustTime(long us) { _elapsed += us; }
+};
+
+#endif // _LED_CUBE_TIMELINE_H
@@ -0,0 +1,195 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeTransition.h"
+#include "LedCubeSnapshot.h"
+
+int LedCubeFrame::getState(int x, int y, int z)
+{
+	const int index = _index(x, y, z);
+	
+	return (_bits[index >> 3] >> (index & 7)) & 1;
+}
+
+void LedCubeFrame::setState(int x, int y, int z, int state)
+{
+	const int index = _index(x, y, z);
+	
+	if (state == LOW) {
+		_bits[index >> 3] &= ~(1 << (index & 7));
+	} else {
+		_bits[index >> 3] |= 1 << (index & 7);
+	}
+}
+
+uint16_t LedCubeFrame::getRow(int y, int z)
+{
+	// the row may continue in the next two bytes (sizes other than 4, 8 and 16)
+	const int index = _index(0, y, z);
+	const int i = index >> 3;
+	uint32_t bits = _bits[i];
+	
+	for (int b = 1; b < 3 && i + b < _bytes; ++b) {
+		bits |= (uint32_t)_bits[i + b] << (8 * b);
+	}
+	return (bits >> (index & 7)) & ((1UL << _size) - 1);
+}
+
+void LedCubeFrame::setRow(int y, int z, uint16_t row)
+{
+	const int index = _index(0, y, z);
+	const int i = index >> 3;
+	const uint32_t mask = ((1UL << _size) - 1) << (index & 7);
+	const uint32_t bits = (uint32_t)row << (index & 7);
+	
+	for (int b = 0; b < 3 && (mask >> (8 * b)) != 0; ++b) {
+		const uint8_t byte_mask = mask >> (8 * b);
+		
+		_bits[i + b] = (_bits[i + b] & ~byte_mask) | ((bits >> (8 * b)) & byte_mask);
+	}
+}
+
+void LedCubeFrame::capture(LedCube * led_cube)
+{
+	for (int z = 0; z < _size; ++z) {
+		for (int y = 0; y < _size; ++y) {
+			for (int x = 0; x < _size; ++x) {
+				setState(x, y, z, led_cube->getState(x, y, z));
+			}
+		}
+	}
+}
+
+namespace sequences {
+	void Transition::_advance(LedCubeSequence * &sequence, LedCubeFrame &frame, unsigned long &due)
+	{
+		// frames which are due, a sequence far behind catches up over the next frames of the transition
+		LedCubeFrame * target = _led_cube->getRenderTarget();
+		
+		for (int i = 0; sequence != nullptr && (long)(_time - due) >= 0 && i < _max_catch_up; ++i) {
+			_led_cube->setRenderTarget(&frame);
+			const unsigned long wait = (*sequence)();
+			_led_cube->setRenderTarget(target);
+			if (wait == 0) {
+				// the last frame stays
+				delete sequence;
+				sequence = nullptr;
+			} else {
+				due += wait;
+			}
+		}
+	}
+	
+	void Transition::_blend(unsigned int progress)
+	{
+		// progress 0 => _from, 256 => _to
+		const int size = _led_cube->getSize();
+		
+		_phase += 157; // odd step, all phases are used equally
+		for (int z = 0; z < size; ++z) {
+			for (int y = 0; y < size; ++y) {
+				const uint16_t from = _from_frame.getRow(y, z);
+				const uint16_t to = _to_frame.getRow(y, z);
+				const uint16_t differ = from ^ to;
+				uint16_t take = 0; // LEDs shown from _to
+				
+				if (differ != 0) {
+					const unsigned int index = (y + z * size) * size;
+					for (int x = 0; x < size; ++x) {
+						if (differ & (1U << x)) {
+							uint8_t threshold = _threshold(index + x);
+							if (_mode == transition::CROSSFADE) {
+								threshold += _phase;
+							}
+							if (threshold < progress) {
+								take |= 1U << x;
+							}
+						}
+					}
+				}
+				_led_cube->setRow(y, z, (from & ~take) | (to & take));
+			}
+		}
+	}
+	
+	void Transition::_show(LedCubeFrame &frame)
+	{
+		const int size = _led_cube->getSize();
+		
+		for (int z = 0; z < size; ++z) {
+			for (int y = 0; y < size; ++y) {
+				_led_cube->setRow(y, z, frame.getRow(y, z));
+			}
+		}
+	}
+	
+	unsigned long Transition::operator()()
+	{
+		while (true) {
+			switch(_state) {
+				case 0:
+					// both sequences start from what is shown
+					_from_frame.capture(_led_cube);
+					_to_frame.capture(_led_cube);
+					_seed = random(0x10000);
+					_state += 1;
+				case 1:
+					_advance(_from, _from_frame, _from_due);
+					_advance(_to, _to_frame, _to_due);
+					if (_time >= _duration) {
+						_state += 1;
+						break;
+					}
+					_blend(_time * 256 / _duration);
+					_time += _step;
+					return _step;
+				case 2:
+					// only _to from now on
+					_show(_to_frame);
+					delete _from;
+					_from = nullptr;
+					_state += 1;
+					if (_to == nullptr) {
+						// _to ended during the transition, its last frame is shown once more
+						return _step;
+					}
+					if ((long)(_to_due - _time) > 0) {
+						return _to_due - _time;
+					}
+				case 3:
+					if (_to == nullptr) {
+						_state = -1;
+						return 0;
+					}
+					return (*_to)();
+				default:
+					return 0;
+			}
+		}
+	}
+	
+	bool Transition::archive(LedCubeArchive &archive)
+	{
+		bool has_to = _to != nullptr;
+		
+		if (!archive.isLoading() && _state >= 0 && _state < 3) {
+			return false;
+		}
+		_archiveState(archive);
+		archive.field(has_to);
+		if (!archive.isOk()) {
+			return false;
+		}
+		if (archive.isLoading()) {
+			delete _from;
+			_from = nullptr;
+			if (!has_to) {
+				delete _to;
+				_to = nullptr;
+			}
+		}
+		return !has_to || (_to != nullptr && _to->archive(archive));
+	}
+}
+
+// EOF
@@ -0,0 +1,107 @@
+#ifndef _LED_CUBE_TRANSITION_H
+#define _LED_CUBE_TRANSITION_H
+
+#include "LedCube.h"
+
+/* One bit per LED (bit index = x + y*size + z*size*size, as in the recorded animations of LedCubeStream.h),
+ * 4x4x4: 8 B, 8x8x8: 64 B. Sequences draw into it instead of the map when it is the render target of the cube.
+ * Rows (x = 0..size-1) are read and written at once as 16 bits, so the size is at most 16.
+ */
+class LedCubeFrame
+{
+protected:
+	const int _size;
+	const int _bytes;
+	uint8_t * _bits;
+	
+	int _index(int x, int y, int z) { return x % _size + (y % _size + z % _size * _size) * _size; }
+public:
+	LedCubeFrame(int size)
+		: _size(size), _bytes((size*size*size + 7) / 8)
+	{
+		_bits = new uint8_t[_bytes];
+		fill(LOW);
+	}
+	
+	LedCubeFrame(const LedCubeFrame &) = delete;
+	
+	LedCubeFrame & operator=(const LedCubeFrame &) = delete;
+	
+	~LedCubeFrame() { delete[] _bits; }
+	
+	int getSize() { return _size; }
+	
+	int getBytes() { return _bytes; }
+	
+	// packed LEDs, for operations on whole bytes
+	uint8_t * getBits() { return _bits; }
+	
+	void fill(int state) { memset(_bits, (state == LOW) ? 0x00 : 0xFF, _bytes); }
+	
+	int getState(int x, int y, int z);
+	
+	void setState(int x, int y, int z, int state);
+	
+	// LEDs of the row, bit x = LED x
+	uint16_t getRow(int y, int z);
+	
+	void setRow(int y, int z, uint16_t row);
+	
+	// copies what the cube shows (or what is drawn into its render target)
+	void capture(LedCube * led_cube);
+};
+
+namespace sequences {
+	/* Blends two running sequences: both are played into their own frame (each by its own waits)
+	 * and the cube shows a mix of them, which moves from the first one to the second one during the duration.
+	 * - transition::DISSOLVE: LEDs which differ switch to the second sequence one by one in a random order
+	 * - transition::CROSSFADE: LEDs which differ show the second sequence for a growing part of the frames
+	 *   (the cube has no brightness control, so the duty cycle is made of frames, a short step keeps it smooth)
+	 * Then only the second sequence plays on. The first one may be nullptr, then the frame shown at the start stays.
+	 * Both sequences are owned, the memory is two frames, the work per frame is at most a few frames of both
+	 * sequences (_max_catch_up) and one pass over the rows.
+	 */
+	class Transition : public LedCubeSequence
+	{
+	protected:
+		LedCubeSequence * _from;
+		LedCubeSequence * _to;
+		LedCubeFrame _from_frame;
+		LedCubeFrame _to_frame;
+		const unsigned long _duration; // [ms]
+		const unsigned long _step; // [ms]
+		const transition::Mode _mode;
+		unsigned long _time; // [ms] since the start
+		unsigned long _from_due; // [ms] next frame of _from
+		unsigned long _to_due; // [ms] next frame of _to
+		uint16_t _seed; // order of the dissolve
+		uint8_t _phase; // of the duty cycle
+		static const int _max_catch_up = 4;
+		
+		void _advance(LedCubeSequence * &sequence, LedCubeFrame &frame, unsigned long &due);
+		
+		uint8_t _threshold(unsigned int index) { return (uint16_t)((index + _seed) * 40503U) >> 8; }
+		
+		void _blend(unsigned int progress);
+		
+		void _show(LedCubeFrame &frame);
+	public:
+		Transition(LedCube * led_cube, LedCubeSequence * from, LedCubeSequence * to, unsigned long duration=500, transition::Mode mode=transition::DISSOLVE, unsigned long step=20)
+			: LedCubeSequence(led_cube), _from(from), _to(to), _from_frame(led_cube->getSize()), _to_frame(led_cube->getSize()),
+			_duration(duration), _step(step), _mode(mode), _time(0), _from_due(0), _to_due(0), _seed(0), _phase(0)
+		{}
+		
+		~Transition()
+		{
+			delete _from;
+			delete _to;
+		}
+		
+		unsigned long operator()();
+		
+		// only after the blend, when the second sequence plays on its own
+		bool archive(LedCubeArchive &archive);
+	};
+}
+
+#endif // _LED_CUBE_TRANSITION_H
@@ -0,0 +1,353 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeVM.h"
+#include "LedCubeSnapshot.h"
+
+#if defined(__AVR__) || defined(HOST_ARDUINO)
+	#include <avr/eeprom.h>
+	#define LED_CUBE_VM_HAS_EEPROM
+#endif
+
+namespace vm {
+	// number of operand bytes of every opcode
+	static const uint8_t _operand_bytes[NUM_OPCODES] PROGMEM = {
+		0, // END
+		2, // WAIT
+		1, // FILL
+		3, // SET
+		3, // CLR
+		3, // PLANE
+		2, // SHIFT
+		1, // LOOP
+		0, // NEXT
+		2, // JMP
+		2, // LD
+		2, // ADD
+		2, // SUB
+		2, // RND
+	};
+	
+	// reads of the storages, chosen once per call of Program::operator() (not per byte)
+	struct RamReader
+	{
+		static uint8_t byte(const uint8_t * address) { return *address; }
+		static uint16_t word(const uint8_t * address) { return address[0] | (uint16_t)address[1] << 8; }
+	};
+	
+	struct ProgmemReader
+	{
+		static uint8_t byte(const uint8_t * address) { return pgm_read_byte(address); }
+		static uint16_t word(const uint8_t * address) { return pgm_read_word(address); } // little endian as the bytecode
+	};
+	
+#ifdef LED_CUBE_VM_HAS_EEPROM
+	struct EepromReader
+	{
+		static uint8_t byte(const uint8_t * address) { return eeprom_read_byte(address); }
+		static uint16_t word(const uint8_t * address) { return eeprom_read_word((const uint16_t *)address); }
+	};
+#endif
+}
+
+namespace sequences {
+	uint8_t Program::_fetch()
+	{
+		const uint8_t * address = _code + _pc;
+		_pc += 1;
+		
+		switch (_storage) {
+			case vm::FROM_PROGMEM:
+				return pgm_read_byte(address);
+#ifdef LED_CUBE_VM_HAS_EEPROM
+			case vm::FROM_EEPROM:
+				return eeprom_read_byte(address);
+#endif
+			default:
+				return *address;
+		}
+	}
+	
+	template <typename Reader>
+	uint8_t Program::_fetchFrom()
+	{
+		const uint8_t value = Reader::byte(_code + _pc);
+		_pc += 1;
+		return value;
+	}
+	
+	template <typename Reader>
+	uint16_t Program::_fetchWordFrom()
+	{
+		// one read of the word, little endian
+		const uint16_t value = Reader::word(_code + _pc);
+		_pc += 2;
+		return value;
+	}
+	
+	int Program::_value(uint8_t operand)
+	{
+		if (operand < vm::r0) {
+			return operand;
+		} else if (operand <= vm::r3) {
+			return _registers[operand - vm::r0];
+		} else if (operand == vm::last) {
+			return _led_cube->getSize()-1;
+		} else if (operand == vm::size) {
+			return _led_cube->getSize();
+		}
+		return 0;
+	}
+	
+	bool Program::_skipLoop()
+	{
+		// moves _pc behind the NEXT matching the LOOP just read
+		int depth = 1;
+		
+		while (true) {
+			const uint8_t opcode = _fetch();
+			if (opcode == vm::END || opcode >= vm::NUM_OPCODES) {
+				return false;
+			} else if (opcode == vm::LOOP) {
+				depth += 1;
+			} else if (opcode == vm::NEXT) {
+				depth -= 1;
+				if (depth == 0) {
+					return true;
+				}
+			}
+			_pc += pgm_read_byte(&vm::_operand_bytes[opcode]);
+		}
+	}
+	
+	void Program::_turn(int x, int y, int z, int state)
+	{
+		const int size = _led_cube->getSize();
+		
+		if (x < 0 || x >= size || y < 0 || y >= size || z < 0 || z >= size) {
+			return;
+		}
+		if (state == LOW) {
+			_led_cube->turnOff(x, y, z);
+		} else {
+			_led_cube->turnOn(x, y, z);
+		}
+	}
+	
+	void Program::_plot(uint8_t axis, int k, int i, int j, int state)
+	{
+		// k is the coordinate along the axis
+		switch (axis) {
+			case vm::X: _turn(k, i, j, state); break;
+			case vm::Y: _turn(i, k, j, state); break;
+			default: _turn(i, j, k, state);
+		}
+	}
+	
+	int Program::_get(uint8_t axis, int k, int i, int j)
+	{
+		switch (axis) {
+			case vm::X: return _led_cube->getState(k, i, j);
+			case vm::Y: return _led_cube->getState(i, k, j);
+			default: return _led_cube->getState(i, j, k);
+		}
+	}
+	
+	void Program::_plane(uint8_t axis, int k, int state)
+	{
+		// the state is resolved once per plane, not per LED
+		const int size = _led_cube->getSize();
+		
+		if (k < 0 || k >= size) {
+			return;
+		}
+		if (axis != vm::X) {
+			// whole rows along x
+			const uint16_t row = (state == LOW) ? 0 : (uint16_t)((1UL << size) - 1);
+			
+			for (int i = 0; i < size; ++i) {
+				if (axis == vm::Y) {
+					_led_cube->setRow(k, i, row);
+				} else {
+					_led_cube->setRow(i, k, row);
+				}
+			}
+			return;
+		}
+		
+		void (LedCube::*turn)(int, int, int) = (state == LOW) ? &LedCube::turnOff : &LedCube::turnOn;
+		
+		for (int i = 0; i < size; ++i) {
+			for (int j = 0; j < size; ++j) {
+				(_led_cube->*turn)(k, i, j);
+			}
+		}
+	}
+	
+	void Program::_shift(uint8_t axis, bool up)
+	{
+		const int size = _led_cube->getSize();
+		
+		// planes are rewritten starting at the side the content moves to, so every source is read before it is overwritten
+		for (int n = 0; n < size; ++n) {
+			const int k = up ? size-1 - n : n;
+			const int from = up ? k-1 : k+1;
+			for (int i = 0; i < size; ++i) {
+				for (int j = 0; j < size; ++j) {
+					_plot(axis, k, i, j, (from >= 0 && from < size) ? _get(axis, from, i, j) : LOW);
+				}
+			}
+		}
+	}
+	
+	unsigned long Program::_stop(vm::Status status)
+	{
+		_status = status;
+		_state = -1;
+		return 0;
+	}
+	
+	unsigned long Program::operator()()
+	{
+		switch(_state) {
+			case 0:
+				_pc = 0;
+				_loop_depth = 0;
+				for (int r = 0; r < vm::num_registers; ++r) {
+					_registers[r] = 0;
+				}
+				_status = vm::RUNNING;
+				_state += 1;
+#ifndef LED_CUBE_VM_HAS_EEPROM
+				if (_storage == vm::FROM_EEPROM) {
+					// no EEPROM to read from, the address would be read from the RAM
+					return _stop(vm::BAD_STORAGE);
+				}
+#endif
+			case 1:
+				break;
+			default:
+				return 0;
+		}
+		
+		switch (_storage) {
+			case vm::FROM_PROGMEM:
+				return _execute<vm::ProgmemReader>();
+#ifdef LED_CUBE_VM_HAS_EEPROM
+			case vm::FROM_EEPROM:
+				return _execute<vm::EepromReader>();
+#endif
+			default:
+				return _execute<vm::RamReader>();
+		}
+	}
+	
+	template <typename Reader>
+	unsigned long Program::_execute()
+	{
+		for (int steps = 0; steps < vm::max_steps_per_frame; ++steps) {
+			const uint16_t address = _pc;
+			const uint8_t opcode = _fetchFrom<Reader>();
+			
+			switch (opcode) {
+				case vm::END:
+					return _stop(vm::FINISHED);
+				case vm::WAIT: {
+					const unsigned long wait = _fetchWordFrom<Reader>();
+					return (wait > 0) ? wait : 1; // 0 would end the sequence
+				}
+				case vm::FILL:
+					if (_fetchFrom<Reader>()) {
+						_led_cube->turnEverythingOn();
+					} else {
+						_led_cube->turnEverythingOff();
+					}
+					break;
+				case vm::SET:
+				case vm::CLR: {
+					const int x = _value(_fetchFrom<Reader>());
+					const int y = _value(_fetchFrom<Reader>());
+					const int z = _value(_fetchFrom<Reader>());
+					_turn(x, y, z, (opcode == vm::SET) ? HIGH : LOW);
+					break;
+				}
+				case vm::PLANE: {
+					const uint8_t axis = _fetchFrom<Reader>();
+					const int k = _value(_fetchFrom<Reader>());
+					_plane(axis, k, _value(_fetchFrom<Reader>()) ? HIGH : LOW);
+					break;
+				}
+				case vm::SHIFT: {
+					const uint8_t axis = _fetchFrom<Reader>();
+					_shift(axis, _fetchFrom<Reader>() == 0);
+					break;
+				}
+				case vm::LOOP: {
+					const int count = _value(_fetchFrom<Reader>());
+					if (count <= 0) {
+						if (!_skipLoop()) {
+							_pc = address;
+							return _stop(vm::BAD_LOOP);
+						}
+					} else if (_loop_depth < vm::max_loop_depth) {
+						_loop_start[_loop_depth] = _pc;
+						_loop_count[_loop_depth] = count;
+						_loop_depth += 1;
+					} else {
+						_pc = address;
+						return _stop(vm::BAD_LOOP);
+					}
+					break;
+				}
+				case vm::NEXT:
+					if (_loop_depth == 0) {
+						_pc = address;
+						return _stop(vm::BAD_LOOP);
+					}
+					_loop_count[_loop_depth-1] -= 1;
+					if (_loop_count[_loop_depth-1] > 0) {
+						_pc = _loop_start[_loop_depth-1];
+					} else {
+						_loop_depth -= 1;
+					}
+					break;
+				case vm::JMP:
+					_pc = _fetchWordFrom<Reader>();
+					break;
+				case vm::LD:
+				case vm::ADD:
+				case vm::SUB:
+				case vm::RND: {
+					const uint8_t r = _fetchFrom<Reader>() & (vm::num_registers-1);
+					const int value = _value(_fetchFrom<Reader>());
+					switch (opcode) {
+						case vm::LD: _registers[r] = value; break;
+						case vm::ADD: _registers[r] += value; break;
+						case vm::SUB: _registers[r] -= value; break;
+						default: _registers[r] = (value > 0) ? random(value) : 0;
+					}
+					break;
+				}
+				default:
+					_pc = address;
+					return _stop(vm::BAD_OPCODE);
+			}
+		}
+		
+		return 1;
+	}
+	
+	bool Program::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_pc);
+		archive.field(_registers);
+		archive.field(_loop_start);
+		archive.field(_loop_count);
+		archive.field(_loop_depth);
+		archive.field(_status);
+		return archive.isOk();
+	}
+}
+
+// EOF
@@ -0,0 +1,97 @@
+#ifndef _LED_CUBE_VM_H
+#define _LED_CUBE_VM_H
+
+#include "LedCube.h"
+
+/* Bytecode of the programs run by sequences::Program (assembler: extras/host/lcasm.py)
+ * - every instruction is an opcode byte followed by one byte per operand
+ *   (operands of WAIT and JMP are 16 bit little endian)
+ * - value operands: 0..239 immediate, vm::r0..vm::r3 register, vm::last => size-1, vm::size => size
+ * - reg operands: vm::r0..vm::r3, registers are 8 bit unsigned (0..255, ADD and SUB wrap around)
+ * - LEDs outside the cube (coordinates from registers) are left out
+ * - WAIT ends the frame, END ends the sequence
+ */
+namespace vm {
+	enum Opcode {
+		END = 0x00, // end of the program
+		WAIT = 0x01, // ms_lo ms_hi: show the frame for given time [ms]
+		FILL = 0x02, // state: whole cube on (1) / off (0)
+		SET = 0x03, // x y z: turn the LED on
+		CLR = 0x04, // x y z: turn the LED off
+		PLANE = 0x05, // axis index state: whole plane perpendicular to the axis
+		SHIFT = 0x06, // axis direction: move everything by one LED (direction 0 => +, 1 => -), the new plane is off
+		LOOP = 0x07, // count: repeat the code up to the matching NEXT (count 0 => skip it)
+		NEXT = 0x08,
+		JMP = 0x09, // addr_lo addr_hi
+		LD = 0x0A, // reg value: reg = value
+		ADD = 0x0B, // reg value: reg += value
+		SUB = 0x0C, // reg value: reg -= value
+		RND = 0x0D, // reg value: reg = random number in <0, value)
+		NUM_OPCODES
+	};
+	
+	enum Axis { X = 0, Y = 1, Z = 2 };
+	
+	// special value operands
+	const uint8_t r0 = 0xF0;
+	const uint8_t r1 = 0xF1;
+	const uint8_t r2 = 0xF2;
+	const uint8_t r3 = 0xF3;
+	const uint8_t last = 0xFE;
+	const uint8_t size = 0xFF;
+	
+	const int num_registers = 4;
+	const int max_loop_depth = 4;
+	const int max_steps_per_frame = 255; // without a WAIT the frame is ended anyway (endless loops do not block the cube)
+	
+	// where the program is stored (the address is passed as a pointer as eeprom_read_byte() expects)
+	enum Storage { FROM_PROGMEM, FROM_RAM, FROM_EEPROM };
+	
+	enum Status { RUNNING, FINISHED, BAD_OPCODE, BAD_LOOP, BAD_STORAGE }; // BAD_STORAGE => FROM_EEPROM without an EEPROM
+}
+
+namespace sequences {
+	/* Interprets the bytecode of a program loaded at runtime (see namespace vm).
+	 * The state is fixed: program counter, 4 registers and 4 nested loops.
+	 */
+	class Program : public LedCubeSequence
+	{
+	protected:
+		const uint8_t * const _code;
+		const vm::Storage _storage;
+		uint16_t _pc;
+		uint8_t _registers[vm::num_registers];
+		uint16_t _loop_start[vm::max_loop_depth];
+		uint8_t _loop_count[vm::max_loop_depth];
+		uint8_t _loop_depth;
+		vm::Status _status;
+		
+		uint8_t _fetch();
+		template <typename Reader> uint8_t _fetchFrom();
+		template <typename Reader> uint16_t _fetchWordFrom();
+		int _value(uint8_t operand);
+		bool _skipLoop();
+		void _turn(int x, int y, int z, int state);
+		void _plot(uint8_t axis, int k, int i, int j, int state);
+		int _get(uint8_t axis, int k, int i, int j);
+		void _plane(uint8_t axis, int k, int state);
+		void _shift(uint8_t axis, bool up);
+		unsigned long _stop(vm::Status status);
+		template <typename Reader> unsigned long _execute();
+	public:
+		Program(LedCube * led_cube, const uint8_t * code, vm::Storage storage=vm::FROM_PROGMEM)
+			: LedCubeSequence(led_cube), _code(code), _storage(storage), _pc(0), _loop_depth(0), _status(vm::RUNNING)
+		{}
+		
+		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
+		
+		vm::Status getStatus() { return _status; }
+		
+		// address of the next instruction (of the faulty one after an error)
+		uint16_t getAddress() { return _pc; }
+	};
+}
+
+#endif // _LED_CUBE_VM_H
@@ -0,0 +1,253 @@
+// Create by: Jan Doležal, 2020
+
+#include "Arduino.h"
+#include "LedCubeVector.h"
+#include "LedCubeRaster.h"
+#include "LedCubeSnapshot.h"
+
+// sin(2*pi*k/256) in Q14, k = <0, 64> (a quarter of the wave, the rest by symmetry)
+static const int16_t _sin_table[65] PROGMEM = {
+	0, 402, 804, 1205, 1606, 2006, 2404, 2801, 3196, 3590, 3981, 4370, 4756,
+	5139, 5520, 5897, 6270, 6639, 7005, 7366, 7723, 8076, 8423, 8765, 9102, 9434,
+	9760, 10080, 10394, 10702, 11003, 11297, 11585, 11866, 12140, 12406, 12665, 12916, 13160,
+	13395, 13623, 13842, 14053, 14256, 14449, 14635, 14811, 14978, 15137, 15286, 15426, 15557,
+	15679, 15791, 15893, 15986, 16069, 16143, 16207, 16261, 16305, 16340, 16364, 16379, 16384
+};
+
+namespace vector3d {
+	int16_t sin(uint8_t angle)
+	{
+		const uint8_t quarter = angle & 0x3F;
+		int16_t value;
+		
+		// the second and the fourth quarter run backwards, the second half is negative
+		if (angle & 0x40) {
+			value = pgm_read_word(&_sin_table[64 - quarter]);
+		} else {
+			value = pgm_read_word(&_sin_table[quarter]);
+		}
+		return (angle & 0x80) ? -value : value;
+	}
+	
+	int16_t cos(uint8_t angle)
+	{
+		return sin(angle + 64);
+	}
+}
+
+namespace meshes {
+	static const int8_t _cube_points[8][3] PROGMEM = {
+		{-37, -37, -37}, {37, -37, -37}, {37, 37, -37}, {-37, 37, -37},
+		{-37, -37, 37}, {37, -37, 37}, {37, 37, 37}, {-37, 37, 37}
+	};
+	static const uint8_t _cube_edges[12][2] PROGMEM = {
+		{0, 1}, {1, 2}, {2, 3}, {3, 0},
+		{4, 5}, {5, 6}, {6, 7}, {7, 4},
+		{0, 4}, {1, 5}, {2, 6}, {3, 7}
+	};
+	const LedCubeMesh cube = {_cube_points, 8, _cube_edges, 12};
+	
+	static const int8_t _octahedron_points[6][3] PROGMEM = {
+		{64, 0, 0}, {-64, 0, 0}, {0, 64, 0}, {0, -64, 0}, {0, 0, 64}, {0, 0, -64}
+	};
+	static const uint8_t _octahedron_edges[12][2] PROGMEM = {
+		{0, 2}, {2, 1}, {1, 3}, {3, 0},
+		{0, 4}, {2, 4}, {1, 4}, {3, 4},
+		{0, 5}, {2, 5}, {1, 5}, {3, 5}
+	};
+	const LedCubeMesh octahedron = {_octahedron_points, 6, _octahedron_edges, 12};
+	
+	// tips on the axes (0-5), corners of a small inner cube (6-13), every tip joined to the 4 corners on its side
+	static const int8_t _star_points[14][3] PROGMEM = {
+		{64, 0, 0}, {-64, 0, 0}, {0, 64, 0}, {0, -64, 0}, {0, 0, 64}, {0, 0, -64},
+		{-20, -20, -20}, {20, -20, -20}, {20, 20, -20}, {-20, 20, -20},
+		{-20, -20, 20}, {20, -20, 20}, {20, 20, 20}, {-20, 20, 20}
+	};
+	static const uint8_t _star_edges[24][2] PROGMEM = {
+		{0, 7}, {0, 8}, {0, 11}, {0, 12},
+		{1, 6}, {1, 9}, {1, 10}, {1, 13},
+		{2, 8}, {2, 9}, {2, 12}, {2, 13},
+		{3, 6}, {3, 7}, {3, 10}, {3, 11},
+		{4, 10}, {4, 11}, {4, 12}, {4, 13},
+		{5, 6}, {5, 7}, {5, 8}, {5, 9}
+	};
+	const LedCubeMesh star = {_star_points, 14, _star_edges, 24};
+}
+
+LedCubeWireframe::LedCubeWireframe(LedCube * led_cube, const LedCubeMesh * mesh)
+	: _led_cube(led_cube), _mesh(mesh), _scale((led_cube->getSize() - 1) * 128),
+	_angle_x(0), _angle_y(0), _angle_z(0), _is_drawn(false), _last_draw_time(0)
+{
+	_x = _y = _z = (led_cube->getSize() - 1) * 128;
+	_points = new int8_t[mesh->num_points * 3];
+	_drawn = new int8_t[mesh->num_points * 3];
+	_makeMatrix();
+}
+
+LedCubeWireframe::~LedCubeWireframe()
+{
+	delete[] _points;
+	delete[] _drawn;
+}
+
+void LedCubeWireframe::setRotation(uint8_t angle_x, uint8_t angle_y, uint8_t angle_z)
+{
+	_angle_x = angle_x;
+	_angle_y = angle_y;
+	_angle_z = angle_z;
+	_makeMatrix();
+}
+
+void LedCubeWireframe::rotate(int8_t angle_x, int8_t angle_y, int8_t angle_z)
+{
+	setRotation(_angle_x + angle_x, _angle_y + angle_y, _angle_z + angle_z);
+}
+
+void LedCubeWireframe::setPosition(int16_t x, int16_t y, int16_t z)
+{
+	_x = x;
+	_y = y;
+	_z = z;
+}
+
+void LedCubeWireframe::setScale(int16_t scale)
+{
+	_scale = scale;
+	_makeMatrix();
+}
+
+void LedCubeWireframe::_makeMatrix()
+{
+	// R = Rz * Ry * Rx in Q14, then scaled to Q8.8 LEDs per unit
+	const long sx = vector3d::sin(_angle_x), cx = vector3d::cos(_angle_x);
+	const long sy = vector3d::sin(_angle_y), cy = vector3d::cos(_angle_y);
+	const long sz = vector3d::sin(_angle_z), cz = vector3d::cos(_angle_z);
+	const long sy_sx = (sy * sx) >> 14;
+	const long sy_cx = (sy * cx) >> 14;
+	const long rotation[9] = {
+		(cz * cy) >> 14, ((cz * sy_sx) >> 14) - ((sz * cx) >> 14), ((cz * sy_cx) >> 14) + ((sz * sx) >> 14),
+		(sz * cy) >> 14, ((sz * sy_sx) >> 14) + ((cz * cx) >> 14), ((sz * sy_cx) >> 14) - ((cz * sx) >> 14),
+		-sy, (cy * sx) >> 14, (cy * cx) >> 14
+	};
+	
+	for (uint8_t i = 0; i < 9; ++i) {
+		_matrix[i] = (rotation[i] * _scale) >> 14;
+	}
+}
+
+void LedCubeWireframe::transform()
+{
+	// Q8.8 * 1/64 => 1/16384 LED, the pivot and a half (rounding) are added in the same units
+	const long x0 = ((long)_x << 6) + 8192;
+	const long y0 = ((long)_y << 6) + 8192;
+	const long z0 = ((long)_z << 6) + 8192;
+	
+	for (uint8_t i = 0; i < _mesh->num_points; ++i) {
+		const int8_t px = pgm_read_byte(&_mesh->points[i][0]);
+		const int8_t py = pgm_read_byte(&_mesh->points[i][1]);
+		const int8_t pz = pgm_read_byte(&_mesh->points[i][2]);
+		const long coordinates[3] = {
+			x0 + (long)_matrix[0] * px + (long)_matrix[1] * py + (long)_matrix[2] * pz,
+			y0 + (long)_matrix[3] * px + (long)_matrix[4] * py + (long)_matrix[5] * pz,
+			z0 + (long)_matrix[6] * px + (long)_matrix[7] * py + (long)_matrix[8] * pz
+		};
+		
+		for (uint8_t axis = 0; axis < 3; ++axis) {
+			const long led = coordinates[axis] >> 14;
+			
+			_points[i * 3 + axis] = (led > 127) ? 127 : (led < -128) ? -128 : led;
+		}
+	}
+}
+
+void LedCubeWireframe::getPoint(uint8_t index, int &x, int &y, int &z)
+{
+	x = _points[index * 3];
+	y = _points[index * 3 + 1];
+	z = _points[index * 3 + 2];
+}
+
+void LedCubeWireframe::_drawEdges(const int8_t * points, int state)
+{
+	for (uint8_t i = 0; i < _mesh->num_edges; ++i) {
+		const int8_t * a = points + pgm_read_byte(&_mesh->edges[i][0]) * 3;
+		const int8_t * b = points + pgm_read_byte(&_mesh->edges[i][1]) * 3;
+		
+		raster::line(_led_cube, a[0], a[1], a[2], b[0], b[1], b[2], state);
+	}
+}
+
+void LedCubeWireframe::draw()
+{
+	const unsigned long start = micros();
+	
+	erase();
+	transform();
+	_drawEdges(_points, HIGH);
+	memcpy(_drawn, _points, _mesh->num_points * 3);
+	_is_drawn = true;
+	_last_draw_time = micros() - start;
+}
+
+void LedCubeWireframe::erase()
+{
+	if (_is_drawn) {
+		_drawEdges(_drawn, LOW);
+		_is_drawn = false;
+	}
+}
+
+bool LedCubeWireframe::archive(LedCubeArchive &archive)
+{
+	archive.field(_angle_x);
+	archive.field(_angle_y);
+	archive.field(_angle_z);
+	archive.field(_x);
+	archive.field(_y);
+	archive.field(_z);
+	archive.field(_scale);
+	archive.field(_is_drawn);
+	archive.bytes(_drawn, _mesh->num_points * 3);
+	if (archive.isLoading()) {
+		_makeMatrix();
+	}
+	return archive.isOk();
+}
+
+namespace sequences {
+	unsigned long Spin::operator()()
+	{
+		while (true) {
+			switch(_state) {
+				case 0:
+					_led_cube->turnEverythingOff();
+					_state += 1;
+				case 1:
+					if (_frames_cnt < _max_frames) {
+						_frames_cnt += 1;
+						_wireframe.draw();
+						_wireframe.rotate(_speed_x, _speed_y, _speed_z);
+						return _wait;
+					} else {
+						_state += 1;
+					}
+					break;
+				case 2:
+					_wireframe.erase();
+					_state += 1;
+					return _wait;
+				default:
+					return 0;
+			}
+		}
+	}
+	
+	bool Spin::archive(LedCubeArchive &archive)
+	{
+		_archiveState(archive);
+		archive.field(_frames_cnt);
+		return _wireframe.archive(archive);
+	}
+}
+
+// EOF
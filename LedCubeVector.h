@@ -0,0 +1,118 @@
+#ifndef _LED_CUBE_VECTOR_H
+#define _LED_CUBE_VECTOR_H
+
+#include "LedCube.h"
+
+/* Angles are 1/256 of a turn (64 => 90°, 32 => 45°, 96 => 135°), sin and cos are read from a quarter wave
+ * in PROGMEM (65 words) in Q14 (16384 => 1.0).
+ */
+namespace vector3d {
+	int16_t sin(uint8_t angle);
+	
+	int16_t cos(uint8_t angle);
+}
+
+/* Wireframe model: points in 1/64 of the unit (-127..127), the farthest point should be 1 unit (64) from the origin,
+ * so the model fits when it is scaled to the half of the cube; edges are pairs of indices of the points.
+ * Both arrays are in PROGMEM.
+ */
+struct LedCubeMesh
+{
+	const int8_t (*points)[3];
+	uint8_t num_points;
+	const uint8_t (*edges)[2];
+	uint8_t num_edges;
+};
+
+namespace meshes {
+	extern const LedCubeMesh cube; // 8 points, 12 edges
+	extern const LedCubeMesh octahedron; // 6 points, 12 edges
+	extern const LedCubeMesh star; // 14 points (6 tips around an inner cube), 24 edges
+}
+
+/* Draws a mesh rotated by any angle around the x, y and z axes (in this order) about a pivot, scaled and moved:
+ * - once per frame, the rotation matrix is made from 6 table lookups and scaled (3x3 in Q8.8 LEDs per unit)
+ * - every point costs 9 multiplications of 16 x 8 bits, it is rounded to the nearest LED
+ * - edges are drawn by raster::line(), the edges of the previous frame are erased first (only the LEDs of the model change)
+ * Positions are in Q8.8 LEDs (256 => 1 LED), the default pivot is the center of the cube.
+ * Memory: 6 B per point (this and the previous frame).
+ */
+class LedCubeWireframe
+{
+protected:
+	LedCube * _led_cube;
+	const LedCubeMesh * _mesh;
+	int16_t _matrix[9]; // Q8.8 LEDs per unit, row major
+	int16_t _x, _y, _z; // pivot [1/256 LED]
+	int16_t _scale; // [1/256 LED] per unit
+	uint8_t _angle_x, _angle_y, _angle_z;
+	int8_t * _points; // [num_points][3] of this frame
+	int8_t * _drawn; // [num_points][3] of the previous frame
+	bool _is_drawn;
+	unsigned long _last_draw_time; // [us]
+	
+	void _makeMatrix();
+	
+	void _drawEdges(const int8_t * points, int state);
+public:
+	LedCubeWireframe(LedCube * led_cube, const LedCubeMesh * mesh);
+	
+	LedCubeWireframe(const LedCubeWireframe &) = delete;
+	
+	LedCubeWireframe & operator=(const LedCubeWireframe &) = delete;
+	
+	~LedCubeWireframe();
+	
+	void setRotation(uint8_t angle_x, uint8_t angle_y, uint8_t angle_z);
+	
+	// adds to the angles (they wrap around)
+	void rotate(int8_t angle_x, int8_t angle_y, int8_t angle_z);
+	
+	// pivot [1/256 LED]
+	void setPosition(int16_t x, int16_t y, int16_t z);
+	
+	// size of the unit [1/256 LED], default the half of the cube: (size-1) * 128
+	void setScale(int16_t scale);
+	
+	// projects the points (without drawing), then getPoint() gives the LEDs
+	void transform();
+	
+	void getPoint(uint8_t index, int &x, int &y, int &z);
+	
+	// erases the previous frame, projects and draws this one
+	void draw();
+	
+	// erases the drawn frame
+	void erase();
+	
+	unsigned long getLastDrawTime() { return _last_draw_time; }
+	
+	// angles, pivot, scale and the drawn points (see LedCubeSnapshot.h)
+	bool archive(LedCubeArchive &archive);
+};
+
+namespace sequences {
+	// spins the mesh by speed_x, speed_y, speed_z (1/256 of a turn) per frame around the center of the cube
+	class Spin : public LedCubeSequence
+	{
+	protected:
+		LedCubeWireframe _wireframe;
+		const unsigned long _wait; // [ms]
+		const int _max_frames;
+		int _frames_cnt;
+		const int8_t _speed_x, _speed_y, _speed_z;
+	public:
+		Spin(LedCube * led_cube, const LedCubeMesh &mesh=meshes::cube, unsigned long wait=20, int max_frames=500, int8_t speed_x=2, int8_t speed_y=3, int8_t speed_z=1)
+			: LedCubeSequence(led_cube), _wireframe(led_cube, &mesh), _wait(wait), _max_frames(max_frames), _frames_cnt(0),
+			_speed_x(speed_x), _speed_y(speed_y), _speed_z(speed_z)
+		{}
+		
+		unsigned long operator()();
+		
+		bool archive(LedCubeArchive &archive);
+		
+		LedCubeWireframe & getWireframe() { return _wireframe; }
+	};
+}
+
+#endif // _LED_CUBE_VECTOR_H
@@ -0,0 +1,75 @@
+// Create by: Jan Doležal, 2020
+
+#include "LedCube.h"
+#include "LedCubeAudio.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+#define AUDIO_PIN 6 // A6 (e.g. Arduino Nano), A0 to A5 drive layers; the signal has to be biased to 2.5 V
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+LedCubeAnalogSource audio(AUDIO_PIN, 4000);
+
+// the audio is sampled by Timer1 (ATmega328P at 16 MHz: 16 MHz / 8 / 500 = 4 kHz), the visualizer takes whole blocks
+ISR(TIMER1_COMPA_vect)
+{
+	audio.sample();
+}
+
+class LedCubeManager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	
+	unsigned long run() {
+		unsigned long wait = 0;
+		
+		if (_led_cube->isSequenceRunning()) {
+			wait = _led_cube->nextFrameOfSequence();
+		} else {
+			_led_cube->setSequence(new sequences::AudioVisualizer(_led_cube, &audio, sequences::AudioVisualizer::COLUMNS));
+			wait = 1;
+		}
+		
+		return wait;
+	}
+
+public:
+	LedCubeManager(LedCube * led_cube)
+		: _led_cube(led_cube)
+	{
+		start(150);
+	}
+} led_cube_manager(&led_cube);
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	
+	audio.begin();
+	noInterrupts();
+	TCCR1A = 0;
+	TCCR1B = _BV(WGM12) | _BV(CS11); // CTC, clock / 8
+	TCNT1 = 0;
+	OCR1A = F_CPU / 8 / 4000 - 1;
+	TIMSK1 = _BV(OCIE1A);
+	interrupts();
+}
+
+void loop()
+{
+	VariableTimedAction::updateActions();
+}
+
+// EOF
@@ -0,0 +1,96 @@
+// Create by: Jan Doležal, 2020
+
+#include "LedCube.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+class LedCubeManager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	
+	unsigned long run() {
+		if (!_led_cube->isSequenceRunning()) {
+			_led_cube->setSequence(new sequences::Demo(_led_cube));
+		}
+		return _led_cube->nextFrameOfSequence();
+	}
+
+public:
+	LedCubeManager(LedCube * led_cube)
+		: _led_cube(led_cube)
+	{
+		start(150);
+	}
+} led_cube_manager(&led_cube);
+
+// the refresh rate chosen for the load of the demo and how steady it is
+class StatsReporter : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	
+	unsigned long run() {
+		const LedCubeRefreshStats stats = _led_cube->getRefreshStats();
+		
+		Serial.print(_led_cube->getRefreshFrequency());
+		Serial.print(F(" Hz (target "));
+		Serial.print(_led_cube->getTargetRefreshFrequency());
+		Serial.print(F(" Hz), period "));
+		Serial.print(stats.min_period);
+		Serial.print(F("/"));
+		Serial.print(stats.period);
+		Serial.print(F("/"));
+		Serial.print(stats.max_period);
+		Serial.print(F(" us, jitter "));
+		Serial.print(stats.jitter);
+		Serial.print(F(" us, layer "));
+		Serial.print(stats.time_for_layer);
+		Serial.print(F(" us + "));
+		Serial.print(stats.scan_overhead);
+		Serial.print(F(" us switching, longest gap "));
+		Serial.print(stats.max_gap);
+		Serial.println(F(" us"));
+		_led_cube->resetRefreshStats();
+		return 0;
+	}
+
+public:
+	StatsReporter(LedCube * led_cube)
+		: _led_cube(led_cube)
+	{
+		start(5000);
+	}
+} stats_reporter(&led_cube);
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	randomSeed(analogRead(10)); // seeding random for random pattern
+	
+	// 50-250 Hz, at least 200 us for every layer
+	led_cube.setAutoRefresh(true, 50, 250, 200);
+	
+	Serial.begin(9600);
+}
+
+void loop()
+{
+	VariableTimedAction::updateActions();
+}
+
+// EOF
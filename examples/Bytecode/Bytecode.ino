@@ -0,0 +1,139 @@
+// Create by: Jan Doležal, 2020
+
+/* Plays sequences written in bytecode (see LedCubeVM.h), so effects can be changed without reflashing:
+ * - layer_stomp.h is layer_stomp.lcasm assembled into PROGMEM (extras/host/lcasm.py layer_stomp.lcasm -c layer_stomp -o layer_stomp.h)
+ * - a program uploaded over the serial line is kept in the EEPROM and played after the built-in one
+ *   upload: 2 bytes of length (little endian) followed by the bytecode (lcasm.py program.lcasm -o program.bin)
+ */
+
+#include <avr/eeprom.h>
+
+#include "LedCube.h"
+#include "LedCubeVM.h"
+
+#include "layer_stomp.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+#define EEPROM_PROGRAM ((const uint8_t *)2) // address 0 and 1 hold the length of the program
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+bool hasEepromProgram()
+{
+	const uint16_t length = eeprom_read_word((const uint16_t *)0);
+	return length != 0 && length != 0xFFFF && length <= E2END - 1;
+}
+
+class LedCubeManager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	int _state;
+	
+	unsigned long run() {
+		unsigned long wait = 0;
+		
+		if (_led_cube->isSequenceRunning()) {
+			wait = _led_cube->nextFrameOfSequence();
+		} else {
+			do {
+				_state += 1;
+				switch(_state) {
+					case 1:
+						_led_cube->setSequence(new sequences::Program(_led_cube, layer_stomp, vm::FROM_PROGMEM));
+						wait = 500;
+						break;
+					case 2:
+						if (hasEepromProgram()) {
+							_led_cube->setSequence(new sequences::Program(_led_cube, EEPROM_PROGRAM, vm::FROM_EEPROM));
+							wait = 500;
+							break;
+						}
+					default:
+						_state = 0;
+				}
+			} while (_state == 0);
+		}
+		
+		return wait;
+	}
+
+public:
+	LedCubeManager(LedCube * led_cube)
+		: _led_cube(led_cube), _state(0)
+	{
+		start(150);
+	}
+} led_cube_manager(&led_cube);
+
+// receives a program into the EEPROM (the running sequence is stopped, it could be the one being overwritten)
+class ProgramReceiver
+{
+private:
+	uint16_t _length;
+	uint16_t _received;
+	int _header;
+public:
+	ProgramReceiver() : _length(0), _received(0), _header(0) {}
+	
+	void update()
+	{
+		while (Serial.available() > 0) {
+			const uint8_t b = Serial.read();
+			if (_header < 2) {
+				_length |= (uint16_t)b << (8 * _header);
+				_header += 1;
+				if (_header == 2) {
+					if (_length == 0 || _length > E2END - 1) {
+						Serial.println(F("program too long"));
+						_length = 0;
+						_header = 0;
+					} else {
+						led_cube.stopCurrentSequence();
+						eeprom_update_word((uint16_t *)0, 0);
+					}
+				}
+			} else {
+				eeprom_update_byte((uint8_t *)EEPROM_PROGRAM + _received, b);
+				_received += 1;
+				if (_received == _length) {
+					eeprom_update_word((uint16_t *)0, _length);
+					Serial.print(F("program stored: "));
+					Serial.print(_length);
+					Serial.println(F(" bytes"));
+					_length = 0;
+					_received = 0;
+					_header = 0;
+				}
+			}
+		}
+	}
+} program_receiver;
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	
+	Serial.begin(9600);
+}
+
+void loop()
+{
+	program_receiver.update();
+	VariableTimedAction::updateActions();
+}
+
+// EOF
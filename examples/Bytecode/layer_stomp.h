@@ -0,0 +1,9 @@
+// generated by extras/host/lcasm.py, 94 bytes
+const uint8_t layer_stomp[] PROGMEM = {
+	0x02, 0x00, 0x01, 0x4B, 0x00, 0x07, 0x05, 0x0A, 0xF0, 0x00, 0x05, 0x02, 0xF0, 0x01, 0x01, 0x4B,
+	0x00, 0x07, 0x02, 0x07, 0xFE, 0x05, 0x02, 0xF0, 0x00, 0x0B, 0xF0, 0x01, 0x05, 0x02, 0xF0, 0x01,
+	0x01, 0x4B, 0x00, 0x08, 0x01, 0x4B, 0x00, 0x07, 0xFE, 0x05, 0x02, 0xF0, 0x00, 0x0C, 0xF0, 0x01,
+	0x05, 0x02, 0xF0, 0x01, 0x01, 0x4B, 0x00, 0x08, 0x01, 0x4B, 0x00, 0x08, 0x07, 0xFE, 0x0B, 0xF0,
+	0x01, 0x05, 0x02, 0xF0, 0x01, 0x01, 0x4B, 0x00, 0x08, 0x01, 0x4B, 0x00, 0x07, 0xFF, 0x05, 0x02,
+	0xF0, 0x00, 0x0C, 0xF0, 0x01, 0x01, 0x4B, 0x00, 0x08, 0x01, 0x4B, 0x00, 0x08, 0x00,
+};
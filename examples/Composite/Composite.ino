@@ -0,0 +1,88 @@
+// Create by: Jan Doležal, 2020
+
+#include "LedCube.h"
+#include "LedCubeComposite.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+// status LED in the top corner, inverts whatever the animation shows there
+class Heartbeat : public LedCubeSequence
+{
+public:
+	Heartbeat(LedCube * led_cube)
+		: LedCubeSequence(led_cube)
+	{}
+	
+	unsigned long operator()()
+	{
+		const int last = _led_cube->getSize() - 1;
+		
+		_state = !_state;
+		if (_state) {
+			_led_cube->turnOn(last, last, last);
+			return 100;
+		}
+		_led_cube->turnOff(last, last, last);
+		return 900;
+	}
+};
+
+class LedCubeManager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	sequences::Composite * _composite; // owned by the cube while it plays
+	
+	unsigned long run() {
+		if (_led_cube->isSequenceRunning()) {
+			const unsigned long wait = _led_cube->nextFrameOfSequence();
+			if (wait != 0 && _composite->getLastCompositeTime() == _composite->getMaxCompositeTime() && _composite->getMaxCompositeTime() > 0) {
+				Serial.print(F("longest compositing: "));
+				Serial.print(_composite->getMaxCompositeTime());
+				Serial.println(F(" us"));
+			}
+			return wait;
+		}
+		
+		_composite = new sequences::Composite(_led_cube);
+		_composite->addLayer(new sequences::Demo(_led_cube));
+		_composite->addLayer(new Heartbeat(_led_cube), composite::XOR);
+		_led_cube->setSequence(_composite);
+		return 500;
+	}
+
+public:
+	LedCubeManager(LedCube * led_cube)
+		: _led_cube(led_cube), _composite(nullptr)
+	{
+		start(150);
+	}
+} led_cube_manager(&led_cube);
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	
+	Serial.begin(9600);
+}
+
+void loop()
+{
+	VariableTimedAction::updateActions();
+}
+
+// EOF
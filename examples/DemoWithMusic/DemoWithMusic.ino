@@ -5,6 +5,7 @@
 synth synthesizer;
 
 #include "LedCube.h"
+#include "LedCubeTimeline.h"
 #include "notes.h"
 #include "song.h"
 
@@ -19,6 +20,13 @@ int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led
 
 LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
 
+#define BPM 120 // beats per minute
+#define TICKS_PER_BEAT 24
+#define TICKS_PER_WHOLE_NOTE (4 * TICKS_PER_BEAT)
+
+// the song and the sequences are scheduled against the same clock, so they do not drift apart
+LedCubeTimeline timeline(BPM, TICKS_PER_BEAT);
+
 class LedCubeManager : public VariableTimedAction
 {
 private:
@@ -41,7 +49,7 @@ private:
 				_state += 1;
 				switch(_state) {
 					case 1:
- 						_led_cube->setSequence(new sequences::Demo(_led_cube));
+ 						_led_cube->setSequence(new sequences::BeatSync(_led_cube, new sequences::Demo(_led_cube)));
 						wait = 500;
 						break;
 					default:
@@ -66,9 +74,13 @@ class MusicManager : public VariableTimedAction
 {
 private:
 	int thisNote = 0;
+	unsigned long tick = 0; // start of the current note on the timeline
+	
 	unsigned long run() {
-		int bpm = 120; // beats per minute
-		int noteDuration = 60000 / bpm * 4 / noteDurations[thisNote];
+		if (tick == 0) {
+			// the song starts the clock (before the first sequence of the cube)
+			timeline.start();
+		}
 		
 		if(melody[thisNote]<=NOTE_E4) {
 			synthesizer.mTrigger(1, melody[thisNote]+32);
@@ -76,12 +88,13 @@ private:
 			synthesizer.mTrigger(0, melody[thisNote]+32);
 		}
 		
+		tick += TICKS_PER_WHOLE_NOTE / noteDurations[thisNote];
 		thisNote += 1;
 		if (thisNote >= melody_length) {
 			thisNote = 0;
 		}
 		
-		return noteDuration;
+		return timeline.untilTick(tick);
 	}
 
 public:
@@ -103,6 +116,8 @@ void setup()
 		p_led_cube_map[l] = led_cube_map[l];
 	}
 	randomSeed(analogRead(10)); // seeding random for random pattern
+	
+	led_cube.setTimeline(&timeline);
 }
 
 void loop()
@@ -0,0 +1,88 @@
+// Create by: Jan Doležal, 2020
+// Plays sequences::MatrixRain with the automatic refresh and a frame budget: its frames are split at the end of the budget
+// (or with LOWER_DETAIL fewer drops fall), so the refresh keeps its highest rate. Every 5 s it prints the budget,
+// the overruns and the frames split since the start of the sequence.
+
+#include "LedCube.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+#define BUDGET_POLICY LedCube::SPLIT_WORK // COUNT_ONLY, SPLIT_WORK, DEFER_FRAME, LOWER_DETAIL
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+class LedCubeManager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	
+	unsigned long run() {
+		if (!_led_cube->isSequenceRunning()) {
+			_led_cube->setSequence(new sequences::MatrixRain(_led_cube), playlist::MATRIX_RAIN);
+		}
+		return _led_cube->nextFrameOfSequence();
+	}
+
+public:
+	LedCubeManager(LedCube * led_cube)
+		: _led_cube(led_cube)
+	{
+		start(150);
+	}
+} led_cube_manager(&led_cube);
+
+class BudgetReporter : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	
+	unsigned long run() {
+		Serial.print(_led_cube->getRefreshFrequency());
+		Serial.print(F(" Hz, budget "));
+		Serial.print(_led_cube->getFrameBudget());
+		Serial.print(F(" us, overruns "));
+		Serial.print(_led_cube->getBudgetOverruns());
+		Serial.print(F(", split "));
+		Serial.print(_led_cube->getSplitFrames());
+		Serial.print(F(", detail "));
+		Serial.println(_led_cube->getDetail());
+		return 0;
+	}
+
+public:
+	BudgetReporter(LedCube * led_cube)
+		: _led_cube(led_cube)
+	{
+		start(5000);
+	}
+} budget_reporter(&led_cube);
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	randomSeed(analogRead(10)); // seeding random for random pattern
+	
+	// 50-250 Hz, at least 200 us for every layer, the budget follows from it
+	led_cube.setAutoRefresh(true, 50, 250, 200);
+	led_cube.setBudgetPolicy(BUDGET_POLICY);
+	
+	Serial.begin(9600);
+}
+
+void loop()
+{
+	VariableTimedAction::updateActions();
+}
+
+// EOF
@@ -0,0 +1,132 @@
+// Create by: Jan Doležal, 2020
+
+#include "LedCube.h"
+#include "LedCubeInput.h"
+
+/* A cursor moved by two buttons (to GND) and a joystick:
+ * button on pin 3 (interrupt) moves it along x, button on pin 11 along z, the joystick on A6 (Nano) sets y.
+ */
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+const uint8_t button_pins[] = {3, 11};
+const uint8_t axis_pins[] = {A6};
+LedCubeInput led_cube_input(&led_cube, button_pins, 2, axis_pins, 1);
+
+void onButton()
+{
+	led_cube_input.capture();
+}
+
+class Cursor : public LedCubeSequence
+{
+protected:
+	LedCubeInput * _input;
+	int _x;
+	int _y;
+	int _z;
+	
+public:
+	Cursor(LedCube * led_cube, LedCubeInput * input)
+		: LedCubeSequence(led_cube), _input(input), _x(0), _y(input->getAxis(0) * SIZE / 1024), _z(0)
+	{}
+	
+	unsigned long operator()()
+	{
+		LedCubeInputEvent event;
+		
+		while (_input->read(event)) {
+			if (event.type == input::MOVE) {
+				_y = event.value * SIZE / 1024;
+			} else if (event.type == input::PRESS) {
+				if (event.source == 0) {
+					_x = (_x + 1) % SIZE;
+				} else {
+					_z = (_z + 1) % SIZE;
+				}
+			}
+		}
+		_led_cube->turnEverythingOff();
+		_led_cube->turnOn(_x, _y, _z);
+		// a short wait, so the next event is shown soon
+		return 2;
+	}
+};
+
+class LedCubeManager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	
+	unsigned long run() {
+		if (!_led_cube->isSequenceRunning()) {
+			_led_cube->setSequence(new Cursor(_led_cube, &led_cube_input));
+		}
+		return _led_cube->nextFrameOfSequence();
+	}
+
+public:
+	LedCubeManager(LedCube * led_cube)
+		: _led_cube(led_cube)
+	{
+		start(1);
+	}
+} led_cube_manager(&led_cube);
+
+// input to photon latency
+class LatencyReporter : public VariableTimedAction
+{
+private:
+	LedCubeInput * _input;
+	
+	unsigned long run() {
+		Serial.print(_input->getLatencies());
+		Serial.print(F(" events shown, latency "));
+		Serial.print(_input->getAverageLatency());
+		Serial.print(F(" us average, "));
+		Serial.print(_input->getMaxLatency());
+		Serial.print(F(" us at most, "));
+		Serial.print(_input->getBounces());
+		Serial.println(F(" bounces ignored"));
+		return 0;
+	}
+
+public:
+	LatencyReporter(LedCubeInput * input)
+		: _input(input)
+	{
+		start(5000);
+	}
+} latency_reporter(&led_cube_input);
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	
+	// a fast refresh with short scans shows the input soon
+	led_cube.setAutoRefresh(true, 50, 200, 200);
+	attachInterrupt(digitalPinToInterrupt(3), onButton, CHANGE);
+	
+	Serial.begin(9600);
+}
+
+void loop()
+{
+	VariableTimedAction::updateActions();
+}
+
+// EOF
@@ -0,0 +1,77 @@
+// Create by: Jan Doležal, 2020
+// Measures one generation of the 3D game of life on 4x4x4, 8x8x8 and 16x16x16 (16x16x16 needs ~1.4 kB of RAM, e.g. Arduino Mega), then plays it.
+
+#include "LedCube.h"
+#include "LedCubeLife.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+void measure(int size)
+{
+	const int generations = 50;
+	unsigned long total = 0;
+	LedCubeLife * life = new LedCubeLife(size, life3d::amoeba);
+	
+	life->randomize(64);
+	for (int i = 0; i < generations; ++i) {
+		const unsigned long start = micros();
+		life->step();
+		total += micros() - start;
+	}
+	
+	Serial.print(size);
+	Serial.print(F("x"));
+	Serial.print(size);
+	Serial.print(F("x"));
+	Serial.print(size);
+	Serial.print(F(": "));
+	Serial.print(total / generations);
+	Serial.print(F(" us, "));
+	Serial.print(total / generations * (F_CPU / 1000000UL));
+	Serial.print(F(" cycles per generation, "));
+	Serial.print(total * (F_CPU / 1000000UL) / generations / ((unsigned long)size * size * size));
+	Serial.println(F(" cycles per cell"));
+	delete life;
+}
+
+
+
+
+void setup()
+{
+	Serial.begin(9600);
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	randomSeed(analogRead(10)); // seeding random for random pattern
+	
+	measure(4);
+	measure(8);
+	measure(16);
+	
+	led_cube.setSequence(new sequences::Life3D(&led_cube, life3d::bays_4555));
+}
+
+void loop()
+{
+	static unsigned long next_frame = 0;
+	
+	if (!led_cube.isSequenceRunning()) {
+		led_cube.setSequence(new sequences::Life3D(&led_cube, life3d::bays_4555));
+	}
+	if (millis() >= next_frame) {
+		next_frame = millis() + led_cube.nextFrameOfSequence();
+	}
+	VariableTimedAction::updateActions();
+}
+
+// EOF
@@ -0,0 +1,83 @@
+// Create by: Jan Doležal, 2020
+// Measures the time of one frame of the particle engine with 16, 64 and 256 particles (256 particles need ~3 kB of RAM, e.g. Arduino Mega).
+
+#include "LedCube.h"
+#include "LedCubeParticles.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+// slowly wandering particles which live long enough to keep the pool full
+const LedCubeParticleEmitter swarm = {LedCubeParticleEmitter::random_pos, LedCubeParticleEmitter::random_pos, LedCubeParticleEmitter::random_pos, 0, 0, 0, 1, 1, 0, 255, 255, 0, 0, 0};
+
+void measure(LedCubeParticles * particles)
+{
+	const int frames = 100;
+	unsigned long total = 0;
+	unsigned long worst = 0;
+	
+	if (particles == nullptr) {
+		Serial.println(F("not enough memory"));
+		return;
+	}
+	
+	led_cube.turnEverythingOff();
+	particles->emit(particles->getCapacity());
+	for (int i = 0; i < frames; ++i) {
+		particles->step(false);
+		total += particles->getLastStepTime();
+		if (particles->getLastStepTime() > worst) {
+			worst = particles->getLastStepTime();
+		}
+	}
+	
+	Serial.print(particles->getCapacity());
+	Serial.print(F(" particles: mean "));
+	Serial.print(total / frames);
+	Serial.print(F(" us, max "));
+	Serial.print(worst);
+	Serial.println(F(" us per frame"));
+}
+
+void setup()
+{
+	Serial.begin(9600);
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	randomSeed(analogRead(10)); // seeding random for random pattern
+	
+	LedCubeParticlePool<16> * pool16 = new LedCubeParticlePool<16>(&led_cube, &swarm);
+	measure(pool16);
+	delete pool16;
+	
+	LedCubeParticlePool<64> * pool64 = new LedCubeParticlePool<64>(&led_cube, &swarm);
+	measure(pool64);
+	delete pool64;
+	
+	LedCubeParticlePool<256> * pool256 = new LedCubeParticlePool<256>(&led_cube, &swarm);
+	measure(pool256);
+	delete pool256;
+	
+	led_cube.setSequence(new sequences::ParticleShow<32>(&led_cube, particles::fountain));
+}
+
+void loop()
+{
+	static unsigned long next_frame = 0;
+	
+	if (led_cube.isSequenceRunning() && millis() >= next_frame) {
+		next_frame = millis() + led_cube.nextFrameOfSequence();
+	}
+	VariableTimedAction::updateActions();
+}
+
+// EOF
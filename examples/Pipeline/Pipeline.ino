@@ -0,0 +1,98 @@
+// Create by: Jan Doležal, 2020
+
+#include "LedCube.h"
+#include "LedCubePipeline.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+// 4 frames ahead, the first frame 100 ms after the start
+LedCubePipeline pipeline(&led_cube, 4, 100);
+
+// consumer: shows the frames of the pipeline on time (could be a timer interrupt as well)
+class LedCubePresenter : public VariableTimedAction
+{
+private:
+	LedCubePipeline * _pipeline;
+	
+	unsigned long run() {
+		_pipeline->present();
+		return 0;
+	}
+
+public:
+	LedCubePresenter(LedCubePipeline * pipeline)
+		: _pipeline(pipeline)
+	{
+		start(1);
+	}
+} led_cube_presenter(&pipeline);
+
+class StatsReporter : public VariableTimedAction
+{
+private:
+	LedCubePipeline * _pipeline;
+	
+	unsigned long run() {
+		Serial.print(F("queued "));
+		Serial.print(_pipeline->getQueued());
+		Serial.print(F("/"));
+		Serial.print(_pipeline->getDepth());
+		Serial.print(F(", lead "));
+		Serial.print(_pipeline->getLead());
+		Serial.print(F(" ms (min "));
+		Serial.print(_pipeline->getMinLead());
+		Serial.print(F(" ms), underruns "));
+		Serial.print(_pipeline->getUnderruns());
+		Serial.print(F(", dropped "));
+		Serial.print(_pipeline->getDropped());
+		Serial.print(F(", max late "));
+		Serial.print(_pipeline->getMaxLate());
+		Serial.println(F(" ms"));
+		return 0;
+	}
+
+public:
+	StatsReporter(LedCubePipeline * pipeline)
+		: _pipeline(pipeline)
+	{
+		start(5000);
+	}
+} stats_reporter(&pipeline);
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	
+	Serial.begin(9600);
+	
+	// produce() computes a heavy frame in pieces between the refreshes and present(), the frames queued before it
+	// are shown on time meanwhile (whole frames would stop the refresh until they are done)
+	led_cube.setBudgetPolicy(LedCube::SPLIT_WORK);
+}
+
+void loop()
+{
+	VariableTimedAction::updateActions();
+	
+	// producer: computes frames ahead in the time left, at most a frame budget per pass
+	if (!pipeline.isRunning()) {
+		pipeline.setSequence(new sequences::MatrixRain(&led_cube));
+	}
+	pipeline.produce();
+}
+
+// EOF
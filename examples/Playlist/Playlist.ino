@@ -0,0 +1,81 @@
+// Create by: Jan Doležal, 2020
+
+#include "LedCube.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+// sequence, wait [ms] (0 => default), repeats (0 => default), gap before the sequence [ms]
+const playlist::Entry my_playlist[] PROGMEM = {
+	{playlist::TURN_EVERYTHING_OFF, 0, 0, 0},
+	{playlist::SPIRAL_IN_AND_OUT, 40, 3, 0},
+	{playlist::AROUND_EDGE_DOWN, 0, 0, 0},
+	{playlist::GO_THROUGH_ALL_LEDS, 10, 2, 0},
+	{playlist::RANDOM_RAIN, 80, 20, 250},
+	{playlist::PAUSE, 0, 0, 1000},
+	{playlist::END, 0, 0, 0}
+};
+
+class LedCubeManager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	sequences::Playlist * _playlist; // owned by the cube while it plays
+	unsigned long _reported_switches;
+	
+	unsigned long run() {
+		if (_led_cube->isSequenceRunning()) {
+			const unsigned long wait = _led_cube->nextFrameOfSequence();
+			// the playlist is deleted by the cube after its last frame
+			if (wait != 0 && _playlist->getSwitches() != _reported_switches) {
+				_reported_switches = _playlist->getSwitches();
+				Serial.print(F("switch "));
+				Serial.print(_reported_switches);
+				Serial.print(F(": "));
+				Serial.print(_playlist->getLastSwitchTime());
+				Serial.print(F(" us, constructed on switch: "));
+				Serial.println(_playlist->getUnpreparedSwitches());
+			}
+			return wait;
+		}
+		
+		_playlist = new sequences::Playlist(_led_cube, my_playlist);
+		_reported_switches = 0;
+		_led_cube->setSequence(_playlist);
+		return 500;
+	}
+
+public:
+	LedCubeManager(LedCube * led_cube)
+		: _led_cube(led_cube), _playlist(nullptr), _reported_switches(0)
+	{
+		start(150);
+	}
+} led_cube_manager(&led_cube);
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	
+	Serial.begin(9600);
+}
+
+void loop()
+{
+	VariableTimedAction::updateActions();
+}
+
+// EOF
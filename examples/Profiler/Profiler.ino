@@ -0,0 +1,63 @@
+// Create by: Jan Doležal, 2020
+// Plays sequences::Demo with the profiler of sequences and prints its table every 10 s (in pieces which fit the free part
+// of the serial buffer, so the refresh never waits for the line). Columns: type frames min mean max [us] writes per frame misses.
+
+#include "LedCube.h"
+#include "LedCubeProfiler.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+#define DUMP_PERIOD 10000 // [ms]
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+LedCubeProfiler profiler(&led_cube);
+
+
+
+
+void setup()
+{
+	Serial.begin(115200);
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	randomSeed(analogRead(10)); // seeding random for random pattern
+	
+	led_cube.setProfiler(&profiler);
+}
+
+void loop()
+{
+	static unsigned long next_frame = 0;
+	static unsigned long next_dump = DUMP_PERIOD;
+	static bool is_dumping = false;
+	
+	if (!led_cube.isSequenceRunning()) {
+		led_cube.setSequence(new sequences::Demo(&led_cube), profiler::PLAYLIST);
+	}
+	if (millis() >= next_frame) {
+		next_frame = millis() + led_cube.nextFrameOfSequence();
+	}
+	
+	if (!is_dumping && millis() >= next_dump) {
+		next_dump += DUMP_PERIOD;
+		profiler.startDump();
+		is_dumping = true;
+	}
+	if (is_dumping) {
+		const int free = Serial.availableForWrite();
+		
+		if (free > 0 && profiler.dump(Serial, (free < 255) ? free : 255)) {
+			is_dumping = false;
+		}
+	}
+	VariableTimedAction::updateActions();
+}
+
+// EOF
@@ -0,0 +1,74 @@
+// Create by: Jan Doležal, 2020
+
+#include "LedCube.h"
+#include "LedCubeText.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+const char message[] PROGMEM = "Hello LED cube!";
+
+class LedCubeManager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	int _state;
+	
+	unsigned long run() {
+		unsigned long wait = 0;
+		
+		if (_led_cube->isSequenceRunning()) {
+			wait = _led_cube->nextFrameOfSequence();
+		} else {
+			do {
+				_state += 1;
+				switch(_state) {
+					case 1:
+						_led_cube->setSequence(new sequences::ScrollText(_led_cube, message, sequences::ScrollText::AROUND, 120, 1, true));
+						wait = 500;
+						break;
+					case 2:
+						_led_cube->setSequence(new sequences::ScrollText(_led_cube, "12:34", sequences::ScrollText::THROUGH, 150));
+						wait = 500;
+						break;
+					default:
+						_state = 0;
+				}
+			} while (_state == 0);
+		}
+		
+		return wait;
+	}
+
+public:
+	LedCubeManager(LedCube * led_cube)
+		: _led_cube(led_cube), _state(0)
+	{
+		start(150);
+	}
+} led_cube_manager(&led_cube);
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+}
+
+void loop()
+{
+	VariableTimedAction::updateActions();
+}
+
+// EOF
@@ -0,0 +1,86 @@
+// Create by: Jan Doležal, 2020
+// Measures the time of one frame of every built-in field (LedCubeField.h), then plays them one after another (a frame every 40 ms).
+
+#include "LedCube.h"
+#include "LedCubeField.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+#define FRAME_PERIOD 40 // [ms]
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+LedCubeField * makeField(int index)
+{
+	switch (index) {
+		case 0:
+			return new fields::Plane(&led_cube);
+		case 1:
+			return new fields::Wave(&led_cube);
+		case 2:
+			return new fields::Ripple(&led_cube);
+		default:
+			return new fields::Plasma(&led_cube);
+	}
+}
+
+void measure(const char * name, LedCubeField * field)
+{
+	const int frames = 100;
+	unsigned long total = 0;
+	
+	for (int i = 0; i < frames; ++i) {
+		field->draw(i);
+		total += field->getLastDrawTime();
+	}
+	
+	Serial.print(name);
+	Serial.print(F(": mean "));
+	Serial.print(total / frames);
+	Serial.print(F(" us, max "));
+	Serial.print(field->getMaxDrawTime());
+	Serial.print(F(" us per frame ("));
+	Serial.print(field->getMaxDrawTime() * 100 / (FRAME_PERIOD * 1000UL));
+	Serial.println(F(" % of the frame period)"));
+	delete field;
+}
+
+
+
+
+void setup()
+{
+	Serial.begin(9600);
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	
+	measure("plane", makeField(0));
+	measure("wave", makeField(1));
+	measure("ripple", makeField(2));
+	measure("plasma", makeField(3));
+	led_cube.turnEverythingOff();
+}
+
+void loop()
+{
+	static unsigned long next_frame = 0;
+	static int index = 0;
+	
+	if (!led_cube.isSequenceRunning()) {
+		led_cube.setSequence(new sequences::Shader(&led_cube, makeField(index), FRAME_PERIOD, 300, 2));
+		index = (index + 1) % 4;
+	}
+	if (millis() >= next_frame) {
+		next_frame = millis() + led_cube.nextFrameOfSequence();
+	}
+	VariableTimedAction::updateActions();
+}
+
+// EOF
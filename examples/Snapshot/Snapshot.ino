@@ -0,0 +1,96 @@
+// Create by: Jan Doležal, 2020
+// Plays sequences::Demo and saves where it is into the EEPROM every minute (LedCubeSnapshot), after a reset or a power cut
+// it goes on from the last save instead of from the start. The saves take turns in 4 slots and only changed bytes are
+// written: a cell of the EEPROM (about 100 000 writes) is written at most every 4 minutes, which lasts for more than
+// half a year of playing day and night (a longer SAVE_INTERVAL lasts longer). A save cut off by a power cut is ignored
+// and the one before it is loaded.
+// Note: every save seeds random() anew, so the random parts of the show after a save differ from the ones a run without
+// saves would have (the restored show repeats the saved one exactly).
+
+#include "LedCube.h"
+#include "LedCubeSnapshot.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+#define SAVE_INTERVAL 60000 // [ms]
+#define EEPROM_ADDRESS 0
+#define EEPROM_SLOTS 4 // 4 * (6 + 192) B of the EEPROM
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+LedCubeSnapshot snapshot(&led_cube, 192); // sequences::Demo on 4x4x4 needs 168 B
+
+class LedCubeManager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	
+	unsigned long run() {
+		if (!_led_cube->isSequenceRunning()) {
+			_led_cube->setSequence(new sequences::Demo(_led_cube));
+		}
+		return _led_cube->nextFrameOfSequence();
+	}
+
+public:
+	LedCubeManager(LedCube * led_cube)
+		: _led_cube(led_cube)
+	{
+		start(150);
+	}
+} led_cube_manager(&led_cube);
+
+class SnapshotSaver : public VariableTimedAction
+{
+private:
+	LedCubeSnapshot * _snapshot;
+	
+	unsigned long run() {
+		// between two frames, a save refused (e.g. during a transition) is tried again in a second
+		if (!_snapshot->save()) {
+			return 1000;
+		}
+		_snapshot->saveToEeprom(EEPROM_ADDRESS, EEPROM_SLOTS);
+		Serial.print(F("saved "));
+		Serial.print(_snapshot->getLength());
+		Serial.println(F(" B"));
+		return SAVE_INTERVAL;
+	}
+
+public:
+	SnapshotSaver(LedCubeSnapshot * snapshot)
+		: _snapshot(snapshot)
+	{
+		start(SAVE_INTERVAL);
+	}
+} snapshot_saver(&snapshot);
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	randomSeed(analogRead(10)); // seeding random for random pattern
+	
+	Serial.begin(9600);
+	
+	// the sequence as it was at the last save (constructed with the same parameters), else the manager starts a new one
+	if (snapshot.loadFromEeprom(EEPROM_ADDRESS, EEPROM_SLOTS) && snapshot.restore(new sequences::Demo(&led_cube))) {
+		Serial.println(F("restored"));
+	}
+}
+
+void loop()
+{
+	VariableTimedAction::updateActions();
+}
+
+// EOF
@@ -0,0 +1,110 @@
+// Create by: Jan Doležal, 2020
+
+/* Plays animations recorded into files on the SD card (format: LedCubeStream.h, recorder: extras/host/stream_bench.cpp),
+ * falls back to the built-in demo when the card is missing.
+ * Note: pins of the SD card (SPI and CS) must not collide with the pins of the cube,
+ * with the default pins below use a board with SPI elsewhere (Arduino Mega: 50-53).
+ */
+
+#include <SD.h>
+
+#include "LedCube.h"
+#include "LedCubeStream.h"
+#include "LedCubeStorageSD.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+#define SD_CS_PIN 53
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+const char * const files[] = {"demo.lca", "rain.lca", "text.lca"};
+const int num_files = sizeof(files) / sizeof(files[0]);
+
+class LedCubeManager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	int _file_index;
+	File _file;
+	LedCubeStorageSD * _storage;
+	sequences::Stream<64, 32> * _player; // owned by the cube while it plays
+	unsigned long _reported_underruns;
+	
+	void _close()
+	{
+		_player = nullptr;
+		delete _storage;
+		_storage = nullptr;
+		if (_file) {
+			_file.close();
+		}
+	}
+	
+	unsigned long run() {
+		if (_led_cube->isSequenceRunning()) {
+			const unsigned long wait = _led_cube->nextFrameOfSequence();
+			// the player is deleted by the cube after its last frame
+			if (wait != 0 && _player && _player->getUnderruns() != _reported_underruns) {
+				_reported_underruns = _player->getUnderruns();
+				Serial.print(F("underrun, the frame waited "));
+				Serial.print(_player->getFrameStall());
+				Serial.println(F(" us for the card"));
+			}
+			return wait;
+		}
+		
+		_close();
+		for (int tries = 0; tries < num_files; ++tries) {
+			_file_index = (_file_index + 1) % num_files;
+			_file = SD.open(files[_file_index]);
+			if (_file) {
+				Serial.println(files[_file_index]);
+				_storage = new LedCubeStorageSD(_file);
+				_player = new sequences::Stream<64, 32>(_led_cube, _storage);
+				_reported_underruns = 0;
+				_led_cube->setSequence(_player);
+				return 500;
+			}
+		}
+		
+		_led_cube->setSequence(new sequences::Demo(_led_cube));
+		return 500;
+	}
+
+public:
+	LedCubeManager(LedCube * led_cube)
+		: _led_cube(led_cube), _file_index(-1), _storage(nullptr), _player(nullptr), _reported_underruns(0)
+	{
+		start(150);
+	}
+} led_cube_manager(&led_cube);
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	
+	Serial.begin(9600);
+	if (!SD.begin(SD_CS_PIN)) {
+		Serial.println(F("no SD card"));
+	}
+}
+
+void loop()
+{
+	VariableTimedAction::updateActions();
+}
+
+// EOF
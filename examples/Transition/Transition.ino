@@ -0,0 +1,66 @@
+// Create by: Jan Doležal, 2020
+
+#include "LedCube.h"
+#include "LedCubeTransition.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+class LedCubeManager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	int _round;
+	
+	unsigned long run() {
+		if (_led_cube->isSequenceRunning()) {
+			return _led_cube->nextFrameOfSequence();
+		}
+		
+		LedCubeSequence * sequence;
+		if (_round % 2 == 0) {
+			// two running sequences: the rain dissolves into the propeller within 1.5 s
+			sequence = new sequences::Transition(_led_cube, new sequences::RandomRain(_led_cube, 80), new sequences::Propeller(_led_cube), 1500, transition::DISSOLVE);
+		} else {
+			// the demo with a short crossfade at every switch instead of the cuts
+			sequences::Demo * demo = new sequences::Demo(_led_cube);
+			demo->setTransition(transition::CROSSFADE, 400, 10);
+			sequence = demo;
+		}
+		_round += 1;
+		_led_cube->setSequence(sequence);
+		return 500;
+	}
+
+public:
+	LedCubeManager(LedCube * led_cube)
+		: _led_cube(led_cube), _round(0)
+	{
+		start(150);
+	}
+} led_cube_manager(&led_cube);
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+}
+
+void loop()
+{
+	VariableTimedAction::updateActions();
+}
+
+// EOF
@@ -0,0 +1,91 @@
+// Create by: Jan Doležal, 2020
+
+#include "LedCube.h"
+#include "LedCubeSync.h"
+
+/* A wall of cubes, one controller each: TX of the master goes to RX of all slaves (and GND to GND).
+ * Upload with IS_MASTER 1 to one controller and IS_MASTER 0 to the others.
+ */
+#define IS_MASTER 1
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+// sequences of the wall, the id sent to the slaves is the index
+const playlist::Entry wall_sequences[] PROGMEM = {
+	{playlist::SPIRAL_IN_AND_OUT, 40, 3, 0},
+	{playlist::RANDOM_RAIN, 80, 20, 0},
+	{playlist::AROUND_EDGE_DOWN, 0, 0, 0},
+	{playlist::PROPELLER, 0, 0, 0}
+};
+const uint8_t num_wall_sequences = sizeof(wall_sequences) / sizeof(wall_sequences[0]);
+
+LedCubeSync led_cube_sync(&led_cube, &Serial, IS_MASTER ? LedCubeSync::MASTER : LedCubeSync::SLAVE);
+
+static void startWallSequence(uint8_t id)
+{
+	playlist::Entry entry;
+	
+	memcpy_P(&entry, &wall_sequences[id % num_wall_sequences], sizeof(entry));
+	led_cube.setSequence(playlist::create(&led_cube, entry));
+}
+
+class LedCubeManager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	uint8_t _next;
+	
+	unsigned long run() {
+		if (_led_cube->isSequenceRunning()) {
+			return _led_cube->nextFrameOfSequence();
+		}
+		// the slaves start the sequences announced by the master (setOnSequence())
+		if (led_cube_sync.getRole() == LedCubeSync::MASTER) {
+			led_cube_sync.startSequence(_next);
+			startWallSequence(_next);
+			_next = (_next + 1) % num_wall_sequences;
+			return _led_cube->nextFrameOfSequence();
+		}
+		return 1;
+	}
+
+public:
+	LedCubeManager(LedCube * led_cube)
+		: _led_cube(led_cube), _next(0)
+	{
+		start(1);
+	}
+} led_cube_manager(&led_cube);
+
+
+
+
+void setup()
+{
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	randomSeed(analogRead(10)); // the master seeds random() of the slaves with every sequence
+	
+	// the rate of the master is followed by the slaves, it has to leave room for the main loop of every cube
+	led_cube.setAutoRefresh(true, 50, 100, 200);
+	led_cube_sync.setOnSequence(startWallSequence);
+	
+	Serial.begin(115200);
+}
+
+void loop()
+{
+	VariableTimedAction::updateActions();
+}
+
+// EOF
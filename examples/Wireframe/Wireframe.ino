@@ -0,0 +1,75 @@
+// Create by: Jan Doležal, 2020
+// Measures the time of one frame of a spinning wireframe cube and star, then spins them (a frame every 20 ms => 50 fps).
+
+#include "LedCube.h"
+#include "LedCubeVector.h"
+
+#define SIZE 4 // 4x4x4 => 4, 8x8x8 => 8
+#define NUM_LAYERS 8
+#define NUM_COLUMNS 8
+
+int led_cube_map[NUM_LAYERS][NUM_COLUMNS];
+int * p_led_cube_map[NUM_LAYERS];
+int layer[NUM_LAYERS] = {A2,A3,A4,A5,12,13,A0,A1}; // initializing and declaring led layers
+int column[NUM_COLUMNS] = {2,6,10,8,4,5,9,7}; // initializing and declaring led rows
+
+LedCube led_cube(p_led_cube_map, layer, column, NUM_LAYERS, NUM_COLUMNS, SIZE, 60);
+
+void measure(const char * name, const LedCubeMesh &mesh)
+{
+	const int frames = 100;
+	unsigned long total = 0;
+	unsigned long worst = 0;
+	LedCubeWireframe wireframe(&led_cube, &mesh);
+	
+	led_cube.turnEverythingOff();
+	for (int i = 0; i < frames; ++i) {
+		wireframe.draw();
+		wireframe.rotate(2, 3, 1);
+		total += wireframe.getLastDrawTime();
+		if (wireframe.getLastDrawTime() > worst) {
+			worst = wireframe.getLastDrawTime();
+		}
+	}
+	wireframe.erase();
+	
+	Serial.print(name);
+	Serial.print(F(": mean "));
+	Serial.print(total / frames);
+	Serial.print(F(" us, max "));
+	Serial.print(worst);
+	Serial.print(F(" us per frame (up to "));
+	Serial.print(1000000UL / worst);
+	Serial.println(F(" fps)"));
+}
+
+
+
+
+void setup()
+{
+	Serial.begin(9600);
+	for (int l = 0; l < NUM_LAYERS; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+	}
+	
+	measure("cube", meshes::cube);
+	measure("star", meshes::star);
+}
+
+void loop()
+{
+	static unsigned long next_frame = 0;
+	static bool is_star = false;
+	
+	if (!led_cube.isSequenceRunning()) {
+		led_cube.setSequence(new sequences::Spin(&led_cube, is_star ? meshes::star : meshes::cube, 20, 500));
+		is_star = !is_star;
+	}
+	if (millis() >= next_frame) {
+		next_frame = millis() + led_cube.nextFrameOfSequence();
+	}
+	VariableTimedAction::updateActions();
+}
+
+// EOF
@@ -0,0 +1,141 @@
+// Stand-in of the Arduino core for building the library on a Linux host.
+
+#include "Arduino.h"
+
+#include <atomic>
+#include <chrono>
+
+static std::atomic<unsigned long long> _now(0); // [us], atomic for tools running the library in two threads
+// every thread is a board of its own (batch_render.cpp): pins and random() are per thread, the time is shared
+static thread_local uint8_t _pins[HOST_NUM_PINS];
+static int (*_analog_reader)(uint8_t pin) = nullptr;
+static void (*_digital_write_hook)(uint8_t pin, uint8_t value) = nullptr;
+static void (*_time_hook)(unsigned long long now) = nullptr;
+static thread_local unsigned long _seed = 1;
+static unsigned int _real_time_scale = 0;
+static std::chrono::steady_clock::time_point _real_time_last;
+static unsigned long long _real_time_ns = 0; // [ns * scale] not moved yet
+
+// moves the virtual time by the real time spent since the last reading (hostSetRealTimeScale())
+static void _followRealTime()
+{
+	if (_real_time_scale == 0) {
+		return;
+	}
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	
+	_real_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(now - _real_time_last).count() * _real_time_scale;
+	_real_time_last = now;
+	if (_real_time_ns >= 1000) {
+		hostAdvance(_real_time_ns / 1000);
+		_real_time_ns %= 1000;
+	}
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	// an open input with the pull-up reads HIGH
+	if (mode == INPUT_PULLUP && pin < HOST_NUM_PINS) {
+		_pins[pin] = HIGH;
+	}
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+	if (pin < HOST_NUM_PINS) {
+		_pins[pin] = value ? HIGH : LOW;
+	}
+	if (_digital_write_hook != nullptr) {
+		_digital_write_hook(pin, value);
+	}
+}
+
+int digitalRead(uint8_t pin)
+{
+	return (pin < HOST_NUM_PINS) ? _pins[pin] : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+	return (_analog_reader != nullptr) ? _analog_reader(pin) : 512;
+}
+
+unsigned long millis()
+{
+	_followRealTime();
+	return (unsigned long)(_now / 1000);
+}
+
+unsigned long micros()
+{
+	_followRealTime();
+	return (unsigned long)_now;
+}
+
+void delay(unsigned long ms)
+{
+	hostAdvance(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	hostAdvance(us);
+}
+
+long random(long howbig)
+{
+	if (howbig <= 0) {
+		return 0;
+	}
+	// Park-Miller like avr-libc random()
+	_seed = (unsigned long)((16807ULL * _seed) % 2147483647ULL);
+	return _seed % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+	if (howsmall >= howbig) {
+		return howsmall;
+	}
+	return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed)
+{
+	_seed = (seed % 2147483647UL) ? seed % 2147483647UL : 1;
+}
+
+void hostAdvance(unsigned long us)
+{
+	_now += us;
+	if (_time_hook != nullptr) {
+		_time_hook(_now);
+	}
+}
+
+unsigned long long hostTime()
+{
+	return _now;
+}
+
+void hostSetAnalogReader(int (*reader)(uint8_t pin))
+{
+	_analog_reader = reader;
+}
+
+void hostSetDigitalWriteHook(void (*hook)(uint8_t pin, uint8_t value))
+{
+	_digital_write_hook = hook;
+}
+
+void hostSetTimeHook(void (*hook)(unsigned long long now))
+{
+	_time_hook = hook;
+}
+
+void hostSetRealTimeScale(unsigned int scale)
+{
+	_real_time_scale = scale;
+	_real_time_last = std::chrono::steady_clock::now();
+	_real_time_ns = 0;
+}
@@ -0,0 +1,90 @@
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+// Stand-in of the Arduino core for building the library on a Linux host.
+// Time is virtual: it moves only by delay(), delayMicroseconds() and hostAdvance() (and by the real time with hostSetRealTimeScale()).
+// Pins and random() are per thread (a thread is a board of its own), the time and the hooks are shared.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HOST_ARDUINO 1
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+
+#define HOST_NUM_PINS 70
+
+#define PROGMEM
+#define F(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr) (*(void * const *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// byte stream of the core (Serial, SoftwareSerial, ...), only the members the library uses
+class Stream
+{
+public:
+	virtual ~Stream() {}
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+	virtual size_t write(uint8_t value) = 0;
+	
+	virtual size_t write(const uint8_t * buffer, size_t size)
+	{
+		size_t written = 0;
+		while (written < size && write(buffer[written]) == 1) {
+			written += 1;
+		}
+		return written;
+	}
+	
+	virtual void flush() {}
+};
+
+// host only
+void hostAdvance(unsigned long us); // moves the virtual time
+unsigned long long hostTime(); // virtual time [us] without overflow
+void hostSetAnalogReader(int (*reader)(uint8_t pin));
+void hostSetDigitalWriteHook(void (*hook)(uint8_t pin, uint8_t value));
+void hostSetTimeHook(void (*hook)(unsigned long long now)); // called whenever the virtual time moves (e.g. to follow the real time)
+void hostSetRealTimeScale(unsigned int scale); // millis()/micros() move the virtual time by the real time spent * scale (0 => off), e.g. to see the cost of computing
+
+#endif // _HOST_ARDUINO_H
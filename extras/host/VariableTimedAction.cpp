@@ -0,0 +1,77 @@
+// Stand-in of the VariableTimedAction library for host builds.
+
+#include "VariableTimedAction.h"
+
+thread_local VariableTimedAction * VariableTimedAction::_actions[VariableTimedAction::_max_actions];
+thread_local int VariableTimedAction::_num_actions = 0;
+
+void VariableTimedAction::updateActions()
+{
+	for (int i = 0; i < _num_actions; ++i) {
+		_actions[i]->update();
+	}
+}
+
+unsigned long VariableTimedAction::hostUntilNext()
+{
+	const unsigned long now = millis();
+	unsigned long until = 0xFFFFFFFFUL;
+	
+	for (int i = 0; i < _num_actions; ++i) {
+		if (!_actions[i]->_running) {
+			continue;
+		}
+		const long left = (long)(_actions[i]->_next_run - now);
+		
+		if (left <= 0) {
+			return 0;
+		}
+		if ((unsigned long)left < until) {
+			until = left;
+		}
+	}
+	return until;
+}
+
+void VariableTimedAction::start(unsigned long start_interval, bool start_now)
+{
+	_interval = start_interval;
+	_next_run = start_now ? millis() : millis() + start_interval;
+	_running = true;
+	
+	if (!_registered && _num_actions < _max_actions) {
+		_actions[_num_actions++] = this;
+		_registered = true;
+	}
+}
+
+void VariableTimedAction::stop()
+{
+	_running = false;
+}
+
+void VariableTimedAction::toggleRunning()
+{
+	_running = !_running;
+}
+
+void VariableTimedAction::update()
+{
+	if (_running && (long)(millis() - _next_run) >= 0) {
+		unsigned long interval = run();
+		if (interval > 0) {
+			_interval = interval;
+		}
+		_next_run = millis() + _interval;
+	}
+}
+
+VariableTimedAction::~VariableTimedAction()
+{
+	for (int i = 0; i < _num_actions; ++i) {
+		if (_actions[i] == this) {
+			_actions[i] = _actions[--_num_actions];
+			break;
+		}
+	}
+}
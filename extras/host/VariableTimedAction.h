@@ -0,0 +1,39 @@
+#ifndef _HOST_VARIABLE_TIMED_ACTION_H
+#define _HOST_VARIABLE_TIMED_ACTION_H
+
+// Stand-in of the VariableTimedAction library (same public interface) for host builds.
+
+#include "Arduino.h"
+
+class VariableTimedAction
+{
+public:
+	static void updateActions();
+	
+	// host only: [ms] until the first running action is due (0 => now, 0xFFFFFFFF => none runs), for skipping idle time
+	static unsigned long hostUntilNext();
+	
+	void start(unsigned long start_interval, bool start_now=true);
+	void stop();
+	void toggleRunning();
+	bool isRunning() const { return _running; }
+	unsigned long getInterval() const { return _interval; }
+	void update();
+	
+	virtual ~VariableTimedAction();
+private:
+	// per thread, an action is destroyed in the thread which started it
+	static const int _max_actions = 16;
+	static thread_local VariableTimedAction * _actions[_max_actions];
+	static thread_local int _num_actions;
+	
+	unsigned long _interval = 0; // [ms]
+	unsigned long _next_run = 0; // [ms]
+	bool _running = false;
+	bool _registered = false;
+	
+	// returns the new interval or 0 to keep the current one
+	virtual unsigned long run() = 0;
+};
+
+#endif // _HOST_VARIABLE_TIMED_ACTION_H
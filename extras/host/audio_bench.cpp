@@ -0,0 +1,335 @@
+/* Runs sequences::AudioVisualizer on the host in the main loop of the examples (LedCubeRefresher and a manager
+ * calling LedCube::nextFrameOfSequence(), virtual time), with samples from a WAV file instead of the analog input:
+ * - the samples are taken on the virtual clock at the sample rate (as by the timer interrupt of the examples),
+ *   the visualizer takes the newest whole block without waiting for it
+ * - reports the compute time of every block (real time of the host)
+ * - measures the latency from the sound to the LEDs: tone bursts after silence, from the start of a burst to the first
+ *   column switched on by the scan (on the pins), at the fixed 60 Hz refresh and the automatic one
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. audio_bench.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeSpectrum.cpp ../../LedCubeAudio.cpp -o audio_bench
+ * Usage:
+ *   ./audio_bench song.wav [size=4] [columns|layers] [sample_rate=4000]
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "LedCube.h"
+#include "LedCubeAudio.h"
+
+// samples taken on the virtual clock at the sample rate, as by the timer interrupt of the examples
+class ClockedSampleSource : public LedCubeSampleSource
+{
+protected:
+	unsigned int _sample_rate;
+	unsigned long long _start; // [us] of the first sample
+	unsigned long long _read; // samples read
+	
+	// signed 16 bit sample number i
+	virtual int _at(unsigned long long i) = 0;
+public:
+	ClockedSampleSource(unsigned int sample_rate)
+		: _sample_rate(sample_rate), _start(0), _read(0)
+	{}
+	
+	void begin()
+	{
+		_start = hostTime();
+		_read = 0;
+	}
+	
+	// [us] virtual time of sample i
+	unsigned long long getTime(unsigned long long i) { return _start + i * 1000000ULL / _sample_rate; }
+	
+	unsigned int getSampleRate() { return _sample_rate; }
+	
+	unsigned int available()
+	{
+		const unsigned long long sampled = (hostTime() - _start) * _sample_rate / 1000000ULL + 1;
+		
+		return (sampled > _read) ? sampled - _read : 0;
+	}
+	
+	int read()
+	{
+		// 16 bit => 10 bit of the ADC
+		return _at(_read++) >> 6;
+	}
+	
+	unsigned long long getRead() { return _read; }
+};
+
+// 16/8 bit PCM WAV file resampled to the sample rate of the source (channels are mixed)
+class WavSampleSource : public ClockedSampleSource
+{
+protected:
+	std::vector<int> _samples; // signed 16 bit
+	unsigned int _file_rate;
+	
+	int _at(unsigned long long i)
+	{
+		i = i * _file_rate / _sample_rate;
+		return (i < _samples.size()) ? _samples[i] : 0;
+	}
+public:
+	WavSampleSource(unsigned int sample_rate)
+		: ClockedSampleSource(sample_rate), _file_rate(0)
+	{}
+	
+	bool load(const char * path)
+	{
+		FILE * f = fopen(path, "rb");
+		if (f == nullptr) {
+			return false;
+		}
+		
+		unsigned char header[12];
+		if (fread(header, 1, 12, f) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4)) {
+			fclose(f);
+			return false;
+		}
+		
+		int channels = 0;
+		int bits = 0;
+		unsigned char chunk[8];
+		while (fread(chunk, 1, 8, f) == 8) {
+			unsigned long len = chunk[4] | chunk[5] << 8 | chunk[6] << 16 | (unsigned long)chunk[7] << 24;
+			if (!memcmp(chunk, "fmt ", 4)) {
+				std::vector<unsigned char> fmt(len);
+				if (fread(fmt.data(), 1, len, f) != len || len < 16) {
+					break;
+				}
+				channels = fmt[2] | fmt[3] << 8;
+				_file_rate = fmt[4] | fmt[5] << 8 | fmt[6] << 16 | (unsigned long)fmt[7] << 24;
+				bits = fmt[14] | fmt[15] << 8;
+			} else if (!memcmp(chunk, "data", 4) && channels > 0) {
+				std::vector<unsigned char> data(len);
+				len = fread(data.data(), 1, len, f);
+				int frame = channels * bits / 8;
+				for (unsigned long i = 0; i + frame <= len; i += frame) {
+					long sum = 0;
+					for (int c = 0; c < channels; ++c) {
+						if (bits == 16) {
+							sum += (int16_t)(data[i + 2*c] | data[i + 2*c + 1] << 8);
+						} else {
+							sum += ((int)data[i + c] - 128) << 8;
+						}
+					}
+					_samples.push_back(sum / channels);
+				}
+				break;
+			} else {
+				fseek(f, len + (len & 1), SEEK_CUR);
+			}
+		}
+		fclose(f);
+		
+		return !_samples.empty() && (bits == 8 || bits == 16);
+	}
+	
+	bool finished() { return _read * _file_rate / _sample_rate >= _samples.size(); }
+	
+	double getDuration() { return (double)_samples.size() / _file_rate; }
+};
+
+// silence with a tone burst of burst_ms every period_ms
+class BurstSource : public ClockedSampleSource
+{
+protected:
+	int _at(unsigned long long i)
+	{
+		const unsigned long long t = i * 1000000ULL / _sample_rate % (period_ms * 1000ULL);
+		
+		return (t < burst_ms * 1000ULL) ? (int)(30000 * sin(2 * M_PI * tone_hz * t / 1e6)) : 0;
+	}
+public:
+	static const unsigned long period_ms = 500;
+	static const unsigned long burst_ms = 100;
+	static const unsigned int tone_hz = 500;
+	
+	BurstSource(unsigned int sample_rate)
+		: ClockedSampleSource(sample_rate)
+	{}
+};
+
+int led_cube_map[16][256];
+int * p_led_cube_map[16];
+int layer[16];
+int column[256];
+
+static const int first_column_pin = 16;
+static const unsigned long loop_us = 20;
+static const int bursts = 40;
+
+// calls LedCube::nextFrameOfSequence() (as LedCubeManager of the examples), the real time of the frames which took a block
+class Player : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	ClockedSampleSource * _source;
+	
+	unsigned long run() {
+		const unsigned long long read = _source->getRead();
+		const auto start = std::chrono::steady_clock::now();
+		const unsigned long wait = _led_cube->nextFrameOfSequence();
+		const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		
+		if (_source->getRead() != read) {
+			blocks += 1;
+			total_us += us;
+			last_us = us;
+			if (us > worst_us) {
+				worst_us = us;
+			}
+		}
+		return (wait > 0) ? wait : 1;
+	}
+
+public:
+	unsigned long blocks;
+	double total_us;
+	double worst_us;
+	double last_us;
+	
+	Player(LedCube * led_cube, ClockedSampleSource * source)
+		: _led_cube(led_cube), _source(source), blocks(0), total_us(0), worst_us(0), last_us(0)
+	{
+		start(1);
+	}
+};
+
+// main loop, the idle time skipped
+static void loopOnce()
+{
+	VariableTimedAction::updateActions();
+	const unsigned long idle = VariableTimedAction::hostUntilNext();
+	hostAdvance((idle > 0 && idle != 0xFFFFFFFFUL) ? idle * 1000 : loop_us);
+}
+
+// the start of the burst, the first column switched on after it and the last column switched on [us]
+static unsigned long long onset = 0;
+static unsigned long long first_lit = 0;
+static unsigned long long last_lit = 0;
+
+static void onWrite(uint8_t pin, uint8_t value)
+{
+	if (pin >= first_column_pin && value == HIGH) {
+		if (first_lit == 0 && hostTime() >= onset) {
+			first_lit = hostTime();
+		}
+		last_lit = hostTime();
+	}
+}
+
+static bool measureLatency(int size, bool layers, unsigned int sample_rate, bool is_auto)
+{
+	LedCube led_cube(p_led_cube_map, layer, column, size, size * size, size, 60);
+	BurstSource source(sample_rate);
+	Player player(&led_cube, &source);
+	const unsigned long long period_us = BurstSource::period_ms * 1000ULL;
+	double total_ms = 0;
+	double worst_ms = 0;
+	int measured = 0;
+	
+	if (is_auto) {
+		led_cube.setAutoRefresh(true, 50, 200, 200);
+	}
+	led_cube.setSequence(new sequences::AudioVisualizer(&led_cube, &source,
+		layers ? sequences::AudioVisualizer::LAYERS : sequences::AudioVisualizer::COLUMNS));
+	hostSetDigitalWriteHook(onWrite);
+	last_lit = 0;
+	source.begin();
+	for (int burst = 0; burst < bursts; ++burst) {
+		onset = source.getTime(0) + burst * period_us;
+		first_lit = 0;
+		while (hostTime() < onset) {
+			loopOnce();
+		}
+		// dark for 100 ms before the burst (the levels of the previous one have fallen)
+		const bool is_dark = last_lit == 0 || last_lit + 100000 < onset;
+		while (first_lit == 0 && hostTime() < onset + period_us / 2) {
+			loopOnce();
+		}
+		if (!is_dark || first_lit == 0) {
+			continue;
+		}
+		const double ms = (first_lit - onset) / 1000.0;
+		total_ms += ms;
+		if (ms > worst_ms) {
+			worst_ms = ms;
+		}
+		measured += 1;
+	}
+	hostSetDigitalWriteHook(nullptr);
+	
+	const bool ok = measured == bursts;
+	printf("latency, %-20s %2d Hz: %2d of %d bursts, sound to the first lit column avg %5.1f ms, max %5.1f ms (block %.1f ms)%s\n",
+		is_auto ? "automatic refresh" : "fixed refresh", led_cube.getRefreshFrequency(), measured, bursts,
+		measured ? total_ms / measured : 0.0, worst_ms, 1000.0 * LedCubeSpectrum::block_len / sample_rate, ok ? "" : "  FAILED");
+	return ok;
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s file.wav [size=4] [columns|layers] [sample_rate=4000]\n", argv[0]);
+		return 1;
+	}
+	
+	int size = (argc > 2) ? atoi(argv[2]) : 4;
+	bool layers = (argc > 3) && !strcmp(argv[3], "layers");
+	unsigned int sample_rate = (argc > 4) ? atoi(argv[4]) : 4000;
+	if (size < 1 || size > 16) {
+		fprintf(stderr, "size has to be in <1, 16>\n");
+		return 1;
+	}
+	
+	WavSampleSource source(sample_rate);
+	if (!source.load(argv[1])) {
+		fprintf(stderr, "cannot read %s (PCM 8/16 bit WAV expected)\n", argv[1]);
+		return 1;
+	}
+	
+	for (int l = 0; l < size; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+		layer[l] = l;
+	}
+	for (int c = 0; c < size * size; ++c) {
+		column[c] = first_column_pin + c;
+	}
+	
+	bool ok = true;
+	{
+		LedCube led_cube(p_led_cube_map, layer, column, size, size * size, size, 60);
+		sequences::AudioVisualizer * visualizer = new sequences::AudioVisualizer(&led_cube, &source,
+			layers ? sequences::AudioVisualizer::LAYERS : sequences::AudioVisualizer::COLUMNS);
+		Player player(&led_cube, &source);
+		int num_bands = (size < LedCubeSpectrum::max_bands) ? size : LedCubeSpectrum::max_bands;
+		
+		led_cube.setSequence(visualizer);
+		source.begin();
+		for (unsigned long printed = 0; !source.finished(); ) {
+			loopOnce();
+			if (player.blocks >= printed + 50) {
+				printed = player.blocks;
+				printf("%8.3f s |", hostTime() / 1e6);
+				for (int band = 0; band < num_bands; ++band) {
+					printf(" %2d", visualizer->getLevel(band));
+				}
+				printf(" | %6.1f us\n", player.last_us);
+			}
+		}
+		
+		printf("\n%lu blocks of %d samples at %u Hz (%.3f s of audio, %llu samples)\n", player.blocks, LedCubeSpectrum::block_len,
+			sample_rate, source.getDuration(), source.getRead());
+		printf("compute per block: mean %.1f us, max %.1f us (host)\n", player.total_us / player.blocks, player.worst_us);
+	}
+	
+	printf("\n");
+	ok &= measureLatency(size, layers, sample_rate, false);
+	ok &= measureLatency(size, layers, sample_rate, true);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+#ifndef _HOST_AVR_EEPROM_H
+#define _HOST_AVR_EEPROM_H
+
+// Stand-in of avr-libc EEPROM access: 4 KiB of erased (0xFF) memory, addresses are passed as pointers like on AVR.
+
+#include <stdint.h>
+#include <string.h>
+
+#define E2END 0x0FFF
+
+inline uint8_t * hostEeprom()
+{
+	static uint8_t eeprom[E2END + 1];
+	static bool erased = false;
+	if (!erased) {
+		memset(eeprom, 0xFF, sizeof(eeprom));
+		erased = true;
+	}
+	return eeprom;
+}
+
+inline uint8_t eeprom_read_byte(const uint8_t * address) { return hostEeprom()[(uintptr_t)address & E2END]; }
+inline void eeprom_write_byte(uint8_t * address, uint8_t value) { hostEeprom()[(uintptr_t)address & E2END] = value; }
+inline void eeprom_update_byte(uint8_t * address, uint8_t value) { eeprom_write_byte(address, value); }
+inline uint16_t eeprom_read_word(const uint16_t * address) { return eeprom_read_byte((const uint8_t *)address) | eeprom_read_byte((const uint8_t *)address + 1) << 8; }
+inline void eeprom_update_word(uint16_t * address, uint16_t value) { eeprom_write_byte((uint8_t *)address, value & 0xFF); eeprom_write_byte((uint8_t *)address + 1, value >> 8); }
+
+#endif // _HOST_AVR_EEPROM_H
@@ -0,0 +1,518 @@
+/* Batch rendering: every built-in sequence on cubes of many sizes (2x2x2 to 16x16x16) with many seeds of random(),
+ * each one an independent cube and sequence, run on a work-stealing pool of threads (a queue of jobs per thread,
+ * the owner takes from the back, an idle thread steals from the front of another queue).
+ * - every frame is hashed (FNV-1a of the map), with --hashes the hash of every job is written into a file
+ *   ("sequence size seed frames hash" per line) to be compared between builds
+ * - out of bounds: every allocation of a job has red zones before and after it, checked after every frame and when
+ *   it is freed (an overflowing array of a sequence), coordinates outside the cube (LedCube::getWrappedCoordinates()),
+ *   sequences which do not end within --max-frames
+ * - --scaling runs the batch on 1, 2, 4, ... threads up to --threads: jobs per second, speed-up against one thread,
+ *   steals and whether the results are the same as on one thread; --min-efficiency P fails the run when the speed-up on
+ *   any number of threads up to the hardware threads is below P % of the number of threads (the scaling is linear when
+ *   e.g. --min-efficiency 80 passes on a machine with several cores, a single core has nothing to show)
+ * The run fails (exit 1) with any finding out of bounds, with results differing between numbers of threads and below
+ * the efficiency.
+ * Every thread is a board of its own in the shim (pins, random() and the actions), the virtual time is not moved:
+ * the sequences are called directly, their waits are only summed.
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -pthread -I. -I../.. batch_render.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp -o batch_render
+ * (-fsanitize=address finds reads out of bounds as well, -fsanitize=thread checks the pool)
+ * Usage:
+ *   ./batch_render [--threads N] [--sizes MIN-MAX] [--seeds N] [--max-frames N] [--scaling] [--min-efficiency P] [--hashes FILE]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "LedCube.h"
+
+// playlist::SequenceId by name
+static const char * const names[playlist::PAUSE] = {
+	"off", "on", "flicker_on", "flicker_off", "up_down", "sideways", "stomp", "edge_down",
+	"rnd_flicker", "rnd_rain", "matrix_rain", "diagonal", "propeller", "spiral", "all_leds"
+};
+
+static int min_size = 2;
+static int max_size = 16;
+static int seeds = 8;
+static unsigned long max_frames = 200000;
+
+// red zones around every allocation, the allocations of the running job of a thread are listed
+namespace {
+	struct alignas(16) Block {
+		size_t size;
+		Block * prev;
+		Block * next;
+		uint32_t is_tracked;
+		uint32_t guard; // red zone before the data
+	};
+}
+
+static const uint32_t guard_value = 0x5AFEC0DEUL;
+static const size_t red_zone = 256; // after the data, longer overflows may crash (the job is named then)
+static const uint8_t red_byte = 0xA5;
+
+static thread_local bool is_tracking = false;
+static thread_local Block * tracked = nullptr;
+static thread_local unsigned long overruns = 0;
+static thread_local char running_job[64]; // for the crash handler
+
+static uint8_t * redZoneOf(Block * block) { return (uint8_t *)(block + 1) + block->size; }
+
+// counts an overrun once (the red zone is repaired)
+static void checkBlock(Block * block)
+{
+	bool is_overrun = block->guard != guard_value;
+	uint8_t * zone = redZoneOf(block);
+	
+	for (size_t i = 0; i < red_zone; ++i) {
+		is_overrun |= zone[i] != red_byte;
+	}
+	if (is_overrun) {
+		overruns += 1;
+		block->guard = guard_value;
+		memset(zone, red_byte, red_zone);
+	}
+}
+
+static void checkRedZones()
+{
+	for (Block * block = tracked; block != nullptr; block = block->next) {
+		checkBlock(block);
+	}
+}
+
+void * operator new(size_t size)
+{
+	Block * block = (Block *)malloc(sizeof(Block) + size + red_zone);
+	
+	if (block == nullptr) {
+		throw std::bad_alloc();
+	}
+	block->size = size;
+	block->guard = guard_value;
+	block->is_tracked = is_tracking;
+	block->prev = nullptr;
+	block->next = nullptr;
+	memset(redZoneOf(block), red_byte, red_zone);
+	if (is_tracking) {
+		block->next = tracked;
+		if (tracked != nullptr) {
+			tracked->prev = block;
+		}
+		tracked = block;
+	}
+	return block + 1;
+}
+
+void operator delete(void * data) noexcept
+{
+	if (data == nullptr) {
+		return;
+	}
+	Block * block = (Block *)data - 1;
+	
+	checkBlock(block);
+	// a job frees what it allocated in its own thread
+	if (block->is_tracked) {
+		if (block->prev != nullptr) {
+			block->prev->next = block->next;
+		} else {
+			tracked = block->next;
+		}
+		if (block->next != nullptr) {
+			block->next->prev = block->prev;
+		}
+	}
+	free(block);
+}
+
+void * operator new[](size_t size) { return operator new(size); }
+
+void operator delete[](void * data) noexcept { operator delete(data); }
+
+void operator delete(void * data, size_t) noexcept { operator delete(data); }
+
+void operator delete[](void * data, size_t) noexcept { operator delete(data); }
+
+struct Job {
+	uint8_t sequence; // playlist::SequenceId
+	int size;
+	unsigned long seed;
+};
+
+struct Result {
+	uint64_t hash; // of all frames
+	unsigned long frames;
+	unsigned long long duration; // [ms] sum of the waits
+	unsigned long wrapped; // coordinates outside the cube
+	unsigned long overruns; // red zones
+	bool is_finished;
+	double time; // [us] wall time
+	
+	bool operator==(const Result &other) const
+	{
+		return hash == other.hash && frames == other.frames && duration == other.duration && wrapped == other.wrapped
+			&& overruns == other.overruns && is_finished == other.is_finished;
+	}
+};
+
+// names the job of the crashed thread (write() only, it is called in a signal handler)
+static void onCrash(int signal)
+{
+	static const char message[] = "\ncrashed in the job: ";
+	
+	if (write(STDERR_FILENO, message, sizeof(message) - 1) < 0 || write(STDERR_FILENO, running_job, strlen(running_job)) < 0) {
+		_exit(128 + signal);
+	}
+	_exit(128 + signal);
+}
+
+// one layer per z, a column per LED of a layer (pins beyond the pins of the shim are ignored)
+static Result render(const Job &job)
+{
+	Result result = {};
+	const int size = job.size;
+	const auto start = std::chrono::steady_clock::now();
+	const unsigned long overruns_before = overruns;
+	
+	snprintf(running_job, sizeof(running_job), "%s %dx%dx%d seed %lu\n", names[job.sequence], size, size, size, job.seed);
+	is_tracking = true;
+	int ** map = new int * [size];
+	int * layer_pins = new int[size];
+	int * column_pins = new int[size * size];
+	
+	for (int z = 0; z < size; ++z) {
+		map[z] = new int[size * size]();
+		layer_pins[z] = z;
+	}
+	for (int c = 0; c < size * size; ++c) {
+		column_pins[c] = size + c;
+	}
+	{
+		LedCube led_cube(map, layer_pins, column_pins, size, size * size, size, 60);
+		const playlist::Entry entry = {job.sequence, 0, 0, 0};
+		LedCubeSequence * sequence;
+		uint64_t hash = 14695981039346656037ULL;
+		
+		randomSeed(job.seed);
+		sequence = playlist::create(&led_cube, entry);
+		while (result.frames < max_frames) {
+			const unsigned long wait = (*sequence)();
+			
+			for (int z = 0; z < size; ++z) {
+				for (int c = 0; c < size * size; ++c) {
+					hash = (hash ^ (map[z][c] != 0)) * 1099511628211ULL;
+				}
+			}
+			result.frames += 1;
+			checkRedZones();
+			if (wait == 0) {
+				result.is_finished = true;
+				break;
+			}
+			result.duration += wait;
+		}
+		delete sequence;
+		result.hash = hash;
+		result.wrapped = led_cube.getWrappedCoordinates();
+	}
+	for (int z = 0; z < size; ++z) {
+		delete[] map[z];
+	}
+	delete[] map;
+	delete[] layer_pins;
+	delete[] column_pins;
+	is_tracking = false;
+	
+	result.overruns = overruns - overruns_before;
+	result.time = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+// a queue of jobs per thread, the owner takes from the back, the others steal from the front
+class Pool
+{
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<size_t> jobs;
+	};
+	
+	std::vector<std::unique_ptr<Queue> > _queues;
+	std::atomic<unsigned long> _steals;
+	
+	bool _take(int owner, size_t &job)
+	{
+		Queue &queue = *_queues[owner];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		
+		if (queue.jobs.empty()) {
+			return false;
+		}
+		job = queue.jobs.back();
+		queue.jobs.pop_back();
+		return true;
+	}
+	
+	bool _steal(int thief, size_t &job)
+	{
+		const int threads = _queues.size();
+		
+		for (int i = 1; i < threads; ++i) {
+			Queue &queue = *_queues[(thief + i) % threads];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			
+			if (!queue.jobs.empty()) {
+				job = queue.jobs.front();
+				queue.jobs.pop_front();
+				_steals += 1;
+				return true;
+			}
+		}
+		return false;
+	}
+public:
+	Pool() : _steals(0) {}
+	
+	unsigned long getSteals() { return _steals; }
+	
+	// no job adds jobs, so a thread which finds every queue empty is done
+	void run(const std::vector<Job> &jobs, std::vector<Result> &results, int threads)
+	{
+		_queues.clear();
+		for (int t = 0; t < threads; ++t) {
+			_queues.push_back(std::unique_ptr<Queue>(new Queue()));
+		}
+		for (size_t j = 0; j < jobs.size(); ++j) {
+			_queues[j % threads]->jobs.push_back(j);
+		}
+		_steals = 0;
+		results.assign(jobs.size(), Result());
+		
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; ++t) {
+			workers.push_back(std::thread([this, t, &jobs, &results]() {
+				size_t job;
+				
+				while (_take(t, job) || _steal(t, job)) {
+					results[job] = render(jobs[job]);
+				}
+			}));
+		}
+		for (size_t t = 0; t < workers.size(); ++t) {
+			workers[t].join();
+		}
+	}
+};
+
+static double runBatch(Pool &pool, const std::vector<Job> &jobs, std::vector<Result> &results, int threads)
+{
+	const auto start = std::chrono::steady_clock::now();
+	
+	pool.run(jobs, results, threads);
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// false when a job was out of bounds or did not end
+static bool report(const std::vector<Job> &jobs, const std::vector<Result> &results)
+{
+	unsigned long findings = 0;
+	
+	printf("%-12s %9s %9s %10s %10s %9s  %s\n", "sequence", "frames", "CPU ms", "slowest ms", "wrapped", "overruns",
+		"unfinished");
+	for (int s = 0; s < playlist::PAUSE; ++s) {
+		unsigned long long frames = 0;
+		double time = 0;
+		double slowest = 0;
+		unsigned long wrapped = 0;
+		unsigned long overruns = 0;
+		unsigned long unfinished = 0;
+		
+		for (size_t j = 0; j < jobs.size(); ++j) {
+			if (jobs[j].sequence != s) {
+				continue;
+			}
+			frames += results[j].frames;
+			time += results[j].time;
+			if (results[j].time > slowest) {
+				slowest = results[j].time;
+			}
+			wrapped += results[j].wrapped;
+			overruns += results[j].overruns;
+			unfinished += !results[j].is_finished;
+		}
+		printf("%-12s %9llu %9.1f %10.2f %10lu %9lu  %lu\n", names[s], frames, time / 1000, slowest / 1000, wrapped, overruns,
+			unfinished);
+	}
+	
+	// findings by sequence and size
+	printf("\nout of bounds:\n");
+	for (int s = 0; s < playlist::PAUSE; ++s) {
+		for (int size = min_size; size <= max_size; ++size) {
+			unsigned long wrapped_seeds = 0;
+			unsigned long overrun_seeds = 0;
+			unsigned long unfinished_seeds = 0;
+			
+			for (size_t j = 0; j < jobs.size(); ++j) {
+				if (jobs[j].sequence == s && jobs[j].size == size) {
+					wrapped_seeds += results[j].wrapped > 0;
+					overrun_seeds += results[j].overruns > 0;
+					unfinished_seeds += !results[j].is_finished;
+				}
+			}
+			if (wrapped_seeds + overrun_seeds + unfinished_seeds == 0) {
+				continue;
+			}
+			findings += 1;
+			printf("  %-12s %2dx%dx%d:", names[s], size, size, size);
+			const char * separator = " ";
+			if (overrun_seeds > 0) {
+				printf("%sred zone overrun in %lu of %d seeds", separator, overrun_seeds, seeds);
+				separator = ", ";
+			}
+			if (wrapped_seeds > 0) {
+				printf("%scoordinates outside the cube in %lu of %d seeds", separator, wrapped_seeds, seeds);
+				separator = ", ";
+			}
+			if (unfinished_seeds > 0) {
+				printf("%snot ended within %lu frames in %lu of %d seeds", separator, max_frames, unfinished_seeds, seeds);
+			}
+			printf("\n");
+		}
+	}
+	if (findings == 0) {
+		printf("  none\n");
+	}
+	return findings == 0;
+}
+
+static bool writeHashes(const char * path, const std::vector<Job> &jobs, const std::vector<Result> &results)
+{
+	FILE * file = fopen(path, "w");
+	
+	if (file == nullptr) {
+		return false;
+	}
+	for (size_t j = 0; j < jobs.size(); ++j) {
+		fprintf(file, "%s %d %lu %lu %016llx\n", names[jobs[j].sequence], jobs[j].size, jobs[j].seed, results[j].frames,
+			(unsigned long long)results[j].hash);
+	}
+	fclose(file);
+	return true;
+}
+
+int main(int argc, char ** argv)
+{
+	int threads = std::thread::hardware_concurrency();
+	bool is_scaling = false;
+	double min_efficiency = 0; // [%]
+	const char * hashes_path = nullptr;
+	
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--threads") == 0 && i+1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--sizes") == 0 && i+1 < argc) {
+			if (sscanf(argv[++i], "%d-%d", &min_size, &max_size) == 1) {
+				max_size = min_size;
+			}
+		} else if (strcmp(argv[i], "--seeds") == 0 && i+1 < argc) {
+			seeds = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--max-frames") == 0 && i+1 < argc) {
+			max_frames = strtoul(argv[++i], nullptr, 0);
+		} else if (strcmp(argv[i], "--scaling") == 0) {
+			is_scaling = true;
+		} else if (strcmp(argv[i], "--min-efficiency") == 0 && i+1 < argc) {
+			min_efficiency = atof(argv[++i]);
+			is_scaling = true;
+		} else if (strcmp(argv[i], "--hashes") == 0 && i+1 < argc) {
+			hashes_path = argv[++i];
+		} else {
+			fprintf(stderr, "usage: %s [--threads N] [--sizes MIN-MAX] [--seeds N] [--max-frames N] [--scaling] [--min-efficiency P]"
+				" [--hashes FILE]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+	// a layer of 16x16 is 256 columns, the most the cube takes
+	if (min_size < 1 || max_size > 16 || min_size > max_size || seeds < 1) {
+		fprintf(stderr, "sizes 1-16, at least one seed\n");
+		return 2;
+	}
+	
+	// the largest cubes first, they are the longest jobs
+	std::vector<Job> jobs;
+	for (int size = max_size; size >= min_size; --size) {
+		for (int s = 0; s < playlist::PAUSE; ++s) {
+			for (int seed = 1; seed <= seeds; ++seed) {
+				const Job job = {(uint8_t)s, size, (unsigned long)seed};
+				jobs.push_back(job);
+			}
+		}
+	}
+	
+	Pool pool;
+	std::vector<Result> results;
+	bool ok = true;
+	
+	signal(SIGSEGV, onCrash);
+	signal(SIGBUS, onCrash);
+	signal(SIGABRT, onCrash);
+	
+	printf("%zu jobs: %d sequences, sizes %d-%d, %d seeds, at most %lu frames each\n\n", jobs.size(), (int)playlist::PAUSE,
+		min_size, max_size, seeds, max_frames);
+	if (is_scaling) {
+		std::vector<Result> single;
+		double single_time = 0;
+		
+		printf("%7s %8s %9s %9s %10s %7s  %s\n", "threads", "wall s", "jobs/s", "speed-up", "efficiency", "steals", "results");
+		for (int t = 1; ; t = (t * 2 < threads) ? t * 2 : threads) {
+			const double time = runBatch(pool, jobs, results, t);
+			bool is_same = true;
+			
+			if (t == 1) {
+				single = results;
+				single_time = time;
+			}
+			for (size_t j = 0; j < jobs.size(); ++j) {
+				is_same &= results[j] == single[j];
+			}
+			const double efficiency = 100 * single_time / time / t;
+			// more threads than cores cannot scale
+			const bool is_efficient = t > (int)std::thread::hardware_concurrency() || efficiency >= min_efficiency;
+			
+			ok &= is_same && is_efficient;
+			printf("%7d %8.2f %9.1f %9.2f %9.0f %% %7lu  %s%s\n", t, time, jobs.size() / time, single_time / time,
+				efficiency, pool.getSteals(), is_same ? "same" : "DIFFERENT", is_efficient ? "" : "  BELOW");
+			if (t == threads) {
+				break;
+			}
+		}
+		printf("(%u hardware threads)\n\n", std::thread::hardware_concurrency());
+	} else {
+		const double time = runBatch(pool, jobs, results, threads);
+		
+		printf("%d threads: %.2f s, %.1f jobs/s, %lu steals\n\n", threads, time, jobs.size() / time, pool.getSteals());
+	}
+	
+	ok &= report(jobs, results);
+	if (hashes_path != nullptr && !writeHashes(hashes_path, jobs, results)) {
+		fprintf(stderr, "cannot write %s\n", hashes_path);
+		ok = false;
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+/* Checks sequences::BeatSync (LedCube.h) on the timeline of the cube (LedCubeTimeline.h) in a simulated main loop
+ * (virtual time, the refresh of the cube in the same loop) over a whole song:
+ * - a sequence with waits shorter and longer than a tick (7 to 333 ms, a tick of 120 bpm and 24 ticks per beat is 20.8 ms)
+ *   at a constant tempo: every frame against the sum of the waits from the start (error of the frames, drift),
+ *   beside what the waits rounded to whole ticks (at least one) would add up to
+ * - the same with the tempo changed in the middle of the song: every frame against the position of the sum of the waits
+ *   on the timeline (a tick after the change is longer, so is every wait counted in ticks)
+ * - checks that no frame is later than one refresh of the cube (the main loop is busy with it) and that the earliest frame of
+ *   the last tenth of the song is less than 1 ms off the earliest one of the first tenth (drift)
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. beat_check.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp -o beat_check
+ */
+
+#include <stdio.h>
+#include <vector>
+
+#include "LedCube.h"
+#include "LedCubeTimeline.h"
+
+static const int size = 4;
+static const int num_layers = 8;
+static const int num_columns = 8;
+int led_cube_map[num_layers][num_columns];
+int * p_led_cube_map[num_layers] = {
+	led_cube_map[0], led_cube_map[1], led_cube_map[2], led_cube_map[3],
+	led_cube_map[4], led_cube_map[5], led_cube_map[6], led_cube_map[7]
+};
+int layer[num_layers] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column[num_columns] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+static const unsigned long loop_us = 20;
+static const unsigned int bpm = 120;
+static const unsigned int changed_bpm = 90;
+static const unsigned int ticks_per_beat = 24;
+static const unsigned long song_ms = 240000UL;
+static const unsigned long waits[] = {7, 13, 50, 16, 150, 9, 333, 21, 40, 11}; // [ms]
+static const int num_waits = sizeof(waits) / sizeof(waits[0]);
+
+// frames with the waits above, the time of every frame
+class Frames : public LedCubeSequence
+{
+private:
+	int _frame;
+public:
+	std::vector<unsigned long long> times; // [us]
+	
+	Frames(LedCube * led_cube)
+		: LedCubeSequence(led_cube), _frame(0)
+	{}
+	
+	unsigned long operator()()
+	{
+		times.push_back(hostTime());
+		if (_frame % 2 == 0) {
+			_led_cube->turnOn(0, 0, 0);
+		} else {
+			_led_cube->turnOff(0, 0, 0);
+		}
+		return waits[_frame++ % num_waits];
+	}
+};
+
+class Player : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	
+	unsigned long run() {
+		const unsigned long wait = _led_cube->nextFrameOfSequence();
+		
+		return (wait > 0) ? wait : 1;
+	}
+
+public:
+	Player(LedCube * led_cube)
+		: _led_cube(led_cube)
+	{
+		start(1);
+	}
+};
+
+static void loopUntil(unsigned long long end)
+{
+	while (hostTime() < end) {
+		VariableTimedAction::updateActions();
+		hostAdvance(loop_us);
+	}
+}
+
+// [us] since the start of the timeline of the position in ticks, the tempo changed at the tick change_tick
+static double tickTime(double tick, double change_tick, unsigned int second_bpm)
+{
+	const double first = 60e6 / ((double)bpm * ticks_per_beat);
+	const double second = 60e6 / ((double)second_bpm * ticks_per_beat);
+	
+	return (tick < change_tick) ? tick * first : change_tick * first + (tick - change_tick) * second;
+}
+
+static bool run(const char * name, bool change_tempo)
+{
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	LedCubeTimeline timeline(bpm, ticks_per_beat);
+	Player player(&led_cube);
+	Frames * frames = new Frames(&led_cube);
+	
+	led_cube.setTimeline(&timeline);
+	loopUntil(hostTime() + 100000);
+	timeline.start();
+	const unsigned long long start = hostTime();
+	led_cube.setSequence(new sequences::BeatSync(&led_cube, frames));
+	
+	double change_tick = 1e18;
+	unsigned long long change_time = ~0ULL; // [us] since the start
+	if (change_tempo) {
+		loopUntil(start + song_ms * 500);
+		change_time = hostTime() - start;
+		change_tick = timeline.getTick();
+		timeline.setTempo(changed_bpm);
+	}
+	loopUntil(start + song_ms * 1000);
+	
+	// the first frame is on the tick the sequence starts on, every wait moves the position by its ticks of the first tempo
+	const std::vector<unsigned long long> times = frames->times;
+	const size_t window = times.size() / 10;
+	double tick = (double)(unsigned long)((double)(times[0] - start) / tickTime(1, 1e18, bpm));
+	double max_error = 0;
+	double first_earliest = 1e18;
+	double last_earliest = 1e18;
+	double rounded = 0; // [us] the waits rounded to whole ticks (at least one) against the waits
+	
+	for (size_t frame = 1; frame < times.size(); ++frame) {
+		const unsigned long wait = waits[(frame - 1) % num_waits];
+		const double ticks = wait * 1000 / tickTime(1, 1e18, bpm);
+		const double rounded_ticks = (ticks < 0.5) ? 1 : (double)(unsigned long)(ticks + 0.5);
+		
+		rounded += tickTime(tick + rounded_ticks, change_tick, changed_bpm) - tickTime(tick + ticks, change_tick, changed_bpm);
+		tick += ticks;
+		const double error = (double)(times[frame] - start) - tickTime(tick, change_tick, changed_bpm);
+		
+		// the wait over the change of the tempo was computed before it
+		if (times[frame - 1] - start >= change_time || times[frame] - start < change_time) {
+			if (error > max_error || -error > max_error) {
+				max_error = (error < 0) ? -error : error;
+			}
+		}
+		if (frame <= window && error < first_earliest) {
+			first_earliest = error;
+		}
+		if (frame >= times.size() - window && error < last_earliest) {
+			last_earliest = error;
+		}
+	}
+	// the main loop delays frames by up to a refresh of the cube (for long runs of frames when the waits keep in step with
+	// the refresh), the earliest frames are not delayed
+	const double drift = last_earliest - first_earliest;
+	const bool ok = max_error < 1e6 / 60 && drift < 1000 && -drift < 1000;
+	
+	printf("%-22s %5zu frames in %3lu s, frames at most %5.2f ms late, drift %5.2f ms (rounded to ticks: %+8.1f ms)%s\n",
+		name, times.size(), song_ms / 1000, max_error / 1000, drift / 1000, rounded / 1000, ok ? "" : "  FAILED");
+	led_cube.stopCurrentSequence();
+	return ok;
+}
+
+int main()
+{
+	bool ok = run("120 bpm", false);
+	ok &= run("120 bpm, then 90 bpm", true);
+	printf("%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,290 @@
+/* Checks the frame budget of the cube (LedCube::setBudgetPolicy()) in a simulated main loop (virtual time, slow digitalWrite()):
+ * - the budget derived from the fixed and the automatic refresh, and a given one
+ * - a sequence whose frames take longer than the budget (12 pieces of work of 500 us every 20 ms) under every policy:
+ *   refresh rate chosen by the tuning, longest gap, overruns, frames split, deferred and finished, detail, drift of the
+ *   sequence, and the profiler records every finished frame once (a split one too)
+ * - sequences::MatrixRain split into many calls (every call over a budget of 1 us with the virtual time following
+ *   the real time) shows the same frames as in whole calls, with the lowest detail at most one drop falls
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. budget_check.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeProfiler.cpp -o budget_check
+ */
+
+#include <stdio.h>
+#include <vector>
+
+#include "LedCube.h"
+#include "LedCubeProfiler.h"
+
+static const int size = 4;
+static const int num_layers = 8;
+static const int num_columns = 8;
+int led_cube_map[num_layers][num_columns];
+int * p_led_cube_map[num_layers] = {
+	led_cube_map[0], led_cube_map[1], led_cube_map[2], led_cube_map[3],
+	led_cube_map[4], led_cube_map[5], led_cube_map[6], led_cube_map[7]
+};
+int layer[num_layers] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column[num_columns] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+static const unsigned long write_us = 5;
+static const unsigned long loop_us = 20;
+static const unsigned long min_time_for_layer = 100;
+
+static void slowWrite(uint8_t pin, uint8_t value)
+{
+	(void)pin;
+	(void)value;
+	hostAdvance(write_us);
+}
+
+// frames of pieces of work, split at the budget (SPLIT_WORK) or fewer of them with a lowered detail (LOWER_DETAIL)
+class Heavy : public LedCubeSequence
+{
+public:
+	static const unsigned long wait = 20; // [ms]
+	static const int pieces = 12;
+	static const unsigned long piece_us = 500;
+private:
+	int _piece;
+	int _frame_pieces;
+public:
+	unsigned long finished; // frames
+	
+	Heavy(LedCube * led_cube)
+		: LedCubeSequence(led_cube), _piece(0), _frame_pieces(0), finished(0)
+	{}
+	
+	unsigned long operator()()
+	{
+		if (_piece == 0) {
+			_frame_pieces = pieces * _led_cube->getDetail() / 255;
+			if (_frame_pieces < 1) {
+				_frame_pieces = 1;
+			}
+		}
+		while (_piece < _frame_pieces) {
+			hostAdvance(piece_us);
+			_piece += 1;
+			if (_piece < _frame_pieces && _isOverBudget(piece_us)) {
+				return _continueFrame();
+			}
+		}
+		_piece = 0;
+		finished += 1;
+		return wait;
+	}
+};
+
+class Player : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	
+	unsigned long run() {
+		const unsigned long wait = _led_cube->nextFrameOfSequence();
+		
+		return (wait > 0) ? wait : 1;
+	}
+
+public:
+	Player(LedCube * led_cube)
+		: _led_cube(led_cube)
+	{
+		start(1);
+	}
+};
+
+static void loopFor(unsigned long ms)
+{
+	const unsigned long long end = hostTime() + (unsigned long long)ms * 1000;
+	
+	while (hostTime() < end) {
+		VariableTimedAction::updateActions();
+		hostAdvance(loop_us);
+	}
+}
+
+static bool checkBudgets()
+{
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	Player player(&led_cube);
+	bool ok = true;
+	
+	led_cube.setSequence(new Heavy(&led_cube));
+	loopFor(100);
+	const unsigned long fixed = led_cube.getFrameBudget();
+	// the half of the period the layers leave, without the switching
+	const unsigned long expected_fixed = 1000000UL / 60 - led_cube.getTimeForLayerMicros() * num_layers
+		- led_cube.getRefreshStats().scan_overhead * num_layers;
+	
+	led_cube.setAutoRefresh(true, 30, 200, min_time_for_layer);
+	loopFor(1000);
+	const unsigned long automatic = led_cube.getFrameBudget();
+	const unsigned long switching = led_cube.getRefreshStats().scan_overhead * num_layers;
+	
+	led_cube.setBudgetPolicy(LedCube::COUNT_ONLY, 2500);
+	loopFor(100);
+	const unsigned long given = led_cube.getFrameBudget();
+	
+	// 1e6 / 200 * 8 / 9 without the scan
+	const unsigned long expected = 1000000UL / 200 * 8 / 9 - switching - min_time_for_layer * num_layers;
+	
+	ok &= (long)(fixed - expected_fixed) <= (long)num_layers && (long)(expected_fixed - fixed) <= (long)num_layers;
+	ok &= (long)(automatic - expected) <= (long)num_layers && (long)(expected - automatic) <= (long)num_layers;
+	ok &= given == 2500;
+	printf("budget: fixed 60 Hz %lu us (expected %lu us), automatic 30-200 Hz %lu us (expected %lu us), given %lu us%s\n\n",
+		fixed, expected_fixed, automatic, expected, given, ok ? "" : "  FAILED");
+	return ok;
+}
+
+static bool run(const char * name, LedCube::BudgetPolicy policy)
+{
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	Player player(&led_cube);
+	Heavy * heavy = new Heavy(&led_cube);
+	LedCubeProfiler profiler(&led_cube);
+	
+	led_cube.setProfiler(&profiler);
+	led_cube.setAutoRefresh(true, 30, 200, min_time_for_layer);
+	led_cube.setBudgetPolicy(policy);
+	led_cube.setSequence(heavy);
+	// settles, then measures
+	loopFor(3000);
+	led_cube.resetRefreshStats();
+	const unsigned long finished = heavy->finished;
+	const unsigned long overruns = led_cube.getBudgetOverruns();
+	const unsigned long split = led_cube.getSplitFrames();
+	const unsigned long deferred = led_cube.getDeferredFrames();
+	const unsigned long recorded = profiler.getProfile(profiler::OTHER).frames;
+	loopFor(10000);
+	
+	const LedCubeRefreshStats stats = led_cube.getRefreshStats();
+	const unsigned long frames = heavy->finished - finished;
+	const unsigned long calls_over = led_cube.getBudgetOverruns() - overruns;
+	const unsigned long budget = led_cube.getFrameBudget();
+	const int rate = led_cube.getTargetRefreshFrequency();
+	const long drift = led_cube.getSequenceDrift();
+	// a frame recorded when it is finished (the measured ones end with the last one)
+	bool ok = true;
+	const long records = profiler.getProfile(profiler::OTHER).frames - recorded;
+	const bool records_ok = records >= (long)frames - 1 && records <= (long)frames + 1;
+	
+	switch (policy) {
+		case LedCube::COUNT_ONLY:
+			// every frame over, the tuning makes room for it
+			ok = calls_over >= frames && rate < 150 && frames >= 495;
+			break;
+		case LedCube::SPLIT_WORK:
+			// every frame on time, the refresh at its highest rate
+			ok = rate == 200 && frames >= 495 && stats.max_gap <= budget + 100;
+			break;
+		case LedCube::DEFER_FRAME:
+			// every frame a pass later, the sequence keeps its speed
+			ok = frames >= 495 && led_cube.getDeferredFrames() - deferred >= frames - 2 && drift < (long)Heavy::wait;
+			break;
+		case LedCube::LOWER_DETAIL:
+			// the detail fits the frames into the budget, rare overruns while it probes higher
+			ok = rate >= 150 && frames >= 495 && led_cube.getDetail() * Heavy::pieces / 255 * Heavy::piece_us <= budget + Heavy::piece_us
+				&& calls_over * 5 < frames;
+			break;
+	}
+	ok &= records_ok;
+	printf("%-13s %4d Hz  %5lu us  %6lu us  %6lu  %6lu  %6lu  %6lu  %5u  %5ld ms  %6ld%s\n", name, rate, budget, stats.max_gap,
+		calls_over, led_cube.getSplitFrames() - split, led_cube.getDeferredFrames() - deferred, frames, led_cube.getDetail(),
+		drift, records, ok ? "" : "  FAILED");
+	led_cube.stopCurrentSequence();
+	led_cube.setProfiler(nullptr);
+	return ok;
+}
+
+static unsigned long hashMap()
+{
+	unsigned long hash = 2166136261UL;
+	
+	for (int l = 0; l < num_layers; ++l) {
+		for (int c = 0; c < num_columns; ++c) {
+			hash = (hash ^ (led_cube_map[l][c] != 0)) * 16777619UL;
+		}
+	}
+	return hash;
+}
+
+// frames of sequences::MatrixRain: the map after every whole frame
+static std::vector<unsigned long> rain(LedCube::BudgetPolicy policy, unsigned long budget, unsigned long &calls, int &max_lit)
+{
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	std::vector<unsigned long> frames;
+	
+	randomSeed(7);
+	led_cube.setBudgetPolicy(policy, budget);
+	led_cube.setSequence(new sequences::MatrixRain(&led_cube, 10, 400));
+	calls = 0;
+	max_lit = 0;
+	while (led_cube.isSequenceRunning()) {
+		const unsigned long split = led_cube.getSplitFrames();
+		const unsigned long wait = led_cube.nextFrameOfSequence();
+		
+		calls += 1;
+		if (wait == 0 || led_cube.getSplitFrames() != split) {
+			continue;
+		}
+		frames.push_back(hashMap());
+		// the drops from before the detail went down have fallen
+		if (frames.size() > 40) {
+			int lit = 0;
+			
+			for (int l = 0; l < num_layers; ++l) {
+				for (int c = 0; c < num_columns; ++c) {
+					lit += led_cube_map[l][c] != 0;
+				}
+			}
+			if (lit > max_lit) {
+				max_lit = lit;
+			}
+		}
+		hostAdvance(wait * 1000);
+	}
+	return frames;
+}
+
+static bool checkRain()
+{
+	unsigned long whole_calls, split_calls, low_calls;
+	int whole_lit, split_lit, low_lit;
+	
+	const std::vector<unsigned long> whole = rain(LedCube::COUNT_ONLY, 0, whole_calls, whole_lit);
+	hostSetRealTimeScale(1000);
+	const std::vector<unsigned long> split = rain(LedCube::SPLIT_WORK, 1, split_calls, split_lit);
+	const std::vector<unsigned long> low = rain(LedCube::LOWER_DETAIL, 1, low_calls, low_lit);
+	hostSetRealTimeScale(0);
+	
+	const bool same = whole == split;
+	const bool ok = same && split_calls > 4 * whole_calls && low_lit <= 1 && whole_lit > 1;
+	
+	printf("\nMatrixRain: %zu frames in %lu calls, split %zu frames in %lu calls (%s), lowest detail %zu frames"
+		" (at most %d LEDs lit, %d in whole frames)%s\n",
+		whole.size(), whole_calls, split.size(), split_calls, same ? "same frames" : "DIFFERENT frames", low.size(),
+		low_lit, whole_lit, ok ? "" : "  FAILED");
+	return ok;
+}
+
+int main()
+{
+	bool ok = true;
+	
+	hostSetDigitalWriteHook(slowWrite);
+	printf("%lu us per digitalWrite(), %lu us per pass of the main loop, automatic refresh 30-200 Hz, at least %lu us per layer\n",
+		write_us, loop_us, min_time_for_layer);
+	printf("frames of %d x %lu us every %lu ms\n\n", Heavy::pieces, Heavy::piece_us, Heavy::wait);
+	ok &= checkBudgets();
+	printf("%-13s %7s  %8s  %9s  %6s  %6s  %6s  %6s  %5s  %8s  %6s\n", "policy", "rate", "budget", "max gap", "over", "split",
+		"defer", "frames", "detail", "drift", "record");
+	ok &= run("COUNT_ONLY", LedCube::COUNT_ONLY);
+	ok &= run("SPLIT_WORK", LedCube::SPLIT_WORK);
+	ok &= run("DEFER_FRAME", LedCube::DEFER_FRAME);
+	ok &= run("LOWER_DETAIL", LedCube::LOWER_DETAIL);
+	ok &= checkRain();
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
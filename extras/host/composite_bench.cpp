@@ -0,0 +1,244 @@
+/* Checks sequences::Composite (LedCubeComposite.h) and measures the cost of compositing:
+ * - LayerStompUpAndDown OR Propeller XOR a blinking corner, MASK of a blinking plane, on 4x4x4 and 8x8x8 cubes,
+ *   and on 4x4x4 with the base added with AND (shown as it is, not blanked)
+ * - every frame is compared with the same layers played separately and combined LED by LED
+ * - reports how many frames needed compositing and the time of compositing on whole bytes
+ *   against combining every frame LED by LED
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. composite_bench.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeComposite.cpp -o composite_bench
+ */
+
+#include <stdio.h>
+#include <chrono>
+
+#include "LedCube.h"
+#include "LedCubeComposite.h"
+
+int map_4[8][8];
+int * p_map_4[8] = {map_4[0], map_4[1], map_4[2], map_4[3], map_4[4], map_4[5], map_4[6], map_4[7]};
+int layer_4[8] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column_4[8] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+int map_8[8][64];
+int * p_map_8[8] = {map_8[0], map_8[1], map_8[2], map_8[3], map_8[4], map_8[5], map_8[6], map_8[7]};
+int layer_8[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+int column_8[64];
+
+// LED blinking in the corner: on for on_time, off for off_time (never ends)
+class Heartbeat : public LedCubeSequence
+{
+protected:
+	const unsigned long _on_time; // [ms]
+	const unsigned long _off_time; // [ms]
+public:
+	Heartbeat(LedCube * led_cube, unsigned long on_time=100, unsigned long off_time=900)
+		: LedCubeSequence(led_cube), _on_time(on_time), _off_time(off_time)
+	{}
+	
+	unsigned long operator()()
+	{
+		const int last = _led_cube->getSize() - 1;
+		
+		_state = !_state;
+		if (_state) {
+			_led_cube->turnOn(last, last, last);
+			return _on_time;
+		}
+		_led_cube->turnOff(last, last, last);
+		return _off_time;
+	}
+};
+
+// plane z = 0 shown for 1 s every 3 s
+class BlinkingPlane : public LedCubeSequence
+{
+public:
+	BlinkingPlane(LedCube * led_cube)
+		: LedCubeSequence(led_cube)
+	{}
+	
+	unsigned long operator()()
+	{
+		const int size = _led_cube->getSize();
+		
+		_state = !_state;
+		for (int y = 0; y < size; ++y) {
+			_led_cube->setRow(y, 0, _state ? (1 << size) - 1 : 0);
+		}
+		return _state ? 1000 : 2000;
+	}
+};
+
+static const int num_layers = 4;
+static composite::Operator ops[num_layers] = {composite::OR, composite::OR, composite::XOR, composite::MASK};
+
+static LedCubeSequence * createLayer(LedCube * led_cube, int l)
+{
+	switch (l) {
+		case 0: return new sequences::LayerStompUpAndDown(led_cube);
+		case 1: return new sequences::Propeller(led_cube, 90, 1000);
+		case 2: return new Heartbeat(led_cube);
+		default: return new BlinkingPlane(led_cube);
+	}
+}
+
+/* The same layers played separately, each frame combined LED by LED (getState/turnOn/turnOff of the cube),
+ * as a sequence without layers would have to do it.
+ */
+struct Reference
+{
+	LedCube * led_cube;
+	LedCubeSequence * sequences[num_layers];
+	LedCubeFrame * frames[num_layers];
+	unsigned long due[num_layers];
+	
+	Reference(LedCube * cube)
+		: led_cube(cube)
+	{
+		for (int l = 0; l < num_layers; ++l) {
+			sequences[l] = createLayer(led_cube, l);
+			frames[l] = new LedCubeFrame(led_cube->getSize());
+			due[l] = 0;
+		}
+	}
+	
+	~Reference()
+	{
+		for (int l = 0; l < num_layers; ++l) {
+			delete sequences[l];
+			delete frames[l];
+		}
+	}
+	
+	void advance(unsigned long time)
+	{
+		for (int l = 0; l < num_layers; ++l) {
+			while (sequences[l] != nullptr && due[l] <= time) {
+				led_cube->setRenderTarget(frames[l]);
+				const unsigned long wait = (*sequences[l])();
+				led_cube->setRenderTarget(nullptr);
+				if (wait == 0) {
+					delete sequences[l];
+					sequences[l] = nullptr;
+				} else {
+					due[l] += wait;
+				}
+			}
+		}
+	}
+	
+	int expected(int x, int y, int z)
+	{
+		// the base is taken as it is
+		int state = frames[0]->getState(x, y, z);
+		
+		for (int l = 1; l < num_layers; ++l) {
+			if (sequences[l] == nullptr) {
+				continue;
+			}
+			const int led = frames[l]->getState(x, y, z);
+			switch (ops[l]) {
+				case composite::OR: state |= led; break;
+				case composite::AND: state &= led; break;
+				case composite::XOR: state ^= led; break;
+				case composite::MASK: state &= !led; break;
+			}
+		}
+		return state;
+	}
+	
+	// writes the combination into the map
+	void show()
+	{
+		const int size = led_cube->getSize();
+		
+		for (int z = 0; z < size; ++z) {
+			for (int y = 0; y < size; ++y) {
+				for (int x = 0; x < size; ++x) {
+					if (expected(x, y, z)) {
+						led_cube->turnOn(x, y, z);
+					} else {
+						led_cube->turnOff(x, y, z);
+					}
+				}
+			}
+		}
+	}
+};
+
+static bool check(const char * name, LedCube &led_cube)
+{
+	const int size = led_cube.getSize();
+	
+	led_cube.turnEverythingOff();
+	sequences::Composite composite(&led_cube);
+	for (int l = 0; l < num_layers; ++l) {
+		composite.addLayer(createLayer(&led_cube, l), ops[l]);
+	}
+	Reference reference(&led_cube);
+	unsigned long time = 0, frames = 0, wrong = 0, wait;
+	while ((wait = composite()) != 0) {
+		reference.advance(time);
+		for (int z = 0; z < size; ++z) {
+			for (int y = 0; y < size; ++y) {
+				for (int x = 0; x < size; ++x) {
+					if (led_cube.getState(x, y, z) != reference.expected(x, y, z)) {
+						wrong += 1;
+					}
+				}
+			}
+		}
+		frames += 1;
+		time += wait;
+	}
+	
+	// time of the compositing alone: the same frames again, composited on bytes / LED by LED
+	const int repeats = 200;
+	double composite_ns = 0, reference_ns = 0;
+	unsigned long composites = 0;
+	for (int r = 0; r < repeats; ++r) {
+		sequences::Composite timed(&led_cube);
+		for (int l = 0; l < num_layers; ++l) {
+			timed.addLayer(createLayer(&led_cube, l), ops[l]);
+		}
+		Reference naive(&led_cube);
+		time = 0;
+		while (true) {
+			auto start = std::chrono::steady_clock::now();
+			wait = timed();
+			composite_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			if (wait == 0) {
+				break;
+			}
+			naive.advance(time);
+			start = std::chrono::steady_clock::now();
+			naive.show();
+			reference_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			time += wait;
+		}
+		composites = timed.getComposites();
+	}
+	
+	printf("%s: %lu frames in %lu ms, %lu composited, %lu without writing the map, %lu LEDs differ from the layers combined LED by LED => %s\n",
+		name, frames, time, composites, composite.getSkippedWrites(), wrong, (wrong == 0) ? "OK" : "WRONG");
+	printf("  per frame: composite (frames of the layers + compositing on bytes) %.0f ns, combining LED by LED alone %.0f ns\n",
+		composite_ns / repeats / frames, reference_ns / repeats / frames);
+	return wrong == 0;
+}
+
+int main()
+{
+	for (int i = 0; i < 64; ++i) {
+		column_8[i] = i;
+	}
+	LedCube led_cube_4(p_map_4, layer_4, column_4, 8, 8, 4, 60);
+	LedCube led_cube_8(p_map_8, layer_8, column_8, 8, 64, 8, 60);
+	
+	bool ok = check("4x4x4", led_cube_4);
+	ok &= check("8x8x8", led_cube_8);
+	// the operator of the base is not used: AND has nothing under it to combine with
+	ops[0] = composite::AND;
+	ok &= check("4x4x4, AND base", led_cube_4);
+	return ok ? 0 : 1;
+}
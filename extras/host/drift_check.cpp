@@ -0,0 +1,181 @@
+/* Checks the late policies of the cube (LedCube::setLatePolicy()) with sequences::Demo on 4x4x4 in the main loop of
+ * the examples (virtual time, the blocking refresh at 60 Hz, every digitalWrite() takes write_us, idle time skipped):
+ * - length of the Demo, drift at its end (LedCube::getSequenceDrift()) and dropped frames under CATCH_UP, DROP and STRETCH
+ * - the drift of every sequence of the Demo (sequences::Playlist::getLastDrift()), summed over its runs, and the largest one
+ * - checks that CATCH_UP and DROP end less than a refresh behind the sum of the waits, so they take as long as STRETCH
+ *   without its drift, and that the sequences of the Demo make up the drift of STRETCH
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. drift_check.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp -o drift_check
+ */
+
+#include <stdio.h>
+
+#include "LedCube.h"
+
+static const int size = 4;
+static const int num_layers = 8;
+static const int num_columns = 8;
+int led_cube_map[num_layers][num_columns];
+int * p_led_cube_map[num_layers] = {
+	led_cube_map[0], led_cube_map[1], led_cube_map[2], led_cube_map[3],
+	led_cube_map[4], led_cube_map[5], led_cube_map[6], led_cube_map[7]
+};
+int layer[num_layers] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column[num_columns] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+static const unsigned long write_us = 5;
+static const unsigned long loop_us = 20;
+static const long refresh_ms = 1000 / 60 + 1;
+
+// playlist::SequenceId by name
+static const char * const names[playlist::PAUSE] = {
+	"off", "on", "flicker_on", "flicker_off", "up_down", "sideways", "stomp", "edge_down",
+	"rnd_flicker", "rnd_rain", "matrix_rain", "diagonal", "propeller", "spiral", "all_leds"
+};
+
+static void slowWrite(uint8_t pin, uint8_t value)
+{
+	(void)pin;
+	(void)value;
+	hostAdvance(write_us);
+}
+
+// the Demo, the drift of every sequence when it ends
+class RecordedDemo : public sequences::Demo
+{
+public:
+	long drifts[playlist::PAUSE];
+	int ends[playlist::PAUSE];
+	
+	RecordedDemo(LedCube * led_cube)
+		: sequences::Demo(led_cube), drifts(), ends()
+	{}
+	
+	unsigned long operator()()
+	{
+		const bool is_playing = _state == 1;
+		const uint8_t type = _current_type;
+		const unsigned long switches = _switches;
+		const unsigned long wait = sequences::Demo::operator()();
+		
+		// the sequence ended: the next one starts (at once or after the gap) or the list ends (a sequence which starts and
+		// ends in one call, e.g. turning everything on, has no drift and is not counted)
+		if (is_playing && (_state != 1 || _switches != switches || wait == 0)) {
+			drifts[type] += _last_drift;
+			ends[type] += 1;
+		}
+		return wait;
+	}
+};
+
+class Player : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	
+	unsigned long run() {
+		const unsigned long wait = _led_cube->nextFrameOfSequence();
+		
+		return (wait > 0) ? wait : 1;
+	}
+
+public:
+	Player(LedCube * led_cube)
+		: _led_cube(led_cube)
+	{
+		start(1);
+	}
+};
+
+struct Result
+{
+	double seconds;
+	long drift; // [ms] at the end
+	unsigned long dropped;
+	long drifts[playlist::PAUSE]; // [ms] of the sequences
+	int ends[playlist::PAUSE];
+	long max_drift;
+	uint8_t max_drift_type;
+};
+
+static Result run(LedCube::LatePolicy policy)
+{
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	Player player(&led_cube);
+	RecordedDemo * demo = new RecordedDemo(&led_cube);
+	Result result;
+	
+	randomSeed(1);
+	led_cube.setLatePolicy(policy);
+	led_cube.setSequence(demo);
+	const unsigned long long start = hostTime();
+	while (led_cube.isSequenceRunning()) {
+		VariableTimedAction::updateActions();
+		// a pass of the main loop, or the idle time until the next action
+		const unsigned long idle = VariableTimedAction::hostUntilNext();
+		unsigned long long step = loop_us;
+		
+		if (idle > 0 && idle != 0xFFFFFFFFUL) {
+			const unsigned long long due = (hostTime() / 1000 + idle) * 1000;
+			
+			if (due > hostTime() + loop_us) {
+				step = due - hostTime();
+			}
+		}
+		hostAdvance(step);
+		if (led_cube.isSequenceRunning()) {
+			// the cube deletes the Demo with its last frame
+			for (int type = 0; type < playlist::PAUSE; ++type) {
+				result.drifts[type] = demo->drifts[type];
+				result.ends[type] = demo->ends[type];
+			}
+			result.max_drift = demo->getMaxDrift();
+			result.max_drift_type = demo->getMaxDriftType();
+		}
+	}
+	result.seconds = (hostTime() - start) / 1e6;
+	result.drift = led_cube.getSequenceDrift();
+	result.dropped = led_cube.getDroppedFrames();
+	return result;
+}
+
+int main()
+{
+	hostSetDigitalWriteHook(slowWrite);
+	const Result catch_up = run(LedCube::CATCH_UP);
+	const Result drop = run(LedCube::DROP);
+	const Result stretch = run(LedCube::STRETCH);
+	const Result * results[3] = {&catch_up, &drop, &stretch};
+	const char * policies[3] = {"CATCH_UP", "DROP", "STRETCH"};
+	
+	printf("sequences::Demo on 4x4x4, blocking refresh at 60 Hz:\n");
+	for (int i = 0; i < 3; ++i) {
+		printf("  %-8s %6.1f s, drift at the end %6ld ms, %4lu frames dropped, largest drift of a sequence %5ld ms (%s)\n",
+			policies[i], results[i]->seconds, results[i]->drift, results[i]->dropped, results[i]->max_drift,
+			names[results[i]->max_drift_type]);
+	}
+	
+	printf("\ndrift of the sequences [ms], summed over their runs:\n  %-12s %4s %9s %9s %9s\n", "sequence", "runs", "CATCH_UP", "DROP", "STRETCH");
+	long stretch_sum = 0;
+	for (int type = 0; type < playlist::PAUSE; ++type) {
+		if (stretch.ends[type] == 0) {
+			continue;
+		}
+		printf("  %-12s %4d %9ld %9ld %9ld\n", names[type], stretch.ends[type], catch_up.drifts[type], drop.drifts[type],
+			stretch.drifts[type]);
+		stretch_sum += stretch.drifts[type];
+	}
+	
+	bool ok = true;
+	for (int i = 0; i < 2; ++i) {
+		const double expected = stretch.seconds - stretch.drift / 1000.0;
+		
+		ok &= results[i]->drift < refresh_ms && -results[i]->drift < refresh_ms;
+		ok &= results[i]->seconds - expected < 0.1 && expected - results[i]->seconds < 0.1;
+	}
+	// the gaps between the sequences add the rest
+	ok &= stretch_sum <= stretch.drift && stretch_sum * 10 >= stretch.drift * 9;
+	printf("\nSTRETCH: %ld of %ld ms of drift in the sequences\n%s\n", stretch_sum, stretch.drift, ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
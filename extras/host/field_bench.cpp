@@ -0,0 +1,257 @@
+/* Checks and measures the procedural fields (LedCubeField.h) on 4x4x4, 8x8x8 and 16x16x16 cubes:
+ * - for all 256 frames: the rows evaluated incrementally against value() of every LED, the cube against the band
+ * - the lit LEDs against the same field computed in doubles (an LED may differ only where the exact value
+ *   is within the tolerance of the edge of the band)
+ * - the time of evaluating a frame by rows, by value() for every LED and by a function in doubles for every LED,
+ *   and of the whole frame with writing the LEDs (8x8x8)
+ * - sequences::Shader: frames drawn and the dark cube at the end
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. field_bench.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeVector.cpp ../../LedCubeField.cpp -o field_bench
+ */
+
+#include <stdio.h>
+#include <chrono>
+
+#include "LedCube.h"
+#include "LedCubeField.h"
+
+int map_4[8][8];
+int * p_map_4[8] = {map_4[0], map_4[1], map_4[2], map_4[3], map_4[4], map_4[5], map_4[6], map_4[7]};
+int layer_4[8] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column_4[8] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+int map_8[8][64];
+int * p_map_8[8] = {map_8[0], map_8[1], map_8[2], map_8[3], map_8[4], map_8[5], map_8[6], map_8[7]};
+int layer_8[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+int column_8[64];
+
+int map_16[16][256];
+int * p_map_16[16];
+int layer_16[16];
+int column_16[256];
+
+static double nowNs()
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double turn(double angle)
+{
+	return angle * 2 * M_PI / 256;
+}
+
+// the built-in fields with their default parameters in doubles, in the same units
+static double exactPlane(int size, int t, int x, int y, int z)
+{
+	const double c = (size - 1) / 2.0;
+	const double a = turn((uint8_t)(t * 2)), b = turn((uint8_t)(t * 3));
+	
+	return 256 * (cos(b) * cos(a) * (x - c) + cos(b) * sin(a) * (y - c) + sin(b) * (z - c));
+}
+
+static double exactWave(int size, int t, int x, int y, int z)
+{
+	const double height = (size - 1) * 128 + (size - 1) * 64 * sin(turn((256 / size) * x + (128 / size) * y + t));
+	
+	return z * 256 - height;
+}
+
+static double exactRipple(int size, int t, int x, int y, int z)
+{
+	const double c = (size - 1) / 2.0;
+	const double distance = sqrt((x - c) * (x - c) + (y - c) * (y - c));
+	const double height = (size - 1) * 128 + (size - 1) * 64 * sin(turn((512 / size) * distance - t));
+	
+	return z * 256 - height;
+}
+
+static double exactPlasma(int size, int t, int x, int y, int z)
+{
+	const int k = 256 / size;
+	
+	return 64 * (sin(turn(k * x + t)) + sin(turn(k * y - 2 * t + 64)) + sin(turn(k * z + 3 * t + 128)) + sin(turn(k * (x + y + z) / 2.0 - t)));
+}
+
+// the same field drawn by value() for every LED
+template <class Field>
+class PerLed : public Field
+{
+public:
+	using Field::Field;
+	
+	void row(int y, int z, int16_t * values) { LedCubeField::row(y, z, values); }
+};
+
+static int16_t plasmaInDoubles(int x, int y, int z, uint8_t t)
+{
+	return (int16_t)lround(exactPlasma(8, t, x, y, z));
+}
+
+static bool check(LedCube &led_cube, const char * name, LedCubeField &field, double (*exact)(int, int, int, int, int), int16_t low, int16_t high, double tolerance)
+{
+	const int size = led_cube.getSize();
+	int16_t values[16];
+	long leds = 0, lit = 0, rows_wrong = 0, cube_wrong = 0, borderline = 0, wrong = 0;
+	
+	for (int t = 0; t < 256; ++t) {
+		field.draw(t);
+		for (int z = 0; z < size; ++z) {
+			for (int y = 0; y < size; ++y) {
+				field.row(y, z, values);
+				for (int x = 0; x < size; ++x) {
+					const int16_t value = field.value(x, y, z);
+					const bool is_lit = value >= low && value <= high;
+					const double e = exact(size, t, x, y, z);
+					const bool is_exact_lit = e >= low - 0.5 && e < high + 0.5;
+					
+					rows_wrong += values[x] != value;
+					cube_wrong += (led_cube.getState(x, y, z) == HIGH) != is_lit;
+					if (is_lit != is_exact_lit) {
+						if (fabs(e - low) <= tolerance || fabs(e - high) <= tolerance) {
+							borderline += 1;
+						} else {
+							wrong += 1;
+						}
+					}
+					lit += is_lit;
+					leds += 1;
+				}
+			}
+		}
+	}
+	const bool ok = rows_wrong == 0 && cube_wrong == 0 && wrong == 0;
+	printf("%2dx%2dx%-2d %-7s %8ld LEDs %5.1f%% lit: rows %ld, cube %ld wrong; against doubles %4ld at the edge (+-%.0f), %ld wrong%s\n",
+		size, size, size, name, leds, 100.0 * lit / leds, rows_wrong, cube_wrong, borderline, tolerance, wrong, ok ? "" : "  FAILED");
+	return ok;
+}
+
+static bool checkAll(LedCube &led_cube)
+{
+	bool ok = true;
+	fields::Plane plane(&led_cube);
+	fields::Wave wave(&led_cube);
+	fields::Ripple ripple(&led_cube);
+	fields::Plasma plasma(&led_cube);
+	
+	ok &= check(led_cube, "plane", plane, exactPlane, -128, 127, 16);
+	ok &= check(led_cube, "wave", wave, exactWave, -128, 127, 8);
+	ok &= check(led_cube, "ripple", ripple, exactRipple, -128, 127, 16);
+	ok &= check(led_cube, "plasma", plasma, exactPlasma, -40, 40, 6);
+	return ok;
+}
+
+static const int frames = 5000;
+
+// a whole frame: evaluated and written into the cube
+static double measure(LedCubeField &field)
+{
+	const double start = nowNs();
+	
+	for (int i = 0; i < frames; ++i) {
+		field.draw(i);
+	}
+	return (nowNs() - start) / frames;
+}
+
+// only evaluated (begin() and all rows)
+static double measureValues(LedCubeField &field, int size)
+{
+	int16_t values[16];
+	int sum = 0;
+	const double start = nowNs();
+	
+	for (int i = 0; i < frames; ++i) {
+		field.begin(i);
+		for (int z = 0; z < size; ++z) {
+			for (int y = 0; y < size; ++y) {
+				field.row(y, z, values);
+				sum += values[y];
+			}
+		}
+	}
+	const double ns = (nowNs() - start) / frames;
+	
+	// keeps the values from being optimized out
+	if (sum == 0x7FFFFFFF) {
+		printf("\n");
+	}
+	return ns;
+}
+
+template <class Field>
+static void measureField(LedCube &led_cube, const char * name)
+{
+	const int size = led_cube.getSize();
+	const int leds = size * size * size;
+	Field by_rows(&led_cube);
+	PerLed<Field> by_leds(&led_cube);
+	const double rows_ns = measureValues(by_rows, size);
+	const double leds_ns = measureValues(by_leds, size);
+	const double frame_ns = measure(by_rows);
+	
+	printf("%-7s %7.0f ns %5.2f ns/LED  %7.0f ns %5.2f ns/LED  %5.1fx  %8.0f ns\n",
+		name, rows_ns, rows_ns / leds, leds_ns, leds_ns / leds, leds_ns / rows_ns, frame_ns);
+}
+
+static bool checkSequence(LedCube &led_cube)
+{
+	const int size = led_cube.getSize();
+	sequences::Shader shader(&led_cube, new fields::Ripple(&led_cube), 40, 300, 3);
+	int frames = 0;
+	bool is_dark = false;
+	
+	while (shader() != 0) {
+		frames += 1;
+		is_dark = true;
+		for (int z = 0; z < size && is_dark; ++z) {
+			for (int y = 0; y < size && is_dark; ++y) {
+				for (int x = 0; x < size; ++x) {
+					if (led_cube.getState(x, y, z) == HIGH) {
+						is_dark = false;
+						break;
+					}
+				}
+			}
+		}
+	}
+	// 300 frames and the dark one at the end
+	const bool ok = frames == 301 && is_dark;
+	printf("%2dx%2dx%-2d sequences::Shader (ripple): %d frames, the last one dark: %s%s\n",
+		size, size, size, frames, is_dark ? "yes" : "no", ok ? "" : "  FAILED");
+	return ok;
+}
+
+int main()
+{
+	bool ok = true;
+	
+	for (int i = 0; i < 16; ++i) {
+		p_map_16[i] = map_16[i];
+	}
+	LedCube cube_4(p_map_4, layer_4, column_4, 8, 8, 4, 60);
+	LedCube cube_8(p_map_8, layer_8, column_8, 8, 64, 8, 60);
+	LedCube cube_16(p_map_16, layer_16, column_16, 16, 256, 16, 60);
+	
+	printf("all 256 frames, rows against value() of every LED and against the fields in doubles\n\n");
+	ok &= checkAll(cube_4);
+	ok &= checkAll(cube_8);
+	ok &= checkAll(cube_16);
+	
+	printf("\n8x8x8, evaluation of a frame and the whole frame with writing the LEDs (host time)\n");
+	printf("%-7s %24s  %24s  %6s  %11s\n", "", "by rows (begin(), row())", "value() for every LED", "faster", "whole frame");
+	measureField<fields::Plane>(cube_8, "plane");
+	measureField<fields::Wave>(cube_8, "wave");
+	measureField<fields::Ripple>(cube_8, "ripple");
+	measureField<fields::Plasma>(cube_8, "plasma");
+	fields::Function in_doubles(&cube_8, plasmaInDoubles, -40, 40);
+	const double doubles_ns = measureValues(in_doubles, 8);
+	printf("%-7s %24s  %7.0f ns %5.2f ns/LED  (fields::Function, the plasma in doubles for every LED)\n", "doubles", "", doubles_ns, doubles_ns / 512);
+	
+	printf("\n");
+	ok &= checkSequence(cube_4);
+	ok &= checkSequence(cube_8);
+	ok &= checkSequence(cube_16);
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
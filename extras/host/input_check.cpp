@@ -0,0 +1,400 @@
+/* Plays a cursor game (one LED moved by three buttons and a joystick axis) through LedCubeInput with scripted input:
+ * - buttons are pressed and released every 150-400 ms with 2-4 bounces within 1.5 ms, the axis jumps now and then
+ * - the script changes the pins while the virtual time moves (also during the refresh), the pin change interrupt
+ *   calls LedCubeInput::capture() at once
+ * - the photon is found on the pins: the first time the layer with the new position of the cursor is lit with its column
+ * - reports the input to photon latency (on the pins and measured by the library), bounces and wrong LEDs
+ *   for the input read only from the main loop and for the interrupt with reading while the layers are lit
+ * - checks that every press moved the cursor exactly once and, with the automatic refresh (up to 200 Hz), the latency under 20 ms
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. input_check.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeInput.cpp -o input_check
+ */
+
+#include <stdio.h>
+#include <vector>
+
+#include "LedCube.h"
+#include "LedCubeInput.h"
+
+static const int size = 4;
+static const int num_layers = 8;
+static const int num_columns = 8;
+int led_cube_map[num_layers][num_columns];
+int * p_led_cube_map[num_layers] = {
+	led_cube_map[0], led_cube_map[1], led_cube_map[2], led_cube_map[3],
+	led_cube_map[4], led_cube_map[5], led_cube_map[6], led_cube_map[7]
+};
+int layer[num_layers] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column[num_columns] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+enum Button {
+	LEFT,
+	RIGHT,
+	UP
+};
+static const uint8_t button_pins[] = {20, 21, 22};
+static const uint8_t axis_pins[] = {A4};
+
+static const unsigned long write_us = 5;
+static const unsigned long loop_us = 20;
+static const unsigned long frame_us = 300; // drawing a frame of the game
+static const unsigned long frame_wait = 2; // [ms]
+static const unsigned long settle_ms = 3000; // the refresh finds its rate before the input starts
+static const unsigned long script_ms = 20000;
+static const unsigned long max_latency = 20000; // [us]
+
+// --- the script ---
+
+struct Change
+{
+	unsigned long long time; // [us]
+	int button; // -1 => the axis
+	int value; // level of the pin / position of the axis
+};
+
+// where the cursor should be from the time on (only changes which move it)
+struct Target
+{
+	unsigned long long time; // [us]
+	int led;
+	bool is_seen;
+	unsigned long long photon; // [us]
+};
+
+static std::vector<Change> script;
+static std::vector<Target> targets;
+static unsigned long script_state;
+static int presses;
+static int moves;
+
+static unsigned long scriptRandom(unsigned long range)
+{
+	script_state = script_state * 1103515245UL + 12345UL;
+	return (script_state >> 8) % range;
+}
+
+static int ledIndex(int x, int y, int z) { return x + y * size + z * size * size; }
+
+static int axisToY(int value) { return value * size / 1024; }
+
+// an edge of the button with the bounces before it settles
+static void scriptEdge(unsigned long long time, int button, int level)
+{
+	const int bounces = 2 + scriptRandom(3);
+	unsigned long long t = time;
+	
+	script.push_back({time, button, level});
+	for (int i = 0; i < bounces; ++i) {
+		t += 100 + scriptRandom(300);
+		script.push_back({t, button, (i % 2 == 0) ? !level : level});
+	}
+	if (bounces % 2 == 1) {
+		script.push_back({t + 100, button, level});
+	}
+}
+
+// from the time start on
+static void makeScript(unsigned long long start)
+{
+	int x = 0, y = axisToY(512), z = 0, axis = 512;
+	unsigned long long t = start + (unsigned long long)settle_ms * 1000;
+	
+	script.clear();
+	targets.clear();
+	script_state = 7;
+	presses = 0;
+	moves = 0;
+	targets.push_back({start, ledIndex(x, y, z), false, 0});
+	while (t < start + (unsigned long long)(settle_ms + script_ms) * 1000) {
+		const int kind = scriptRandom(4);
+		
+		if (kind < 3) {
+			const unsigned long long release = t + 60000 + scriptRandom(80000);
+			
+			scriptEdge(t, kind, LOW);
+			scriptEdge(release, kind, HIGH);
+			presses += 1;
+			x = (kind == LEFT) ? (x + size - 1) % size : (kind == RIGHT) ? (x + 1) % size : x;
+			z = (kind == UP) ? (z + 1) % size : z;
+		} else {
+			int value;
+			do {
+				value = scriptRandom(1024);
+			} while (axisToY(value) == y);
+			axis = value;
+			y = axisToY(axis);
+			script.push_back({t, -1, axis});
+			moves += 1;
+		}
+		targets.push_back({t, ledIndex(x, y, z), false, 0});
+		t += 150000 + scriptRandom(250000);
+	}
+}
+
+// --- the simulated board ---
+
+static LedCubeInput * board_input;
+static bool is_interrupt;
+static size_t next_change;
+static int axis_value;
+static bool is_scripting;
+static bool is_mapping;
+static int layer_index[HOST_NUM_PINS]; // -1 => not a layer
+static int led_at[num_layers][num_columns]; // -1 => none
+static int mapped_levels[num_layers][num_columns];
+static int off_levels[num_layers][num_columns];
+static unsigned long wrong_leds;
+
+static int readAxis(uint8_t pin)
+{
+	(void)pin;
+	return axis_value;
+}
+
+static void followScript(unsigned long long now)
+{
+	if (is_scripting) {
+		return;
+	}
+	is_scripting = true;
+	while (next_change < script.size() && script[next_change].time <= now) {
+		const Change &change = script[next_change++];
+		
+		if (change.button < 0) {
+			axis_value = change.value;
+		} else {
+			digitalWrite(button_pins[change.button], change.value);
+			// pin change interrupt
+			if (is_interrupt && board_input != nullptr) {
+				board_input->capture();
+			}
+		}
+	}
+	is_scripting = false;
+}
+
+static void lit(int led)
+{
+	const unsigned long long now = hostTime();
+	size_t k = 0;
+	
+	while (k + 1 < targets.size() && targets[k + 1].time <= now) {
+		k += 1;
+	}
+	if (led == targets[k].led) {
+		if (!targets[k].is_seen) {
+			targets[k].is_seen = true;
+			targets[k].photon = now;
+		}
+	} else if (k == 0 || led != targets[k - 1].led) {
+		wrong_leds += 1;
+	}
+}
+
+static void onWrite(uint8_t pin, uint8_t value)
+{
+	if (is_scripting) {
+		return;
+	}
+	hostAdvance(write_us);
+	if (value != HIGH || layer_index[pin] < 0) {
+		return;
+	}
+	const int l = layer_index[pin];
+	
+	for (int c = 0; c < num_columns; ++c) {
+		if (is_mapping) {
+			mapped_levels[l][c] = digitalRead(column[c]);
+		} else if (digitalRead(column[c]) != off_levels[l][c] && led_at[l][c] >= 0) {
+			lit(led_at[l][c]);
+		}
+	}
+}
+
+// which layer and column light every LED
+static void mapLeds(LedCube &led_cube)
+{
+	is_mapping = true;
+	led_cube.turnEverythingOff();
+	led_cube.update();
+	memcpy(off_levels, mapped_levels, sizeof(off_levels));
+	memset(led_at, -1, sizeof(led_at));
+	for (int z = 0; z < size; ++z) {
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				led_cube.turnEverythingOff();
+				led_cube.turnOn(x, y, z);
+				led_cube.update();
+				for (int l = 0; l < num_layers; ++l) {
+					for (int c = 0; c < num_columns; ++c) {
+						if (mapped_levels[l][c] != off_levels[l][c]) {
+							led_at[l][c] = ledIndex(x, y, z);
+						}
+					}
+				}
+			}
+		}
+	}
+	led_cube.turnEverythingOff();
+	is_mapping = false;
+}
+
+// --- the game ---
+
+class Cursor : public LedCubeSequence
+{
+private:
+	LedCubeInput * _input;
+	int _x;
+	int _y;
+	int _z;
+
+public:
+	Cursor(LedCube * led_cube, LedCubeInput * input)
+		: LedCubeSequence(led_cube), _input(input), _x(0), _y(axisToY(input->getAxis(0))), _z(0)
+	{}
+	
+	unsigned long operator()()
+	{
+		LedCubeInputEvent event;
+		
+		while (_input->read(event)) {
+			if (event.type == input::MOVE) {
+				_y = axisToY(event.value);
+			} else if (event.type == input::PRESS) {
+				_x = (event.source == LEFT) ? (_x + size - 1) % size : (event.source == RIGHT) ? (_x + 1) % size : _x;
+				_z = (event.source == UP) ? (_z + 1) % size : _z;
+			}
+		}
+		_led_cube->turnEverythingOff();
+		_led_cube->turnOn(_x, _y, _z);
+		hostAdvance(frame_us);
+		return frame_wait;
+	}
+	
+	int getLed() { return ledIndex(_x, _y, _z); }
+};
+
+class Manager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	LedCubeInput * _input;
+	Cursor * _cursor;
+	
+	unsigned long run() {
+		if (!_led_cube->isSequenceRunning()) {
+			_cursor = new Cursor(_led_cube, _input);
+			_led_cube->setSequence(_cursor);
+		}
+		return _led_cube->nextFrameOfSequence();
+	}
+
+public:
+	Manager(LedCube * led_cube, LedCubeInput * input)
+		: _led_cube(led_cube), _input(input), _cursor(nullptr)
+	{
+		start(1);
+	}
+	
+	int getLed() { return (_cursor != nullptr) ? _cursor->getLed() : -1; }
+};
+
+// other work of the main loop: work_us every interval
+class Load : public VariableTimedAction
+{
+private:
+	const unsigned long _work_us;
+	
+	unsigned long run() {
+		hostAdvance(_work_us);
+		return 0;
+	}
+
+public:
+	Load(unsigned long interval, unsigned long work_us)
+		: _work_us(work_us)
+	{
+		start(interval);
+	}
+};
+
+static bool run(const char * name, int freq, bool is_auto, bool interrupt, bool during_refresh, bool is_checked)
+{
+	randomSeed(1);
+	script.clear();
+	axis_value = 512;
+	wrong_leds = 0;
+	is_interrupt = interrupt;
+	
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, freq);
+	mapLeds(led_cube);
+	makeScript(hostTime());
+	next_change = 0;
+	LedCubeInput input(&led_cube, button_pins, 3, axis_pins, 1);
+	if (!during_refresh) {
+		led_cube.setRefreshTask(nullptr);
+	}
+	if (is_auto) {
+		led_cube.setAutoRefresh(true, 50, 200, 200);
+	}
+	board_input = &input;
+	Manager manager(&led_cube, &input);
+	Load load(20, 3000);
+	
+	const unsigned long long end = hostTime() + (unsigned long long)(settle_ms + script_ms + 500) * 1000;
+	while (hostTime() < end) {
+		VariableTimedAction::updateActions();
+		hostAdvance(loop_us);
+	}
+	board_input = nullptr;
+	
+	unsigned long long sum = 0, worst = 0;
+	int seen = 0;
+	for (size_t k = 1; k < targets.size(); ++k) {
+		if (targets[k].is_seen) {
+			const unsigned long long latency = targets[k].photon - targets[k].time;
+			
+			sum += latency;
+			worst = (latency > worst) ? latency : worst;
+			seen += 1;
+		}
+	}
+	const int expected_events = presses * 2 + moves;
+	const bool is_correct = seen == (int)targets.size() - 1 && wrong_leds == 0 && manager.getLed() == targets.back().led
+		&& (int)input.getEvents() == expected_events && input.getOverflows() == 0;
+	const bool ok = is_correct && (!is_checked || worst < max_latency);
+	
+	printf("%-44s %4d Hz  %3d/%3d  %6lu %6lu  %3d/%3d  %6.1f %6.1f  %6.1f %6.1f  %6lu%s\n",
+		name, led_cube.getRefreshFrequency(), (int)input.getEvents(), expected_events, input.getBounces(), wrong_leds,
+		seen, (int)targets.size() - 1, (seen > 0) ? sum / 1000.0 / seen : 0.0, worst / 1000.0,
+		input.getAverageLatency() / 1000.0, input.getMaxLatency() / 1000.0, input.getLatencies(),
+		ok ? "" : "  FAILED");
+	return ok;
+}
+
+int main()
+{
+	bool ok = true;
+	
+	for (int pin = 0; pin < HOST_NUM_PINS; ++pin) {
+		layer_index[pin] = -1;
+	}
+	for (int l = 0; l < num_layers; ++l) {
+		layer_index[layer[l]] = l;
+	}
+	hostSetDigitalWriteHook(onWrite);
+	hostSetTimeHook(followScript);
+	hostSetAnalogReader(readAxis);
+	printf("cursor game: frame every %lu ms (%lu us), other work 3 ms / 20 ms, %lu us per digitalWrite(), %lu s of scripted input\n\n",
+		frame_wait, frame_us, write_us, script_ms / 1000);
+	printf("%-44s %7s  %7s  %6s %6s  %7s  %13s  %13s  %6s\n",
+		"", "refresh", "events", "bounce", "wrong", "moves", "photon avg/max", "library avg/max", "count");
+	ok &= run("requested 60 Hz, main loop only", 60, false, false, false, false);
+	ok &= run("requested 60 Hz, interrupt, during refresh", 60, false, true, true, false);
+	ok &= run("automatic 50-200 Hz, main loop only", 60, true, false, false, true);
+	ok &= run("automatic 50-200 Hz, interrupt, during refresh", 60, true, true, true, true);
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
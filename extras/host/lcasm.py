@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""Assembler of LED cube programs for sequences::Program (LedCubeVM.h).
+
+Usage:
+  lcasm.py program.lcasm -o program.bin            raw bytecode (RAM, EEPROM or serial upload)
+  lcasm.py program.lcasm -c name -o program.h      C array in PROGMEM
+
+Syntax (one instruction per line, ';' starts a comment, case insensitive):
+  label:                      jump target
+  .equ name value             named constant
+  end
+  wait <ms>                   0..65535
+  fill on|off
+  set <x> <y> <z>             value operands: 0..239, r0..r3, last (size-1), size
+  clr <x> <y> <z>
+  plane x|y|z <index> on|off
+  shift x|y|z up|down
+  loop <count>  ...  next     at most 4 nested loops, count 0 skips the body
+  jmp <label>
+  ld|add|sub|rnd <reg> <value>
+Operands may be separated by spaces or commas.
+"""
+
+import argparse
+import sys
+
+OPCODES = {
+	'end': (0x00, ''),
+	'wait': (0x01, 'w'),
+	'fill': (0x02, 's'),
+	'set': (0x03, 'vvv'),
+	'clr': (0x04, 'vvv'),
+	'plane': (0x05, 'avs'),
+	'shift': (0x06, 'ad'),
+	'loop': (0x07, 'v'),
+	'next': (0x08, ''),
+	'jmp': (0x09, 'l'),
+	'ld': (0x0A, 'rv'),
+	'add': (0x0B, 'rv'),
+	'sub': (0x0C, 'rv'),
+	'rnd': (0x0D, 'rv'),
+}
+
+REGISTERS = {'r0': 0xF0, 'r1': 0xF1, 'r2': 0xF2, 'r3': 0xF3}
+SPECIAL = {'last': 0xFE, 'size': 0xFF}
+AXES = {'x': 0, 'y': 1, 'z': 2}
+STATES = {'off': 0, 'on': 1, '0': 0, '1': 1}
+DIRECTIONS = {'up': 0, '+': 0, 'down': 1, '-': 1}
+MAX_IMMEDIATE = 0xEF
+
+
+class AsmError(Exception):
+	pass
+
+
+def parse_number(token, constants):
+	if token in constants:
+		return constants[token]
+	try:
+		return int(token, 0)
+	except ValueError:
+		raise AsmError('expected a number, got "%s"' % token)
+
+
+def encode(kind, token, constants, labels):
+	if kind == 'v':
+		if token in REGISTERS:
+			return [REGISTERS[token]]
+		if token in SPECIAL:
+			return [SPECIAL[token]]
+		value = parse_number(token, constants)
+		if not 0 <= value <= MAX_IMMEDIATE:
+			raise AsmError('immediate %d out of range 0..%d (use a register)' % (value, MAX_IMMEDIATE))
+		return [value]
+	if kind == 'r':
+		if token not in REGISTERS:
+			raise AsmError('expected a register r0..r3, got "%s"' % token)
+		return [REGISTERS[token]]
+	if kind == 'w':
+		value = parse_number(token, constants)
+		if not 0 <= value <= 0xFFFF:
+			raise AsmError('wait %d out of range 0..65535' % value)
+		return [value & 0xFF, value >> 8]
+	if kind == 'l':
+		if labels is None:
+			return [0, 0]
+		if token not in labels:
+			raise AsmError('unknown label "%s"' % token)
+		return [labels[token] & 0xFF, labels[token] >> 8]
+	table = {'s': STATES, 'a': AXES, 'd': DIRECTIONS}[kind]
+	if token not in table:
+		raise AsmError('expected one of %s, got "%s"' % ('/'.join(table), token))
+	return [table[token]]
+
+
+def assemble(lines):
+	constants = {}
+	labels = {}
+	program = []
+
+	# tokenize and collect labels (every instruction has a fixed size)
+	address = 0
+	for number, line in enumerate(lines, 1):
+		tokens = line.split(';')[0].replace(',', ' ').lower().split()
+		while tokens and tokens[0].endswith(':'):
+			labels[tokens.pop(0)[:-1]] = address
+		if not tokens:
+			continue
+		if tokens[0] == '.equ':
+			if len(tokens) != 3:
+				raise AsmError('line %d: .equ name value' % number)
+			constants[tokens[1]] = parse_number(tokens[2], constants)
+			continue
+		if tokens[0] not in OPCODES:
+			raise AsmError('line %d: unknown instruction "%s"' % (number, tokens[0]))
+		opcode, kinds = OPCODES[tokens[0]]
+		if len(tokens) - 1 != len(kinds):
+			raise AsmError('line %d: %s expects %d operands' % (number, tokens[0], len(kinds)))
+		program.append((number, tokens, address))
+		address += 1 + sum(2 if k in 'wl' else 1 for k in kinds)
+
+	code = []
+	depth = 0
+	for number, tokens, address in program:
+		opcode, kinds = OPCODES[tokens[0]]
+		try:
+			code.append(opcode)
+			for kind, token in zip(kinds, tokens[1:]):
+				code.extend(encode(kind, token, constants, labels))
+		except AsmError as e:
+			raise AsmError('line %d: %s' % (number, e))
+		if tokens[0] == 'loop':
+			depth += 1
+			if depth > 4:
+				raise AsmError('line %d: more than 4 nested loops' % number)
+		elif tokens[0] == 'next':
+			depth -= 1
+			if depth < 0:
+				raise AsmError('line %d: next without loop' % number)
+	if depth != 0:
+		raise AsmError('loop without next')
+	if len(code) > 0xFFFF:
+		raise AsmError('program is longer than 64 KiB')
+	return bytes(code)
+
+
+def as_c_array(code, name):
+	out = ['// generated by extras/host/lcasm.py, %d bytes' % len(code)]
+	out.append('const uint8_t %s[] PROGMEM = {' % name)
+	for i in range(0, len(code), 16):
+		out.append('\t' + ', '.join('0x%02X' % b for b in code[i:i+16]) + ',')
+	out.append('};')
+	return '\n'.join(out) + '\n'
+
+
+def main():
+	parser = argparse.ArgumentParser(description='LED cube bytecode assembler')
+	parser.add_argument('source')
+	parser.add_argument('-o', '--output', help='output file (default: stdout for -c)')
+	parser.add_argument('-c', '--c-array', metavar='NAME', help='emit a C array in PROGMEM instead of raw bytes')
+	args = parser.parse_args()
+
+	with open(args.source) as f:
+		try:
+			code = assemble(f.readlines())
+		except AsmError as e:
+			sys.exit('%s: %s' % (args.source, e))
+
+	if args.c_array:
+		text = as_c_array(code, args.c_array)
+		if args.output:
+			with open(args.output, 'w') as f:
+				f.write(text)
+		else:
+			sys.stdout.write(text)
+	else:
+		if not args.output:
+			sys.exit('raw output needs -o')
+		with open(args.output, 'wb') as f:
+			f.write(code)
+
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,225 @@
+/* Checks and measures the 3D game of life (LedCubeLife.h) on 4x4x4, 8x8x8 and 16x16x16 cubes:
+ * - every generation of the bit-sliced counting against a naive count of the 26 neighbours of every cell,
+ *   for several rules, with dead edges and wrapped around
+ * - the time of a generation (bit-sliced and naive), per cell, and the periods of the cycles found
+ * - sequences::Life3D on a cube: what the cube shows against the generation after every frame
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. life_bench.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeLife.cpp -o life_bench
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "LedCube.h"
+#include "LedCubeLife.h"
+
+static const int generations = 200;
+
+struct NamedRule
+{
+	const char * name;
+	const LedCubeLifeRule * rule;
+};
+
+static const NamedRule rules[] = {
+	{"B5/S45", &life3d::bays_4555},
+	{"B6/S567", &life3d::bays_5766},
+	{"B5-7/S4-8", &life3d::amoeba},
+	{"B1/S0-26", &life3d::crystal}
+};
+
+// one byte per cell, 26 neighbours read for every cell
+class NaiveLife
+{
+private:
+	const int _size;
+	const bool _wrap;
+	const LedCubeLifeRule _rule;
+	std::vector<uint8_t> _cells;
+	std::vector<uint8_t> _next;
+	
+	int _index(int x, int y, int z) { return x + (y + z * _size) * _size; }
+	
+	bool _isAlive(int x, int y, int z)
+	{
+		if (_wrap) {
+			return _cells[_index((x + _size) % _size, (y + _size) % _size, (z + _size) % _size)];
+		}
+		if (x < 0 || y < 0 || z < 0 || x >= _size || y >= _size || z >= _size) {
+			return false;
+		}
+		return _cells[_index(x, y, z)];
+	}
+
+public:
+	NaiveLife(LedCubeLife &life, bool wrap)
+		: _size(life.getSize()), _wrap(wrap), _rule(life.getRule()), _cells(_size * _size * _size), _next(_size * _size * _size)
+	{
+		for (int z = 0; z < _size; ++z) {
+			for (int y = 0; y < _size; ++y) {
+				for (int x = 0; x < _size; ++x) {
+					_cells[_index(x, y, z)] = life.getCell(x, y, z);
+				}
+			}
+		}
+	}
+	
+	void step()
+	{
+		for (int z = 0; z < _size; ++z) {
+			for (int y = 0; y < _size; ++y) {
+				for (int x = 0; x < _size; ++x) {
+					int neighbours = 0;
+					
+					for (int dz = -1; dz <= 1; ++dz) {
+						for (int dy = -1; dy <= 1; ++dy) {
+							for (int dx = -1; dx <= 1; ++dx) {
+								if ((dx != 0 || dy != 0 || dz != 0) && _isAlive(x + dx, y + dy, z + dz)) {
+									neighbours += 1;
+								}
+							}
+						}
+					}
+					const uint32_t rule = _cells[_index(x, y, z)] ? _rule.survival : _rule.birth;
+					_next[_index(x, y, z)] = (rule >> neighbours) & 1;
+				}
+			}
+		}
+		_cells.swap(_next);
+	}
+	
+	bool isSame(LedCubeLife &life)
+	{
+		for (int z = 0; z < _size; ++z) {
+			for (int y = 0; y < _size; ++y) {
+				for (int x = 0; x < _size; ++x) {
+					if (_cells[_index(x, y, z)] != life.getCell(x, y, z)) {
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+};
+
+static double nowNs()
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool check(int size, const NamedRule &named, bool wrap)
+{
+	LedCubeLife life(size, *named.rule, wrap);
+	// the crystal grows from a few cells, the others from a quarter
+	const uint8_t density = (named.rule == &life3d::crystal) ? 4 : 64;
+	double life_ns = 0, naive_ns = 0;
+	int same = 0, first_cycle = -1, period = 0;
+	
+	randomSeed(size * 10 + wrap);
+	life.randomize(density);
+	NaiveLife naive(life, wrap);
+	for (int g = 0; g < generations; ++g) {
+		double start = nowNs();
+		life.step();
+		life_ns += nowNs() - start;
+		start = nowNs();
+		naive.step();
+		naive_ns += nowNs() - start;
+		same += naive.isSame(life);
+		if (first_cycle < 0 && life.getPeriod() > 0) {
+			first_cycle = g + 1;
+			period = life.getPeriod();
+		}
+	}
+	const bool ok = same == generations;
+	const int cells = size * size * size;
+	
+	printf("%2dx%2dx%-2d %-10s %-5s  %3d/%3d  %9.0f %7.2f  %10.0f %7.2f  %5.1fx  %5d  ",
+		size, size, size, named.name, wrap ? "torus" : "edges", same, generations,
+		life_ns / generations, life_ns / generations / cells, naive_ns / generations, naive_ns / generations / cells,
+		naive_ns / life_ns, life.getPopulation());
+	if (first_cycle >= 0) {
+		printf("period %d after %d generations", period, first_cycle);
+	} else {
+		printf("no cycle");
+	}
+	printf("%s\n", ok ? "" : "  FAILED");
+	return ok;
+}
+
+static bool checkSequence(LedCube &led_cube)
+{
+	const int size = led_cube.getSize();
+	sequences::Life3D life3d(&led_cube, life3d::bays_4555, 100, 400, 64, 6);
+	int frames = 0, same = 0;
+	
+	randomSeed(3);
+	while (life3d() != 0) {
+		LedCubeLife &life = life3d.getLife();
+		bool is_same = true;
+		
+		for (int z = 0; z < size && is_same; ++z) {
+			for (int y = 0; y < size && is_same; ++y) {
+				for (int x = 0; x < size; ++x) {
+					if ((led_cube.getState(x, y, z) == HIGH) != life.getCell(x, y, z)) {
+						is_same = false;
+						break;
+					}
+				}
+			}
+		}
+		frames += 1;
+		same += is_same;
+	}
+	const bool ok = same == frames;
+	printf("%2dx%2dx%-2d sequences::Life3D: %d/%d frames shown right, %lu new starts%s\n",
+		size, size, size, same, frames, life3d.getRestarts(), ok ? "" : "  FAILED");
+	return ok;
+}
+
+int map_4[8][8];
+int * p_map_4[8] = {map_4[0], map_4[1], map_4[2], map_4[3], map_4[4], map_4[5], map_4[6], map_4[7]};
+int layer_4[8] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column_4[8] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+int map_8[8][64];
+int * p_map_8[8] = {map_8[0], map_8[1], map_8[2], map_8[3], map_8[4], map_8[5], map_8[6], map_8[7]};
+int layer_8[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+int column_8[64];
+
+int map_16[16][256];
+int * p_map_16[16];
+int layer_16[16];
+int column_16[256];
+
+int main()
+{
+	bool ok = true;
+	
+	printf("%d generations, bit-sliced rows against 26 neighbours read for every cell (host time)\n\n", generations);
+	printf("%-9s %-10s %-5s  %7s  %17s  %18s  %6s  %5s  %s\n",
+		"", "rule", "edges", "same", "bit-sliced ns/gen", "naive ns/gen", "faster", "alive", "cycle");
+	const int sizes[] = {4, 8, 16};
+	for (int size : sizes) {
+		for (const NamedRule &named : rules) {
+			ok &= check(size, named, false);
+			ok &= check(size, named, true);
+		}
+	}
+	printf("\n");
+	
+	for (int i = 0; i < 16; ++i) {
+		p_map_16[i] = map_16[i];
+	}
+	LedCube cube_4(p_map_4, layer_4, column_4, 8, 8, 4, 60);
+	LedCube cube_8(p_map_8, layer_8, column_8, 8, 64, 8, 60);
+	LedCube cube_16(p_map_16, layer_16, column_16, 16, 256, 16, 60);
+	ok &= checkSequence(cube_4);
+	ok &= checkSequence(cube_8);
+	ok &= checkSequence(cube_16);
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
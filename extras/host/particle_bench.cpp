@@ -0,0 +1,162 @@
+/* Checks and measures the particle engine (LedCubeParticles.h) on 4x4x4 and 8x8x8:
+ * - the emitters of the library, fixed and moving (the origin goes around the cube, a new one every frame), with pools
+ *   of 16, 64 and 256 particles, so many particles share LEDs
+ * - after every frame the cube against the LEDs of the living particles: an LED is lit exactly when a particle is on it
+ * - the time of a frame of the engine
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. particle_bench.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeParticles.cpp -o particle_bench
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "LedCube.h"
+#include "LedCubeParticles.h"
+
+int map_8[8][64];
+int * p_map_8[8] = {map_8[0], map_8[1], map_8[2], map_8[3], map_8[4], map_8[5], map_8[6], map_8[7]};
+int layer_8[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+int column_8[64];
+
+int map_4[8][8];
+int * p_map_4[8] = {map_4[0], map_4[1], map_4[2], map_4[3], map_4[4], map_4[5], map_4[6], map_4[7]};
+int layer_4[8] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column_4[8] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+static const int frames = 2000;
+
+// the pool with the LEDs of its particles
+template <int capacity>
+class CheckedPool : public LedCubeParticlePool<capacity>
+{
+public:
+	CheckedPool(LedCube * led_cube, const LedCubeParticleEmitter * emitter)
+		: LedCubeParticlePool<capacity>(led_cube, emitter)
+	{}
+	
+	// LEDs which differ from the particles, shared LEDs (more particles on one LED)
+	int countWrong(LedCube &led_cube, int &shared)
+	{
+		const int size = led_cube.getSize();
+		std::vector<int> on(size * size * size, 0);
+		int wrong = 0;
+		
+		for (int i = 0; i < capacity; ++i) {
+			if (this->_life[i] != 0) {
+				const uint16_t voxel = this->_drawn[i];
+				on[(voxel & 0x0F) + (((voxel >> 4) & 0x0F) + (voxel >> 8) * size) * size] += 1;
+			}
+		}
+		shared = 0;
+		for (int z = 0; z < size; ++z) {
+			for (int y = 0; y < size; ++y) {
+				for (int x = 0; x < size; ++x) {
+					const int count = on[x + (y + z * size) * size];
+					
+					shared += count > 1;
+					wrong += (count > 0) != (led_cube.getState(x, y, z) != LOW);
+				}
+			}
+		}
+		return wrong;
+	}
+};
+
+// x and y of the origin around the edge of the cube, one LED per frame (z and everything else of the emitter stay)
+static void moveEmitter(LedCubeParticleEmitter &emitter, int size, int frame)
+{
+	const int side = size - 1;
+	const int step = frame % (4 * side);
+	
+	if (step < side) {
+		emitter.x = step;
+		emitter.y = 0;
+	} else if (step < 2 * side) {
+		emitter.x = side;
+		emitter.y = step - side;
+	} else if (step < 3 * side) {
+		emitter.x = 3 * side - step;
+		emitter.y = side;
+	} else {
+		emitter.x = 0;
+		emitter.y = 4 * side - step;
+	}
+}
+
+template <int capacity>
+static bool run(LedCube &led_cube, const char * name, const LedCubeParticleEmitter * emitter, bool moving)
+{
+	LedCubeParticleEmitter moved = *emitter;
+	CheckedPool<capacity> pool(&led_cube, moving ? &moved : emitter);
+	int wrong_frames = 0;
+	int max_wrong = 0;
+	long shared_frames = 0;
+	long alive = 0;
+	double ns = 0;
+	
+	randomSeed(capacity);
+	led_cube.turnEverythingOff();
+	for (int frame = 0; frame < frames; ++frame) {
+		if (moving) {
+			moveEmitter(moved, led_cube.getSize(), frame);
+		}
+		const auto start = std::chrono::steady_clock::now();
+		pool.step(true);
+		ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		
+		int shared;
+		const int wrong = pool.countWrong(led_cube, shared);
+		wrong_frames += wrong > 0;
+		if (wrong > max_wrong) {
+			max_wrong = wrong;
+		}
+		shared_frames += shared > 0;
+		alive += pool.getAlive();
+	}
+	
+	const bool ok = wrong_frames == 0;
+	printf("  %-10s %-6s %3d particles: %5.1f alive, shared LEDs in %4ld of %d frames, %4d frames wrong (at most %2d LEDs), %6.0f ns per frame%s\n",
+		name, moving ? "moving" : "fixed", capacity, (double)alive / frames, shared_frames, frames, wrong_frames, max_wrong,
+		ns / frames, ok ? "" : "  FAILED");
+	return ok;
+}
+
+static bool check(LedCube &led_cube, const char * name)
+{
+	const struct {
+		const char * name;
+		const LedCubeParticleEmitter * emitter;
+	} emitters[] = {
+		{"rain", &particles::rain},
+		{"snow", &particles::snow},
+		{"fireworks", &particles::fireworks},
+		{"fountain", &particles::fountain}
+	};
+	bool ok = true;
+	
+	printf("%s\n", name);
+	for (const auto &e : emitters) {
+		for (int moving = 0; moving < 2; ++moving) {
+			ok &= run<16>(led_cube, e.name, e.emitter, moving);
+			ok &= run<64>(led_cube, e.name, e.emitter, moving);
+			ok &= run<256>(led_cube, e.name, e.emitter, moving);
+		}
+	}
+	return ok;
+}
+
+int main()
+{
+	for (int i = 0; i < 64; ++i) {
+		column_8[i] = i;
+	}
+	LedCube led_cube_4(p_map_4, layer_4, column_4, 8, 8, 4, 60);
+	LedCube led_cube_8(p_map_8, layer_8, column_8, 8, 64, 8, 60);
+	
+	bool ok = check(led_cube_4, "4x4x4");
+	ok &= check(led_cube_8, "8x8x8");
+	printf("%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,352 @@
+/* Plays MatrixRain through LedCubePipeline (LedCubePipeline.h), every 8th frame made heavy (45 ms of work at 20 ms per frame):
+ * - one main loop as in examples/Pipeline (virtual time, fixed 60 Hz refresh, 5 us per digitalWrite()): the refresher,
+ *   present() and produce() take turns, the heavy work is done in pieces of 500 us which stop at the end of the frame
+ *   budget (SPLIT_WORK); against the same sequence played directly by LedCube::nextFrameOfSequence() in the same loop,
+ *   with whole frames and split ones, and against the pipeline with whole frames
+ * - two threads (host only): the producer computes frames ahead with the heavy work in real time, the consumer moves
+ *   the virtual time with the real one and presents the frames every 250 us; against the frames computed when due
+ *   in the consumer thread
+ * - checks that the shown frames are the frames of the sequence played directly (same order, none lost)
+ * - reports how late the frames were shown (measured: the time a frame is finished or presented against the start of
+ *   the sequence + the sum of the waits before it), the longest refresh period, underruns, dropped frames and the lead
+ *   of the producer for several depths of the queue
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -pthread -I. -I../.. pipeline_bench.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubePipeline.cpp -o pipeline_bench
+ * (-fsanitize=thread checks the queue for data races)
+ */
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "LedCube.h"
+#include "LedCubePipeline.h"
+
+static const int size = 4;
+static const int num_layers = 8;
+static const int num_columns = 8;
+int led_cube_map[num_layers][num_columns];
+int * p_led_cube_map[num_layers] = {
+	led_cube_map[0], led_cube_map[1], led_cube_map[2], led_cube_map[3],
+	led_cube_map[4], led_cube_map[5], led_cube_map[6], led_cube_map[7]
+};
+int layer[num_layers] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column[num_columns] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+static const unsigned long frames = 240;
+static const unsigned long heavy_us = 45000;
+static const unsigned long piece_us = 500;
+static const unsigned long write_us = 5;
+static const unsigned long loop_us = 20;
+
+enum Work {
+	NO_WORK,
+	REAL_WORK, // busy for heavy_us of real time at once
+	VIRTUAL_WORK // heavy_us of virtual time in pieces, split at the end of the budget
+};
+
+// MatrixRain limited to a number of frames, every 8th one takes heavy_us
+class HeavyRain : public sequences::MatrixRain
+{
+protected:
+	const Work _work;
+	unsigned long _frames;
+	unsigned long _work_done; // [us] of the running frame
+	bool _is_timed;
+	unsigned long _due; // [ms] of the running frame
+public:
+	unsigned long max_late; // [ms] the frame finished against its due time
+	
+	HeavyRain(LedCube * led_cube, Work work)
+		: MatrixRain(led_cube, 20), _work(work), _frames(0), _work_done(0), _is_timed(false), _due(0), max_late(0)
+	{}
+	
+	unsigned long operator()()
+	{
+		if (!_is_timed) {
+			_due = millis();
+			_is_timed = true;
+		}
+		if (_work != NO_WORK && _frames % 8 == 7) {
+			while (_work_done < heavy_us) {
+				if (_work == REAL_WORK) {
+					const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(heavy_us);
+					while (std::chrono::steady_clock::now() < until) {}
+					_work_done = heavy_us;
+				} else {
+					if (_isOverBudget(piece_us)) {
+						return _continueFrame();
+					}
+					hostAdvance(piece_us);
+					_work_done += piece_us;
+				}
+			}
+		}
+		if (_frames + 1 >= frames) {
+			return 0;
+		}
+		const unsigned long wait = MatrixRain::operator()();
+		if (wait == LedCube::CONTINUE_FRAME) {
+			return wait;
+		}
+		if (millis() - _due > max_late) {
+			max_late = millis() - _due;
+		}
+		_due += wait;
+		_frames += 1;
+		_work_done = 0;
+		return wait;
+	}
+};
+
+static void slowWrite(uint8_t pin, uint8_t value)
+{
+	(void)pin;
+	(void)value;
+	hostAdvance(write_us);
+}
+
+// FNV-1a of the map
+static unsigned long hashMap()
+{
+	unsigned long hash = 2166136261UL;
+	
+	for (int l = 0; l < num_layers; ++l) {
+		for (int c = 0; c < num_columns; ++c) {
+			hash = (hash ^ led_cube_map[l][c]) * 16777619UL;
+		}
+	}
+	return hash;
+}
+
+static std::vector<unsigned long> playDirectly()
+{
+	std::vector<unsigned long> hashes;
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	
+	randomSeed(1);
+	led_cube.turnEverythingOff();
+	HeavyRain rain(&led_cube, NO_WORK);
+	unsigned long wait;
+	do {
+		wait = rain();
+		hashes.push_back(hashMap());
+	} while (wait != 0);
+	return hashes;
+}
+
+// frames compared in order, dropped ones are skipped
+static bool isInOrder(const std::vector<unsigned long> &shown, unsigned long dropped, const std::vector<unsigned long> &expected)
+{
+	size_t matched = 0;
+	
+	for (size_t i = 0, j = 0; i < shown.size(); ++i) {
+		while (j < expected.size() && expected[j] != shown[i]) {
+			j += 1;
+		}
+		if (j < expected.size()) {
+			matched += 1;
+			j += 1;
+		}
+	}
+	return matched == shown.size() && shown.size() + dropped == expected.size();
+}
+
+// the sequence of the examples (LedCubeManager)
+class Player : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	
+	unsigned long run() {
+		const unsigned long wait = _led_cube->nextFrameOfSequence();
+		
+		return (wait > 0) ? wait : 1;
+	}
+
+public:
+	Player(LedCube * led_cube)
+		: _led_cube(led_cube)
+	{
+		start(1);
+	}
+};
+
+// the consumer of examples/Pipeline
+class Presenter : public VariableTimedAction
+{
+private:
+	LedCubePipeline * _pipeline;
+	
+	unsigned long run() {
+		_pipeline->present();
+		return 0;
+	}
+
+public:
+	Presenter(LedCubePipeline * pipeline)
+		: _pipeline(pipeline)
+	{
+		start(1);
+	}
+};
+
+static void printLoopRun(const char * name, LedCube &led_cube, unsigned long max_late)
+{
+	printf("  %-30s max late %3lu ms, refresh %2d Hz, longest period %5lu us", name, max_late,
+		led_cube.getRefreshFrequency(), led_cube.getRefreshStats().max_period);
+}
+
+// the sequence played by nextFrameOfSequence() in one main loop
+static void loopDirectly(LedCube::BudgetPolicy policy)
+{
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	Player player(&led_cube);
+	HeavyRain * rain = new HeavyRain(&led_cube, VIRTUAL_WORK);
+	
+	randomSeed(1);
+	led_cube.setBudgetPolicy(policy);
+	led_cube.setSequence(rain);
+	// the sequence is deleted with its last frame
+	unsigned long max_late = 0;
+	while (led_cube.isSequenceRunning()) {
+		VariableTimedAction::updateActions();
+		if (led_cube.isSequenceRunning()) {
+			max_late = rain->max_late;
+		}
+		hostAdvance(loop_us);
+	}
+	printLoopRun((policy == LedCube::SPLIT_WORK) ? "directly, split frames" : "directly, whole frames", led_cube, max_late);
+	printf(", %lu frames split\n", led_cube.getSplitFrames());
+}
+
+// the sequence played through the pipeline in one main loop (examples/Pipeline)
+static bool loopPipelined(uint8_t depth, LedCube::BudgetPolicy policy, const std::vector<unsigned long> &expected)
+{
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	LedCubePipeline pipeline(&led_cube, depth, 20);
+	Presenter presenter(&pipeline);
+	std::vector<unsigned long> shown;
+	unsigned long presented = 0;
+	char name[40];
+	
+	randomSeed(1);
+	led_cube.turnEverythingOff();
+	led_cube.setBudgetPolicy(policy);
+	pipeline.setSequence(new HeavyRain(&led_cube, VIRTUAL_WORK));
+	while (pipeline.isRunning()) {
+		VariableTimedAction::updateActions();
+		if (pipeline.getPresented() != presented) {
+			presented = pipeline.getPresented();
+			shown.push_back(hashMap());
+		}
+		pipeline.produce();
+		hostAdvance(loop_us);
+	}
+	
+	const bool ok = isInOrder(shown, pipeline.getDropped(), expected);
+	snprintf(name, sizeof(name), "pipeline depth %u, %s", depth, (policy == LedCube::SPLIT_WORK) ? "split" : "whole");
+	printLoopRun(name, led_cube, pipeline.getMaxLate());
+	printf(", %lu underruns, %lu dropped, min lead %2lu ms, %lu frames split, frames %s\n", pipeline.getUnderruns(),
+		pipeline.getDropped(), pipeline.getMinLead(), pipeline.getSplitFrames(), ok ? "in order" : "WRONG");
+	return ok;
+}
+
+// the frames computed when due in the thread of the consumer, virtual time following the real one
+static void threadDirectly()
+{
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	HeavyRain rain(&led_cube, REAL_WORK);
+	
+	randomSeed(1);
+	hostSetRealTimeScale(1);
+	unsigned long due = millis();
+	unsigned long wait;
+	do {
+		wait = rain();
+		// the next frame when it is due, at once when late
+		due += wait;
+		if ((long)(due - millis()) > 0) {
+			delay(due - millis());
+		}
+	} while (wait != 0);
+	hostSetRealTimeScale(0);
+	printf("  %-30s max late %3lu ms\n", "directly, when due", rain.max_late);
+}
+
+static bool threadPipelined(uint8_t depth, const std::vector<unsigned long> &expected)
+{
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	
+	randomSeed(1);
+	led_cube.turnEverythingOff();
+	LedCubePipeline pipeline(&led_cube, depth, 20);
+	pipeline.setSequence(new HeavyRain(&led_cube, REAL_WORK));
+	
+	std::atomic<bool> done(false);
+	std::thread producer([&]() {
+		// random() is per thread
+		randomSeed(1);
+		while (pipeline.isRunning()) {
+			if (!pipeline.produce()) {
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+			}
+		}
+		done = true;
+	});
+	
+	// consumer: virtual time follows the real one
+	std::vector<unsigned long> shown;
+	unsigned long presented = 0;
+	const auto start = std::chrono::steady_clock::now();
+	const unsigned long long virtual_start = hostTime();
+	for (unsigned long step = 1; !done; ++step) {
+		std::this_thread::sleep_until(start + std::chrono::microseconds(250 * step));
+		const unsigned long long now = virtual_start + 250ULL * step;
+		if (now > hostTime()) {
+			hostAdvance(now - hostTime());
+		}
+		pipeline.present();
+		if (pipeline.getPresented() != presented) {
+			presented = pipeline.getPresented();
+			shown.push_back(hashMap());
+		}
+	}
+	producer.join();
+	
+	const bool ok = isInOrder(shown, pipeline.getDropped(), expected);
+	printf("  pipeline depth %u: %zu frames shown, %lu dropped, %lu underruns, max late %lu ms, min lead %lu ms, frames %s\n",
+		depth, shown.size(), pipeline.getDropped(), pipeline.getUnderruns(), pipeline.getMaxLate(), pipeline.getMinLead(),
+		ok ? "in order" : "WRONG");
+	return ok;
+}
+
+int main()
+{
+	const std::vector<unsigned long> expected = playDirectly();
+	const uint8_t depths[] = {1, 2, 4, 8};
+	bool ok = true;
+	
+	printf("MatrixRain, %zu frames of 20 ms, every 8th frame takes %lu ms to compute\n\n", expected.size(), heavy_us / 1000);
+	
+	printf("one main loop (fixed 60 Hz refresh, %lu us per digitalWrite(), work in pieces of %lu us):\n", write_us, piece_us);
+	hostSetDigitalWriteHook(slowWrite);
+	loopDirectly(LedCube::COUNT_ONLY);
+	loopDirectly(LedCube::SPLIT_WORK);
+	ok &= loopPipelined(4, LedCube::COUNT_ONLY, expected);
+	for (uint8_t depth : depths) {
+		ok &= loopPipelined(depth, LedCube::SPLIT_WORK, expected);
+	}
+	hostSetDigitalWriteHook(nullptr);
+	
+	printf("\ntwo threads (producer and consumer):\n");
+	threadDirectly();
+	for (uint8_t depth : depths) {
+		ok &= threadPipelined(depth, expected);
+	}
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+/* Plays sequences::Demo and the same sequences without gaps (sequences::Playlist) with and without constructing
+ * the next sequence ahead:
+ * - checks that both variants produce the same frames
+ * - measures every switch without a gap: the call in which a sequence ends and the next one shows its first frame
+ *   (with a gap the construction happens in the call returning the gap, so it does not delay any frame in either variant)
+ * - reports what preparing ahead saves against the time of constructing a sequence: the built-in sequences only set
+ *   their fields, so their switches are about as fast either way (only sequences with a costly constructor gain)
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. playlist_bench.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp -o playlist_bench
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "LedCube.h"
+
+static const int size = 4;
+static const int num_layers = 8;
+static const int num_columns = 8;
+int led_cube_map[num_layers][num_columns];
+int * p_led_cube_map[num_layers] = {
+	led_cube_map[0], led_cube_map[1], led_cube_map[2], led_cube_map[3],
+	led_cube_map[4], led_cube_map[5], led_cube_map[6], led_cube_map[7]
+};
+int layer[num_layers] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column[num_columns] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+
+// sequences of the demo back to back
+const playlist::Entry back_to_back[] PROGMEM = {
+	{playlist::TURN_EVERYTHING_OFF, 0, 0, 0},
+	{playlist::FLICKER_ON, 0, 0, 0},
+	{playlist::TURN_EVERYTHING_ON, 0, 0, 0},
+	{playlist::UP_AND_DOWN, 0, 0, 0},
+	{playlist::LAYER_STOMP, 0, 0, 0},
+	{playlist::SPIRAL_IN_AND_OUT, 0, 0, 0},
+	{playlist::SIDEWAYS, 0, 0, 0},
+	{playlist::AROUND_EDGE_DOWN, 0, 0, 0},
+	{playlist::TURN_EVERYTHING_OFF, 0, 0, 0},
+	{playlist::RANDOM_FLICKER, 0, 0, 0},
+	{playlist::RANDOM_RAIN, 0, 0, 0},
+	{playlist::MATRIX_RAIN, 0, 0, 0},
+	{playlist::DIAGONAL_RECTANGLE, 0, 0, 0},
+	{playlist::GO_THROUGH_ALL_LEDS, 0, 0, 0},
+	{playlist::PROPELLER, 0, 0, 0},
+	{playlist::SPIRAL_IN_AND_OUT, 0, 0, 0},
+	{playlist::FLICKER_OFF, 0, 0, 0},
+	{playlist::END, 0, 0, 0}
+};
+
+struct Result
+{
+	unsigned long frames;
+	unsigned long hash;
+	unsigned long switches;
+	unsigned long unprepared;
+	std::vector<double> switch_ns; // median of the repeats for every switch
+	double frame_ns; // median call without a switch
+};
+
+static Result play(const playlist::Entry * entries, bool prepare_ahead, int repeats)
+{
+	Result result = {0, 2166136261UL, 0, 0, {}, 0};
+	std::vector<std::vector<double> > switches;
+	std::vector<double> frames_ns;
+	
+	for (int r = 0; r < repeats; ++r) {
+		randomSeed(1);
+		led_cube.turnEverythingOff();
+		sequences::Playlist demo(&led_cube, entries, true, prepare_ahead);
+		size_t index = 0;
+		unsigned long wait;
+		do {
+			const unsigned long switches_before = demo.getSwitches();
+			auto start = std::chrono::steady_clock::now();
+			wait = demo();
+			const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			
+			if (demo.getSwitches() != switches_before) {
+				if (switches.size() <= index) {
+					switches.resize(index + 1);
+				}
+				switches[index].push_back(ns);
+				index += 1;
+			} else if (r == repeats - 1) {
+				frames_ns.push_back(ns);
+			}
+			
+			if (r == 0) {
+				result.frames += 1;
+				result.hash = (result.hash ^ wait) * 16777619UL;
+				for (int l = 0; l < num_layers; ++l) {
+					for (int c = 0; c < num_columns; ++c) {
+						result.hash = (result.hash ^ led_cube_map[l][c]) * 16777619UL;
+					}
+				}
+			}
+		} while (wait != 0);
+		result.switches = demo.getSwitches();
+		result.unprepared = demo.getUnpreparedSwitches();
+	}
+	
+	for (size_t i = 0; i < switches.size(); ++i) {
+		std::sort(switches[i].begin(), switches[i].end());
+		result.switch_ns.push_back(switches[i][switches[i].size() / 2]);
+	}
+	std::sort(frames_ns.begin(), frames_ns.end());
+	result.frame_ns = frames_ns[frames_ns.size() / 2];
+	return result;
+}
+
+static void compare(const char * name, const playlist::Entry * entries, int repeats, bool print_switches)
+{
+	Result on_switch = play(entries, false, repeats);
+	Result ahead = play(entries, true, repeats);
+	
+	printf("%s\n", name);
+	printf("  construct on switch: %lu frames, hash %08lx, %lu switches (%lu constructed on switch), median frame %.0f ns\n",
+		on_switch.frames, on_switch.hash, on_switch.switches, on_switch.unprepared, on_switch.frame_ns);
+	printf("  prepare ahead:       %lu frames, hash %08lx, %lu switches (%lu constructed on switch), median frame %.0f ns  => %s frames\n",
+		ahead.frames, ahead.hash, ahead.switches, ahead.unprepared, ahead.frame_ns, (ahead.hash == on_switch.hash && ahead.frames == on_switch.frames) ? "same" : "DIFFERENT");
+	if (!print_switches) {
+		return;
+	}
+	
+	printf("\n  switch  on switch [ns]  ahead [ns]\n");
+	double sum_on_switch = 0, sum_ahead = 0;
+	for (size_t i = 1; i < on_switch.switch_ns.size() && i < ahead.switch_ns.size(); ++i) {
+		printf("  %6zu  %14.0f  %10.0f\n", i + 1, on_switch.switch_ns[i], ahead.switch_ns[i]);
+		sum_on_switch += on_switch.switch_ns[i];
+		sum_ahead += ahead.switch_ns[i];
+	}
+	printf("     sum  %14.0f  %10.0f\n", sum_on_switch, sum_ahead);
+	
+	// what preparing ahead can save at most: the construction of the next sequence
+	std::vector<double> constructions;
+	for (int r = 0; r < repeats; ++r) {
+		for (const playlist::Entry * entry = entries; entry->sequence != playlist::END; ++entry) {
+			auto start = std::chrono::steady_clock::now();
+			LedCubeSequence * sequence = playlist::create(&led_cube, *entry);
+			const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			
+			delete sequence;
+			constructions.push_back(ns);
+		}
+	}
+	std::sort(constructions.begin(), constructions.end());
+	const double construction = constructions[constructions.size() / 2];
+	const double at_most = construction * (on_switch.switch_ns.size() - 1);
+	
+	printf("\n  prepare ahead: %.0f ns against %.0f ns (%+.0f %%), it can save at most the constructions: %zu x %.0f ns = %.0f ns\n",
+		sum_ahead, sum_on_switch, 100 * (sum_ahead / sum_on_switch - 1), on_switch.switch_ns.size() - 1, construction, at_most);
+	if (at_most < sum_on_switch / 4) {
+		// the built-in sequences only set their fields, the switch is mostly the first frame of the next one
+		printf("  => no measurable gain with the built-in sequences (the difference is noise)\n");
+	}
+}
+
+int main()
+{
+	const int repeats = 51;
+	
+	compare("sequences::Demo (gaps between sequences)", playlist::demo, 1, false);
+	compare("back to back (no gaps)", back_to_back, repeats, true);
+	return 0;
+}
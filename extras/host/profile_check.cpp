@@ -0,0 +1,345 @@
+/* Checks the profiler of sequences (LedCubeProfiler.h):
+ * - a sequence with scripted costs, LED writes and spikes longer than its wait (late policies CATCH_UP and DROP):
+ *   frames, min/mean/max time, writes and deadline misses against the bookkeeping of the sequence itself
+ * - sequences::Demo with the virtual time following the real time (x50, roughly an AVR): every built-in sequence
+ *   recorded under its type, the frames of the playlist against the calls, the writes of the sequences against the cube,
+ *   the text dump and the binary dump read back
+ * - dumping while the cube refreshes over a serial line of 115200 Bd with a 64 B buffer: the whole dump at once
+ *   against pieces which fit the free part of the buffer (time waiting for the line, longest gap of the refresh)
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. profile_check.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeProfiler.cpp -o profile_check
+ */
+
+#include <stdio.h>
+#include <string>
+
+#include "LedCube.h"
+#include "LedCubeProfiler.h"
+
+static const int size = 4;
+static const int num_layers = 8;
+static const int num_columns = 8;
+int led_cube_map[num_layers][num_columns];
+int * p_led_cube_map[num_layers] = {
+	led_cube_map[0], led_cube_map[1], led_cube_map[2], led_cube_map[3],
+	led_cube_map[4], led_cube_map[5], led_cube_map[6], led_cube_map[7]
+};
+int layer[num_layers] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column[num_columns] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+
+// what the profiler should find
+struct Expected
+{
+	unsigned long frames, time, min_time, max_time, writes, misses;
+};
+
+// frames with scripted costs and writes
+class Costly : public LedCubeSequence
+{
+public:
+	static const unsigned long wait = 20; // [ms]
+private:
+	Expected * _expected;
+	const unsigned long _max_frames;
+	unsigned long _start; // [ms]
+	unsigned long _waits; // [ms] sum of the waits returned
+public:
+	Costly(LedCube * led_cube, Expected * expected, unsigned long max_frames)
+		: LedCubeSequence(led_cube), _expected(expected), _max_frames(max_frames), _start(0), _waits(0)
+	{
+		*_expected = {0, 0, 0xFFFF, 0, 0, 0};
+	}
+	
+	unsigned long operator()()
+	{
+		Expected &e = *_expected;
+		
+		if (e.frames == 0) {
+			_start = millis();
+		}
+		// mostly 0.2-3 ms, spikes of 25 and 45 ms (longer than the wait)
+		unsigned long cost = 200 + random(2800);
+		if (e.frames % 37 == 36) {
+			cost = 25000;
+		}
+		if (e.frames % 91 == 90) {
+			cost = 45000;
+		}
+		const int count = random(20);
+		
+		for (int i = 0; i < count; ++i) {
+			if (random(2)) {
+				_led_cube->turnOn(random(size), random(size), random(size));
+			} else {
+				_led_cube->turnOff(random(size), random(size), random(size));
+			}
+		}
+		hostAdvance(cost);
+		
+		e.frames += 1;
+		e.time += cost;
+		e.min_time = (cost < e.min_time) ? cost : e.min_time;
+		e.max_time = (cost > e.max_time) ? cost : e.max_time;
+		e.writes += count;
+		if (e.frames > _max_frames) {
+			return 0;
+		}
+		// done only when the next frame is already due
+		_waits += wait;
+		if (millis() - _start >= _waits) {
+			e.misses += 1;
+		}
+		return wait;
+	}
+};
+
+static unsigned long frame_calls;
+
+// the main loop of the examples: a frame when it is due, the refresh, 50 us of other work; extra runs every pass
+static void run(unsigned long ms, void (*extra)()=nullptr)
+{
+	const unsigned long end = millis() + ms;
+	unsigned long next_frame = millis();
+	
+	while ((long)(millis() - end) < 0 && led_cube.isSequenceRunning()) {
+		if ((long)(millis() - next_frame) >= 0) {
+			frame_calls += 1;
+			next_frame = millis() + led_cube.nextFrameOfSequence();
+		}
+		VariableTimedAction::updateActions();
+		if (extra != nullptr) {
+			extra();
+		}
+		hostAdvance(50);
+	}
+}
+
+static bool checkScripted(LedCube::LatePolicy policy, const char * name)
+{
+	LedCubeProfiler profiler(&led_cube, profiler::USER + 1);
+	Expected e;
+	
+	randomSeed(7);
+	led_cube.setProfiler(&profiler);
+	led_cube.setLatePolicy(policy);
+	led_cube.setSequence(new Costly(&led_cube, &e, 400), profiler::USER);
+	run(60000);
+	led_cube.setProfiler(nullptr);
+	led_cube.setLatePolicy(LedCube::CATCH_UP);
+	
+	const LedCubeProfile &profile = profiler.getProfile(profiler::USER);
+	const bool ok = profile.frames == e.frames && profile.time == e.time && profile.min_time == e.min_time && profile.max_time == e.max_time
+		&& profile.writes == e.writes && profile.misses == e.misses && e.misses > 0 && profiler.getProfile(profiler::OTHER).frames == 0;
+	printf("%-9s %lu frames, min %u us, mean %lu us, max %u us, %lu writes, %u misses (the sequence: %lu frames, %lu misses)%s\n",
+		name, profile.frames, profile.min_time, profiler.getMeanTime(profiler::USER), profile.max_time, profile.writes, profile.misses,
+		e.frames, e.misses, ok ? "" : "  FAILED");
+	return ok;
+}
+
+// output of the dumps
+class StringStream : public Stream
+{
+public:
+	std::string text;
+	
+	int available() { return 0; }
+	int read() { return -1; }
+	int peek() { return -1; }
+	size_t write(uint8_t value) { text += (char)value; return 1; }
+};
+
+static uint32_t readLittle(const std::string &text, size_t &pos, int bytes)
+{
+	uint32_t value = 0;
+	
+	for (int i = 0; i < bytes; ++i) {
+		value |= (uint32_t)(uint8_t)text[pos++] << (8 * i);
+	}
+	return value;
+}
+
+static bool checkDemo()
+{
+	LedCubeProfiler profiler(&led_cube);
+	bool ok = true;
+	
+	randomSeed(3);
+	frame_calls = 0;
+	led_cube.setProfiler(&profiler);
+	led_cube.setSequence(new sequences::Demo(&led_cube), profiler::PLAYLIST);
+	const unsigned long writes_before = led_cube.getWrites();
+	hostSetRealTimeScale(50);
+	run(3600000);
+	hostSetRealTimeScale(0);
+	const unsigned long writes = led_cube.getWrites() - writes_before;
+	led_cube.setProfiler(nullptr);
+	
+	// the playlist and the sequences in it
+	unsigned long sequence_writes = 0;
+	int types = 0;
+	for (uint8_t type = 0; type <= playlist::GO_THROUGH_ALL_LEDS; ++type) {
+		sequence_writes += profiler.getProfile(type).writes;
+		types += profiler.getProfile(type).frames > 0;
+	}
+	const LedCubeProfile &list = profiler.getProfile(profiler::PLAYLIST);
+	const LedCubeProfile &off = profiler.getProfile(playlist::TURN_EVERYTHING_OFF);
+	const bool attributed = types == 15 && list.frames == frame_calls && list.writes == writes && sequence_writes == writes
+		&& off.frames == 3 && off.writes == 3 * size * size * size && profiler.getProfile(profiler::OTHER).frames == 0;
+	printf("sequences::Demo: %d of 15 types with frames, playlist %lu frames of %lu calls, writes: playlist %lu, sequences %lu, cube %lu%s\n\n",
+		types, list.frames, frame_calls, list.writes, sequence_writes, writes, attributed ? "" : "  FAILED");
+	ok &= attributed;
+	
+	// text
+	StringStream text;
+	int calls = 0;
+	profiler.startDump(true);
+	while (!profiler.dump(text)) {
+		calls += 1;
+	}
+	printf("%s(%zu B in %d calls of 16 B)\n", text.text.c_str(), text.text.size(), calls + 1);
+	
+	// binary, read back
+	StringStream binary;
+	profiler.startDump(false);
+	while (!profiler.dump(binary, 255)) {
+	}
+	const std::string &data = binary.text;
+	size_t pos = 4;
+	int records = 0;
+	bool same = data.compare(0, 4, "LCP\x01") == 0;
+	while (same && pos < data.size() && (uint8_t)data[pos] != 0xFF) {
+		const uint8_t type = readLittle(data, pos, 1);
+		const LedCubeProfile &profile = profiler.getProfile(type);
+		
+		same &= readLittle(data, pos, 4) == profile.frames;
+		same &= readLittle(data, pos, 4) == profile.time;
+		same &= readLittle(data, pos, 2) == profile.min_time;
+		same &= readLittle(data, pos, 2) == profile.max_time;
+		same &= readLittle(data, pos, 4) == profile.writes;
+		same &= readLittle(data, pos, 2) == profile.misses;
+		records += 1;
+	}
+	same &= pos + 1 == data.size() && records == types + 1;
+	printf("binary dump: %zu B, %d records read back%s\n", data.size(), records, same ? "" : "  FAILED");
+	return ok && same;
+}
+
+// serial line: 115200 Bd (87 us per byte) with a 64 B transmit buffer, write() waits while the buffer is full
+class SerialLine : public Stream
+{
+private:
+	static const unsigned long _byte_us = 87;
+	unsigned long long _busy_until; // [us] when the last byte in the buffer is sent
+public:
+	unsigned long long waited; // [us] in write()
+	unsigned long sent;
+	
+	SerialLine() : _busy_until(0), waited(0), sent(0) {}
+	
+	int availableForWrite()
+	{
+		const unsigned long long now = hostTime();
+		const unsigned long long queued = (_busy_until > now) ? (_busy_until - now + _byte_us - 1) / _byte_us : 0;
+		
+		return 64 - (int)queued;
+	}
+	
+	int available() { return 0; }
+	int read() { return -1; }
+	int peek() { return -1; }
+	
+	size_t write(uint8_t value)
+	{
+		(void)value;
+		while (availableForWrite() <= 0) {
+			hostAdvance(_byte_us);
+			waited += _byte_us;
+		}
+		const unsigned long long now = hostTime();
+		
+		_busy_until = ((_busy_until > now) ? _busy_until : now) + _byte_us;
+		sent += 1;
+		return 1;
+	}
+};
+
+static LedCubeProfiler * dumped_profiler;
+static SerialLine * line;
+static unsigned long next_dump;
+static bool is_dumping;
+
+// every 500 ms the whole dump at once
+static void dumpAtOnce()
+{
+	if ((long)(millis() - next_dump) >= 0) {
+		next_dump += 500;
+		dumped_profiler->startDump(true);
+		while (!dumped_profiler->dump(*line, 255)) {
+		}
+	}
+}
+
+// every 500 ms a dump, a piece which fits the buffer in every pass of the loop
+static void dumpInPieces()
+{
+	if (!is_dumping && (long)(millis() - next_dump) >= 0) {
+		next_dump += 500;
+		dumped_profiler->startDump(true);
+		is_dumping = true;
+	}
+	if (is_dumping) {
+		const int free = line->availableForWrite();
+		
+		if (free > 0 && dumped_profiler->dump(*line, free)) {
+			is_dumping = false;
+		}
+	}
+}
+
+static bool checkDumpDuringRefresh()
+{
+	bool ok = true;
+	
+	printf("\n10 s of sequences::Demo with a dump every 500 ms over 115200 Bd (64 B buffer), refresh 60 Hz\n");
+	for (int mode = 0; mode < 3; ++mode) {
+		LedCubeProfiler profiler(&led_cube);
+		SerialLine serial;
+		
+		dumped_profiler = &profiler;
+		line = &serial;
+		next_dump = millis() + 500;
+		is_dumping = false;
+		led_cube.setProfiler(&profiler);
+		led_cube.setSequence(new sequences::Demo(&led_cube), profiler::PLAYLIST);
+		led_cube.resetRefreshStats();
+		run(10000, (mode == 0) ? nullptr : (mode == 1) ? dumpAtOnce : dumpInPieces);
+		led_cube.setProfiler(nullptr);
+		led_cube.stopCurrentSequence();
+		
+		const LedCubeRefreshStats stats = led_cube.getRefreshStats();
+		const char * names[] = {"no dump", "at once", "in pieces"};
+		printf("%-9s %6lu B sent, %7llu us waiting for the line, longest gap of the refresh %5lu us, max period %5lu us\n",
+			names[mode], serial.sent, serial.waited, stats.max_gap, stats.max_period);
+		if (mode == 2) {
+			ok &= serial.waited == 0 && serial.sent > 0;
+		}
+	}
+	return ok;
+}
+
+int main()
+{
+	bool ok = true;
+	
+	printf("scripted costs (virtual time), 401 frames every %lu ms\n", Costly::wait);
+	ok &= checkScripted(LedCube::CATCH_UP, "CATCH_UP");
+	ok &= checkScripted(LedCube::DROP, "DROP");
+	printf("\n");
+	ok &= checkDemo();
+	ok &= checkDumpDuringRefresh();
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
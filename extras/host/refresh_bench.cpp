@@ -0,0 +1,123 @@
+/* Refreshes a 4x4x4 cube through LedCubeRefresher in a simulated main loop (virtual time):
+ * - every digitalWrite() takes write_us (about the time of digitalWrite() on an ATmega328P)
+ * - the main loop takes loop_us per pass and runs a load (frames of a sequence taking some time)
+ * - reports the requested and achieved refresh rate, the on-time of the layers (against the former whole milliseconds),
+ *   the period with its jitter and the longest gap, for the requested rate and for the automatic one
+ * - checks that the fixed refresh reaches the requested rate while the load fits in its gap, and that the automatic
+ *   refresh keeps its period (jitter, longest period) and the shortest on-time of the layers
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. refresh_bench.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp -o refresh_bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "LedCube.h"
+
+static const int size = 4;
+static const int num_layers = 8;
+static const int num_columns = 8;
+int led_cube_map[num_layers][num_columns];
+int * p_led_cube_map[num_layers] = {
+	led_cube_map[0], led_cube_map[1], led_cube_map[2], led_cube_map[3],
+	led_cube_map[4], led_cube_map[5], led_cube_map[6], led_cube_map[7]
+};
+int layer[num_layers] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column[num_columns] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+static const unsigned long write_us = 5;
+static const unsigned long loop_us = 20;
+static const unsigned long min_time_for_layer = 100;
+
+static void slowWrite(uint8_t pin, uint8_t value)
+{
+	(void)pin;
+	(void)value;
+	hostAdvance(write_us);
+}
+
+// frames of a sequence: work_us (+ up to spread_us at random) every interval
+class Load : public VariableTimedAction
+{
+private:
+	const unsigned long _work_us;
+	const unsigned long _spread_us;
+	
+	unsigned long run() {
+		hostAdvance(_work_us + ((_spread_us > 0) ? random(_spread_us + 1) : 0));
+		return 0;
+	}
+
+public:
+	Load(unsigned long interval, unsigned long work_us, unsigned long spread_us)
+		: _work_us(work_us), _spread_us(spread_us)
+	{
+		if (interval > 0) {
+			start(interval);
+		}
+	}
+};
+
+static void loopFor(unsigned long ms)
+{
+	const unsigned long long end = hostTime() + (unsigned long long)ms * 1000;
+	
+	while (hostTime() < end) {
+		VariableTimedAction::updateActions();
+		hostAdvance(loop_us);
+	}
+}
+
+static bool run(const char * name, int freq, bool is_auto, unsigned long interval, unsigned long work_us, unsigned long spread_us)
+{
+	randomSeed(1);
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, freq);
+	Load load(interval, work_us, spread_us);
+	
+	if (is_auto) {
+		led_cube.setAutoRefresh(true, 30, 400, min_time_for_layer);
+	}
+	// settles, then measures
+	loopFor(5000);
+	led_cube.resetRefreshStats();
+	loopFor(5000);
+	
+	const LedCubeRefreshStats stats = led_cube.getRefreshStats();
+	const int target = led_cube.getTargetRefreshFrequency();
+	const unsigned long period = 1000000UL / target;
+	const double duty = 100.0 * stats.time_for_layer * num_layers / stats.period;
+	bool ok = true;
+	
+	// the reached rate within 2 % of the target (the fixed refresh at the requested one, the automatic at its chosen one)
+	ok = (unsigned long)abs(led_cube.getRefreshFrequency() - target) * 50 <= (unsigned long)target;
+	if (is_auto) {
+		ok &= stats.jitter * 50 < period && stats.max_period < period + period / 8 && stats.time_for_layer >= min_time_for_layer;
+	}
+	printf("%-34s %4d Hz %4d Hz  %5lu us (%d ms)  %6lu %6lu %6lu  %5lu us  %4lu us  %6lu us  %4.0f %%%s\n",
+		name, target, led_cube.getRefreshFrequency(), stats.time_for_layer, 1000 / target / num_layers,
+		stats.min_period, stats.period, stats.max_period, stats.jitter, stats.scan_overhead, stats.max_gap, duty,
+		ok ? "" : "  FAILED");
+	return ok;
+}
+
+int main()
+{
+	bool ok = true;
+	
+	hostSetDigitalWriteHook(slowWrite);
+	printf("%lu us per digitalWrite(), %lu us per pass of the main loop, automatic: 30-400 Hz, at least %lu us per layer\n\n",
+		write_us, loop_us, min_time_for_layer);
+	printf("%-34s %7s %7s  %18s  %20s  %8s  %7s  %9s  %s\n",
+		"", "target", "reached", "on-time (former)", "period min/avg/max", "jitter", "switch", "max gap", "duty");
+	ok &= run("requested 60 Hz, no load", 60, false, 0, 0, 0);
+	ok &= run("requested 60 Hz, 3 ms / 20 ms", 60, false, 20, 3000, 0);
+	ok &= run("requested 200 Hz, no load", 200, false, 0, 0, 0);
+	ok &= run("automatic, no load", 60, true, 0, 0, 0);
+	ok &= run("automatic, 3 ms / 20 ms", 60, true, 20, 3000, 0);
+	ok &= run("automatic, 8 ms / 40 ms", 60, true, 40, 8000, 0);
+	ok &= run("automatic, 1-6 ms / 10 ms", 60, true, 10, 1000, 5000);
+	ok &= run("automatic, 20 ms / 100 ms", 60, true, 100, 20000, 0);
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
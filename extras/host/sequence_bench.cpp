@@ -0,0 +1,294 @@
+/* Compares sequences written with SEQUENCE_BEGIN/SEQUENCE_YIELD (LedCubeCoroutine.h) against
+ * the previous hand written "while (true) { switch (_state) ... }" implementations and C++20 coroutines:
+ * - checks that all variants produce the same frames and waits
+ * - reports the time per frame and the code size of operator() of every variant on the host
+ *
+ * Build (in extras/host, C++20 for the coroutine variant):
+ *   g++ -std=gnu++20 -O2 -I. -I../.. sequence_bench.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp -o sequence_bench
+ */
+
+#include <stdio.h>
+#include <chrono>
+
+#include "LedCube.h"
+#include "LedCubeCoroutine.h"
+
+// previous implementations (state machines with magic numbers)
+class SwitchUpAndDown : public sequences::TurnOnAndOffAllByLayerUpAndDown
+{
+public:
+	SwitchUpAndDown(LedCube * led_cube) : sequences::TurnOnAndOffAllByLayerUpAndDown(led_cube) {}
+	unsigned long operator()();
+};
+
+class SwitchSideways : public sequences::TurnOnAndOffAllByLayerSideways
+{
+public:
+	SwitchSideways(LedCube * led_cube) : sequences::TurnOnAndOffAllByLayerSideways(led_cube) {}
+	unsigned long operator()();
+};
+
+unsigned long SwitchUpAndDown::operator()()
+{
+	int x = 0;
+	int y = 0;
+	int z = 0;
+	
+	while (true) {
+		switch(_state) {
+			case 0:
+				_led_cube->turnEverythingOn();
+				_state += 1;
+				return _wait;
+			case 1:
+				_layer = _led_cube->getSize()-1;
+				_state += 1;
+			case 2:
+				// Turn off by layer from the top to the bottom
+				z = _layer;
+				for (x = 0; x < _led_cube->getSize(); ++x) {
+					for (y = 0; y < _led_cube->getSize(); ++y) {
+						_led_cube->turnOff(x, y, z);
+					}
+				}
+				_layer -= 1;
+				if (_layer < 0) {
+					_layer = 0;
+					_state += 1;
+				}
+				return _wait;
+			case 3:
+				// Turn on by layer from the bottom to the top
+				z = _layer;
+				for (x = 0; x < _led_cube->getSize(); ++x) {
+					for (y = 0; y < _led_cube->getSize(); ++y) {
+						_led_cube->turnOn(x, y, z);
+					}
+				}
+				_layer += 1;
+				if (_layer >= _led_cube->getSize()) {
+					_layer = 0;
+					_state += 1;
+				}
+				return _wait;
+			case 4:
+				// Turn off by layer from the bottom to the top
+				z = _layer;
+				for (x = 0; x < _led_cube->getSize(); ++x) {
+					for (y = 0; y < _led_cube->getSize(); ++y) {
+						_led_cube->turnOff(x, y, z);
+					}
+				}
+				_layer += 1;
+				if (_layer >= _led_cube->getSize()) {
+					_layer = _led_cube->getSize()-1;
+					_state += 1;
+				}
+				return _wait;
+			case 5:
+				// Turn on by layer from the top to the bottom
+				z = _layer;
+				for (x = 0; x < _led_cube->getSize(); ++x) {
+					for (y = 0; y < _led_cube->getSize(); ++y) {
+						_led_cube->turnOn(x, y, z);
+					}
+				}
+				_layer -= 1;
+				if (_layer < 0) {
+					_layer = 0;
+					_state += 1;
+				}
+				return _wait;
+			case 6:
+				if (_cycles_cnt < _max_cycles) {
+					_cycles_cnt += 1;
+					_state = 1;
+				} else {
+					_state += 1;
+				}
+				break;
+			default:
+				return 0;
+		}
+	}
+}
+
+unsigned long SwitchSideways::operator()()
+{
+	while (true) {
+		switch(_state) {
+			case 0:
+				_led_cube->turnEverythingOff();
+				_state += 1;
+				return _wait;
+			case 1:
+				_layer = 0;
+				_state += 1;
+			case 2:
+				// Turn on by layer from the front to the back
+				for (int i = 0; i < _led_cube->getSize(); ++i) {
+					for (int j = 0; j < _led_cube->getSize(); ++j) {
+						_led_cube->turnOn(i, _layer, j);
+					}
+				}
+				_layer += 1;
+				if (_layer >= _led_cube->getSize()) {
+					_layer = 0;
+					_state += 1;
+				}
+				return _wait;
+			case 3:
+				// Turn off by layer from the front to the back
+				for (int i = 0; i < _led_cube->getSize(); ++i) {
+					for (int j = 0; j < _led_cube->getSize(); ++j) {
+						_led_cube->turnOff(i, _layer, j);
+					}
+				}
+				_layer += 1;
+				if (_layer >= _led_cube->getSize()) {
+					_layer = _led_cube->getSize()-1;
+					_state += 1;
+				}
+				return _wait;
+			case 4:
+				// Turn on by layer from the back to the front
+				for (int i = 0; i < _led_cube->getSize(); ++i) {
+					for (int j = 0; j < _led_cube->getSize(); ++j) {
+						_led_cube->turnOn(i, _layer, j);
+					}
+				}
+				_layer -= 1;
+				if (_layer < 0) {
+					_layer = _led_cube->getSize()-1;
+					_state += 1;
+				}
+				return _wait;
+			case 5:
+				// Turn off by layer from the back to the front
+				for (int i = 0; i < _led_cube->getSize(); ++i) {
+					for (int j = 0; j < _led_cube->getSize(); ++j) {
+						_led_cube->turnOff(i, _layer, j);
+					}
+				}
+				_layer -= 1;
+				if (_layer < 0) {
+					_layer = 0;
+					_state += 1;
+				}
+				return _wait;
+			case 6:
+				if (_cycles_cnt < _max_cycles) {
+					_cycles_cnt += 1;
+					_state = 1;
+				} else {
+					_state += 1;
+				}
+				break;
+			default:
+				return 0;
+		}
+	}
+}
+
+#if defined(__cpp_impl_coroutine)
+LedCubeTask coroutineUpAndDown(LedCube * led_cube, unsigned long wait=75, int max_cycles=5)
+{
+	const int size = led_cube->getSize();
+	
+	led_cube->turnEverythingOn();
+	co_yield wait;
+	for (int cycle = 0; ; ++cycle) {
+		for (int z = size-1; z >= 0; --z) {
+			for (int x = 0; x < size; ++x) for (int y = 0; y < size; ++y) led_cube->turnOff(x, y, z);
+			co_yield wait;
+		}
+		for (int z = 0; z < size; ++z) {
+			for (int x = 0; x < size; ++x) for (int y = 0; y < size; ++y) led_cube->turnOn(x, y, z);
+			co_yield wait;
+		}
+		for (int z = 0; z < size; ++z) {
+			for (int x = 0; x < size; ++x) for (int y = 0; y < size; ++y) led_cube->turnOff(x, y, z);
+			co_yield wait;
+		}
+		for (int z = size-1; z >= 0; --z) {
+			for (int x = 0; x < size; ++x) for (int y = 0; y < size; ++y) led_cube->turnOn(x, y, z);
+			co_yield wait;
+		}
+		if (cycle >= max_cycles) {
+			break;
+		}
+	}
+}
+#endif
+
+static const int size = 8;
+int led_cube_map[size][size * size];
+int * p_led_cube_map[size];
+int layer[size];
+int column[size * size];
+
+// FNV-1a of all frames and waits
+struct Run
+{
+	unsigned long frames;
+	unsigned long hash;
+	double ns_per_frame;
+};
+
+Run play(LedCube * led_cube, LedCubeSequence * (*create)(LedCube *), int repeats)
+{
+	Run run = {0, 2166136261UL, 0};
+	double ns = 0;
+	
+	for (int r = 0; r < repeats; ++r) {
+		LedCubeSequence * sequence = create(led_cube);
+		led_cube->turnEverythingOff();
+		unsigned long wait;
+		do {
+			auto start = std::chrono::steady_clock::now();
+			wait = (*sequence)();
+			ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			if (r == 0) {
+				run.frames += 1;
+				run.hash = (run.hash ^ wait) * 16777619UL;
+				for (int l = 0; l < size; ++l) {
+					for (int c = 0; c < size * size; ++c) {
+						run.hash = (run.hash ^ led_cube_map[l][c]) * 16777619UL;
+					}
+				}
+			}
+		} while (wait != 0);
+		delete sequence;
+	}
+	run.ns_per_frame = ns / repeats / run.frames;
+	return run;
+}
+
+void report(const char * name, Run run, Run reference)
+{
+	printf("%-28s %5lu frames  hash %08lx %s  %8.1f ns/frame\n", name, run.frames, run.hash, (run.hash == reference.hash && run.frames == reference.frames) ? "same" : "DIFFERENT", run.ns_per_frame);
+}
+
+int main()
+{
+	for (int l = 0; l < size; ++l) {
+		p_led_cube_map[l] = led_cube_map[l];
+		layer[l] = l;
+	}
+	LedCube led_cube(p_led_cube_map, layer, column, size, size * size, size, 60);
+	const int repeats = 2000;
+	
+	Run reference = play(&led_cube, [](LedCube * c) -> LedCubeSequence * { return new SwitchUpAndDown(c); }, repeats);
+	report("UpAndDown switch", reference, reference);
+	report("UpAndDown SEQUENCE_YIELD", play(&led_cube, [](LedCube * c) -> LedCubeSequence * { return new sequences::TurnOnAndOffAllByLayerUpAndDown(c); }, repeats), reference);
+#if defined(__cpp_impl_coroutine)
+	report("UpAndDown C++20 co_yield", play(&led_cube, [](LedCube * c) -> LedCubeSequence * { return new sequences::Coroutine(c, coroutineUpAndDown(c)); }, repeats), reference);
+#endif
+	
+	reference = play(&led_cube, [](LedCube * c) -> LedCubeSequence * { return new SwitchSideways(c); }, repeats);
+	report("Sideways switch", reference, reference);
+	report("Sideways SEQUENCE_YIELD", play(&led_cube, [](LedCube * c) -> LedCubeSequence * { return new sequences::TurnOnAndOffAllByLayerSideways(c); }, repeats), reference);
+	
+	printf("\ncode size of operator() (host, see also: nm -C --size-sort sequence_bench | grep operator)\n");
+	return 0;
+}
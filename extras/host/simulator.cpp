@@ -0,0 +1,387 @@
+/* Headless simulator: runs the unmodified library in a main loop like the one of the examples on the virtual time,
+ * idle time is skipped, so hours of animation take seconds. The scan of the cube is followed pin by pin
+ * (every digitalWrite() takes write_us) and the brightness of every LED is reconstructed from it: the time it was lit
+ * in a window as long as the eye integrates (20 ms), 255 => lit for the whole time of its layer (1 / layers of the window).
+ * - --view draws the cube in an ANSI terminal (layers side by side, bottom layer left, y up), paced to --speed
+ * - --dump writes the windows into a file: "LCV1", size (1 B), window [ms] (2 B, little endian), then size^3 B per window
+ *   (brightness of x + y * size + z * size^2)
+ * - at the end: simulated seconds per wall second, refreshes, frames of the sequence, mean brightness of the lit LEDs
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. simulator.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp -o simulator
+ * Usage:
+ *   ./simulator [--sequence demo|NAME] [--seconds S] [--size 4|8] [--freq HZ] [--auto] [--write-us US] [--window MS]
+ *               [--view] [--speed X] [--dump FILE] [--seed N] [--list]
+ *   --seconds S restarts the sequence until S simulated seconds have passed (default: the sequence once),
+ *   --speed X simulated seconds per wall second (default 1 with --view, 0 => as fast as possible)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <chrono>
+#include <thread>
+
+#include "LedCube.h"
+
+// playlist::SequenceId by name
+static const char * const names[playlist::PAUSE] = {
+	"off", "on", "flicker_on", "flicker_off", "up_down", "sideways", "stomp", "edge_down",
+	"rnd_flicker", "rnd_rain", "matrix_rain", "diagonal", "propeller", "spiral", "all_leds"
+};
+
+static int size = 4;
+static int num_layers = 8;
+static int num_columns = 8;
+static unsigned long write_us = 5;
+static const unsigned long loop_us = 20;
+
+// the scan followed pin by pin: a layer pin is the layer index, a column pin num_layers + the column index
+static uint8_t pins[256];
+static unsigned long long lit_since[256]; // [us] of the layers, since the last flush
+static unsigned long * lit; // [us] of the cells (layer * num_columns + column) in the window
+static int * led_of_cell; // x + y * size + z * size^2, -1 => unused cell
+
+// windows of the brightness
+static unsigned long window_us = 20000;
+static unsigned long long window_end;
+static uint8_t * brightness; // [size^3]
+static unsigned long windows = 0;
+static unsigned long long lit_sum = 0; // brightness of the lit LEDs
+static unsigned long long lit_count = 0;
+
+// output
+static bool is_view = false;
+static double speed = -1;
+static FILE * dump = nullptr;
+static std::chrono::steady_clock::time_point wall_start;
+static std::chrono::steady_clock::time_point last_draw;
+static unsigned long long sim_start;
+static const char * sequence_name = "demo";
+
+static void flushLayer(int layer, unsigned long long until)
+{
+	if (!pins[layer]) {
+		return;
+	}
+	const unsigned long time = until - lit_since[layer];
+	unsigned long * cells = lit + layer * num_columns;
+	
+	for (int column = 0; column < num_columns; ++column) {
+		if (pins[num_layers + column]) {
+			cells[column] += time;
+		}
+	}
+	lit_since[layer] = until;
+}
+
+static void flushLayers(unsigned long long until)
+{
+	for (int layer = 0; layer < num_layers; ++layer) {
+		flushLayer(layer, until);
+	}
+}
+
+static void draw()
+{
+	std::string out = "\x1b[H";
+	char buffer[64];
+	
+	for (int y = size - 1; y >= 0; --y) {
+		for (int z = 0; z < size; ++z) {
+			for (int x = 0; x < size; ++x) {
+				const uint8_t value = brightness[x + y * size + z * size * size];
+				
+				if (value == 0) {
+					out += "\x1b[38;5;236m\xc2\xb7\xc2\xb7";
+				} else {
+					snprintf(buffer, sizeof(buffer), "\x1b[38;5;%dm\xe2\x96\x88\xe2\x96\x88", 232 + value * 23 / 255);
+					out += buffer;
+				}
+			}
+			out += "\x1b[0m  ";
+		}
+		out += "\n";
+	}
+	snprintf(buffer, sizeof(buffer), "\n%s  %.1f s  \x1b[K\n", sequence_name, (hostTime() - sim_start) / 1e6);
+	out += buffer;
+	fputs(out.c_str(), stdout);
+	fflush(stdout);
+}
+
+static void endOfWindow()
+{
+	// 255 => lit for the whole share of its layer
+	for (int cell = 0; cell < num_layers * num_columns; ++cell) {
+		if (led_of_cell[cell] < 0) {
+			continue;
+		}
+		const unsigned long long value = (unsigned long long)lit[cell] * num_layers * 255 / window_us;
+		const uint8_t shown = (value < 255) ? value : 255;
+		
+		brightness[led_of_cell[cell]] = shown;
+		lit[cell] = 0;
+		if (shown > 0) {
+			lit_sum += shown;
+			lit_count += 1;
+		}
+	}
+	windows += 1;
+	if (dump != nullptr) {
+		fwrite(brightness, 1, size * size * size, dump);
+	}
+	if (speed > 0) {
+		// the simulation waits for the wall clock
+		const double ahead = (window_end - sim_start) / 1e6 / speed
+			- std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+		
+		if (ahead > 0) {
+			std::this_thread::sleep_for(std::chrono::duration<double>(ahead));
+		}
+	}
+	if (is_view && std::chrono::steady_clock::now() - last_draw >= std::chrono::milliseconds(20)) {
+		last_draw = std::chrono::steady_clock::now();
+		draw();
+	}
+}
+
+static void onTime(unsigned long long now)
+{
+	while (now >= window_end) {
+		flushLayers(window_end);
+		endOfWindow();
+		window_end += window_us;
+	}
+}
+
+static void onWrite(uint8_t pin, uint8_t value)
+{
+	const unsigned long long now = hostTime();
+	
+	if (pin < num_layers) {
+		if (value && !pins[pin]) {
+			lit_since[pin] = now;
+		} else {
+			flushLayer(pin, now);
+		}
+	} else if (pin < num_layers + num_columns) {
+		// a column switched while its layer is lit
+		flushLayers(now);
+	}
+	pins[pin] = value ? HIGH : LOW;
+	hostAdvance(write_us);
+}
+
+static LedCubeSequence * create(LedCube * led_cube)
+{
+	if (strcmp(sequence_name, "demo") == 0) {
+		return new sequences::Demo(led_cube);
+	}
+	for (int id = 0; id < playlist::PAUSE; ++id) {
+		if (strcmp(sequence_name, names[id]) == 0) {
+			const playlist::Entry entry = {(uint8_t)id, 0, 0, 0};
+			
+			return playlist::create(led_cube, entry);
+		}
+	}
+	return nullptr;
+}
+
+// the sequence again and again until the end of the simulation (or once)
+class Player : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	const bool _repeat;
+	
+	unsigned long run() {
+		if (!_led_cube->isSequenceRunning()) {
+			if (runs > 0 && !_repeat) {
+				is_done = true;
+				stop();
+				return 0;
+			}
+			_led_cube->setSequence(create(_led_cube));
+			runs += 1;
+		}
+		const unsigned long wait = _led_cube->nextFrameOfSequence();
+		
+		frames += 1;
+		return (wait > 0) ? wait : 1;
+	}
+
+public:
+	unsigned long runs;
+	unsigned long frames;
+	bool is_done;
+	
+	Player(LedCube * led_cube, bool repeat)
+		: _led_cube(led_cube), _repeat(repeat), runs(0), frames(0), is_done(false)
+	{
+		start(1);
+	}
+};
+
+int main(int argc, char ** argv)
+{
+	double seconds = 0;
+	int freq = 60;
+	bool is_auto = false;
+	const char * dump_path = nullptr;
+	unsigned long seed = 1;
+	
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--sequence") == 0 && i+1 < argc) {
+			sequence_name = argv[++i];
+		} else if (strcmp(argv[i], "--seconds") == 0 && i+1 < argc) {
+			seconds = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--size") == 0 && i+1 < argc) {
+			size = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--freq") == 0 && i+1 < argc) {
+			freq = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--auto") == 0) {
+			is_auto = true;
+		} else if (strcmp(argv[i], "--write-us") == 0 && i+1 < argc) {
+			write_us = strtoul(argv[++i], nullptr, 0);
+		} else if (strcmp(argv[i], "--window") == 0 && i+1 < argc) {
+			window_us = strtoul(argv[++i], nullptr, 0) * 1000;
+		} else if (strcmp(argv[i], "--view") == 0) {
+			is_view = true;
+		} else if (strcmp(argv[i], "--speed") == 0 && i+1 < argc) {
+			speed = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--dump") == 0 && i+1 < argc) {
+			dump_path = argv[++i];
+		} else if (strcmp(argv[i], "--seed") == 0 && i+1 < argc) {
+			seed = strtoul(argv[++i], nullptr, 0);
+		} else if (strcmp(argv[i], "--list") == 0) {
+			printf("demo");
+			for (int id = 0; id < playlist::PAUSE; ++id) {
+				printf(" %s", names[id]);
+			}
+			printf("\n");
+			return 0;
+		} else {
+			fprintf(stderr, "usage: %s [--sequence demo|NAME] [--seconds S] [--size 4|8] [--freq HZ] [--auto] [--write-us US]"
+				" [--window MS] [--view] [--speed X] [--dump FILE] [--seed N] [--list]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (size != 4 && size != 8) {
+		fprintf(stderr, "size 4 (8 layers of 8 columns) or 8 (8 layers of 64 columns)\n");
+		return 2;
+	}
+	if (window_us == 0) {
+		window_us = 20000;
+	}
+	if (speed < 0) {
+		speed = is_view ? 1 : 0;
+	}
+	
+	// 4x4x4 wired as in the examples (the footprint split in two), 8x8x8 a column per LED of a layer
+	num_layers = 8;
+	num_columns = size * size * size / num_layers;
+	int ** map = new int * [num_layers];
+	int * layer_pins = new int[num_layers];
+	int * column_pins = new int[num_columns];
+	
+	for (int i = 0; i < num_layers; ++i) {
+		map[i] = new int[num_columns];
+		layer_pins[i] = i;
+	}
+	for (int i = 0; i < num_columns; ++i) {
+		column_pins[i] = num_layers + i;
+	}
+	lit = new unsigned long[num_layers * num_columns]();
+	led_of_cell = new int[num_layers * num_columns];
+	brightness = new uint8_t[size * size * size]();
+	
+	LedCube led_cube(map, layer_pins, column_pins, num_layers, num_columns, size, freq);
+	
+	LedCubeSequence * probe = create(&led_cube);
+	
+	if (probe == nullptr) {
+		fprintf(stderr, "unknown sequence %s (--list)\n", sequence_name);
+		return 2;
+	}
+	delete probe;
+	// which cell of the map is which LED
+	for (int cell = 0; cell < num_layers * num_columns; ++cell) {
+		led_of_cell[cell] = -1;
+	}
+	for (int z = 0; z < size; ++z) {
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				led_cube.turnEverythingOff();
+				led_cube.turnOn(x, y, z);
+				for (int cell = 0; cell < num_layers * num_columns; ++cell) {
+					if (map[cell / num_columns][cell % num_columns]) {
+						led_of_cell[cell] = x + y * size + z * size * size;
+					}
+				}
+			}
+		}
+	}
+	led_cube.turnEverythingOff();
+	if (is_auto) {
+		led_cube.setAutoRefresh(true);
+	}
+	
+	if (dump_path != nullptr) {
+		dump = fopen(dump_path, "wb");
+		if (dump == nullptr) {
+			fprintf(stderr, "cannot write %s\n", dump_path);
+			return 1;
+		}
+		const uint8_t header[7] = {'L', 'C', 'V', '1', (uint8_t)size, (uint8_t)((window_us / 1000) & 0xFF), (uint8_t)((window_us / 1000) >> 8)};
+		
+		fwrite(header, 1, sizeof(header), dump);
+	}
+	if (is_view) {
+		printf("\x1b[2J\x1b[?25l");
+	}
+	
+	randomSeed(seed);
+	Player player(&led_cube, seconds > 0);
+	const unsigned long long end = hostTime() + (unsigned long long)(seconds * 1e6);
+	
+	sim_start = hostTime();
+	window_end = sim_start + window_us;
+	wall_start = std::chrono::steady_clock::now();
+	last_draw = wall_start - std::chrono::seconds(1);
+	hostSetDigitalWriteHook(onWrite);
+	hostSetTimeHook(onTime);
+	while (!player.is_done && (seconds <= 0 || hostTime() < end)) {
+		VariableTimedAction::updateActions();
+		// a pass of the main loop, or the idle time until the next action
+		const unsigned long idle = VariableTimedAction::hostUntilNext();
+		unsigned long long step = loop_us;
+		
+		if (idle > 0 && idle != 0xFFFFFFFFUL) {
+			const unsigned long long due = (hostTime() / 1000 + idle) * 1000;
+			
+			if (due > hostTime() + loop_us) {
+				step = due - hostTime();
+			}
+		}
+		hostAdvance(step);
+	}
+	hostSetTimeHook(nullptr);
+	hostSetDigitalWriteHook(nullptr);
+	
+	const double simulated = (hostTime() - sim_start) / 1e6;
+	const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+	const LedCubeRefreshStats stats = led_cube.getRefreshStats();
+	
+	if (is_view) {
+		printf("\x1b[?25h\n");
+	}
+	if (dump != nullptr) {
+		fclose(dump);
+	}
+	printf("%s on %dx%dx%d: %.1f simulated s in %.2f s (%.0f simulated s per second), %lu refreshes (%.1f Hz), "
+		"%lu frames in %lu runs, %lu windows of %lu ms, lit LEDs at %.0f %% on average\n",
+		sequence_name, size, size, size, simulated, wall, (wall > 0) ? simulated / wall : 0.0, stats.refreshes,
+		stats.refreshes / simulated, player.frames, player.runs, windows, window_us / 1000,
+		(lit_count > 0) ? 100.0 * lit_sum / lit_count / 255 : 0.0);
+	return 0;
+}
@@ -0,0 +1,310 @@
+/* Checks snapshots of sequences (LedCubeSnapshot.h) on sequences::Demo, on a playlist with dissolves and on the sequences
+ * of the other modules (ScrollText, ParticleShow, Program, Composite, Life3D, Spin, Shader):
+ * - a run with a checkpoint every 10 s (the map hashed after every frame), every checkpoint restored into a new sequence
+ *   plays the same frames as the run did after it (up to 300 frames or the end)
+ * - seeking: the frame at a time reached from the latest checkpoint before it against a replay from the start
+ *   (frames computed, wall time)
+ * - EEPROM slots: the newest one loaded, with the newest one cut off during its write the previous one
+ * - the size of the blobs and the time of a restore
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. snapshot_check.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeSnapshot.cpp ../../LedCubeText.cpp ../../LedCubeParticles.cpp ../../LedCubeVM.cpp ../../LedCubeComposite.cpp ../../LedCubeLife.cpp ../../LedCubeVector.cpp ../../LedCubeField.cpp -o snapshot_check
+ */
+
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <avr/eeprom.h>
+
+#include "LedCube.h"
+#include "LedCubeSnapshot.h"
+#include "LedCubeText.h"
+#include "LedCubeParticles.h"
+#include "LedCubeVM.h"
+#include "LedCubeComposite.h"
+#include "LedCubeLife.h"
+#include "LedCubeVector.h"
+#include "LedCubeField.h"
+#include "examples/Bytecode/layer_stomp.h"
+
+static const int size = 4;
+static const int num_layers = 8;
+static const int num_columns = 8;
+int led_cube_map[num_layers][num_columns];
+int * p_led_cube_map[num_layers] = {
+	led_cube_map[0], led_cube_map[1], led_cube_map[2], led_cube_map[3],
+	led_cube_map[4], led_cube_map[5], led_cube_map[6], led_cube_map[7]
+};
+int layer[num_layers] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column[num_columns] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+static const unsigned long checkpoint_ms = 10000; // sequences::Demo, 1 s for the shorter sequences
+static const size_t compared_frames = 300;
+
+struct Checkpoint {
+	size_t frame; // frames computed before it
+	unsigned long time; // [ms]
+	std::vector<uint8_t> blob;
+};
+
+struct Run {
+	std::vector<unsigned long> hashes; // after every frame
+	std::vector<unsigned long> times; // [ms] of every frame
+	std::vector<Checkpoint> checkpoints;
+	unsigned long failed_saves;
+	size_t max_blob;
+};
+
+static unsigned long hashMap()
+{
+	unsigned long hash = 2166136261UL;
+	
+	for (int l = 0; l < num_layers; ++l) {
+		for (int c = 0; c < num_columns; ++c) {
+			hash = (hash ^ (led_cube_map[l][c] != 0)) * 16777619UL;
+		}
+	}
+	return hash;
+}
+
+// a new sequence, always with the same parameters
+typedef LedCubeSequence * (*Factory)(LedCube * led_cube);
+
+static LedCubeSequence * demo(LedCube * led_cube) { return new sequences::Demo(led_cube); }
+
+static LedCubeSequence * demoWithDissolves(LedCube * led_cube)
+{
+	sequences::Playlist * playlist = new sequences::Demo(led_cube);
+	
+	playlist->setTransition(transition::DISSOLVE, 400, 20);
+	return playlist;
+}
+
+static LedCubeSequence * scrollText(LedCube * led_cube) { return new sequences::ScrollText(led_cube, "SNAPSHOT", sequences::ScrollText::AROUND, 120, 8); }
+
+static LedCubeSequence * particleShow(LedCube * led_cube) { return new sequences::ParticleShow<16>(led_cube, particles::fountain, 50, 1200); }
+
+static LedCubeSequence * program(LedCube * led_cube) { return new sequences::Program(led_cube, layer_stomp, vm::FROM_PROGMEM); }
+
+static LedCubeSequence * demoWithLife(LedCube * led_cube)
+{
+	sequences::Composite * composite = new sequences::Composite(led_cube);
+	
+	composite->addLayer(new sequences::Demo(led_cube));
+	composite->addLayer(new sequences::Life3D(led_cube, life3d::bays_4555, 300, 100), composite::XOR);
+	return composite;
+}
+
+static LedCubeSequence * life3D(LedCube * led_cube) { return new sequences::Life3D(led_cube, life3d::amoeba, 100, 600); }
+
+static LedCubeSequence * spin(LedCube * led_cube) { return new sequences::Spin(led_cube, meshes::star, 40, 1500); }
+
+static LedCubeSequence * shader(LedCube * led_cube) { return new sequences::Shader(led_cube, new fields::Plasma(led_cube), 40, 1500); }
+
+/* Frames until the end of the sequence or max_frames, the time of a frame is the sum of the waits before it.
+ * With a snapshot it saves at the checkpoints (every save seeds random(), so the runs after a restore save too).
+ */
+static void play(LedCube &led_cube, Run &run, unsigned long time, size_t max_frames, LedCubeSnapshot * snapshot,
+	unsigned long period=checkpoint_ms)
+{
+	unsigned long next_checkpoint = (time / period + 1) * period;
+	
+	while (led_cube.isSequenceRunning() && run.hashes.size() < max_frames) {
+		const unsigned long wait = led_cube.nextFrameOfSequence();
+		
+		run.hashes.push_back(hashMap());
+		run.times.push_back(time);
+		time += wait;
+		hostAdvance(wait * 1000UL);
+		if (snapshot != nullptr && time >= next_checkpoint && led_cube.isSequenceRunning()) {
+			if (snapshot->save()) {
+				const Checkpoint checkpoint = {run.hashes.size(), time,
+					std::vector<uint8_t>(snapshot->getData(), snapshot->getData() + snapshot->getLength())};
+				
+				run.checkpoints.push_back(checkpoint);
+				if (checkpoint.blob.size() > run.max_blob) {
+					run.max_blob = checkpoint.blob.size();
+				}
+				next_checkpoint += period;
+			} else {
+				// e.g. during the blend of a transition, tried again after the next frame
+				run.failed_saves += 1;
+			}
+		}
+	}
+}
+
+static bool restore(LedCube &led_cube, LedCubeSnapshot &snapshot, const Checkpoint &checkpoint, Factory create)
+{
+	snapshot.setData(checkpoint.blob.data(), checkpoint.blob.size());
+	return snapshot.restore(create(&led_cube));
+}
+
+static bool checkRestores(const char * name, Factory create, unsigned long period=checkpoint_ms)
+{
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	LedCubeSnapshot snapshot(&led_cube);
+	Run run = {};
+	bool ok = true;
+	size_t same = 0;
+	double max_restore_us = 0;
+	
+	randomSeed(1);
+	led_cube.setSequence(create(&led_cube));
+	play(led_cube, run, 0, (size_t)-1, &snapshot, period);
+	
+	for (size_t i = 0; i < run.checkpoints.size(); ++i) {
+		const Checkpoint &checkpoint = run.checkpoints[i];
+		led_cube.turnEverythingOff();
+		
+		const auto start = std::chrono::steady_clock::now();
+		const bool restored = restore(led_cube, snapshot, checkpoint, create);
+		const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		if (us > max_restore_us) {
+			max_restore_us = us;
+		}
+		// what the cube showed at the checkpoint, then the frames after it
+		bool is_same = restored && hashMap() == run.hashes[checkpoint.frame - 1];
+		Run after = {};
+		play(led_cube, after, checkpoint.time, compared_frames, &snapshot, period);
+		const size_t count = std::min(compared_frames, run.hashes.size() - checkpoint.frame);
+		is_same &= after.hashes.size() == count;
+		for (size_t j = 0; is_same && j < count; ++j) {
+			is_same &= after.hashes[j] == run.hashes[checkpoint.frame + j];
+		}
+		if (!is_same) {
+			printf("  checkpoint at %lu ms (frame %zu) DIFFERS\n", checkpoint.time, checkpoint.frame);
+		}
+		same += is_same;
+		led_cube.stopCurrentSequence();
+	}
+	
+	ok = run.checkpoints.size() >= 5 && same == run.checkpoints.size();
+	printf("%-18s %6zu frames  %5.1f s  %3zu checkpoints  %3zu same  %3lu saves refused  blob <= %3zu B  restore <= %5.1f us%s\n",
+		name, run.hashes.size(), run.times.back() / 1000.0, run.checkpoints.size(), same, run.failed_saves, run.max_blob,
+		max_restore_us, ok ? "" : "  FAILED");
+	return ok;
+}
+
+static bool checkSeek()
+{
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	LedCubeSnapshot snapshot(&led_cube);
+	Run run = {};
+	bool ok = true;
+	
+	randomSeed(2);
+	led_cube.setSequence(demo(&led_cube));
+	play(led_cube, run, 0, (size_t)-1, &snapshot);
+	
+	printf("\nseek (the frame shown at the time, sequences::Demo of %.1f s):\n", run.times.back() / 1000.0);
+	for (unsigned long target = 15000; target < run.times.back(); target += 20000) {
+		// frame shown at the target: the last one which started before it
+		size_t target_frame = 0;
+		while (target_frame + 1 < run.times.size() && run.times[target_frame + 1] <= target) {
+			target_frame += 1;
+		}
+		
+		// replay from the start
+		auto start = std::chrono::steady_clock::now();
+		Run replay = {};
+		randomSeed(2);
+		led_cube.setSequence(demo(&led_cube));
+		play(led_cube, replay, 0, target_frame + 1, &snapshot);
+		const double replay_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		const bool replay_ok = replay.hashes.back() == run.hashes[target_frame];
+		
+		// from the latest checkpoint before the target
+		start = std::chrono::steady_clock::now();
+		size_t c = 0;
+		while (c + 1 < run.checkpoints.size() && run.checkpoints[c + 1].frame <= target_frame) {
+			c += 1;
+		}
+		const Checkpoint &checkpoint = run.checkpoints[c];
+		Run seek = {};
+		bool seek_ok = restore(led_cube, snapshot, checkpoint, demo);
+		play(led_cube, seek, checkpoint.time, target_frame + 1 - checkpoint.frame, &snapshot);
+		const double seek_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		seek_ok &= hashMap() == run.hashes[target_frame];
+		led_cube.stopCurrentSequence();
+		
+		ok &= replay_ok && seek_ok && seek.hashes.size() <= run.hashes.size();
+		printf("  %6.1f s: replay %5zu frames %8.1f us%s, from the checkpoint at %5.1f s %4zu frames %7.1f us%s\n",
+			target / 1000.0, replay.hashes.size(), replay_us, replay_ok ? "" : " DIFFERS", checkpoint.time / 1000.0,
+			seek.hashes.size(), seek_us, seek_ok ? "" : " DIFFERS");
+	}
+	printf("%s\n", ok ? "" : "FAILED");
+	return ok;
+}
+
+static bool checkEeprom()
+{
+	LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+	LedCubeSnapshot snapshot(&led_cube);
+	LedCubeSnapshot loaded(&led_cube);
+	const uint16_t address = 64;
+	const uint8_t slots = 2;
+	std::vector<std::vector<uint8_t> > saved;
+	bool ok = true;
+	
+	randomSeed(3);
+	led_cube.setSequence(demo(&led_cube));
+	// more saves than slots, each load gives the last save
+	for (int i = 0; i < 5; ++i) {
+		for (int frame = 0; frame < 40 + 17 * i; ++frame) {
+			led_cube.nextFrameOfSequence();
+		}
+		ok &= snapshot.save() && snapshot.saveToEeprom(address, slots);
+		saved.push_back(std::vector<uint8_t>(snapshot.getData(), snapshot.getData() + snapshot.getLength()));
+		ok &= loaded.loadFromEeprom(address, slots)
+			&& std::vector<uint8_t>(loaded.getData(), loaded.getData() + loaded.getLength()) == saved.back();
+	}
+	const bool newest_ok = ok;
+	
+	// the newest slot cut off in the middle of its data: the previous save is loaded
+	uint8_t * eeprom = hostEeprom();
+	const uint16_t slot_size = snapshot.getEepromSize(slots) / slots;
+	int newest = -1;
+	for (int slot = 0; slot < slots; ++slot) {
+		const uint8_t * p = eeprom + address + slot * slot_size;
+		if ((uint16_t)(p[4] | p[5] << 8) != 0 && std::vector<uint8_t>(p + 6, p + 6 + saved.back().size()) == saved.back()) {
+			newest = slot;
+		}
+	}
+	eeprom[address + newest * slot_size + 6 + saved.back().size() / 2] ^= 0x5A;
+	const bool fallback_ok = loaded.loadFromEeprom(address, slots)
+		&& std::vector<uint8_t>(loaded.getData(), loaded.getData() + loaded.getLength()) == saved[saved.size() - 2];
+	
+	// nothing valid
+	for (int i = 0; i < snapshot.getEepromSize(slots); ++i) {
+		eeprom[address + i] = 0xFF;
+	}
+	const bool empty_ok = !loaded.loadFromEeprom(address, slots);
+	
+	led_cube.stopCurrentSequence();
+	ok &= fallback_ok && empty_ok;
+	printf("EEPROM (%u slots of %u B): newest save loaded %s, newest slot broken => previous save %s, erased => none %s%s\n",
+		slots, slot_size, newest_ok ? "yes" : "NO", fallback_ok ? "yes" : "NO", empty_ok ? "yes" : "NO", ok ? "" : "  FAILED");
+	return ok;
+}
+
+int main()
+{
+	bool ok = true;
+	
+	printf("4x4x4, checkpoint every %lu ms, %zu frames compared after every restore\n\n", checkpoint_ms, compared_frames);
+	ok &= checkRestores("Demo", demo);
+	ok &= checkRestores("Demo, dissolves", demoWithDissolves);
+	ok &= checkRestores("ScrollText", scrollText, 1000);
+	ok &= checkRestores("ParticleShow", particleShow, 1000);
+	ok &= checkRestores("Program", program, 1000);
+	ok &= checkRestores("Composite", demoWithLife);
+	ok &= checkRestores("Life3D", life3D, 1000);
+	ok &= checkRestores("Spin", spin, 1000);
+	ok &= checkRestores("Shader", shader, 1000);
+	ok &= checkSeek();
+	ok &= checkEeprom();
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
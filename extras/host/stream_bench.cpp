@@ -0,0 +1,315 @@
+/* Records sequences::Demo into an animation file (LedCubeStream.h) and plays it back through sequences::Stream
+ * from a file-backed stand-in of the storage with injected read latency (virtual time), in the main loop of the examples
+ * (LedCubeRefresher at 60 Hz and LedCube::nextFrameOfSequence()):
+ * - checks that the played frames are the recorded ones
+ * - reports prefetch underruns, the longest stall, how late the frames were against their deadlines and the longest
+ *   period of the refresh (the cube is dark while the storage is read between two refreshes)
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. stream_bench.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeStream.cpp -o stream_bench
+ * Usage:
+ *   ./stream_bench [file.lca]            records the demo into the file (default /tmp/demo.lca) and plays it with several storages
+ *   ./stream_bench file.lca latency_us per_byte_us [sector_bytes [spike_us spike_every]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "LedCube.h"
+#include "LedCubeStream.h"
+
+static const int size = 4;
+static const int num_layers = 8;
+static const int num_columns = 8;
+int led_cube_map[num_layers][num_columns];
+int * p_led_cube_map[num_layers] = {
+	led_cube_map[0], led_cube_map[1], led_cube_map[2], led_cube_map[3],
+	led_cube_map[4], led_cube_map[5], led_cube_map[6], led_cube_map[7]
+};
+int layer[num_layers] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column[num_columns] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+
+/* File with the latency of a real storage: latency + per_byte * length,
+ * with sector > 0 the latency is paid only when a read needs another sector (SD library caches one sector of 512 B),
+ * every spike_every-th latency takes spike more (wear leveling of SD cards, ...)
+ */
+class FileStorage : public LedCubeStorage
+{
+private:
+	FILE * _file;
+	unsigned long _latency; // [us]
+	unsigned long _per_byte; // [us]
+	unsigned long _sector; // [B]
+	unsigned long _spike; // [us]
+	unsigned long _spike_every;
+	unsigned long _reads;
+	unsigned long _loads;
+	long _cached_sector;
+public:
+	FileStorage(FILE * file, unsigned long latency, unsigned long per_byte, unsigned long sector=0, unsigned long spike=0, unsigned long spike_every=0)
+		: _file(file), _latency(latency), _per_byte(per_byte), _sector(sector), _spike(spike), _spike_every(spike_every), _reads(0), _loads(0), _cached_sector(-1)
+	{}
+	
+	int read(uint32_t offset, uint8_t * buffer, int length)
+	{
+		_reads += 1;
+		unsigned long time = _per_byte * length;
+		
+		long first = 0, last = 0;
+		if (_sector > 0 && length > 0) {
+			first = offset / _sector;
+			last = (offset + length - 1) / _sector;
+		}
+		for (long sector = first; sector <= last; ++sector) {
+			if (_sector == 0 || sector != _cached_sector) {
+				_loads += 1;
+				time += _latency + ((_spike_every && _loads % _spike_every == 0) ? _spike : 0);
+				_cached_sector = sector;
+			}
+		}
+		hostAdvance(time);
+		
+		if (fseek(_file, offset, SEEK_SET) != 0) {
+			return -1;
+		}
+		return fread(buffer, 1, length, _file);
+	}
+	
+	unsigned long getReads() { return _reads; }
+};
+
+// FNV-1a of the frames and waits
+static unsigned long hashFrame(unsigned long hash, unsigned long wait)
+{
+	hash = (hash ^ wait) * 16777619UL;
+	for (int z = 0; z < size; ++z) {
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				hash = (hash ^ led_cube.getState(x, y, z)) * 16777619UL;
+			}
+		}
+	}
+	return hash;
+}
+
+static unsigned long record(const char * path, std::vector<unsigned long> &waits)
+{
+	FILE * f = fopen(path, "wb");
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	const uint8_t header[stream::header_bytes] = {'L', 'C', stream::version, size};
+	fwrite(header, 1, sizeof(header), f);
+	
+	randomSeed(1);
+	led_cube.turnEverythingOff();
+	sequences::Demo demo(&led_cube);
+	unsigned long hash = 2166136261UL;
+	unsigned long wait;
+	waits.clear();
+	while ((wait = demo()) != 0) {
+		if (wait > 0xFFFF) {
+			wait = 0xFFFF;
+		}
+		hash = hashFrame(hash, wait);
+		waits.push_back(wait);
+		
+		uint8_t frame[stream::frameBytes(size)];
+		memset(frame, 0, sizeof(frame));
+		frame[0] = wait & 0xFF;
+		frame[1] = wait >> 8;
+		for (int i = 0, z = 0; z < size; ++z) {
+			for (int y = 0; y < size; ++y) {
+				for (int x = 0; x < size; ++x, ++i) {
+					if (led_cube.getState(x, y, z)) {
+						frame[2 + i / 8] |= 1 << (i % 8);
+					}
+				}
+			}
+		}
+		fwrite(frame, 1, sizeof(frame), f);
+	}
+	const uint8_t end[2] = {0, 0};
+	fwrite(end, 1, sizeof(end), f);
+	fclose(f);
+	return hash;
+}
+
+static const unsigned long loop_us = 20;
+
+// sequences::Demo computed, with its frames counted (the lateness of the loop itself)
+class CountedDemo : public sequences::Demo
+{
+public:
+	unsigned long frames;
+	
+	CountedDemo(LedCube * led_cube)
+		: Demo(led_cube), frames(0)
+	{}
+	
+	unsigned long operator()()
+	{
+		const unsigned long wait = Demo::operator()();
+		
+		if (wait != 0) {
+			frames += 1;
+		}
+		return wait;
+	}
+};
+
+// plays the sequence of the cube (as LedCubeManager of the examples) and notes when every frame is drawn
+class Player : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	LedCubeStreamPlayer * _stream; // nullptr => _demo
+	CountedDemo * _demo;
+	
+	unsigned long _frames() { return (_stream != nullptr) ? _stream->getFrames() : _demo->frames; }
+	
+	unsigned long run() {
+		const unsigned long long start = hostTime();
+		const unsigned long frames = _frames();
+		const unsigned long wait = _led_cube->nextFrameOfSequence();
+		
+		if (_led_cube->isSequenceRunning() && _frames() != frames) {
+			// the frame is drawn after the reads of an underrun, the prefetch after it is a part of its wait
+			drawn.push_back(start + ((_stream != nullptr) ? _stream->getFrameStall() : 0));
+			hash = hashFrame(hash, waits[drawn.size() - 1]);
+		}
+		return (wait > 0) ? wait : 1;
+	}
+
+public:
+	const std::vector<unsigned long> &waits;
+	std::vector<unsigned long long> drawn; // [us]
+	unsigned long hash;
+	
+	Player(LedCube * led_cube, LedCubeStreamPlayer * stream, CountedDemo * demo, const std::vector<unsigned long> &waits)
+		: _led_cube(led_cube), _stream(stream), _demo(demo), waits(waits), hash(2166136261UL)
+	{
+		start(1);
+	}
+};
+
+struct StreamStats {
+	unsigned long frames;
+	unsigned long underruns;
+	unsigned long max_stall; // [us]
+	bool error;
+};
+
+// main loop until the sequence ends, the statistics of the stream are kept before the cube deletes it
+static StreamStats runLoop(LedCubeStreamPlayer * stream)
+{
+	StreamStats stats = {};
+	
+	led_cube.resetRefreshStats();
+	while (led_cube.isSequenceRunning()) {
+		if (stream != nullptr) {
+			stats.frames = stream->getFrames();
+			stats.underruns = stream->getUnderruns();
+			stats.max_stall = stream->getMaxStall();
+			stats.error = stream->hasError();
+		}
+		VariableTimedAction::updateActions();
+		const unsigned long idle = VariableTimedAction::hostUntilNext();
+		hostAdvance((idle > 0 && idle != 0xFFFFFFFFUL) ? idle * 1000 : loop_us);
+	}
+	return stats;
+}
+
+// frames late against their deadlines from the first frame, the longest refresh period
+static void printLateness(const Player &player, unsigned long recorded_hash)
+{
+	unsigned long long max_late = 0;
+	unsigned long late_frames = 0;
+	unsigned long long deadline = player.drawn.empty() ? 0 : player.drawn[0];
+	
+	for (size_t i = 1; i < player.drawn.size(); ++i) {
+		deadline += player.waits[i - 1] * 1000ULL;
+		if (player.drawn[i] > deadline) {
+			if (player.drawn[i] - deadline > max_late) {
+				max_late = player.drawn[i] - deadline;
+			}
+			late_frames += 1;
+		}
+	}
+	printf("  %4lu late frames  max late %6.1f ms  longest refresh period %6.1f ms  frames %s", late_frames, max_late / 1000.0,
+		led_cube.getRefreshStats().max_period / 1000.0,
+		(player.hash == recorded_hash && player.drawn.size() == player.waits.size()) ? "same" : "DIFFERENT");
+}
+
+// the demo computed in the same loop: lateness of the loop and the refresh without any storage
+static void compute(unsigned long recorded_hash, const std::vector<unsigned long> &waits)
+{
+	CountedDemo * demo = new CountedDemo(&led_cube);
+	Player player(&led_cube, nullptr, demo, waits);
+	
+	randomSeed(1);
+	led_cube.turnEverythingOff();
+	led_cube.setSequence(demo);
+	runLoop(nullptr);
+	printf("%-34s %5zu frames  %69s", "computed, no storage", player.drawn.size(), "");
+	printLateness(player, recorded_hash);
+	printf("\n");
+}
+
+template <int block_size, int chunk_size>
+static void play(const char * name, const char * path, unsigned long recorded_hash, const std::vector<unsigned long> &waits, unsigned long latency, unsigned long per_byte, unsigned long sector=0, unsigned long spike=0, unsigned long spike_every=0)
+{
+	FILE * f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	FileStorage storage(f, latency, per_byte, sector, spike, spike_every);
+	led_cube.turnEverythingOff();
+	sequences::Stream<block_size, chunk_size> * stream = new sequences::Stream<block_size, chunk_size>(&led_cube, &storage);
+	Player player(&led_cube, stream, nullptr, waits);
+	const unsigned long long start = hostTime();
+	
+	// the cube deletes the stream with its last frame
+	led_cube.setSequence(stream);
+	const StreamStats stats = runLoop(stream);
+	fclose(f);
+	
+	printf("%-34s %5lu frames  start %5.1f ms  %5lu reads  %4lu underruns  max stall %6.1f ms%s", name, stats.frames,
+		player.drawn.empty() ? 0.0 : (player.drawn[0] - start) / 1000.0, storage.getReads(), stats.underruns,
+		stats.max_stall / 1000.0, stats.error ? "  ERROR" : "");
+	printLateness(player, recorded_hash);
+	printf("\n");
+}
+
+int main(int argc, char ** argv)
+{
+	const char * path = (argc > 1) ? argv[1] : "/tmp/demo.lca";
+	std::vector<unsigned long> waits;
+	const unsigned long hash = record(path, waits);
+	printf("recorded %zu frames of sequences::Demo into %s (%d B per frame)\n\n", waits.size(), path, stream::frameBytes(size));
+	
+	if (argc > 3) {
+		play<64, 16>("custom storage", path, hash, waits, strtoul(argv[2], nullptr, 0), strtoul(argv[3], nullptr, 0), (argc > 4) ? strtoul(argv[4], nullptr, 0) : 0,
+			(argc > 6) ? strtoul(argv[5], nullptr, 0) : 0, (argc > 6) ? strtoul(argv[6], nullptr, 0) : 0);
+		return 0;
+	}
+	
+	compute(hash, waits);
+	// I2C EEPROM at 400 kHz: ~0.1 ms per request + ~23 us per byte
+	play<64, 16>("I2C EEPROM, 2x64 B, 16 B chunks", path, hash, waits, 100, 23);
+	play<10, 10>("I2C EEPROM, 2x10 B (one frame)", path, hash, waits, 100, 23);
+	// SD card: ~2 ms per sector of 512 B (cached by the SD library), sometimes 50 ms (wear leveling, other files)
+	play<64, 16>("SD card, 2x64 B, 16 B chunks", path, hash, waits, 2000, 1, 512, 50000, 20);
+	play<128, 32>("SD card, 2x128 B, 32 B chunks", path, hash, waits, 2000, 1, 512, 50000, 20);
+	play<10, 10>("SD card, 2x10 B (one frame)", path, hash, waits, 2000, 1, 512, 50000, 20);
+	// reads of several ms (SPI flash behind a slow bus, SD card without the sector cache): many slices per frame
+	play<64, 16>("slow reads, 6 ms per read", path, hash, waits, 6000, 0);
+	// storage slower than the animation: underruns are expected
+	play<64, 16>("slow storage, 40 ms per read", path, hash, waits, 40000, 0);
+	return 0;
+}
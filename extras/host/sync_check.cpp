@@ -0,0 +1,386 @@
+/* Runs a wall of four cubes as four processes connected by ptys (LedCubeSync.h): node 0 is the master,
+ * this process copies everything it writes to the ptys of the slaves (a shared serial line).
+ * - the wall time moves in steps of step_us for all nodes together; the clock of every node runs off by ppm
+ *   (ceramic resonators of an Arduino are up to 0.5 %) and a node waits in every delay() until the wall time
+ *   reaches it, so the line is read as late as on the hardware (a scan or a long frame delays the reading)
+ * - every node plays the same sequence (a frame every 20 ms), the slaves have their own load of 0 / 2 / 0-6 ms per frame
+ * - reports for every slave how far from the master (in wall time) it shows the same frames and starts its scans,
+ *   free running and synchronized
+ * - checks that synchronized frames stay less than one frame apart and the scans less than a quarter of the period
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. sync_check.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeSync.cpp -lutil -o sync_check
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <map>
+#include <vector>
+
+#include "LedCube.h"
+#include "LedCubeSync.h"
+
+static const int num_nodes = 4;
+static const long node_ppm[num_nodes] = {0, 3000, -2500, 1200};
+static const unsigned long node_work_us[num_nodes] = {0, 0, 2000, 0};
+static const unsigned long node_spread_us[num_nodes] = {0, 0, 0, 6000};
+static const unsigned long frame_ms = 20;
+static const unsigned long start_ms = 500; // of the sequence
+static const unsigned long loop_us = 20; // pass of the main loop
+static const int64_t step_us = 100;
+static const int64_t run_ms = 10000;
+static const int64_t settle_ms = 2000; // not measured
+
+enum EventType {
+	FRAME,
+	SCAN,
+	STEP, // the node reached the wall time
+	DONE
+};
+
+struct Event
+{
+	int32_t node;
+	int32_t type;
+	int64_t value; // frame
+	int64_t time; // [us] wall time
+	int64_t accepted;
+	int64_t rejected;
+	int64_t corrupted;
+};
+
+// byte stream over the tty end of a pty
+class PtyStream : public Stream
+{
+private:
+	int _fd;
+	int _next;
+
+public:
+	PtyStream(int fd)
+		: _fd(fd), _next(-1)
+	{
+		fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+	}
+	
+	int available() { return peek() >= 0 ? 1 : 0; }
+	
+	int peek()
+	{
+		uint8_t value;
+		if (_next < 0 && ::read(_fd, &value, 1) == 1) {
+			_next = value;
+		}
+		return _next;
+	}
+	
+	int read()
+	{
+		const int value = peek();
+		_next = -1;
+		return value;
+	}
+	
+	size_t write(uint8_t value) { return write(&value, 1); }
+	
+	size_t write(const uint8_t * buffer, size_t size)
+	{
+		const ssize_t written = ::write(_fd, buffer, size);
+		return (written > 0) ? written : 0;
+	}
+};
+
+// --- one node (a child process) ---
+
+static int node_id;
+static int control_fd; // wall time of the next step
+static int report_fd;
+static double node_rate;
+static int64_t wall_time; // [us] the node may run until this time
+static int scan_pin;
+static LedCube * node_cube;
+static LedCubeSync * node_sync;
+static int_fast32_t load_state = 1;
+
+static void report(EventType type, int64_t value)
+{
+	Event event = {node_id, type, value, (int64_t)(hostTime() / node_rate), 0, 0, 0};
+	if (type == DONE && node_sync != nullptr) {
+		event.accepted = node_sync->getAccepted();
+		event.rejected = node_sync->getRejected();
+		event.corrupted = node_sync->getCorrupted();
+	}
+	if (write(report_fd, &event, sizeof(event)) != sizeof(event)) {
+		_exit(2);
+	}
+}
+
+// every wait of the node ends in the step of the wall in which it is due
+static void followWall(unsigned long long now)
+{
+	while (now / node_rate > wall_time) {
+		report(STEP, 0);
+		if (read(control_fd, &wall_time, sizeof(wall_time)) != sizeof(wall_time) || wall_time < 0) {
+			report(DONE, 0);
+			_exit(0);
+		}
+	}
+}
+
+static void onWrite(uint8_t pin, uint8_t value)
+{
+	if (pin == scan_pin && value == HIGH) {
+		report(SCAN, 0);
+	}
+}
+
+// a frame every frame_ms, reports it and takes the load of the node (without random(), which is shared by the sequences)
+class Frames : public LedCubeSequence
+{
+private:
+	unsigned long _frame;
+
+public:
+	Frames(LedCube * led_cube)
+		: LedCubeSequence(led_cube), _frame(0)
+	{}
+	
+	unsigned long operator()()
+	{
+		report(FRAME, _frame);
+		_led_cube->turnEverythingOff();
+		_led_cube->turnOn(_frame % 4, _frame / 4 % 4, _frame / 16 % 4);
+		_frame += 1;
+		unsigned long work = node_work_us[node_id];
+		if (node_spread_us[node_id] > 0) {
+			load_state = load_state * 1103515245 + 12345;
+			work += (unsigned long)(load_state >> 8) % (node_spread_us[node_id] + 1);
+		}
+		hostAdvance(work);
+		return frame_ms;
+	}
+};
+
+static void onSequence(uint8_t id)
+{
+	(void)id;
+	node_cube->setSequence(new Frames(node_cube));
+}
+
+class Manager : public VariableTimedAction
+{
+private:
+	LedCube * _led_cube;
+	
+	unsigned long run() {
+		if (_led_cube->isSequenceRunning()) {
+			return _led_cube->nextFrameOfSequence();
+		}
+		if (millis() >= start_ms && (node_sync == nullptr || node_sync->getRole() == LedCubeSync::MASTER)) {
+			if (node_sync != nullptr) {
+				node_sync->startSequence(0);
+			}
+			_led_cube->setSequence(new Frames(_led_cube));
+			return _led_cube->nextFrameOfSequence();
+		}
+		return 1;
+	}
+
+public:
+	Manager(LedCube * led_cube)
+		: _led_cube(led_cube)
+	{
+		start(1);
+	}
+};
+
+static void runNode(int id, int tty, bool is_synced)
+{
+	int map[8][8];
+	int * p_map[8] = {map[0], map[1], map[2], map[3], map[4], map[5], map[6], map[7]};
+	int layer[8] = {2, 3, 4, 5, 6, 7, 8, 9};
+	int column[8] = {10, 11, 12, 13, A0, A1, A2, A3};
+	
+	node_id = id;
+	node_rate = 1.0 + node_ppm[id] * 1e-6;
+	if (read(control_fd, &wall_time, sizeof(wall_time)) != sizeof(wall_time)) {
+		_exit(2);
+	}
+	LedCube led_cube(p_map, layer, column, 8, 8, 4, 60);
+	PtyStream port(tty);
+	node_cube = &led_cube;
+	scan_pin = layer[led_cube.getScanLayer(0)];
+	led_cube.setAutoRefresh(true, 50, 100, 200);
+	if (is_synced) {
+		node_sync = new LedCubeSync(&led_cube, &port, (id == 0) ? LedCubeSync::MASTER : LedCubeSync::SLAVE, 0, 50);
+		node_sync->setOnSequence(onSequence);
+	}
+	Manager manager(&led_cube);
+	hostSetDigitalWriteHook(onWrite);
+	hostSetTimeHook(followWall);
+	
+	// ends in followWall()
+	while (true) {
+		VariableTimedAction::updateActions();
+		hostAdvance(loop_us);
+	}
+}
+
+// --- the wall ---
+
+static bool runWall(bool is_synced)
+{
+	int master_fd[num_nodes], tty_fd[num_nodes], controls[num_nodes][2], reports[2];
+	pid_t pids[num_nodes];
+	
+	if (pipe(reports) != 0) {
+		return false;
+	}
+	for (int i = 0; i < num_nodes; ++i) {
+		struct termios raw;
+		if (openpty(&master_fd[i], &tty_fd[i], nullptr, nullptr, nullptr) != 0 || pipe(controls[i]) != 0) {
+			perror("openpty");
+			return false;
+		}
+		tcgetattr(tty_fd[i], &raw);
+		cfmakeraw(&raw);
+		tcsetattr(tty_fd[i], TCSANOW, &raw);
+		fcntl(master_fd[i], F_SETFL, fcntl(master_fd[i], F_GETFL) | O_NONBLOCK);
+	}
+	for (int i = 0; i < num_nodes; ++i) {
+		pids[i] = fork();
+		if (pids[i] == 0) {
+			close(reports[0]);
+			report_fd = reports[1];
+			control_fd = controls[i][0];
+			for (int j = 0; j < num_nodes; ++j) {
+				close(master_fd[j]);
+				close(controls[j][1]);
+				if (j != i) {
+					close(tty_fd[j]);
+					close(controls[j][0]);
+				}
+			}
+			runNode(i, tty_fd[i], is_synced);
+			_exit(0);
+		}
+	}
+	close(reports[1]);
+	for (int i = 0; i < num_nodes; ++i) {
+		close(tty_fd[i]);
+		close(controls[i][0]);
+	}
+	
+	// steps of the wall: relays the line of the master, lets every node run to the wall time, collects the events
+	std::map<int64_t, int64_t> frames[num_nodes];
+	std::vector<int64_t> scans[num_nodes];
+	Event done[num_nodes];
+	int finished = 0;
+	for (int64_t time = 0; finished < num_nodes; time += step_us) {
+		uint8_t buffer[256];
+		ssize_t length;
+		while ((length = read(master_fd[0], buffer, sizeof(buffer))) > 0) {
+			for (int i = 1; i < num_nodes; ++i) {
+				if (write(master_fd[i], buffer, length) != length) {
+					fprintf(stderr, "relay to node %d lost bytes\n", i);
+				}
+			}
+		}
+		const int64_t next = (time <= run_ms * 1000) ? time : -1;
+		for (int i = 0; i < num_nodes; ++i) {
+			if (write(controls[i][1], &next, sizeof(next)) != sizeof(next)) {
+				return false;
+			}
+		}
+		for (int waiting = num_nodes; waiting > 0; ) {
+			Event event;
+			if (read(reports[0], &event, sizeof(event)) != sizeof(event)) {
+				return false;
+			}
+			if (event.type == FRAME) {
+				frames[event.node][event.value] = event.time;
+			} else if (event.type == SCAN) {
+				scans[event.node].push_back(event.time);
+			} else if (event.type == STEP) {
+				waiting -= 1;
+			} else {
+				done[event.node] = event;
+				finished += 1;
+				waiting -= 1;
+			}
+		}
+	}
+	for (int i = 0; i < num_nodes; ++i) {
+		waitpid(pids[i], nullptr, 0);
+		close(master_fd[i]);
+		close(controls[i][1]);
+	}
+	close(reports[0]);
+	
+	// frames and scans after settling, against the master
+	const int64_t from = settle_ms * 1000;
+	const int64_t period = scans[0].size() > 1 ? (scans[0].back() - scans[0].front()) / (int64_t)(scans[0].size() - 1) : 1;
+	bool ok = true;
+	printf("%s\n", is_synced ? "synchronized" : "free running");
+	for (int i = 1; i < num_nodes; ++i) {
+		double frame_max = 0, frame_last = 0, scan_max = 0, scan_sum = 0;
+		long compared = 0, scans_compared = 0;
+		for (const auto &frame : frames[i]) {
+			auto master = frames[0].find(frame.first);
+			if (master == frames[0].end() || frame.second < from) {
+				continue;
+			}
+			const double skew = (frame.second - master->second) / 1e3;
+			frame_last = skew;
+			if (skew > frame_max || -skew > frame_max) {
+				frame_max = (skew > 0) ? skew : -skew;
+			}
+			compared += 1;
+		}
+		size_t m = 0;
+		for (int64_t scan : scans[i]) {
+			if (scan < from) {
+				continue;
+			}
+			while (m + 1 < scans[0].size() && scans[0][m + 1] <= scan) {
+				m += 1;
+			}
+			int64_t skew = scan - scans[0][m];
+			if (m + 1 < scans[0].size() && scans[0][m + 1] - scan < skew) {
+				skew = scans[0][m + 1] - scan;
+			}
+			scan_sum += skew;
+			scan_max = (skew > scan_max) ? skew : scan_max;
+			scans_compared += 1;
+		}
+		const double scan_mean = scans_compared > 0 ? scan_sum / scans_compared : 0;
+		const bool node_ok = compared > 0 && frame_max < frame_ms && scan_max * 4 < period;
+		printf("  node %d (%+5ld ppm, load %lu-%lu ms): frames %+7.1f ms now, at most %6.1f ms apart (%ld frames); scans %6.0f us apart on average, at most %6.0f us (period %.0f us)",
+			i, node_ppm[i], node_work_us[i] / 1000, (node_work_us[i] + node_spread_us[i]) / 1000, frame_last, frame_max, compared, scan_mean, scan_max, (double)period);
+		if (is_synced) {
+			printf(", packets %lld used / %lld read late / %lld corrupted%s",
+				(long long)done[i].accepted, (long long)done[i].rejected, (long long)done[i].corrupted, node_ok ? "" : "  FAILED");
+			ok &= node_ok;
+		}
+		printf("\n");
+	}
+	return ok;
+}
+
+int main()
+{
+	signal(SIGPIPE, SIG_IGN);
+	printf("%d cubes, a frame every %lu ms, %lld s (the first %lld s not measured)\n",
+		num_nodes, frame_ms, (long long)run_ms / 1000, (long long)settle_ms / 1000);
+	runWall(false);
+	const bool ok = runWall(true);
+	printf("%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
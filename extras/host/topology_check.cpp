@@ -0,0 +1,255 @@
+/* Checks the topologies of LedCube (LedCubeTopology in LedCube.h) exhaustively for a set of wirings:
+ * - every voxel lights exactly one cell of the map, all cells are used (the mapping is a bijection)
+ * - the cell is the one given by the description (and by the former formula for the default wirings)
+ * - refreshing the cube (update()) with one voxel lit turns on exactly its layer pin and column pin together
+ * - the scan order contains every layer once; mean distance of consecutive layers, sequential against interleaved
+ * - setTopology() refuses descriptions which do not fit the numbers of layers and columns
+ * - time of turnOn() through the lookup tables against the former formula
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. topology_check.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp -o topology_check
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "LedCube.h"
+
+static const int max_layers = 32;
+static const int max_columns = 128;
+
+int map_cells[max_layers][max_columns];
+int * p_map[max_layers];
+int layer_pins[max_layers];
+int column_pins[max_columns];
+
+// pins as seen by the digitalWrite hook (layer pins are 200 + i, column pins i)
+static uint8_t pin_state[256];
+static int num_column_pins;
+static std::vector<std::pair<int, int> > lit; // (layer, column) pairs on at the same time
+
+static void onDigitalWrite(uint8_t pin, uint8_t value)
+{
+	pin_state[pin] = value;
+	if (pin >= 200 && value == HIGH) {
+		for (int c = 0; c < num_column_pins; ++c) {
+			if (pin_state[c] == HIGH) {
+				lit.push_back(std::make_pair(pin - 200, c));
+			}
+		}
+	}
+}
+
+struct Wiring
+{
+	const char * name;
+	int size;
+	int num_layers;
+	int num_columns;
+	bool is_default; // created by the constructor, compared with the former formula as well
+	LedCubeTopology topology;
+};
+
+// the description, directly
+static void expected(const Wiring &w, int x, int y, int z, int &layer, int &column)
+{
+	const LedCubeTopology &t = w.topology;
+	const int width = w.size / t.x_groups, depth = w.size / t.y_groups, height = w.size / t.z_groups;
+	const int blocks = t.x_groups * t.y_groups;
+	const int block = x / width + (y / depth) * t.x_groups;
+	const int row = y % depth;
+	const int position = (t.serpentine && row % 2) ? width - 1 - x % width : x % width;
+	const int level = z % height;
+	
+	column = position + row * width + (z / height) * width * depth;
+	layer = t.interleave_blocks ? level * blocks + block : level + block * height;
+	if (t.column_order) {
+		column = t.column_order[column];
+	}
+	if (t.layer_order) {
+		layer = t.layer_order[layer];
+	}
+}
+
+// LedCube::_mapPosition before the topologies
+static void formerFormula(const Wiring &w, int x, int y, int z, int &layer, int &column)
+{
+	if (w.size != w.num_layers) {
+		const int num_splits = w.size / (w.num_columns / w.size);
+		layer = (z + y / num_splits * w.size) % w.num_layers;
+	} else {
+		layer = z % w.num_layers;
+	}
+	column = (x + y * w.size) % w.num_columns;
+}
+
+static bool check(const Wiring &w)
+{
+	for (int l = 0; l < max_layers; ++l) {
+		p_map[l] = map_cells[l];
+		layer_pins[l] = 200 + l;
+	}
+	for (int c = 0; c < max_columns; ++c) {
+		column_pins[c] = c;
+	}
+	memset(pin_state, LOW, sizeof(pin_state));
+	num_column_pins = w.num_columns;
+	LedCube led_cube(p_map, layer_pins, column_pins, w.num_layers, w.num_columns, w.size, 60);
+	if (!w.is_default && !led_cube.setTopology(w.topology)) {
+		printf("%-44s REFUSED\n", w.name);
+		return false;
+	}
+	
+	unsigned long wrong_cell = 0, wrong_former = 0, reused = 0, wrong_pins = 0;
+	std::vector<int> used(w.num_layers * w.num_columns, 0);
+	for (int z = 0; z < w.size; ++z) {
+		for (int y = 0; y < w.size; ++y) {
+			for (int x = 0; x < w.size; ++x) {
+				led_cube.turnEverythingOff();
+				led_cube.turnOn(x, y, z);
+				int cells = 0, layer = -1, column = -1;
+				for (int l = 0; l < w.num_layers; ++l) {
+					for (int c = 0; c < w.num_columns; ++c) {
+						if (map_cells[l][c]) {
+							cells += 1;
+							layer = l;
+							column = c;
+						}
+					}
+				}
+				int expected_layer, expected_column;
+				expected(w, x, y, z, expected_layer, expected_column);
+				if (cells != 1 || layer != expected_layer || column != expected_column) {
+					wrong_cell += 1;
+				}
+				if (w.is_default) {
+					formerFormula(w, x, y, z, expected_layer, expected_column);
+					if (layer != expected_layer || column != expected_column) {
+						wrong_former += 1;
+					}
+				}
+				if (cells == 1 && used[layer * w.num_columns + column]++ != 0) {
+					reused += 1;
+				}
+				
+				// the refresh
+				lit.clear();
+				hostSetDigitalWriteHook(onDigitalWrite);
+				led_cube.update();
+				hostSetDigitalWriteHook(nullptr);
+				if (lit.size() != 1 || lit[0].first != layer || lit[0].second != column) {
+					wrong_pins += 1;
+				}
+			}
+		}
+	}
+	unsigned long unused = 0;
+	for (size_t i = 0; i < used.size(); ++i) {
+		unused += (used[i] == 0);
+	}
+	
+	// scan order: distance of consecutive layers in the cube (z and blocks), sequential order for comparison
+	std::vector<int> scanned(w.num_layers, 0);
+	std::vector<int> level_of(w.num_layers), block_of(w.num_layers);
+	for (int z = 0; z < w.size; ++z) {
+		for (int y = 0; y < w.size; ++y) {
+			for (int x = 0; x < w.size; ++x) {
+				int layer, column;
+				expected(w, x, y, z, layer, column);
+				level_of[layer] = z % (w.size / w.topology.z_groups);
+				block_of[layer] = x / (w.size / w.topology.x_groups) + (y / (w.size / w.topology.y_groups)) * w.topology.x_groups;
+			}
+		}
+	}
+	bool permutation = true;
+	double interleaved = 0, sequential = 0;
+	for (int slot = 0; slot < w.num_layers; ++slot) {
+		const int layer = led_cube.getScanLayer(slot);
+		permutation &= layer >= 0 && layer < w.num_layers && scanned[layer]++ == 0;
+		const int next = led_cube.getScanLayer((slot + 1) % w.num_layers);
+		interleaved += abs(level_of[layer] - level_of[next]) + (block_of[layer] != block_of[next]);
+		sequential += abs(level_of[slot] - level_of[(slot + 1) % w.num_layers]) + (block_of[slot] != block_of[(slot + 1) % w.num_layers]);
+	}
+	
+	// turnOn of all voxels
+	const int repeats = 20000;
+	volatile int sink = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeats; ++r) {
+		for (int z = 0; z < w.size; ++z) {
+			for (int y = 0; y < w.size; ++y) {
+				for (int x = 0; x < w.size; ++x) {
+					led_cube.turnOn(x, y, z);
+				}
+			}
+		}
+	}
+	const int voxels = w.size * w.size * w.size;
+	const double lut_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / repeats / voxels;
+	start = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeats && w.is_default; ++r) {
+		for (int z = 0; z < w.size; ++z) {
+			for (int y = 0; y < w.size; ++y) {
+				for (int x = 0; x < w.size; ++x) {
+					int layer, column;
+					formerFormula(w, x, y, z, layer, column);
+					map_cells[layer][column] = HIGH;
+					sink += layer;
+				}
+			}
+		}
+	}
+	const double former_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / repeats / voxels;
+	
+	const bool ok = wrong_cell == 0 && wrong_former == 0 && reused == 0 && unused == 0 && wrong_pins == 0 && permutation;
+	printf("%-44s %4d voxels: %s  (cells %lu wrong, %lu reused, %lu unused, former formula %lu differ, refresh %lu wrong)\n",
+		w.name, voxels, ok ? "OK" : "WRONG", wrong_cell, reused, unused, wrong_former, wrong_pins);
+	printf("%-44s scan order %s, mean distance of consecutive layers %.2f (sequential %.2f), turnOn %.1f ns",
+		"", permutation ? "complete" : "BROKEN", interleaved / w.num_layers, sequential / w.num_layers, lut_ns);
+	if (w.is_default) {
+		printf(" (former formula %.1f ns)", former_ns);
+	}
+	printf("\n");
+	return ok;
+}
+
+int main()
+{
+	static const uint8_t reversed_layers[4] = {3, 2, 1, 0};
+	static uint8_t shuffled_columns[16];
+	for (int i = 0; i < 16; ++i) {
+		shuffled_columns[i] = (i * 7 + 3) % 16;
+	}
+	static const uint8_t swapped_layers[8] = {1, 0, 3, 2, 5, 4, 7, 6};
+	
+	const Wiring wirings[] = {
+		{"4x4x4, 4 layers x 16 columns (default)", 4, 4, 16, true, LedCubeTopology()},
+		{"4x4x4, 8 layers x 8 columns (default)", 4, 8, 8, true, LedCubeTopology(1, 2)},
+		{"8x8x8, 8 layers x 64 columns (default)", 8, 8, 64, true, LedCubeTopology()},
+		{"4x4x4, 8 x 8, split by y, interleaved blocks", 4, 8, 8, false, LedCubeTopology(1, 2, 1, true)},
+		{"4x4x4, 8 x 8, split by x, serpentine", 4, 8, 8, false, LedCubeTopology(2, 1, 1, false, true)},
+		{"4x4x4, 8 x 8, swapped layer pins", 4, 8, 8, false, LedCubeTopology(1, 2, 1, false, false, true, swapped_layers)},
+		{"4x4x4, 4 x 16, permuted pins, serpentine", 4, 4, 16, false, LedCubeTopology(1, 1, 1, false, true, true, reversed_layers, shuffled_columns)},
+		{"4x4x4, 2 layers x 32 columns (height split)", 4, 2, 32, false, LedCubeTopology(1, 1, 2)},
+		{"8x8x8, 32 layers x 16 columns (2x2 blocks)", 8, 32, 16, false, LedCubeTopology(2, 2, 1, false, true)},
+		{"8x8x8, 4 layers x 128 columns (height split)", 8, 4, 128, false, LedCubeTopology(1, 1, 2)},
+		{"8x8x8, 8 x 64, blocks + height, sequential", 8, 8, 64, false, LedCubeTopology(2, 1, 2, true, false, false)},
+	};
+	
+	bool ok = true;
+	for (const Wiring &w : wirings) {
+		ok &= check(w);
+	}
+	
+	// descriptions which do not fit are refused
+	LedCube led_cube(p_map, layer_pins, column_pins, 8, 8, 4, 60);
+	const bool refused = !led_cube.setTopology(LedCubeTopology(2, 2)) && !led_cube.setTopology(LedCubeTopology(3, 1))
+		&& !led_cube.setTopology(LedCubeTopology(1, 1, 0)) && led_cube.setTopology(LedCubeTopology(2, 1));
+	printf("wrong descriptions refused: %s\n", refused ? "OK" : "WRONG");
+	ok &= refused;
+	
+	printf("%s\n", ok ? "ALL OK" : "FAILED");
+	return ok ? 0 : 1;
+}
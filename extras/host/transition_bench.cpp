@@ -0,0 +1,220 @@
+/* Checks sequences::Transition (LedCubeTransition.h) on host cubes 4x4x4 and 8x8x8:
+ * - dissolve from everything off to everything on lights the LEDs one by one (never turns one off) and ends fully on
+ * - crossfade lights on average the part of the LEDs given by the progress
+ * - after the transition the frames and the total time are the ones of the second sequence played alone
+ * - time of one frame of the transition (two sequences + blending) and the memory of the frames
+ * - rows of LedCubeFrame (getRow()/setRow()) match its LEDs for the sizes 1 to 16
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. transition_bench.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp -o transition_bench
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "LedCube.h"
+#include "LedCubeTransition.h"
+
+int map_4[8][8];
+int * p_map_4[8] = {map_4[0], map_4[1], map_4[2], map_4[3], map_4[4], map_4[5], map_4[6], map_4[7]};
+int layer_4[8] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column_4[8] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+int map_8[8][64];
+int * p_map_8[8] = {map_8[0], map_8[1], map_8[2], map_8[3], map_8[4], map_8[5], map_8[6], map_8[7]};
+int layer_8[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+int column_8[64];
+
+static int countOn(LedCube &led_cube)
+{
+	int on = 0;
+	const int size = led_cube.getSize();
+	
+	for (int z = 0; z < size; ++z) {
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				on += led_cube.getState(x, y, z);
+			}
+		}
+	}
+	return on;
+}
+
+// FNV-1a of the frame
+static unsigned long hashFrame(LedCube &led_cube)
+{
+	unsigned long hash = 2166136261UL;
+	const int size = led_cube.getSize();
+	
+	for (int z = 0; z < size; ++z) {
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				hash = (hash ^ led_cube.getState(x, y, z)) * 16777619UL;
+			}
+		}
+	}
+	return hash;
+}
+
+static bool checkFade(LedCube &led_cube, transition::Mode mode)
+{
+	const unsigned long duration = 2000, step = 10;
+	const int leds = led_cube.getSize() * led_cube.getSize() * led_cube.getSize();
+	bool ok = true;
+	
+	led_cube.turnEverythingOff();
+	sequences::Transition fade(&led_cube, nullptr, new sequences::TurnEverythingOn(&led_cube), duration, mode, step);
+	int last_on = 0;
+	unsigned long time = 0, wait;
+	long window_on = 0, window_expected = 0;
+	double max_error = 0;
+	while ((wait = fade()) != 0) {
+		const int on = countOn(led_cube);
+		if (mode == transition::DISSOLVE && on < last_on) {
+			ok = false;
+		}
+		if (time < duration) {
+			window_on += on;
+			window_expected += (long)leds * (time * 256 / duration) / 256;
+			if ((time / step) % 20 == 19) {
+				// 200 ms window
+				const double error = (double)(window_on - window_expected) / (20 * leds);
+				if (error > max_error || -error > max_error) {
+					max_error = (error > 0) ? error : -error;
+				}
+				window_on = 0;
+				window_expected = 0;
+			}
+		}
+		last_on = on;
+		time += wait;
+	}
+	if (last_on != leds) {
+		ok = false;
+	}
+	printf("  %-9s off -> on in %lu ms: %s, ends with %d of %d LEDs, largest difference from the progress %.1f %% of the LEDs (200 ms windows)\n",
+		(mode == transition::DISSOLVE) ? "dissolve" : "crossfade", duration, ok ? "monotonic" : "NOT MONOTONIC", last_on, leds, 100 * max_error);
+	return ok && (mode == transition::DISSOLVE || max_error < 0.1);
+}
+
+// frames of the sequence alone from the current content of the cube: hash and end time of every frame
+static std::vector<std::pair<unsigned long, unsigned long> > playAlone(LedCube &led_cube, LedCubeSequence * sequence)
+{
+	std::vector<std::pair<unsigned long, unsigned long> > frames;
+	unsigned long time = 0, wait;
+	
+	while ((wait = (*sequence)()) != 0) {
+		time += wait;
+		frames.push_back(std::make_pair(hashFrame(led_cube), time));
+	}
+	delete sequence;
+	return frames;
+}
+
+static bool checkHandover(LedCube &led_cube, transition::Mode mode)
+{
+	const unsigned long duration = 600;
+	
+	randomSeed(1);
+	led_cube.turnEverythingOff();
+	std::vector<std::pair<unsigned long, unsigned long> > alone = playAlone(led_cube, new sequences::LayerStompUpAndDown(&led_cube));
+	
+	led_cube.turnEverythingOff();
+	sequences::Transition transition(&led_cube, new sequences::Propeller(&led_cube), new sequences::LayerStompUpAndDown(&led_cube), duration, mode);
+	unsigned long time = 0, wait;
+	size_t matched = 0, compared = 0;
+	size_t next = 0;
+	while ((wait = transition()) != 0) {
+		time += wait;
+		if (time > duration) {
+			// frames of the sequence alone which end at the same time
+			while (next < alone.size() && alone[next].second < time) {
+				next += 1;
+			}
+			compared += 1;
+			if (next < alone.size() && alone[next].second == time && alone[next].first == hashFrame(led_cube)) {
+				matched += 1;
+			}
+		}
+	}
+	const bool ok = compared > 0 && matched == compared && time == alone.back().second;
+	printf("  %-9s Propeller -> LayerStompUpAndDown: %zu of %zu frames after the transition match, total %lu ms (alone %lu ms)\n",
+		(mode == transition::DISSOLVE) ? "dissolve" : "crossfade", matched, compared, time, alone.back().second);
+	return ok;
+}
+
+static void timeFrames(LedCube &led_cube, transition::Mode mode)
+{
+	const int repeats = 2000;
+	unsigned long frames = 0;
+	
+	randomSeed(1);
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeats; ++r) {
+		led_cube.turnEverythingOff();
+		// only the frames of the transition (the duration is shorter than the sequences)
+		sequences::Transition transition(&led_cube, new sequences::RandomRain(&led_cube, 20), new sequences::MatrixRain(&led_cube, 20), 400, mode, 10);
+		for (int i = 0; i < 40; ++i) {
+			transition();
+			frames += 1;
+		}
+	}
+	const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / frames;
+	printf("  %-9s RandomRain -> MatrixRain: %.0f ns per frame, sequences::Transition %zu B + 2 x %d B of frames\n",
+		(mode == transition::DISSOLVE) ? "dissolve" : "crossfade", ns, sizeof(sequences::Transition), LedCubeFrame(led_cube.getSize()).getBytes());
+}
+
+static bool checkRows()
+{
+	// random rows written one by one, then every LED and every row read back
+	bool ok = true;
+	
+	for (int size = 1; size <= 16; ++size) {
+		LedCubeFrame frame(size);
+		std::vector<uint16_t> rows(size * size);
+		
+		randomSeed(size);
+		for (int i = 0; i < size * size; ++i) {
+			rows[i] = random(0x10000L) & ((1UL << size) - 1);
+			frame.setRow(i % size, i / size, rows[i]);
+		}
+		for (int i = 0; i < size * size; ++i) {
+			for (int x = 0; x < size; ++x) {
+				ok &= frame.getState(x, i % size, i / size) == ((rows[i] >> x) & 1);
+			}
+			ok &= frame.getRow(i % size, i / size) == rows[i];
+		}
+	}
+	printf("rows of the frames 1..16: %s\n", ok ? "ok" : "WRONG");
+	return ok;
+}
+
+static bool check(const char * name, LedCube &led_cube)
+{
+	bool ok = true;
+	
+	printf("%s\n", name);
+	ok &= checkFade(led_cube, transition::DISSOLVE);
+	ok &= checkFade(led_cube, transition::CROSSFADE);
+	ok &= checkHandover(led_cube, transition::DISSOLVE);
+	ok &= checkHandover(led_cube, transition::CROSSFADE);
+	timeFrames(led_cube, transition::DISSOLVE);
+	timeFrames(led_cube, transition::CROSSFADE);
+	return ok;
+}
+
+int main()
+{
+	for (int i = 0; i < 64; ++i) {
+		column_8[i] = i;
+	}
+	LedCube led_cube_4(p_map_4, layer_4, column_4, 8, 8, 4, 60);
+	LedCube led_cube_8(p_map_8, layer_8, column_8, 8, 64, 8, 60);
+	
+	bool ok = checkRows();
+	ok &= check("4x4x4", led_cube_4);
+	ok &= check("8x8x8", led_cube_8);
+	printf("%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
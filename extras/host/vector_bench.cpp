@@ -0,0 +1,170 @@
+/* Checks and measures the fixed-point wireframe rendering (LedCubeVector.h):
+ * - vector3d::sin()/cos() against the exact values for all 256 angles
+ * - the projected points of the meshes for many rotations against the same rotation in doubles rounded to LEDs
+ *   (a point may differ by one LED only where the exact value is within 0.05 LED of a half)
+ * - the time of a frame (projecting, erasing and drawing the edges) for meshes of 8 to 255 points on 8x8x8
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. vector_bench.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeVector.cpp -o vector_bench
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "LedCube.h"
+#include "LedCubeVector.h"
+
+int map_8[8][64];
+int * p_map_8[8] = {map_8[0], map_8[1], map_8[2], map_8[3], map_8[4], map_8[5], map_8[6], map_8[7]};
+int layer_8[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+int column_8[64];
+
+int map_4[8][8];
+int * p_map_4[8] = {map_4[0], map_4[1], map_4[2], map_4[3], map_4[4], map_4[5], map_4[6], map_4[7]};
+int layer_4[8] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column_4[8] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+static double nowNs()
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool checkTable()
+{
+	double worst = 0;
+	
+	for (int angle = 0; angle < 256; ++angle) {
+		const double a = angle * 2 * M_PI / 256;
+		const double error_sin = fabs(vector3d::sin(angle) / 16384.0 - ::sin(a));
+		const double error_cos = fabs(vector3d::cos(angle) / 16384.0 - ::cos(a));
+		
+		worst = (error_sin > worst) ? error_sin : worst;
+		worst = (error_cos > worst) ? error_cos : worst;
+	}
+	const bool ok = worst < 1.0 / 16384;
+	printf("sin/cos table: largest error %.7f (Q14 step %.7f)%s\n", worst, 1.0 / 16384, ok ? "" : "  FAILED");
+	return ok;
+}
+
+// points of the mesh rotated in doubles: the same order of rotations (x, y, z) and the same pivot and scale
+static bool checkMesh(LedCube &led_cube, const char * name, const LedCubeMesh &mesh)
+{
+	const int size = led_cube.getSize();
+	const double pivot = (size - 1) / 2.0;
+	const double scale = (size - 1) * 128 / 256.0 / 64.0;
+	LedCubeWireframe wireframe(&led_cube, &mesh);
+	long points = 0, borderline = 0, wrong = 0;
+	
+	for (int ax = 0; ax < 256; ax += 7) {
+		for (int ay = 0; ay < 256; ay += 11) {
+			for (int az = 0; az < 256; az += 13) {
+				const double sx = ::sin(ax * 2 * M_PI / 256), cx = ::cos(ax * 2 * M_PI / 256);
+				const double sy = ::sin(ay * 2 * M_PI / 256), cy = ::cos(ay * 2 * M_PI / 256);
+				const double sz = ::sin(az * 2 * M_PI / 256), cz = ::cos(az * 2 * M_PI / 256);
+				
+				wireframe.setRotation(ax, ay, az);
+				wireframe.transform();
+				for (int i = 0; i < mesh.num_points; ++i) {
+					const double px = mesh.points[i][0], py = mesh.points[i][1], pz = mesh.points[i][2];
+					// around x, then y, then z
+					const double y1 = cx * py - sx * pz, z1 = sx * py + cx * pz;
+					const double x2 = cy * px + sy * z1, z2 = -sy * px + cy * z1;
+					const double x3 = cz * x2 - sz * y1, y3 = sz * x2 + cz * y1;
+					const double exact[3] = {pivot + scale * x3, pivot + scale * y3, pivot + scale * z2};
+					int led[3];
+					
+					wireframe.getPoint(i, led[0], led[1], led[2]);
+					for (int axis = 0; axis < 3; ++axis) {
+						const double rounded = floor(exact[axis] + 0.5);
+						const double from_half = fabs(exact[axis] - floor(exact[axis]) - 0.5);
+						
+						if (led[axis] == rounded) {
+							continue;
+						}
+						if (fabs(led[axis] - rounded) == 1 && from_half < 0.05) {
+							borderline += 1;
+						} else {
+							wrong += 1;
+						}
+					}
+					points += 1;
+				}
+			}
+		}
+	}
+	const bool ok = wrong == 0;
+	printf("%dx%dx%d %-11s %7ld points: %4ld coordinates off by one at a half, %ld wrong%s\n",
+		size, size, size, name, points, borderline, wrong, ok ? "" : "  FAILED");
+	return ok;
+}
+
+// points spread over a sphere (Fibonacci lattice), edges join every point with the next one
+static void makeSphere(int count, std::vector<int8_t> &points, std::vector<uint8_t> &edges)
+{
+	points.resize(count * 3);
+	edges.resize(count * 2);
+	for (int i = 0; i < count; ++i) {
+		const double z = 1 - (2.0 * i + 1) / count;
+		const double r = sqrt(1 - z * z);
+		const double phi = i * M_PI * (3 - sqrt(5.0));
+		
+		points[i * 3] = (int8_t)lround(64 * r * ::cos(phi));
+		points[i * 3 + 1] = (int8_t)lround(64 * r * ::sin(phi));
+		points[i * 3 + 2] = (int8_t)lround(64 * z);
+		edges[i * 2] = i;
+		edges[i * 2 + 1] = (i + 1) % count;
+	}
+}
+
+static void measure(LedCube &led_cube, const char * name, const LedCubeMesh &mesh)
+{
+	const int frames = 2000;
+	LedCubeWireframe wireframe(&led_cube, &mesh);
+	double transform_ns = 0, frame_ns = 0;
+	
+	led_cube.turnEverythingOff();
+	for (int i = 0; i < frames; ++i) {
+		double start = nowNs();
+		wireframe.transform();
+		transform_ns += nowNs() - start;
+		start = nowNs();
+		wireframe.draw();
+		frame_ns += nowNs() - start;
+		wireframe.rotate(2, 3, 1);
+	}
+	printf("%-11s %3d points %3d edges  %7.0f ns  %5.1f ns/point  %8.0f ns per frame\n",
+		name, mesh.num_points, mesh.num_edges, transform_ns / frames, transform_ns / frames / mesh.num_points, frame_ns / frames);
+}
+
+int main()
+{
+	bool ok = true;
+	LedCube cube_4(p_map_4, layer_4, column_4, 8, 8, 4, 60);
+	LedCube cube_8(p_map_8, layer_8, column_8, 8, 64, 8, 60);
+	
+	ok &= checkTable();
+	ok &= checkMesh(cube_4, "cube", meshes::cube);
+	ok &= checkMesh(cube_4, "star", meshes::star);
+	ok &= checkMesh(cube_8, "cube", meshes::cube);
+	ok &= checkMesh(cube_8, "octahedron", meshes::octahedron);
+	ok &= checkMesh(cube_8, "star", meshes::star);
+	
+	printf("\n8x8x8, rotating by (2, 3, 1)/256 of a turn per frame: projecting, and the whole frame (erase, project, draw)\n");
+	measure(cube_8, "cube", meshes::cube);
+	measure(cube_8, "octahedron", meshes::octahedron);
+	measure(cube_8, "star", meshes::star);
+	const int counts[] = {32, 64, 128, 255};
+	for (int count : counts) {
+		std::vector<int8_t> points;
+		std::vector<uint8_t> edges;
+		char name[16];
+		
+		makeSphere(count, points, edges);
+		const LedCubeMesh sphere = {(const int8_t (*)[3])points.data(), (uint8_t)count, (const uint8_t (*)[2])edges.data(), (uint8_t)count};
+		snprintf(name, sizeof(name), "sphere %d", count);
+		measure(cube_8, name, sphere);
+	}
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
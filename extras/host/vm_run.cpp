@@ -0,0 +1,211 @@
+/* Runs a program for sequences::Program (LedCubeVM.h) assembled by lcasm.py on a host cube:
+ * - prints every frame (layers from the top, 'o' = on) with its wait, or only a summary with -q
+ * - --frames N stops endless programs after N frames (default 1000)
+ * - --storage ram|progmem|eeprom selects how the program is read (eeprom: copied into the host EEPROM first)
+ * - --compare-layer-stomp checks that the program shows the same frames as sequences::LayerStompUpAndDown
+ *   and compares the time per frame of both (the fastest of 100 rounds each), fails when the bytecode is more than 10 %
+ *   slower
+ *
+ * Build (in extras/host):
+ *   g++ -std=gnu++11 -O2 -I. -I../.. vm_run.cpp Arduino.cpp VariableTimedAction.cpp ../../LedCube.cpp ../../LedCubeRaster.cpp ../../LedCubeTimeline.cpp ../../LedCubeTransition.cpp ../../LedCubeVM.cpp -o vm_run
+ * Example:
+ *   ./lcasm.py ../../examples/Bytecode/layer_stomp.lcasm -o layer_stomp.bin && ./vm_run layer_stomp.bin --compare-layer-stomp
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <avr/eeprom.h>
+
+#include "LedCube.h"
+#include "LedCubeVM.h"
+
+static const int size = 4;
+static const int num_layers = 8;
+static const int num_columns = 8;
+int led_cube_map[num_layers][num_columns];
+int * p_led_cube_map[num_layers] = {
+	led_cube_map[0], led_cube_map[1], led_cube_map[2], led_cube_map[3],
+	led_cube_map[4], led_cube_map[5], led_cube_map[6], led_cube_map[7]
+};
+int layer[num_layers] = {2, 3, 4, 5, 6, 7, 8, 9};
+int column[num_columns] = {10, 11, 12, 13, A0, A1, A2, A3};
+
+LedCube led_cube(p_led_cube_map, layer, column, num_layers, num_columns, size, 60);
+
+static const double max_overhead = 10; // [%] of the bytecode against the native sequence
+
+std::vector<uint8_t> code;
+vm::Storage storage = vm::FROM_RAM;
+
+static void printFrame(unsigned long frame, unsigned long wait)
+{
+	printf("frame %lu, wait %lu ms\n", frame, wait);
+	for (int z = size-1; z >= 0; --z) {
+		for (int y = size-1; y >= 0; --y) {
+			printf("  ");
+			for (int x = 0; x < size; ++x) {
+				putchar(led_cube.getState(x, y, z) ? 'o' : '.');
+			}
+		}
+		printf("    z=%d\n", z);
+	}
+}
+
+// FNV-1a of all frames and waits
+struct Run
+{
+	unsigned long frames; // including the last call returning 0
+	unsigned long shown; // frames with a wait
+	unsigned long hash;
+	double ns_per_frame;
+};
+
+static Run play(LedCubeSequence * (*create)(), int repeats, bool print, unsigned long max_frames=0)
+{
+	Run run = {0, 0, 2166136261UL, 0};
+	
+	// the first run is checked, the others are timed as a whole
+	LedCubeSequence * sequence = create();
+	led_cube.turnEverythingOff();
+	unsigned long wait;
+	do {
+		wait = (*sequence)();
+		run.frames += 1;
+		run.hash = (run.hash ^ wait) * 16777619UL;
+		for (int l = 0; l < num_layers; ++l) {
+			for (int c = 0; c < num_columns; ++c) {
+				run.hash = (run.hash ^ led_cube_map[l][c]) * 16777619UL;
+			}
+		}
+		if (wait != 0) {
+			run.shown += 1;
+			if (print) {
+				printFrame(run.shown, wait);
+			}
+		}
+	} while (wait != 0 && run.shown != max_frames);
+	sequences::Program * program = dynamic_cast<sequences::Program *>(sequence);
+	if (program && program->getStatus() == vm::RUNNING) {
+		printf("stopped after %lu frames\n", run.shown);
+	} else if (program && program->getStatus() != vm::FINISHED) {
+		static const char * const names[] = {"RUNNING", "FINISHED", "BAD_OPCODE", "BAD_LOOP", "BAD_STORAGE"};
+		printf("error: %s at address %u\n", names[program->getStatus()], program->getAddress());
+	}
+	delete sequence;
+	
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeats; ++r) {
+		sequence = create();
+		while ((*sequence)() != 0) {}
+		delete sequence;
+	}
+	if (repeats == 0) {
+		return run;
+	}
+	run.ns_per_frame = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / repeats / run.frames;
+	return run;
+}
+
+static LedCubeSequence * createProgram()
+{
+	const uint8_t * address = code.data();
+	if (storage == vm::FROM_EEPROM) {
+		address = (const uint8_t *)0;
+	}
+	return new sequences::Program(&led_cube, address, storage);
+}
+
+static LedCubeSequence * createNative()
+{
+	return new sequences::LayerStompUpAndDown(&led_cube);
+}
+
+int main(int argc, char ** argv)
+{
+	const char * path = nullptr;
+	bool quiet = false;
+	bool compare = false;
+	unsigned long max_frames = 1000; // programs may loop forever
+	
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-q") == 0) {
+			quiet = true;
+		} else if (strcmp(argv[i], "--compare-layer-stomp") == 0) {
+			compare = true;
+		} else if (strcmp(argv[i], "--frames") == 0 && i+1 < argc) {
+			i += 1;
+			max_frames = strtoul(argv[i], nullptr, 0);
+		} else if (strcmp(argv[i], "--storage") == 0 && i+1 < argc) {
+			i += 1;
+			if (strcmp(argv[i], "progmem") == 0) {
+				storage = vm::FROM_PROGMEM;
+			} else if (strcmp(argv[i], "eeprom") == 0) {
+				storage = vm::FROM_EEPROM;
+			} else {
+				storage = vm::FROM_RAM;
+			}
+		} else {
+			path = argv[i];
+		}
+	}
+	if (!path) {
+		fprintf(stderr, "usage: %s program.bin [-q] [--frames N] [--storage ram|progmem|eeprom] [--compare-layer-stomp]\n", argv[0]);
+		return 2;
+	}
+	
+	FILE * f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		return 1;
+	}
+	int c;
+	while ((c = fgetc(f)) != EOF) {
+		code.push_back(c);
+	}
+	fclose(f);
+	
+	if (storage == vm::FROM_EEPROM) {
+		if (code.size() > E2END + 1) {
+			fprintf(stderr, "program does not fit into the EEPROM\n");
+			return 1;
+		}
+		for (size_t i = 0; i < code.size(); ++i) {
+			eeprom_update_byte((uint8_t *)i, code[i]);
+		}
+	}
+	
+	printf("program: %zu bytes, sequences::Program: %zu bytes of RAM\n", code.size(), sizeof(sequences::Program));
+	
+	if (!compare) {
+		Run run = play(createProgram, 0, !quiet, max_frames);
+		printf("%lu frames\n", run.shown);
+		return 0;
+	}
+	
+	// rounds of both in turn, the fastest round of each counts (other load of the host only slows rounds down)
+	const int rounds = 100;
+	const int repeats = 500;
+	Run native = play(createNative, repeats, false);
+	Run program = play(createProgram, repeats, !quiet);
+	for (int round = 1; round < rounds; ++round) {
+		native.ns_per_frame = std::min(native.ns_per_frame, play(createNative, repeats, false).ns_per_frame);
+		program.ns_per_frame = std::min(program.ns_per_frame, play(createProgram, repeats, false).ns_per_frame);
+	}
+	const double overhead = 100.0 * (program.ns_per_frame / native.ns_per_frame - 1);
+	printf("LayerStompUpAndDown native    %5lu frames  hash %08lx  %8.1f ns/frame\n", native.frames, native.hash, native.ns_per_frame);
+	printf("LayerStompUpAndDown bytecode  %5lu frames  hash %08lx  %8.1f ns/frame  (%+.1f ns, %+.1f %%)\n", program.frames, program.hash, program.ns_per_frame, program.ns_per_frame - native.ns_per_frame, overhead);
+	if (native.hash != program.hash || native.frames != program.frames) {
+		printf("DIFFERENT frames\n");
+		return 1;
+	}
+	if (overhead > max_overhead) {
+		printf("same frames, bytecode more than %.0f %% slower\n", max_overhead);
+		return 1;
+	}
+	printf("same frames\n");
+	return 0;
+}